@@ -0,0 +1,69 @@
+#ifndef ANALYSISSERVER_H
+#define ANALYSISSERVER_H
+
+#include <string>
+#include <map>
+#include <iostream>
+
+#include "MaterialResponse.h"
+
+class Tracker;
+class SimParms;
+class DetectorModule;
+
+namespace insur {
+  class Analyzer;
+  class MaterialBudget;
+
+  /**
+   * @class AnalysisServer
+   * @brief Answers queries on a tracker built once, over a local UNIX socket
+   *
+   * The tracker, its material budget and the analyses are kept in memory
+   * between the queries, so that each answer costs a few tracks instead of a
+   * full run. The protocol is line based: every request is one line of words
+   * separated by blanks, and every reply is zero or more lines of numbers
+   * separated by blanks, followed by a line "ok" or "error <message>".
+   * - material <eta> [<phi>]: radiation and interaction lengths crossed by a
+   *   straight track from the origin, beam pipe excluded; the services and
+   *   supports are those of the nearest point of an eta grid with steps of
+   *   0.001
+   * - resolution <eta> <pt> [<phi>]: one line per track tag and material
+   *   case, "<tag> real|ideal deltaPtOverPt deltaPOverP deltaD0 deltaZ0
+   *   deltaPhi deltaCtgTheta activeHits", for the tracks with 3 active hits or more
+   * - module <section> <layer> <ring> <phi> <side>: r z phi irradiationPower
+   *   hitChannels trueStubs fakeStubs of the module, rates per bunch crossing
+   * - help: the list of requests
+   * - quit: closes the connection
+   * - shutdown: closes the connection and stops the server
+   * Angles are in rad, lengths in mm, momenta in GeV/c and powers in W.
+   * Tracks only go towards z+, as the services and supports are only known
+   * there: a negative eta is an error.
+   * Clients are served one at a time, as the analyses are not thread safe.
+   * A client silent for a minute, or sending a line longer than 4096
+   * characters, is disconnected.
+   */
+  class AnalysisServer {
+  public:
+    AnalysisServer(Tracker& tracker, const SimParms& simParms, Analyzer& analyzer, MaterialBudget& mb, MaterialBudget* pm);
+    bool run(const std::string& socketPath);
+    bool answer(const std::string& request, std::ostream& reply);
+  private:
+    void serveClient(int client);
+    // each request writes its data lines and returns the error message, empty if there was none
+    std::string material(std::istream& arguments, std::ostream& reply);
+    std::string resolution(std::istream& arguments, std::ostream& reply);
+    std::string module(std::istream& arguments, std::ostream& reply);
+
+    Tracker& tracker_;
+    const SimParms& simParms_;
+    Analyzer& analyzer_;
+    MaterialBudget& mb_;
+    MaterialBudget* pm_;
+    MaterialResponse inactive_; // the crossings of the services and supports, which do not depend on phi
+    std::map<std::string, DetectorModule*> modules_; // by "section layer ring phi side"
+    bool stopping_;
+  };
+}
+
+#endif
@@ -22,6 +22,8 @@
 #include <hit.hh>
 #include <ModuleCap.h>
 #include <InactiveElement.h>
+#include <InactiveElementIndex.h>
+#include <MaterialResponse.h>
 #include <InactiveSurfaces.h>
 #include <MaterialBudget.h>
 #include <TCanvas.h>
@@ -40,6 +42,7 @@
 #include "Bag.h"
 #include "SummaryTable.h"
 #include "TagMaker.h"
+#include "ResultsExporter.h"
 
 
 
@@ -147,6 +150,8 @@ namespace insur {
     const double& getTriggerRangeLowLimit(const std::string& typeName ) { return triggerRangeLowLimit[typeName] ; }
     const double& getTriggerRangeHighLimit(const std::string& typeName ) { return triggerRangeHighLimit[typeName] ; }
     /*virtual*/ void analyzeMaterialBudget(MaterialBudget& mb, const std::vector<double>& momenta, int etaSteps = 50, MaterialBudget* pm = NULL);
+    // the tracks of the material and resolution scans are also written to the exporter, if one is given
+    void setResultsExporter(ResultsExporter* exporter, const std::string& detector) { resultsExporter_ = exporter; resultsDetector_ = detector; }
     void computeTriggerProcessorsBandwidth(Tracker& tracker);
     void analyzeTaggedTracking(MaterialBudget& mb,
                                const std::vector<double>& momenta,
@@ -156,6 +161,9 @@ namespace insur {
 			       bool& debugResolution,
                                int etaSteps = 50,
                                MaterialBudget* pm = NULL);
+    // the single track steps of analyzeTaggedTracking(), also used to answer queries on one track
+    Material shootTrack(MaterialBudget& mb, MaterialBudget* pm, double eta, double phi, Track& track, const MaterialResponse* inactive = NULL);
+    void prepareTaggedTrack(Track& track, const std::string& tag);
     virtual void analyzeTriggerEfficiency(Tracker& tracker,
                                           const std::vector<double>& triggerMomenta,
                                           const std::vector<double>& thresholdProbabilities,
@@ -370,7 +378,7 @@ namespace insur {
     std::vector<TObject> savingMaterialV; // Vector of ROOT objects to be saved
 
     Material findAllHits(MaterialBudget& mb, MaterialBudget* pm, 
-                         double& eta, double& theta, double& phi, Track& track);
+                         double& eta, double& theta, double& phi, Track& track, const MaterialResponse* inactive = NULL);
 
 
     void computeDetailedWeights(std::vector<std::vector<ModuleCap> >& tracker, std::map<std::string, SummaryTable>& weightTables, bool byMaterial);
@@ -385,8 +393,8 @@ namespace insur {
 
     virtual Material findModuleLayerRI(std::vector<ModuleCap>& layer, double eta, double theta, double phi, Track& t, 
                                        std::map<std::string, Material>& sumComponentsRI, bool isPixel = false);
-    virtual Material analyzeInactiveSurfaces(std::vector<InactiveElement>& elements, double eta, double theta, 
-                                             Track& t, MaterialProperties::Category cat = MaterialProperties::no_cat, bool isPixel = false);
+    virtual Material analyzeInactiveSurfaces(const InactiveElementIndex::EntryList& crossed, MaterialProperties::Category cat,
+                                             double eta, double theta, Track& t, bool isPixel = false);
     virtual Material findHitsInactiveSurfaces(std::vector<InactiveElement>& elements, double eta, double theta,
                                               Track& t, bool isPixel = false);
 
@@ -423,6 +431,8 @@ namespace insur {
   private:
     // A random number generator
     TRandom3 myDice; 
+    ResultsExporter* resultsExporter_;
+    std::string resultsDetector_;
     int findCellIndexR(double r);
     int findCellIndexEta(double eta);
     int createResetCounters(Tracker& tracker, std::map <std::string, int> &modTypes);
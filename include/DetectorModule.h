@@ -20,6 +20,7 @@
 #include "Visitable.h"
 #include "MaterialObject.h"
 #include "messageLogger.h"
+#include "MemoryMonitor.h"
 
 using namespace boost::accumulators;
 using material::MaterialObject;
@@ -48,7 +49,7 @@ namespace insur {
 using insur::ModuleCap;
 using material::ElementsVector;
 
-class DetectorModule : public Decorator<GeometricModule>, public ModuleBase {// implementors of the DetectorModuleInterface must take care of rotating the module based on which part of the subdetector it will be used in (Barrel, EC)
+class DetectorModule : public Decorator<GeometricModule>, public ModuleBase, public MemoryCounted<MemoryMonitor::Modules> {// implementors of the DetectorModuleInterface must take care of rotating the module based on which part of the subdetector it will be used in (Barrel, EC)
   PropertyNode<int> sensorNode;
 
   typedef PtrVector<Sensor> Sensors;
@@ -17,14 +17,45 @@
 #include <tk2CMSSW_strings.h>
 #include <set>
 #include <cmath>
+#include <cstdint>
 #include <limits.h>
+#include <mutex>
 #include <sstream>
+#include <unordered_map>
 #include <Tracker.h>
 #include <MaterialTable.h>
 #include <MaterialBudget.h>
 #include <MaterialObject.h>
 
 namespace insur {
+  /**
+   * @class CompositeCache
+   * @brief The element fractions of the composite materials, worked out once for each composition.
+   *
+   * A composition is identified by a hash of its (material, mass) pairs, in the order of the material names. Each entry keeps the
+   * density and the id of a shared composite that holds the element fractions. A lookup compares the full composition and density,
+   * so a hash collision cannot change the output. The cache can be used from several threads at once.
+   */
+  class CompositeCache {
+  public:
+    CompositeCache() : enabled_(true) {}
+    Composite composite(const std::string& name, double density, const std::map<std::string, double>& masses);
+    void setEnabled(bool enabled) { enabled_ = enabled; }
+    void clear();
+  private:
+    struct Entry {
+      std::map<std::string, double> masses;
+      double density;
+      unsigned int id;
+    };
+    static uint64_t hash(double density, const std::map<std::string, double>& masses);
+    static Composite makeComposite(const std::string& name, double density, const std::map<std::string, double>& masses);
+    std::unordered_map<uint64_t, std::vector<Entry> > entries_;
+    std::vector<Composite> shared_;
+    std::mutex mutex_;
+    bool enabled_;
+  };
+
   /**
    * @class Extractor
    * @brief This class bundles the analysis functions that prepare an existing material budget and table for output to CMSSW XML.
@@ -76,7 +107,10 @@ namespace insur {
       }
     };
   public:
+    Extractor();
     void analyse(MaterialTable& mt, MaterialBudget& mb, CMSSWBundle& d, bool wt = false);
+    void setConcurrentAnalysis(bool concurrent);
+    void setCompositeCache(bool enabled) { composites_.setEnabled(enabled); }
   protected:
     void analyseElements(MaterialTable&mattab, std::vector<Element>& elems);
     void analyseBarrelContainer(Tracker& t, std::vector<std::pair<double, double> >& up,
@@ -97,6 +131,11 @@ namespace insur {
     void analyseSupports(InactiveSurfaces& is, std::vector<Composite>& c, std::vector<LogicalInfo>& l, std::vector<ShapeInfo>& s,
                          std::vector<PosInfo>& p, std::vector<SpecParInfo>& t, bool wt = false);
   private:
+    bool analyseLayer(Layer& barrelLayer, std::vector<ModuleCap>& caps, int layer, const std::string& nspace, PosInfo& pos, CMSSWBundle& f);
+    void analyseDisc(Disk& disc, std::vector<ModuleCap>& caps, int layer, const std::string& nspace, PosInfo& pos, CMSSWBundle& f);
+    void appendFragment(CMSSWBundle& f, std::vector<Composite>& c, std::vector<LogicalInfo>& l, std::vector<ShapeInfo>& s,
+                        std::vector<PosInfo>& p, std::vector<AlgoInfo>& a, std::map<std::string,Rotation>& r,
+                        std::vector<RILengthInfo>& ri, SpecParInfo* specs[]);
     Composite createComposite(std::string name, double density, MaterialProperties& mp, bool nosensors = false);
     std::vector<ModuleCap>::iterator findPartnerModule(std::vector<ModuleCap>::iterator i,
                                                        std::vector<ModuleCap>::iterator g, int ponrod, bool find_first = false);
@@ -111,6 +150,8 @@ namespace insur {
     double compositeDensity(InactiveElement& ie);
     double fromRim(double r, double w);
     int Z(double x0, double A);
+    bool concurrentAnalysis_;
+    CompositeCache composites_;
   };
 
 #if defined(__FLIPSENSORS_IN__) || defined(__FLIPSENSORS_OUT__)
@@ -126,7 +167,7 @@ namespace insur {
      void addShapeInfo   (std::vector<ShapeInfo>&   vec);
      void addLogicInfo   (std::vector<LogicalInfo>& vec);
      void addPositionInfo(std::vector<PosInfo>&     vec);
-     void addMaterialInfo(std::vector<Composite>&   vec);
+     void addMaterialInfo(std::vector<Composite>&   vec, CompositeCache& cache);
      void print() const;
 
      const double getServiceHybridWidth() const { return serviceHybridWidth; }
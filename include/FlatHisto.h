@@ -0,0 +1,249 @@
+#ifndef FLATHISTO_H
+#define FLATHISTO_H
+
+#include <stdint.h>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <iostream>
+
+#include <Histo.h>
+
+/**
+ * @class FlatHisto
+ * @brief A sparse histogram with the same binning and interface as Histo, backed by an open-addressing hash table
+ *
+ * The N bin indices are packed into a single 64 bit key, and the bins are
+ * kept in one flat array of slots with linear probing: a fill is a hash and
+ * a few contiguous reads, with no allocation until the table grows.
+ * Partial histograms filled by different threads are combined with merge().
+ * The text written by serialize() is the one of Histo, so either class can
+ * read it back.
+ */
+template<int N, class T, class E = uint16_t>
+class FlatHisto {
+  static_assert(N*sizeof(E) <= sizeof(uint64_t), "the bin indices must fit in 64 bits");
+  static const int IndexBits = 8*sizeof(E);
+public:
+  enum { Dimensions = N };
+  typedef T BinType;
+  typedef BinKey<N, E> InternalBinKey;
+  typedef BinKey<N, double> ExportableBinKey;
+  typedef std::pair<ExportableBinKey, T> exportable_iterator_element;
+
+private:
+  struct Slot {
+    uint64_t key;
+    T value;
+    bool used;
+    Slot() : key(0), value(), used(false) {}
+  };
+
+  std::vector<Slot> slots_; // the size is always a power of 2
+  size_t size_;
+
+  int nbins_[N];
+  double lo_[N], hi_[N];
+
+  static uint64_t hash(uint64_t key) { // splitmix64 finalizer
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+    return key ^ (key >> 31);
+  }
+
+  // The first index goes to the most significant bits, so that the order of the keys is the order of Histo
+  static uint64_t pack(const InternalBinKey& k) {
+    uint64_t key = 0;
+    for (int i=0; i < N; i++) key = (key << (IndexBits-1) << 1) | uint64_t(k.at(i));
+    return key;
+  }
+
+  static InternalBinKey unpack(uint64_t key) {
+    InternalBinKey k;
+    for (int i=N-1; i >= 0; i--, key = key >> (IndexBits-1) >> 1) k.set(i, E(key & ((uint64_t(1) << (IndexBits-1) << 1) - 1)));
+    return k;
+  }
+
+  int coordToKey(double value, int index) const {
+    int key = (value - lo_[index])/((hi_[index] - lo_[index])/nbins_[index]) + 1; // bin keys start at 1 (0 is the underflow)
+    return key >= 1 ? (key <= nbins_[index] ? key : InternalBinKey::max()) : InternalBinKey::min();
+  }
+
+  ExportableBinKey makeExportableBinKey(const InternalBinKey& bk) const {
+    ExportableBinKey ebk;
+    for (int i=0; i < N; i++) {
+      double binw = (hi_[i] - lo_[i])/nbins_[i];
+      ebk.set(i, (bk.at(i) != bk.min() ? (bk.at(i) != bk.max() ? (bk.at(i)-1)*binw + lo_[i] + binw/2. : ebk.max()) : ebk.min())); // center of the bin, or the underflow/overflow marker
+    }
+    return ebk;
+  }
+
+  // Returns the slot of the key, taking an empty one if the key is not in the table yet
+  Slot& findSlot(uint64_t key) {
+    if (10*(size_ + 1) > 7*slots_.size()) grow();
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash(key) & mask; ; i = (i + 1) & mask) {
+      Slot& slot = slots_[i];
+      if (!slot.used) {
+        slot.used = true;
+        slot.key = key;
+        size_++;
+        return slot;
+      }
+      if (slot.key == key) return slot;
+    }
+  }
+
+  const Slot* lookup(uint64_t key) const {
+    if (slots_.empty()) return nullptr;
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash(key) & mask; slots_[i].used; i = (i + 1) & mask) {
+      if (slots_[i].key == key) return &slots_[i];
+    }
+    return nullptr;
+  }
+
+  void grow() {
+    std::vector<Slot> old;
+    old.swap(slots_);
+    slots_.resize(old.empty() ? 1024 : 2*old.size());
+    size_ = 0;
+    for (const Slot& slot : old) {
+      if (slot.used) findSlot(slot.key).value = slot.value;
+    }
+  }
+
+  uint64_t keyOf(const double coords[N]) const {
+    InternalBinKey k;
+    for (int i=0; i < N; i++) k.set(i, coordToKey(coords[i], i));
+    return pack(k);
+  }
+
+  std::vector<const Slot*> sortedSlots() const {
+    std::vector<const Slot*> sorted;
+    sorted.reserve(size_);
+    for (const Slot& slot : slots_) {
+      if (slot.used) sorted.push_back(&slot);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Slot* a, const Slot* b) { return a->key < b->key; });
+    return sorted;
+  }
+
+public:
+  class const_iterator : public std::iterator<std::input_iterator_tag, exportable_iterator_element> {
+    const FlatHisto* histo_;
+    typename std::vector<Slot>::const_iterator slotit_;
+    exportable_iterator_element current_;
+    void skipEmpty() { while (slotit_ != histo_->slots_.end() && !slotit_->used) ++slotit_; }
+  public:
+    const_iterator(typename std::vector<Slot>::const_iterator slotit, const FlatHisto& histo) : histo_(&histo), slotit_(slotit) { skipEmpty(); }
+    const_iterator& operator++() { ++slotit_; skipEmpty(); return *this; }
+    const_iterator operator++(int) { const_iterator tmp(*this); operator++(); return tmp; }
+    bool operator==(const const_iterator& other) const { return slotit_ == other.slotit_; }
+    bool operator!=(const const_iterator& other) const { return slotit_ != other.slotit_; }
+    const exportable_iterator_element& operator*() {
+      return (current_ = exportable_iterator_element(histo_->makeExportableBinKey(unpack(slotit_->key)), slotit_->value));
+    }
+    const exportable_iterator_element* operator->() { return &operator*(); }
+  };
+
+  FlatHisto(const int nbins[N], const double lo[N], const double hi[N]) : size_(0) {
+    for (int i=0; i<N; i++) {
+      nbins_[i] = nbins[i];
+      lo_[i] = lo[i];
+      hi_[i] = hi[i];
+    }
+  }
+
+  FlatHisto(std::istream& is) : size_(0) {
+    deserialize(is);
+  }
+
+  void fill(const double coords[N], const T& weight = T(1)) { findSlot(keyOf(coords)).value += weight; }
+
+  T get(const double coords[N]) const {
+    const Slot* slot = lookup(keyOf(coords));
+    return slot ? slot->value : T();
+  }
+
+  /**
+   * Adds the bins of a histogram with the same binning, holding entries
+   * filled after the ones of this histogram
+   * @param later the other histogram
+   * @param mergeBin combines a bin of this histogram with the same bin of the other
+   */
+  template<class MergeBin> void merge(const FlatHisto& later, MergeBin mergeBin) {
+    for (const Slot& slot : later.slots_) {
+      if (!slot.used) continue;
+      size_t before = size_;
+      Slot& mine = findSlot(slot.key);
+      if (size_ > before) mine.value = slot.value;
+      else mergeBin(mine.value, slot.value);
+    }
+  }
+  void merge(const FlatHisto& later) { merge(later, [](T& bin, const T& other) { bin += other; }); }
+
+  int getNbins(int k) const { return nbins_[k]; }
+  double getLo(int k) const { return lo_[k]; }
+  double getHi(int k) const { return hi_[k]; }
+  double getWbins(int k) const { return (hi_[k]-lo_[k])/nbins_[k]; }
+
+  T minimumValue() const { // unset bins don't count
+    const T* min = nullptr;
+    for (const Slot& slot : slots_) {
+      if (slot.used && (!min || slot.value < *min)) min = &slot.value;
+    }
+    return min ? *min : T();
+  }
+  T maximumValue() const {
+    T max = T(0);
+    for (const Slot& slot : slots_) {
+      if (slot.used && slot.value > max) max = slot.value;
+    }
+    return max;
+  }
+
+  size_t size() const { return size_; }
+
+  const_iterator begin() const { return const_iterator(slots_.begin(), *this); }
+  const_iterator end() const { return const_iterator(slots_.end(), *this); }
+
+  void clear() {
+    slots_.clear();
+    size_ = 0;
+  }
+
+  // Same text as Histo::serialize(), with the bins in the same order
+  void serialize(std::ostream& out) const {
+    for (int i=0; i<N; i++) out << nbins_[i] << (i<N-1 ? " " : "\r\n");
+    for (int i=0; i<N; i++) out << lo_[i] << (i<N-1 ? " " : "\r\n");
+    for (int i=0; i<N; i++) out << hi_[i] << (i<N-1 ? " " : "\r\n");
+    out << minimumValue() << " " << maximumValue() << std::endl;
+    out << size_ << std::endl;
+    for (const Slot* slot : sortedSlots()) {
+      InternalBinKey k = unpack(slot->key);
+      for (int i=0; i<N; i++) out << k.at(i) << " ";
+      out << slot->value << std::endl;
+    }
+  }
+
+  bool deserialize(std::istream& in) {
+    clear();
+    for (int i=0; i<N; i++) in >> nbins_[i];
+    for (int i=0; i<N; i++) in >> lo_[i];
+    for (int i=0; i<N; i++) in >> hi_[i];
+    T min, max;
+    in >> min >> max; // recomputed from the bins
+    size_t size;
+    in >> size;
+    size_t i = 0;
+    for (; i < size && !in.eof(); i++) {
+      InternalBinKey key;
+      for (int j=0; j<N; j++) { typename InternalBinKey::ElemType tmp; in >> tmp; key.set(j, tmp); }
+      in >> findSlot(pack(key)).value;
+    }
+    return i == size;
+  }
+};
+
+#endif
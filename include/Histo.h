@@ -7,6 +7,10 @@
 #include <map>
 #include <iostream>
 #include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <stdint.h>
+#include <type_traits>
 
 #include <TH1.h>
 #include <TH2.h>
@@ -86,6 +90,148 @@ public:
 };
 
 
+// Keys of Histo which also select how its bins are stored:
+// BinKey keeps the touched bins in a map, DenseBinKey keeps all the bins of
+// the range (plus underflow and overflow) in one array, SortedBinKey keeps
+// the touched bins in a vector sorted by key (for histograms which are read
+// back and looked up, rather than filled)
+template<int N, class T = unsigned> struct DenseBinKey : public BinKey<N, T> {};
+template<int N, class T = unsigned> struct SortedBinKey : public BinKey<N, T> {};
+
+
+// A bin with its key, as written by the binary serialization
+template<class K, class T>
+struct BinEntry {
+  K first;
+  T second;
+};
+
+
+template<class K, class T>
+class MapBins {
+  std::map<K, T> bins_;
+public:
+  typedef typename std::map<K, T>::const_iterator const_iterator;
+  void setup(const int*) {}
+  T& bin(const K& k) { return bins_[k]; }
+  size_t size() const { return bins_.size(); }
+  const_iterator begin() const { return bins_.begin(); }
+  const_iterator end() const { return bins_.end(); }
+  void clear() { bins_.clear(); }
+  template<class Pred> void eraseIf(Pred pred) {
+    for (typename std::map<K, T>::iterator it = bins_.begin(); it != bins_.end(); ) {
+      if (pred(it->first, it->second)) bins_.erase(it++);
+      else ++it;
+    }
+  }
+  void assign(std::vector<BinEntry<K, T> >& sorted) {
+    bins_.clear();
+    for (const BinEntry<K, T>& e : sorted) bins_.insert(bins_.end(), std::make_pair(e.first, e.second));
+  }
+};
+
+
+template<class K, class T>
+class SortedBins {
+  std::vector<BinEntry<K, T> > bins_;
+  static bool keyLess(const BinEntry<K, T>& e, const K& k) { return e.first < k; }
+public:
+  typedef typename std::vector<BinEntry<K, T> >::const_iterator const_iterator;
+  void setup(const int*) {}
+  T& bin(const K& k) { // lookups are binary searches, but a new bin moves all the following ones
+    typename std::vector<BinEntry<K, T> >::iterator it = std::lower_bound(bins_.begin(), bins_.end(), k, keyLess);
+    if (it == bins_.end() || k < it->first) it = bins_.insert(it, BinEntry<K, T>{ k, T() });
+    return it->second;
+  }
+  size_t size() const { return bins_.size(); }
+  const_iterator begin() const { return bins_.begin(); }
+  const_iterator end() const { return bins_.end(); }
+  void clear() { bins_.clear(); }
+  template<class Pred> void eraseIf(Pred pred) {
+    bins_.erase(std::remove_if(bins_.begin(), bins_.end(), [&](const BinEntry<K, T>& e) { return pred(e.first, e.second); }), bins_.end());
+  }
+  void assign(std::vector<BinEntry<K, T> >& sorted) { bins_.swap(sorted); }
+};
+
+
+template<int N, class E, class T>
+class DenseBins {
+  typedef DenseBinKey<N, E> K;
+  std::vector<T> values_;
+  std::vector<bool> used_;
+  size_t size_;
+  int extents_[N]; // bins of each dimension, with underflow and overflow
+
+  size_t index(const K& k) const {
+    size_t i = 0;
+    for (int d=0; d < N; d++) {
+      E key = k.at(d);
+      i = i*extents_[d] + (key == K::min() ? 0 : key == K::max() ? extents_[d]-1 : size_t(key));
+    }
+    return i;
+  }
+  K key(size_t i) const {
+    K k;
+    for (int d=N-1; d >= 0; d--) {
+      size_t j = i % extents_[d];
+      i /= extents_[d];
+      k.set(d, j == 0 ? K::min() : j == size_t(extents_[d]-1) ? K::max() : E(j));
+    }
+    return k;
+  }
+public:
+  class const_iterator {
+    const DenseBins* bins_;
+    size_t i_;
+    mutable BinEntry<K, T> current_;
+    void skipUnused() { while (i_ < bins_->used_.size() && !bins_->used_[i_]) ++i_; }
+  public:
+    const_iterator(const DenseBins* bins, size_t i) : bins_(bins), i_(i) { skipUnused(); }
+    const_iterator& operator++() { ++i_; skipUnused(); return *this; }
+    bool operator==(const const_iterator& other) const { return i_ == other.i_; }
+    bool operator!=(const const_iterator& other) const { return i_ != other.i_; }
+    const BinEntry<K, T>* operator->() const { current_.first = bins_->key(i_); current_.second = bins_->values_[i_]; return &current_; }
+    const BinEntry<K, T>& operator*() const { return *operator->(); }
+  };
+
+  DenseBins() : size_(0) {}
+  void setup(const int* nbins) {
+    size_t total = 1;
+    for (int d=0; d < N; d++) total *= (extents_[d] = nbins[d] + 2);
+    values_.assign(total, T());
+    used_.assign(total, false);
+    size_ = 0;
+  }
+  T& bin(const K& k) {
+    size_t i = index(k);
+    if (!used_[i]) { used_[i] = true; size_++; }
+    return values_[i];
+  }
+  size_t size() const { return size_; }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, used_.size()); }
+  void clear() {
+    std::fill(values_.begin(), values_.end(), T());
+    std::fill(used_.begin(), used_.end(), false);
+    size_ = 0;
+  }
+  template<class Pred> void eraseIf(Pred pred) {
+    for (size_t i = 0; i < used_.size(); i++) {
+      if (used_[i] && pred(key(i), values_[i])) { used_[i] = false; values_[i] = T(); size_--; }
+    }
+  }
+  void assign(std::vector<BinEntry<K, T> >& sorted) {
+    clear();
+    for (const BinEntry<K, T>& e : sorted) bin(e.first) = e.second;
+  }
+};
+
+
+template<class K, class T> struct BinStorage { typedef MapBins<K, T> Type; };
+template<int N, class E, class T> struct BinStorage<DenseBinKey<N, E>, T> { typedef DenseBins<N, E, T> Type; };
+template<int N, class E, class T> struct BinStorage<SortedBinKey<N, E>, T> { typedef SortedBins<SortedBinKey<N, E>, T> Type; };
+
+
 template<int N, class T, class B = BinKey<N, unsigned> >
 class Histo {
 public:
@@ -96,7 +242,8 @@ public:
 
   typedef std::pair<ExportableBinKey, T> exportable_iterator_element;
   typedef std::pair<InternalBinKey, T> internal_iterator_element;
-  typedef typename std::map<InternalBinKey, T>::const_iterator internal_iterator;
+  typedef typename BinStorage<B, T>::Type Storage;
+  typedef typename Storage::const_iterator internal_iterator;
 
   template<class U, class ExportableIteratorElement = typename U::exportable_iterator_element, class InternalIterator = typename U::internal_iterator>
   class ConstIterator : public std::iterator<std::input_iterator_tag, ExportableIteratorElement> { // this is by definition a const iterator
@@ -151,14 +298,14 @@ public:
       //const typename H::InternalBinKey& key() const { return k_; }
     public:
       Indexer(H& h, typename H::InternalBinKey& k) : h_(h), k_(k) {}
-      operator const typename H::BinType&() { return h_.bins_[k_]; }
+      operator const typename H::BinType&() { return h_.bins_.bin(k_); }
       Indexer<0, H>& operator+=(const typename H::BinType& w) { 
-        typename H::BinType& bin = h_.bins_[k_];
+        typename H::BinType& bin = h_.bins_.bin(k_);
         bin += w; h_.minMax(bin);
         return *this;
       }
       Indexer<0, H>& operator=(const typename H::BinType& w) {
-        typename H::BinType& bin = h_.bins_[k_];
+        typename H::BinType& bin = h_.bins_.bin(k_);
         bin = w; h_.minMax(bin);
         return *this;
       }
@@ -172,7 +319,7 @@ public:
 protected:
   friend class ConstIterator<Histo<N, T, B> >;
 
-  std::map<InternalBinKey, T> bins_;
+  Storage bins_;
   InternalBinKey currentBin_;
 
   int nbins_[N];
@@ -210,13 +357,14 @@ protected:
     for (int i=0; i < N; i++) {
       key.set(i, coordToKey(coords[i], i));
     }
-    return bins_[key];
+    return bins_.bin(key);
   }
 
   void setBinning(int k, int nbins, double lo, double hi) {
     nbins_[k] = nbins;
     lo_[k] = lo;
     hi_[k] = hi;
+    if (k == N-1) bins_.setup(nbins_);
   }
 
   void minMax(const T& bin) {
@@ -224,7 +372,46 @@ protected:
     min_ = bin < min_ ? bin : min_;
   }
 
-  Histo() {}
+  Histo() : min_(std::numeric_limits<T>::max()), max_(T(0)) {
+    std::fill(nbins_, nbins_+N, 1);
+    std::fill(lo_, lo_+N, 0.);
+    std::fill(hi_, hi_+N, 1.);
+  }
+
+  typedef BinEntry<InternalBinKey, T> Entry;
+
+  // The number of bins must be positive and the range not empty; maxBins counts the underflow and overflow too
+  static bool validBinning(const int nbins[N], const double lo[N], const double hi[N], uint64_t& maxBins) {
+    maxBins = 1;
+    for (int i=0; i < N; i++) {
+      if (nbins[i] < 1 || !(lo[i] < hi[i])) return false;
+      uint64_t extent = uint64_t(nbins[i]) + 2;
+      maxBins = (maxBins > std::numeric_limits<uint64_t>::max() / extent) ? std::numeric_limits<uint64_t>::max() : maxBins * extent;
+    }
+    return true;
+  }
+
+  // The keys must be in range and sorted
+  static bool validEntries(const std::vector<Entry>& entries, const int nbins[N]) {
+    for (size_t j=0; j < entries.size(); j++) {
+      for (int i=0; i < N; i++) {
+        typename InternalBinKey::ElemType key = entries[j].first.at(i);
+        if (key != InternalBinKey::min() && key != InternalBinKey::max() && (key < 1 || key > typename InternalBinKey::ElemType(nbins[i]))) return false;
+      }
+      if (j > 0 && !(entries[j-1].first < entries[j].first)) return false;
+    }
+    return true;
+  }
+
+  void assign(const int nbins[N], const double lo[N], const double hi[N], const T& minValue, const T& maxValue, std::vector<Entry>& entries) {
+    std::copy(nbins, nbins+N, nbins_);
+    std::copy(lo, lo+N, lo_);
+    std::copy(hi, hi+N, hi_);
+    min_ = minValue;
+    max_ = maxValue;
+    bins_.setup(nbins_);
+    bins_.assign(entries);
+  }
 
 public:
   Histo(const int nbins[N], const double lo[N], const double hi[N]) {
@@ -233,6 +420,7 @@ public:
       lo_[i] = lo[i];
       hi_[i] = hi[i];
     }
+    bins_.setup(nbins_);
     min_ = std::numeric_limits<T>::max();
     max_ = T(0);
   }
@@ -240,8 +428,9 @@ public:
 //    : nbins_(nbins), lo_(lo), hi_(hi), 
 //      min_(std::numeric_limits<T>::max()), max_(T(0)) {}
 
-  Histo(istream& is) {
-    deserialize(is);
+  Histo(std::istream& is) : Histo() { // reads either serialization
+    bool valid = is.peek() == BinaryMagic[0] ? deserializeBinary(is) : deserialize(is);
+    if (!valid) throw std::runtime_error("Histo: the stream does not hold a valid histogram");
   }
 
   void fill(double coords[N], const T& weight = T(1)) {
@@ -264,13 +453,13 @@ public:
     Histo<M, T, B>* folded = new Histo<M, T>();
     for (int i=0; i < M; i++) {
       int index = indices[i];
-      folded.setBinning(i, nbins_[index], lo_[index], hi_[index]);
+      folded->setBinning(i, nbins_[index], lo_[index], hi_[index]);
     }
 
-    for (typename std::map<InternalBinKey, T>::const_iterator it = bins_.begin(); it != bins_.end(); ++it) {
+    for (internal_iterator it = bins_.begin(); it != bins_.end(); ++it) {
       typename Histo<M, T>::InternalBinKey key;
       for (int i=0; i < M; i++) key.set(i, it->first.at(indices[i]));
-      folded.bins_[key] += it->second;
+      folded->bins_.bin(key) += it->second;
     }
 
     return folded;
@@ -296,41 +485,126 @@ public:
   }
 
   void suppressZeros(const T& threshold = T(0)) {
-    for (typename std::map<InternalBinKey, T>::iterator it = bins_.begin(); it != bins_.end(); it++) {
-      if ((-threshold <= it->second && it->second <= threshold) || it->first.overflow() || it->first.underflow()) bins_.erase(it);
-    }
+    bins_.eraseIf([&](const InternalBinKey& k, const T& bin) { return (-threshold <= bin && bin <= threshold) || k.overflow() || k.underflow(); });
   }
 
-  void serialize(ostream& out) {
+  void serialize(std::ostream& out) {
     for (int i=0; i<N; i++) out << nbins_[i] << (i<N-1 ? " " : "\r\n");
     for (int i=0; i<N; i++) out << lo_[i] << (i<N-1 ? " " : "\r\n");
     for (int i=0; i<N; i++) out << hi_[i] << (i<N-1 ? " " : "\r\n");
     out << min_ << " " << max_ << std::endl;
     out << bins_.size() << std::endl;
-    for (typename std::map<InternalBinKey, T>::const_iterator it = bins_.begin(); it != bins_.end(); ++it) {
+    for (internal_iterator it = bins_.begin(); it != bins_.end(); ++it) {
       for (int i=0; i<N; i++) out << it->first.at(i) << " ";
       out << it->second << std::endl;
     }
   }
 
-  bool deserialize(istream& in) {
-    for (int i=0; i<N; i++) in >> nbins_[i];
-    for (int i=0; i<N; i++) in >> lo_[i];
-    for (int i=0; i<N; i++) in >> hi_[i];
-    in >> min_ >> max_;
+  /**
+   * Reads back what serialize() wrote, with the checks of deserializeBinary()
+   * @return false if the stream is not a valid text histogram, which is then left as it was
+   */
+  bool deserialize(std::istream& in) {
+    int nbins[N];
+    double lo[N], hi[N];
+    T minValue, maxValue;
     size_t size;
-    in >> size;
-    size_t i = 0;
-    for (; i < size && !in.eof(); i++) {
-      InternalBinKey key;
-      for (int j=0; j<N; j++) { typename InternalBinKey::ElemType tmp; in >> tmp; key.set(j, tmp); }
-      in >> bins_[key];
+    for (int i=0; i<N; i++) in >> nbins[i];
+    for (int i=0; i<N; i++) in >> lo[i];
+    for (int i=0; i<N; i++) in >> hi[i];
+    in >> minValue >> maxValue >> size;
+    uint64_t maxBins;
+    if (!in || !validBinning(nbins, lo, hi, maxBins) || size > maxBins) return false;
+
+    std::vector<Entry> entries;
+    for (size_t j=0; j < size; j++) {
+      Entry entry;
+      for (int i=0; i<N; i++) { typename InternalBinKey::ElemType tmp; in >> tmp; entry.first.set(i, tmp); }
+      in >> entry.second;
+      if (!in) return false;
+      entries.push_back(entry);
     }
-    if (i < size) return false;
+    if (!validEntries(entries, nbins)) return false;
 
+    assign(nbins, lo, hi, minValue, maxValue, entries);
     return true;
   }
 
+  /**
+   * Writes the histogram as raw bytes: a header with the binning, then all
+   * the bins, sorted by key, as one block that deserializeBinary() reads
+   * back at once. Only for plain keys and bin types, on the same platform.
+   */
+  void serializeBinary(std::ostream& out) const {
+    static_assert(std::is_trivially_copyable<T>::value && std::is_trivially_copyable<InternalBinKey>::value, "the binary serialization copies the bins as raw bytes");
+    uint32_t header[4] = { uint32_t(N), uint32_t(sizeof(InternalBinKey)), uint32_t(sizeof(T)), uint32_t(sizeof(Entry)) };
+    std::vector<Entry> entries;
+    entries.reserve(bins_.size());
+    for (internal_iterator it = bins_.begin(); it != bins_.end(); ++it) entries.push_back(Entry{ it->first, it->second });
+    uint64_t size = entries.size();
+    out.write(BinaryMagic, sizeof(BinaryMagic));
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(nbins_), sizeof(nbins_));
+    out.write(reinterpret_cast<const char*>(lo_), sizeof(lo_));
+    out.write(reinterpret_cast<const char*>(hi_), sizeof(hi_));
+    out.write(reinterpret_cast<const char*>(&min_), sizeof(min_));
+    out.write(reinterpret_cast<const char*>(&max_), sizeof(max_));
+    out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.write(reinterpret_cast<const char*>(entries.data()), size*sizeof(Entry));
+  }
+
+  /**
+   * Reads back what serializeBinary() wrote. Nothing of the stream is trusted:
+   * the binning must be valid, the number of bins must fit both in the binning
+   * and in what is left of the stream, and the keys must be in range and sorted.
+   * @return false if the stream is not a valid binary histogram, which is then left as it was
+   */
+  bool deserializeBinary(std::istream& in) {
+    static_assert(std::is_trivially_copyable<T>::value && std::is_trivially_copyable<InternalBinKey>::value, "the binary serialization copies the bins as raw bytes");
+    char magic[sizeof(BinaryMagic)];
+    uint32_t header[4];
+    int nbins[N];
+    double lo[N], hi[N];
+    T minValue, maxValue;
+    uint64_t size;
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, BinaryMagic, sizeof(magic)) != 0) return false;
+    if (!in.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+        header[0] != uint32_t(N) || header[1] != sizeof(InternalBinKey) || header[2] != sizeof(T) || header[3] != sizeof(Entry)) return false;
+    if (!in.read(reinterpret_cast<char*>(nbins), sizeof(nbins)) ||
+        !in.read(reinterpret_cast<char*>(lo), sizeof(lo)) ||
+        !in.read(reinterpret_cast<char*>(hi), sizeof(hi)) ||
+        !in.read(reinterpret_cast<char*>(&minValue), sizeof(minValue)) ||
+        !in.read(reinterpret_cast<char*>(&maxValue), sizeof(maxValue)) ||
+        !in.read(reinterpret_cast<char*>(&size), sizeof(size))) return false;
+
+    // at most one entry per bin, underflow and overflow included
+    uint64_t maxBins;
+    if (!validBinning(nbins, lo, hi, maxBins) || size > maxBins) return false;
+    std::streampos start = in.tellg();
+    if (start != std::streampos(-1)) {
+      in.seekg(0, std::ios::end);
+      std::streamoff remaining = in.tellg() - start;
+      in.seekg(start);
+      if (!in || remaining < 0 || size > uint64_t(remaining) / sizeof(Entry)) return false;
+    }
+
+    // read in blocks, so that a stream which cannot tell its length still only costs what it holds
+    std::vector<Entry> entries;
+    const uint64_t BlockEntries = 65536;
+    for (uint64_t done = 0; done < size; ) {
+      uint64_t block = std::min(BlockEntries, size - done);
+      entries.resize(done + block);
+      if (!in.read(reinterpret_cast<char*>(&entries[done]), block*sizeof(Entry))) return false;
+      done += block;
+    }
+    if (!validEntries(entries, nbins)) return false;
+
+    assign(nbins, lo, hi, minValue, maxValue, entries);
+    return true;
+  }
+
+
+  static constexpr char BinaryMagic[4] = { 'H', 'S', 'T', 'B' }; // a text serialization starts with a digit
 
   Indexer<N-1, Histo<N,T,B> > operator[](double x) {
     InternalBinKey k; k.set(0, coordToKey(x,0));
@@ -348,6 +622,8 @@ public:
   }
 };
 
+template<int N, class T, class B> constexpr char Histo<N, T, B>::BinaryMagic[4];
+
 
 
 template<class H> void toTH1(H& histo, TH1& thisto, int k = 0) {
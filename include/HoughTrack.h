@@ -13,6 +13,7 @@
 #include <TRandom.h>
 
 #include <Histo.h>
+#include <FlatHisto.h>
 #include <TrackShooter.h>
 #include <ptError.h>
 #include <global_funcs.h>
@@ -61,14 +62,14 @@ struct HitsP { // holder struct for TTree export
 
 
 struct SmartBin {
-  uint8_t count;
-  uint8_t eventid;
+  uint32_t eventid; // wide enough that two events filling the same bin never share their id
   uint16_t hitmask;
+  uint8_t count;
   int8_t stacked; // how many events have been stacked on top of each other
 //public:
-  SmartBin(int count_ = 0, uint8_t eventid_ = 0, uint16_t hitmask_ = 0, uint8_t stacked_ = -1) : count(count_), eventid(eventid_), hitmask(hitmask_), stacked(stacked_) {}
+  SmartBin(int count_ = 0, uint32_t eventid_ = 0, uint16_t hitmask_ = 0, uint8_t stacked_ = -1) : eventid(eventid_), hitmask(hitmask_), count(count_), stacked(stacked_) {}
   SmartBin& operator+=(const SmartBin& other) {
-    if (eventid != other.eventid) {
+    if (eventid != other.eventid || stacked < 0) { // the first event is a new one even if its id is the default one
       eventid = other.eventid;
       hitmask = 0;
       stacked++;
@@ -79,6 +80,14 @@ struct SmartBin {
     }
     return *this;
   }
+  // Adds a bin filled, from an empty bin, with events coming after the ones of this bin
+  SmartBin& merge(const SmartBin& later) {
+    count += later.count;
+    stacked += later.stacked + 1;
+    eventid = later.eventid;
+    hitmask = later.hitmask;
+    return *this;
+  }
 /*  SmartBin& operator=(const SmartBin& other) {
     count_ = other.count_;
     eventid_ = other.eventid_;
@@ -87,7 +96,7 @@ struct SmartBin {
     return *this;
   }*/
  /* uint8_t count() const { return count_; }
-  uint8_t eventid() const { return eventid_; }
+  uint32_t eventid() const { return eventid_; }
   uint16_t hitmask() const { return hitmask_; }
   uint16_t stacked() const { return stacked_; }
 */
@@ -99,16 +108,24 @@ struct SmartBin {
 class HoughTrack {
 
   SparseMatrix<ModuleData, 4> mods_;
-  typedef Histo<4, SmartBin, BinKey<4, uint16_t> > HistoType;
+  typedef FlatHisto<4, SmartBin, uint16_t> HistoType;
   HistoType histo_;
+  typedef Histo<2, double, DenseBinKey<2> > HitMapType; // average hits per track, over invPt and eta
+
+  UInt_t seed_; // each event is smeared with a generator seeded from this and the event number
 
-  TRandom3 die_;
+  struct HoughHit { // what the transform needs of a hit, read from the tree beforehand
+    int hitid;
+    double x, y, z;
+    double pt, ptError, yres;
+  };
 
-  double rectangularSmear(double mean, double sigma, int nsteps, int step);  
+  double rectangularSmear(double mean, double sigma, int nsteps, int step) const;
 
-  double calcPhi0(double x, double y, double pt);
-  double calcTheta(double x, double y, double z, double z0, double pt);
-  void processHit(int evid, int hitid, double x, double y, double z, double pt, double ptError, double yres);
+  double calcPhi0(double x, double y, double pt) const;
+  double calcTheta(double x, double y, double z, double z0, double pt) const;
+  void processHit(HistoType& histo, TRandom& die, int evid, const HoughHit& hit) const;
+  void processEvents(HistoType& histo, const std::vector<std::vector<HoughHit> >& events, long int first, long int last, long int startev) const;
   void loadGeometryData(TFile* infile);
 
   enum { H_K = 0, H_PHI0 = 1, H_Z0 = 2, H_THETA = 3 };
@@ -116,7 +133,7 @@ public:                     //     invPt,phi0,  z0, theta
   HoughTrack() : histo_(seq<4>(1000)(1000)(100)(1000),
                         seq<4>(-0.5)(-3.14)(-70.5)(0.),
                         seq<4>(0.5)(3.14)(69.5)(3.14)),
-                 die_(0xcafebabe) {}
+                 seed_(0xcafebabe) {}
   void processTree(std::string filename, long int startev, long int howmany);
   ~HoughTrack();
 };
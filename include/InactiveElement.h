@@ -16,6 +16,7 @@
 
 #include "MaterialProperties.h"
 #include "global_constants.h"
+#include "MemoryMonitor.h"
 namespace insur {
   /**
    * @class InactiveElement
@@ -25,7 +26,7 @@ namespace insur {
    * packed into the base class. All of these parameters apply to descendants of a different shape as well, though, because
    * they describe relations between the object and the origin, not between points within the object.
    */
-  class InactiveElement : public MaterialProperties {
+  class InactiveElement : public MaterialProperties, public MemoryCountedInstances<MemoryMonitor::MaterialElements, InactiveElement> {
   public:
     /**
      * @enum InType A list of the various types of neighbour or feeder an element can have
@@ -0,0 +1,53 @@
+/**
+ * @file InactiveElementIndex.h
+ * @brief This is the header file for the eta lookup index over a collection of inactive elements
+ */
+
+#ifndef _INACTIVEELEMENTINDEX_H
+#define	_INACTIVEELEMENTINDEX_H
+
+#include <vector>
+#include <InactiveElement.h>
+
+namespace insur {
+  /**
+   * @class InactiveElementIndex
+   * @brief An immutable eta lookup structure over the inactive elements of one category.
+   *
+   * The index is built once from a collection of inactive elements, keeping only the ones in z+ that belong
+   * to the requested category (all of them for <i>no_cat</i>). For each retained element the eta range and the
+   * radiation and interaction lengths are computed once and cached. The covered eta range is cut into equal
+   * slices, and each element records the range of slices [firstSlice, lastSlice] it overlaps. Elements
+   * overlapping at most <i>MaxListedSlices</i> slices are listed in each of them; the wider ones are kept in a
+   * single list, checked by their slice range, so that the memory stays linear in the number of elements.
+   * A straight track from the origin only has to look at the elements of the slice its eta falls into, and
+   * at the wide ones. The candidates keep the order of the original collection, which makes the results
+   * identical to a linear scan. The underlying collection must not change while the index is in use.
+   */
+  class InactiveElementIndex {
+  public:
+    struct Entry {
+      InactiveElement* element;
+      double etaMin, etaMax;
+      double radiationLength, interactionLength;
+      int firstSlice, lastSlice;
+      bool crossedBy(double eta) const { return (etaMin < eta) && (etaMax > eta); }
+    };
+    typedef std::vector<const Entry*> EntryList;
+
+    InactiveElementIndex(std::vector<InactiveElement>& elements, MaterialProperties::Category cat = MaterialProperties::no_cat);
+    InactiveElementIndex(const InactiveElementIndex&) = delete; // slices point into entries_
+    InactiveElementIndex& operator=(const InactiveElementIndex&) = delete;
+    MaterialProperties::Category getCategory() const { return cat_; }
+    void candidates(double eta, EntryList& result) const;
+    size_t size() const { return entries_.size(); }
+  private:
+    MaterialProperties::Category cat_;
+    std::vector<Entry> entries_;
+    static const int MaxListedSlices = 4;
+    std::vector<EntryList> slices_; // the elements overlapping each slice, if they overlap few slices
+    EntryList wideEntries_;         // the elements overlapping more slices
+    double etaLow_, sliceWidth_;
+  };
+}
+#endif	/* _INACTIVEELEMENTINDEX_H */
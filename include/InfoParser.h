@@ -0,0 +1,25 @@
+#ifndef INFOPARSER_H
+#define INFOPARSER_H
+
+#include <string>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/info_parser.hpp>
+
+/**
+ * Reads a configuration in the info format straight from a character
+ * buffer into a ptree.
+ *
+ * The grammar, the resulting tree and the info_parser_error messages (with
+ * the same file name and line number) are the ones of
+ * boost::property_tree::info_parser::read_info, but the buffer is scanned
+ * in place, one line at a time: there is no stream nor per-line copy, and
+ * keys and values without escapes are built directly from the buffer.
+ * Files named by #include are read whole and parsed the same way.
+ * @param fileName the name reported in the errors ("" for an unnamed buffer)
+ */
+void readInfo(const char* begin, const char* end, boost::property_tree::ptree& pt, const std::string& fileName = "");
+void readInfo(const std::string& content, boost::property_tree::ptree& pt, const std::string& fileName = "");
+void readInfoFile(const std::string& fileName, boost::property_tree::ptree& pt);
+
+#endif
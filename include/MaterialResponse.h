@@ -0,0 +1,84 @@
+/**
+ * @file MaterialResponse.h
+ * @brief This is the header file for the tabulated material response of a tracker versus eta
+ */
+
+#ifndef _MATERIALRESPONSE_H
+#define	_MATERIALRESPONSE_H
+
+#include <vector>
+#include <MaterialBudget.h>
+#include <InactiveElementIndex.h>
+#include <hit.hh>
+
+namespace insur {
+  /**
+   * @class MaterialResponse
+   * @brief This class tabulates the material crossed by straight tracks from the origin on a fine eta grid.
+   *
+   * For every point of the grid the ordered list of crossed modules and inactive elements is computed once,
+   * together with the r/z position of the crossing and the radiation and interaction lengths corrected for the
+   * crossing angle. Queries are then answered by nearest-bin lookup for the list of crossings and by linear
+   * interpolation between neighbouring bins for the material totals.
+   * The inactive elements are rotationally symmetric, while the module crossings are computed for the reference
+   * phi given at build time: the queries take no phi, and every answer holds for the reference phi only. A
+   * table is not an average over phi; tracks at other phi need a table built for their own reference phi.
+   * Module lengths are corrected for the module tilt as in the material budget scan,
+   * inactive lengths take into account shallow crossings as in the hit finder used for tracking.
+   * A table can also be built with <i>buildInactive()</i> from chosen collections of inactive elements only:
+   * it then holds for every phi, and also gives the crossed elements of each collection in their original order,
+   * for the analyses that weigh them their own way. Tracks on the grid points get exactly the results of a scan.
+   * The material budgets must not change after the table is built.
+   */
+  class MaterialResponse {
+  public:
+    struct Crossing {
+      ModuleCap* moduleCap;      // NULL if an inactive element was crossed
+      InactiveElement* element;  // NULL if a module was crossed
+      HitType hitType;           // only meaningful for modules
+      double distance, r, z;
+      Material material;
+      bool isPixel;
+    };
+    typedef std::vector<Crossing> Crossings;
+
+    MaterialResponse();
+    ~MaterialResponse();
+    void build(MaterialBudget& mb, MaterialBudget* pm, double etaMax, int etaBins, double phi = 0);
+    int addInactive(std::vector<InactiveElement>& elements, bool isPixel, MaterialProperties::Category cat = MaterialProperties::no_cat);
+    void addInactive(MaterialBudget& mb, MaterialBudget* pm);
+    void buildInactive(double etaMax, int etaBins);
+    bool empty() const { return table_.empty(); }
+    int etaBins() const { return table_.size(); }
+    double etaMax() const { return etaMax_; }
+    double binEta(int bin) const { return bin * etaStep_; }
+    int findEtaBin(double eta) const;
+
+    void castRay(double eta, Crossings& crossings) const;
+    const Crossings& crossings(double eta) const;
+    const InactiveElementIndex::EntryList& crossedEntries(double eta, int collection) const;
+    Material material(double eta) const;
+    Material fillTrack(double eta, Track& t) const;
+  private:
+    void clearInactive();
+    void tabulate(double etaMax, int etaBins);
+    void cast(double eta, Crossings& crossings, std::vector<InactiveElementIndex::EntryList>* crossed) const;
+    void castModules(std::vector<std::vector<ModuleCap> >& caps, double theta, bool isPixel, Crossings& crossings) const;
+    void castInactive(const InactiveElementIndex& index, double eta, double theta, bool isPixel, Crossings& crossings,
+                      InactiveElementIndex::EntryList* crossed) const;
+
+    MaterialBudget* mb_;
+    MaterialBudget* pm_;
+    std::vector<std::pair<InactiveElementIndex*, bool> > indexes_; // inactive elements, is pixel
+    double phi_, etaMax_, etaStep_;
+    std::vector<Crossings> table_;
+    std::vector<std::vector<InactiveElementIndex::EntryList> > crossed_; // by grid point, then by collection of inactive elements
+    std::vector<Material> totals_;
+    Crossings noCrossings_;
+    InactiveElementIndex::EntryList noEntries_;
+
+    MaterialResponse(const MaterialResponse&);
+    MaterialResponse& operator=(const MaterialResponse&);
+  };
+}
+#endif	/* _MATERIALRESPONSE_H */
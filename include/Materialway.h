@@ -14,6 +14,7 @@
 #include <set>
 #include <string>
 #include "MaterialObject.h"
+#include "MemoryMonitor.h"
 //#include "global_constants.h"
 
 class DetectorModule;
@@ -93,7 +94,7 @@ namespace material {
      * @class Section
      * @brief Represents a single element of the materialway
      */
-    class Section {
+    class Section : public MemoryCounted<MemoryMonitor::Sections> {
     public:
       Section(int minZ, int minR, int maxZ, int maxR, Direction bearing, Section* nextSection, bool debug);
       Section(int minZ, int minR, int maxZ, int maxR, Direction bearing, Section* nextSection);
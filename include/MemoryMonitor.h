@@ -0,0 +1,120 @@
+#ifndef MemoryMonitor_h
+#define MemoryMonitor_h
+
+#include <atomic>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @class MemoryMonitor
+ * @brief This class records the memory used by the program at the boundaries of its main steps
+ *
+ * The resident set size (current and peak) and the heap in use are
+ * sampled when a step starts and when it ends: the steps are the ones
+ * measured by the StopWatch, i.e. the stages of the Squid. The peak is
+ * reset when an outermost step starts, where the platform allows it, so
+ * that it is the peak reached since the start of that step. When the
+ * program is built with MEMORY_COUNTERS defined, the main object
+ * families (modules, hits, material elements, materialway sections)
+ * also count their live objects and bytes through MemoryCounted or
+ * MemoryCountedInstances, and
+ * the counts are recorded at the end of every step. Sizes are in bytes;
+ * -1 marks a quantity not available on this platform. Only the first
+ * MaxStages steps are recorded, so that a step run in a loop cannot make
+ * the list grow without bound.
+ */
+class MemoryMonitor {
+ public:
+  enum Family { Modules, Hits, MaterialElements, Sections, NumFamilies };
+  struct Usage {
+    long rss, peakRss, heapInUse;
+  };
+  struct FamilyUsage {
+    long objects, bytes, peakBytes;
+  };
+  struct Stage {
+    std::string name;
+    unsigned int depth;   // 1 for the outermost steps
+    bool completed;
+    Usage before, after;
+    FamilyUsage families[NumFamilies]; // at the end of the step
+  };
+
+  static const size_t MaxStages = 10000; // further stages are only counted, in droppedStages()
+
+  static MemoryMonitor* instance();
+  static void destroy();
+  static Usage currentUsage();
+  static bool resetPeak();
+  static bool countersEnabled();
+  static const char* familyName(Family family);
+  static FamilyUsage familyUsage(Family family);
+  static void countAllocation(Family family, size_t size);
+  static void countDeallocation(Family family, size_t size);
+
+  void beginStage(const std::string& name);
+  void endStage();
+  const std::vector<Stage>& stages() const { return stages_; }
+  size_t droppedStages() const { return droppedStages_; }
+  void writeTable(std::ostream& out) const;
+ private:
+  MemoryMonitor() : droppedStages_(0) {}
+  ~MemoryMonitor() {}
+  MemoryMonitor(const MemoryMonitor&) = delete;
+  MemoryMonitor& operator=(const MemoryMonitor&) = delete;
+
+  static std::atomic<long> objects_[NumFamilies];
+  static std::atomic<long> bytes_[NumFamilies];
+  static std::atomic<long> peakBytes_[NumFamilies];
+  std::vector<Stage> stages_;
+  std::vector<size_t> openStages_; // NotRecorded for the stages beyond MaxStages
+  size_t droppedStages_;
+  static const size_t NotRecorded = size_t(-1);
+};
+
+/**
+ * @class MemoryCounted
+ * @brief Base class making the objects of a family count their allocations in the MemoryMonitor
+ *
+ * Only objects allocated with new are counted, with the size of their
+ * actual class. Without MEMORY_COUNTERS the class is empty and costs nothing.
+ * Families stored by value in containers use MemoryCountedInstances instead.
+ */
+template<int FamilyId> class MemoryCounted {
+#ifdef MEMORY_COUNTERS
+ public:
+  static void* operator new(size_t size) {
+    void* p = ::operator new(size);
+    MemoryMonitor::countAllocation(MemoryMonitor::Family(FamilyId), size);
+    return p;
+  }
+  static void operator delete(void* p, size_t size) {
+    if (!p) return;
+    MemoryMonitor::countDeallocation(MemoryMonitor::Family(FamilyId), size);
+    ::operator delete(p);
+  }
+#endif
+};
+
+/**
+ * @class MemoryCountedInstances
+ * @brief Base class making the objects of a family count themselves in the MemoryMonitor when built and destroyed
+ *
+ * Every instance is counted, whether it is allocated with new or held by
+ * value in a container, with the size of the Counted class: the members
+ * added by its subclasses are not seen. Without MEMORY_COUNTERS the class
+ * is empty and costs nothing.
+ */
+template<int FamilyId, class Counted> class MemoryCountedInstances {
+#ifdef MEMORY_COUNTERS
+ public:
+  MemoryCountedInstances() { MemoryMonitor::countAllocation(MemoryMonitor::Family(FamilyId), sizeof(Counted)); }
+  MemoryCountedInstances(const MemoryCountedInstances&) { MemoryMonitor::countAllocation(MemoryMonitor::Family(FamilyId), sizeof(Counted)); }
+  MemoryCountedInstances& operator=(const MemoryCountedInstances&) { return *this; }
+  ~MemoryCountedInstances() { MemoryMonitor::countDeallocation(MemoryMonitor::Family(FamilyId), sizeof(Counted)); }
+#endif
+};
+
+#endif
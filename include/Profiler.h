@@ -0,0 +1,118 @@
+#ifndef Profiler_h
+#define Profiler_h
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#define PROFILER_CONCAT_(a, b) a ## b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+#define profileZone(...) ProfileZone PROFILER_CONCAT(profileZone_, __LINE__)(__VA_ARGS__)
+
+/**
+ * @class Profiler
+ * @brief This class collects the wall-clock and CPU time spent in nested zones of the code
+ *
+ * Zones are opened and closed in a strictly nested way, either by a
+ * ProfileZone object living in the scope to be measured, or by the
+ * startTaskClock()/stopTaskClock() pair of the StopWatch. Every thread
+ * has its own stack of open zones and its own tree of statistics, so
+ * measuring only takes an uncontended per-thread lock. Wall-clock time
+ * comes from the monotonic clock, CPU time from the CPU clock of the
+ * calling thread. Besides call counts and total times per zone, the
+ * single occurrences of the zones are kept (up to a maximum number per
+ * thread) to be written as a Chrome trace-event file, which can be
+ * loaded in chrome://tracing or in Perfetto.
+ */
+class Profiler {
+ public:
+  struct Sample {
+    double wallTime; // seconds
+    double cpuTime;  // seconds
+  };
+  struct ZoneSummary {
+    std::string path;     // names of the enclosing zones and of the zone itself, separated by '/'
+    std::string name;
+    unsigned int depth;   // 1 for the outermost zones
+    long calls;
+    double wallTime, cpuTime, selfWallTime; // seconds, summed over all the calls and threads
+    unsigned int threads; // number of threads the zone ran in
+  };
+
+  static Profiler* instance();
+  static void destroy();
+  void beginZone(const std::string& name, const std::string& args = "");
+  Sample endZone();
+  unsigned int openZones();
+  std::vector<ZoneSummary> summary() const;
+  void writeChromeTrace(std::ostream& out) const;
+  void setMaxEvents(size_t maxEvents) { maxEvents_ = maxEvents; }
+ private:
+  typedef long long Nanoseconds;
+  struct Node {
+    std::string name;
+    int parent;
+    unsigned int depth;
+    long calls;
+    Nanoseconds wallTime, cpuTime, childWallTime;
+    std::map<std::string, int> children;
+  };
+  struct OpenZone {
+    int node;
+    Nanoseconds wallStart, cpuStart;
+    std::string args;
+  };
+  struct Event {
+    int node;
+    Nanoseconds start, duration;
+    std::string args;
+  };
+  struct ThreadData {
+    unsigned int id;
+    mutable std::mutex mutex;
+    std::vector<Node> nodes; // nodes[0] is the root of the tree, standing for no zone
+    std::vector<OpenZone> stack;
+    std::vector<Event> events;
+    size_t droppedEvents;
+  };
+
+  Profiler();
+  ~Profiler() {}
+  Profiler(const Profiler&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+  ThreadData& threadData();
+  Nanoseconds wallClock() const;
+  static Nanoseconds cpuClock();
+
+  static std::atomic<Profiler*> myInstance_;
+  static std::atomic<unsigned int> generation_;
+  const unsigned int myGeneration_;
+  const std::chrono::steady_clock::time_point origin_;
+  size_t maxEvents_;
+  mutable std::mutex registryMutex_;
+  std::vector<std::unique_ptr<ThreadData> > threads_;
+};
+
+/**
+ * @class ProfileZone
+ * @brief Measures the scope it lives in as a zone of the Profiler
+ *
+ * Best used through the profileZone() macro, as in
+ * profileZone("Material budget eta scan");
+ */
+class ProfileZone {
+ public:
+  explicit ProfileZone(const char* name) { Profiler::instance()->beginZone(name); }
+  ProfileZone(const char* name, const std::string& args) { Profiler::instance()->beginZone(name, args); }
+  ~ProfileZone() { Profiler::instance()->endZone(); }
+ private:
+  ProfileZone(const ProfileZone&) = delete;
+  ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+#endif
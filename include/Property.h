@@ -13,6 +13,7 @@
 #include <iostream>
 #include <typeinfo>
 #include <typeindex>
+#include <stdint.h>
 
 #include <boost/property_tree/ptree.hpp>
 
@@ -329,19 +330,83 @@ template <typename T> using RangeProperty = FixedSizeMultiProperty<T, 2, '-'>;
 typedef ptree PropertyTree;
 
 
+/**
+ * @class PropertySchema
+ * @brief The names of the properties registered by a class, compiled into a perfect hash
+ *
+ * A schema is compiled the first time an object of a class stores a tree,
+ * and shared by all the objects of that class registering the same
+ * properties. Its slots follow the property maps of the objects: the
+ * parsed-and-checked properties first, then the parsed-only and the
+ * checked-only ones, each in name order. The seed of the hash is searched
+ * so that no two names share a bucket, so that looking up a tree key costs
+ * one hash and one comparison.
+ * The schemas also keep track of the properties matched and not matched
+ * across all the objects, for reportUnmatchedProperties().
+ */
+class PropertySchema {
+public:
+  enum Kind { ParsedAndChecked, ParsedOnly, CheckedOnly };
+  static const PropertySchema& get(const std::type_info& type, const PropertyMap& parsedChecked, const PropertyMap& parsed, const PropertyMap& checked);
+  // true if the maps register exactly the names of the schema, in the same kinds
+  bool registers(const PropertyMap& parsedChecked, const PropertyMap& parsed, const PropertyMap& checked) const;
+  int slot(const string& name) const { // -1 if the name is not registered
+    int slot = buckets_[hash(name, seed_) & (buckets_.size() - 1)];
+    return slot >= 0 && names_[slot] == name ? slot : -1;
+  }
+  Kind kind(int slot) const { return slot < int(sizes_[ParsedAndChecked]) ? ParsedAndChecked : slot < int(sizes_[ParsedAndChecked] + sizes_[ParsedOnly]) ? ParsedOnly : CheckedOnly; }
+  size_t size() const { return names_.size(); }
+
+  void recordUse() const { used_ = true; }
+  void recordUnmatched(const string& name) const;
+  static std::set<string> reportUnmatched();
+private:
+  PropertySchema(const std::type_info& type, const PropertyMap& parsedChecked, const PropertyMap& parsed, const PropertyMap& checked);
+  static uint64_t hash(const string& name, uint64_t seed) { // FNV-1a
+    uint64_t h = 14695981039346656037ULL ^ (seed * 0x9e3779b97f4a7c15ULL);
+    for (char c : name) h = (h ^ (unsigned char)c) * 1099511628211ULL;
+    return h ^ (h >> 29);
+  }
+
+  std::type_index type_;
+  vector<string> names_;
+  size_t sizes_[3];
+  uint64_t seed_;
+  vector<int> buckets_;           // the size is a power of 2
+  mutable bool used_;             // all the names count as matched once an object of the schema stored a tree
+  mutable vector<bool> unmatched_; // by unmatched name id
+};
+
+
 class PropertyObject {
   PropertyMap parsedCheckedProperties_, checkedProperties_, parsedProperties_;
   PropertyTree pt_;
-  static std::set<string> globalMatchedProperties_;
-  static std::set<string> globalUnmatchedProperties_;
-
-  void processProperties(PropertyMap& props) {
-    for (auto& propElem : props) {
-      auto childRange = pt_.equal_range(propElem.first);
-      std::for_each(childRange.first, childRange.second, [&propElem](const ptree::value_type& treeElem) {
-        propElem.second->fromPtree(treeElem.second); // takes care of duplicate entries (by overwriting the property value as many times as there are entries with the same key) and of node entries (in that case the PropertyNodes differentiates based on the value)
-      });
-      pt_.erase(propElem.first);
+  const PropertySchema* schema_ = nullptr;
+
+  // Properties can be registered at any time, hence the names are compared on every use of the cached schema
+  const PropertySchema& schema() {
+    if (!schema_ || !schema_->registers(parsedCheckedProperties_, parsedProperties_, checkedProperties_)) {
+      schema_ = &PropertySchema::get(typeid(*this), parsedCheckedProperties_, parsedProperties_, checkedProperties_);
+    }
+    return *schema_;
+  }
+
+  // A single pass on the tree: the entries of the parsed properties are
+  // given to them in the order of the tree, which takes care of duplicate
+  // entries (by overwriting the property value as many times as there are
+  // entries with the same key) and of node entries (in that case the
+  // PropertyNodes differentiates based on the value), and are removed
+  void processProperties(const PropertySchema& sch) {
+    vector<Parsable*> slots;
+    slots.reserve(sch.size());
+    for (auto& propElem : parsedCheckedProperties_) slots.push_back(propElem.second);
+    for (auto& propElem : parsedProperties_) slots.push_back(propElem.second);
+    for (auto it = pt_.begin(); it != pt_.end(); ) {
+      int slot = sch.slot(it->first);
+      if (slot >= 0 && sch.kind(slot) != PropertySchema::CheckedOnly) {
+        slots[slot]->fromPtree(it->second);
+        it = pt_.erase(it);
+      } else ++it;
     }
   }
   void printAll(const PropertyTree& pt) {
@@ -357,11 +422,11 @@ protected:
   PropertyMap& parsedOnly() { return parsedProperties_; }
   PropertyMap& checkedOnly() { return checkedProperties_; }
 
-  void recordMatchedProperties() {
-    for (auto& mapel : parsedCheckedProperties_) globalMatchedProperties_.insert(mapel.first);
-    for (auto& mapel : parsedProperties_) globalMatchedProperties_.insert(mapel.first);
-    for (auto& mapel : checkedProperties_) globalMatchedProperties_.insert(mapel.first);
-    for (auto& trel : pt_) globalUnmatchedProperties_.insert(trel.first);
+  void recordMatchedProperties(const PropertySchema& sch) {
+    sch.recordUse();
+    for (auto& trel : pt_) {
+      if (sch.slot(trel.first) < 0) sch.recordUnmatched(trel.first);
+    }
   }
 
 public:
@@ -376,9 +441,9 @@ public:
     }
 //    std::cout << "============ " << pt_.data() << " ===========" << std::endl;
 //    printAll(pt_);
-    processProperties(parsedCheckedProperties_);
-    processProperties(parsedProperties_);
-    recordMatchedProperties();
+    const PropertySchema& sch = schema();
+    processProperties(sch);
+    recordMatchedProperties(sch);
   }
   virtual void check() {
     for (auto& v : parsedProperties_) {
@@ -394,16 +459,10 @@ public:
     }
   }
 
-  virtual void cleanup() { pt_.clear(); parsedCheckedProperties_.clear(); parsedProperties_.clear(); }
+  virtual void cleanup() { pt_.clear(); parsedCheckedProperties_.clear(); parsedProperties_.clear(); schema_ = nullptr; }
   virtual void cleanupTree() { pt_.clear(); }
 
-  static std::set<string> reportUnmatchedProperties() {
-    std::set<string> unmatched;
-    std::set_difference(globalUnmatchedProperties_.begin(), globalUnmatchedProperties_.end(),
-                        globalMatchedProperties_.begin(), globalMatchedProperties_.end(),
-                        std::inserter(unmatched, unmatched.end()));
-    return unmatched;
-  }
+  static std::set<string> reportUnmatchedProperties() { return PropertySchema::reportUnmatched(); }
 
 };
 
@@ -7,8 +7,6 @@
 
 
 class PtErrorAdapter {
-  static const double minimumPt;
-  static const double maximumPt;
   static const double ptMinFit;
   static const double ptMaxFit;
   // log(pt/z) distribution parameters for 12000 events at 14 TeV
@@ -22,6 +20,7 @@ class PtErrorAdapter {
    void setPterrorParameters();
 public:
    PtErrorAdapter(const DetectorModule& m) : mod_(m) { setPterrorParameters(); }
+   double computeError(double trackPt) { setPterrorParameters(); return myPtError.computeError(trackPt); }
    double getTriggerProbability(const double& trackPt, const double& stereoDistance = 0, const int& triggerWindow = 0);
    double getTriggerFrequencyTruePerEventAbove(const double& myCut);
    double getParticleFrequencyPerEventAbove(const double& myCut);
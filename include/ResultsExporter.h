@@ -0,0 +1,77 @@
+#ifndef RESULTSEXPORTER_H
+#define RESULTSEXPORTER_H
+
+#include <string>
+
+#include <Rtypes.h>
+
+class TFile;
+class TTree;
+class Tracker;
+class SimParms;
+class Track;
+
+/**
+ * @class ResultsExporter
+ * @brief Writes the per-module and per-track results of the analyses to a ROOT file, as flat trees
+ *
+ * The file holds three trees with one plain numeric (or short text) branch
+ * per column:
+ * - "modules": one row per module, with its position, type, irradiated
+ *   power, hit and stub rates, readout bandwidth and material
+ * - "materialTracks": one row per track of the material budget scan
+ * - "resolutionTracks": one row per track and momentum of the resolution
+ *   scan, with the errors on the track parameters
+ * Rows are filled as soon as they are computed: ROOT writes them to the
+ * file by baskets, column by column, so that nothing is kept in memory
+ * and the columns can be read back independently.
+ */
+class ResultsExporter {
+public:
+  ResultsExporter();
+  ~ResultsExporter();
+  bool open(const std::string& fileName);
+  bool isOpen() const { return file_ != nullptr; }
+  void fillModules(Tracker& tracker, const SimParms& simParms, const std::string& detector);
+  void fillMaterialTrack(Track& track, const std::string& detector);
+  void fillResolutionTrack(Track& track, const std::string& detector, const std::string& tag, bool constantP, bool ideal);
+  bool close();
+private:
+  struct ModuleRow {
+    Char_t detector[16], section[32], type[64];
+    Int_t layer, ring, phiIndex, side;
+    Double_t r, z, phi;                        // mm, mm, rad
+    Double_t irradiationPower;                 // W
+    Double_t hitChannels;                      // per bunch crossing, all sensors
+    Double_t trueStubs, fakeStubs;             // per bunch crossing
+    Double_t bandwidth, sparsifiedBandwidth;   // bps
+    Double_t radiationLength, interactionLength; // fraction of X0 and lambda, -1 if not computed
+  };
+  struct MaterialTrackRow {
+    Char_t detector[16];
+    Double_t eta, phi;
+    Double_t radiationLength, interactionLength;
+  };
+  struct ResolutionTrackRow {
+    Char_t detector[16], tag[32];
+    Bool_t constantP, ideal;
+    Double_t pt, p, eta, phi;                  // GeV/c, GeV/c
+    Double_t deltaPtOverPt, deltaPOverP;       // fractions
+    Double_t deltaD0, deltaZ0;                 // mm
+    Double_t deltaPhi, deltaCtgTheta;          // rad, absolute
+    Double_t radiationLength, interactionLength;
+    Int_t activeHits;
+  };
+
+  void createTrees();
+
+  TFile* file_;
+  TTree* modules_;
+  TTree* materialTracks_;
+  TTree* resolutionTracks_;
+  ModuleRow module_;
+  MaterialTrackRow materialTrack_;
+  ResolutionTrackRow resolutionTrack_;
+};
+
+#endif
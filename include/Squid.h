@@ -22,6 +22,7 @@
 #include <Analyzer.h>
 #include <Vizard.h>
 #include <tk2CMSSW.h>
+#include <ResultsExporter.h>
 #include <boost/filesystem/exception.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/property_tree/ptree.hpp>
@@ -108,11 +109,20 @@ namespace insur {
     void setBasename(std::string newBaseName);
     void setGeometryFile(std::string geomFile);
     void setHtmlDir(std::string htmlDir);
+    bool openResultsFile(std::string fileName);
+    bool exportResults();
+    bool serve(std::string socketPath);
 
-    void simulateTracks(const po::variables_map& varmap, int seed);
+    bool simulateTracks(const po::variables_map& varmap, int seed);
     void setCommandLine(int argc, char* argv[]);
     void pixelExtraction(std::string xmlout);
     void createAdditionalXmlSite(std::string xmlout);
+    Tracker* getTracker() { return tr; }
+    InactiveSurfaces* getInactiveSurfaces() { return is; }
+    MaterialBudget* getMaterialBudget() { return mb; }
+    MaterialBudget* getPixelMaterialBudget() { return pm; }
+    SimParms* getSimParms() { return simParms_; }
+    MaterialTable& getMaterialTable() { return tkMaterialCalc.getMaterialTable(); }
   private:
     //std::string g;
     Tracker* tr;
@@ -134,11 +144,13 @@ namespace insur {
     Vizard v;
     mainConfigHandler& mainConfiguration;
     tk2CMSSW t2c;
+    ResultsExporter resultsExporter_;
     bool fileExists(std::string filename);
     std::string extractFileName(const std::string& full);
     Squid(const Squid& s);
     Squid& operator=(const Squid& s);
     void resetVizard();
+    void renderPages();
     std::string baseName_;
     std::string htmlDir_;
     std::string getGeometryFile();
@@ -2,9 +2,9 @@
 #define StopWatch_h
 
 #include <messageLogger.h>
-#include <ctime>
+#include <Profiler.h>
+#include <MemoryMonitor.h>
 #include <string>
-#include <list>
 
 #define startTaskClock(message) StopWatch::instance()->startCounter(message)
 #define addTaskInfo(message) StopWatch::instance()->addInfo(message)
@@ -12,14 +12,15 @@
 
 /**
  * @class StopWatch
- * @brief This class measures the CPU time used between two moments
+ * @brief This class reports on the console the time used by the main steps of the program
  *
- * It uses the ctime library to call time(), which is measuring the
- * CPU time used by the process so far. It works nicely as long as the
- * counter does not flip over (which should happen every 72 minutes at
- * most in a 32 bit CPU) The stop watch is started by the constructyor
- * (and by restart()) and it gives the elapsed CPU time in seconds
- * when asked
+ * Every step started with startTaskClock() and finished with
+ * stopTaskClock() is measured as a zone of the Profiler, so it also
+ * appears in the profiling summary and trace. On the console the steps
+ * are printed as they start, indented by nesting level, down to the
+ * requested verbosity, followed by the wall-clock and CPU time used
+ * when they are done. The steps are also the stages at which the
+ * MemoryMonitor samples the memory in use.
  */
 class StopWatch {
  public:
@@ -33,8 +34,7 @@ class StopWatch {
   StopWatch();
   ~StopWatch();
   static StopWatch* myInstance_;
-  std::list<clock_t> startTimes_;
-  double diffClock(const clock_t& stopTime, const clock_t& startTime);
+  unsigned int openCounters_;
   unsigned int verbosity_;
   unsigned int lastVerbosity_;
   bool reportTime_;
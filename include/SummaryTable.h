@@ -3,6 +3,8 @@
 
 #include <map>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 #include "global_funcs.h"
 
@@ -10,32 +12,79 @@
 /**
  * @class SummaryTable
  * @brief A generic object to build summary tables
+ *
+ * Cells keep numbers as numbers: accumulating into a cell works on the
+ * stored value, and the text of the cells is only produced, with the
+ * precision of the table, when the content is taken for display.
  */
 
 class SummaryTable {
 public:
+  /**
+   * @class Cell
+   * @brief One cell of the table, holding an integer, a floating point number or a text
+   */
+  class Cell {
+  public:
+    enum Type { Empty, Integer, Real, Text };
+    Cell() : type_(Empty), integer_(0), real_(0) {}
+    template<typename T> void set(const T& content) { set(content, Kind<T>()); }
+    template<typename T> T get() const { return get<T>(Kind<T>()); }
+    Type type() const { return type_; }
+    bool empty() const { return type_ == Empty; }
+    std::string format(int precision) const;
+  private:
+    // 0: bool, 1: other integral types, 2: floating point types, 3: anything else (stored as text)
+    template<typename T> using Kind = std::integral_constant<int, std::is_same<T, bool>::value ? 0 :
+                                                                  std::is_integral<T>::value ? 1 :
+                                                                  std::is_floating_point<T>::value ? 2 : 3>;
+    template<typename T> void set(const T& content, std::integral_constant<int, 0>) { type_ = Text; text_ = any2str(content); }
+    template<typename T> void set(const T& content, std::integral_constant<int, 1>) { type_ = Integer; integer_ = content; }
+    template<typename T> void set(const T& content, std::integral_constant<int, 2>) { type_ = Real; real_ = content; }
+    template<typename T> void set(const T& content, std::integral_constant<int, 3>) { type_ = Text; text_ = any2str(content); }
+    template<typename T, int K> T get(std::integral_constant<int, K>) const {
+      switch (type_) {
+      case Integer: return T(integer_);
+      case Real: return T(real_);
+      case Text: return str2any<T>(text_);
+      default: return T();
+      }
+    }
+    template<typename T> T get(std::integral_constant<int, 0>) const { return type_ == Text ? str2any<T>(text_) : T(); }
+    template<typename T> T get(std::integral_constant<int, 3>) const { return type_ == Empty ? T() : str2any<T>(format(-1)); }
+
+    Type type_;
+    long long integer_;
+    double real_;
+    std::string text_;
+  };
+
   SummaryTable() : numRows_(0), numColumns_(0), rowOffset_(0), columnOffset_(0), precision_(-1), summaryCellPosition_(0,0), summaryLabelPosition_(0,0) {};
   void setHeader(std::string rowHeader, std::string columnHeader, int rowOffset = 0, int columnOffset = 0) { // has to be called before filling the table with content or the row and column numbering will not be correctly set
     rowOffset_ = rowOffset; columnOffset_ = columnOffset;
-    summaryTable[std::make_pair(0,0)] = columnHeader + " &rarr;<br>" + rowHeader + " &darr;";
+    cell(0, 0).set(columnHeader + " &rarr;<br>" + rowHeader + " &darr;");
   }
-  void setPrecision(int precision) { precision_ = precision; } // has to be called before filling the table or conversions from floating point won't have the desired precision
+  void setPrecision(int precision) { precision_ = precision; } // precision used to display floating point numbers
 
-  template<typename T> void setCell(int row, int column, const T& content) { setCell(row, column, any2str(content, precision_)); }
-  template<typename T, typename BinaryOp> void setCell(int row, int column, const T& content, BinaryOp binop) { setCell(row, column, binop(hasCell(row, column) ? str2any<T>(getCell(row, column)) : T(), content)); }
+  template<typename T> void setCell(int row, int column, const T& content) { Cell newCell; newCell.set(content); putCell(row, column, newCell); }
+  template<typename T, typename BinaryOp> void setCell(int row, int column, const T& content, BinaryOp binop) { setCell(row, column, binop(hasCell(row, column) ? getCellValue<T>(row, column) : T(), content)); }
 
-  template<typename T> void setSummaryCell(std::string label, const T& content) { setSummaryCell(label, any2str(content, precision_)); }
+  template<typename T> void setSummaryCell(std::string label, const T& content) { Cell newCell; newCell.set(content); putSummaryCell(label, newCell); }
 
-  std::string getCell(int row, int column) { return summaryTable[std::make_pair(row,column)];} // this actually alters the map if the cell's not there = DANGEROUS
+  std::string getCell(int row, int column) const { return hasCell(row, column) ? cells_[row][column].format(precision_) : std::string(); }
+  template<typename T> T getCellValue(int row, int column) const { return hasCell(row, column) ? cells_[row][column].get<T>() : T(); }
 
-  bool hasCell(int row, int column) const { return summaryTable.count(std::make_pair(row,column)); }  // tests whether a cell has already been inserted = SAFE
+  bool hasCell(int row, int column) const { return row >= 0 && row < int(cells_.size()) && column >= 0 && column < int(cells_[row].size()) && !cells_[row][column].empty(); }  // tests whether a cell has already been inserted = SAFE
   bool hasSummaryCell() const { return summaryCellPosition_ > std::make_pair(0, 0); }
 
-  std::map<std::pair<int, int>, std::string>& getContent() { return summaryTable; }
+  std::map<std::pair<int, int>, std::string> getContent() const; // the text of the cells, formatted now
 
-  void clear() { summaryTable.clear(); }
+  void clear() { cells_.clear(); }
 private:
-  std::map<std::pair<int, int>, std::string> summaryTable;
+  Cell& cell(int row, int column);
+  void putCell(int row, int column, const Cell& content);
+  void putSummaryCell(const std::string& label, const Cell& content);
+  std::vector<std::vector<Cell> > cells_; // by row, then by column
   int numRows_, numColumns_;
   int rowOffset_, columnOffset_; // from which number rows and columns headers should start
   int precision_; // precision to convert floating point numbers with
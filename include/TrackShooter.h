@@ -8,6 +8,7 @@
 #include <list>
 #include <vector>
 #include <memory>
+#include <limits>
 
 
 #include <TRandom3.h>
@@ -28,7 +29,8 @@
 
 #include <global_funcs.h>
 #include <global_constants.h>
-#include <module.hh>
+#include <DetectorModule.h>
+#include <PtErrorAdapter.h>
 #include <PlotDrawer.h>
 #include <Palette.h>
 
@@ -40,7 +42,7 @@ template<typename T> int getPointOctant(const T& x, const T& y, const T& z) {
 
 typedef ROOT::Math::DisplacementVector2D<ROOT::Math::Cartesian2D<double>,ROOT::Math::DefaultCoordinateSystemTag> XYVector; // CUIDADO The version of ROOT tkLayout is linked with misses this typedef
 
-std::set<int> getModuleOctants(const Module* mod);
+std::set<int> getModuleOctants(const DetectorModule* mod);
 
 
 class ParticleGenerator {
@@ -140,6 +142,10 @@ struct Tracks { // holder struct for TTree export
     pt.push_back(pt_);
     nhits.push_back(nhits_);
   }
+  void assign(const Tracks& other, int i) { // copies track i of other, in place of the current content
+    clear();
+    push_back(other.eventn[i], other.trackn[i], other.eta[i], other.phi0[i], other.z0[i], other.pt[i], other.nhits[i]);
+  }
   void setupBranches(TTree& tree) {
     tree.Branch((name + ".eventn").c_str(), &eventn);
     tree.Branch((name + ".trackn").c_str(), &trackn);
@@ -189,6 +195,20 @@ struct Hits { // holder struct for TTree export
 //    eta.push_back(eta_);
   }
   int size() const { return glox.size(); }
+  void assign(const Hits& other, int first, int count) { // copies the hits [first, first+count) of other, in place of the current content
+    glox.assign(other.glox.begin() + first, other.glox.begin() + first + count);
+    gloy.assign(other.gloy.begin() + first, other.gloy.begin() + first + count);
+    gloz.assign(other.gloz.begin() + first, other.gloz.begin() + first + count);
+    locx.assign(other.locx.begin() + first, other.locx.begin() + first + count);
+    locy.assign(other.locy.begin() + first, other.locy.begin() + first + count);
+    pterr.assign(other.pterr.begin() + first, other.pterr.begin() + first + count);
+    hitprob.assign(other.hitprob.begin() + first, other.hitprob.begin() + first + count);
+    deltas.assign(other.deltas.begin() + first, other.deltas.begin() + first + count);
+    cnt.assign(other.cnt.begin() + first, other.cnt.begin() + first + count);
+    z.assign(other.z.begin() + first, other.z.begin() + first + count);
+    rho.assign(other.rho.begin() + first, other.rho.begin() + first + count);
+    phi.assign(other.phi.begin() + first, other.phi.begin() + first + count);
+  }
 
   void setupBranches(TTree& tree) {
     tree.Branch((name + ".glox").c_str(), &glox);
@@ -225,8 +245,8 @@ struct Helix {
     : pt(pt_), eta(eta_), phi0(phi0_), z0(z0_), d0(d0_) {
       theta = 2*atan(exp(-eta));
       R = fabs(pt)/(0.3*insur::magnetic_field) * 1e3;
-      Rs = R*dir + d0;
       dir = signum(pt);
+      Rs = R*dir + d0;
       h = -Rs*sin(phi0);
       k =  Rs*cos(phi0);
       L = tan(M_PI/2 - theta);
@@ -235,10 +255,13 @@ struct Helix {
 
 
 
+// The values are drawn from the generator passed in, so that the same value
+// definitions can be shared by threads having each their own generator
 template<class T>
 class Value {
 public:
-  virtual T get() = 0;
+  virtual ~Value() {}
+  virtual T get(TRandom& die) const = 0;
   virtual std::string toString() const = 0;
 };
 
@@ -247,52 +270,52 @@ class ConstValue : public Value<T> {
   T value_;
 public:
   ConstValue(T value) : value_(value) {}
-  T get() { return value_; }
+  T get(TRandom&) const { return value_; }
   std::string toString() const { return any2str(value_); } 
 };
 
 template<class T>
 class UniformValue : public Value<T> {
-  TRandom& die_;
   T min_, max_;
 public:
-  UniformValue(TRandom& die, T min, T max) : die_(die), min_(min), max_(max) {}
-  T get() { return die_.Uniform(min_, max_); }
+  UniformValue(T min, T max) : min_(min), max_(max) {}
+  T get(TRandom& die) const { return die.Uniform(min_, max_); }
   std::string toString() const { return any2str(min_) + ":" + any2str(max_); }
 };
 
 template<class T>
 class BinaryValue : public Value<T> {
-  TRandom& die_;
   T value0_, value1_;
 public:
-  BinaryValue(TRandom& die, T value0, T value1) : die_(die), value0_(value0), value1_(value1) {}
-  T get() { return die_.Integer(2) ? value1_ : value0_; }
+  BinaryValue(T value0, T value1) : value0_(value0), value1_(value1) {}
+  T get(TRandom& die) const { return die.Integer(2) ? value1_ : value0_; }
   std::string toString() const { return any2str(value0_) + "," + any2str(value1_); }
 };
 
-/*
-template<>
-class BinaryValue<bool> : public Value<bool> {
-  TRandom& die_;
-  BinaryValue(TRandom& die) : die_(die) {}
-  bool get() { return die_.Integer(2); }
-  std::string toString() const { return "true|false"; }
-};
-*/
-
 template<class T>
-std::auto_ptr<Value<T> > valueFromString(TRandom& die, const std::string& str) {
+std::unique_ptr<Value<T> > valueFromString(const std::string& str) {
   std::vector<std::string> values = split(str, ":,");
-  if (str.find(":") != std::string::npos && values.size() == 2) return std::auto_ptr<Value<T> >(new UniformValue<T>(die, str2any<T>(values[0]), str2any<T>(values[1])));
-  else if (str.find(",") != std::string::npos && values.size() == 2) return std::auto_ptr<Value<T> >(new BinaryValue<T>(die, str2any<T>(values[0]), str2any<T>(values[1])));
-  else return std::auto_ptr<Value<T> >(new ConstValue<T>(str2any<T>(values[0])));
+  if (str.find(":") != std::string::npos && values.size() == 2) return std::unique_ptr<Value<T> >(new UniformValue<T>(str2any<T>(values[0]), str2any<T>(values[1])));
+  else if (str.find(",") != std::string::npos && values.size() == 2) return std::unique_ptr<Value<T> >(new BinaryValue<T>(str2any<T>(values[0]), str2any<T>(values[1])));
+  else return std::unique_ptr<Value<T> >(new ConstValue<T>(str2any<T>(values[0])));
 }
 
 
 
+/**
+ * @class TrackShooter
+ * @brief Simulates events of helix tracks through the modules of a tracker and writes their hits to a ROOT file
+ *
+ * The events are split in blocks, which are simulated by a pool of worker
+ * threads. Each block is simulated with a generator seeded from the random
+ * seed and the block number only, so that the output does not depend on the
+ * number of threads. The blocks are written by the calling thread alone, in
+ * event order, one tree entry per track.
+ */
 class TrackShooter {
-  static const float HIGH_PT_THRESHOLD = 2.;
+  static constexpr float HIGH_PT_THRESHOLD = 2.;
+  static const long int TRACKS_PER_BLOCK = 1000;   // tracks simulated in one go by a worker
+  static const int BLOCKS_PER_THREAD = 4;          // blocks waiting to be written, per worker, before the workers stop
 
   double trackerMaxRho_;
   double barrelMinZ_, barrelMaxZ_;
@@ -300,7 +323,7 @@ class TrackShooter {
   std::ostream* output_;
   const char *FS, *LS;
 
-  std::vector<Module*> allMods_;
+  std::vector<DetectorModule*> allMods_;
   typedef std::list<BarrelModule*> BarrelModules;   // accessed sequentially. last step in hit localization
   typedef std::list<EndcapModule*> EndcapModules;
   typedef std::vector<BarrelModules> BarrelOctants; // these vectors are accessed randomly when the octant of the hit is known (function of the radius/z discovered in the previous step)
@@ -310,23 +333,36 @@ class TrackShooter {
   BarrelRadii barrelModsByRadius_;
   EndcapZs endcapModsByZ_;
 
-  TRandom3 die_;
-  std::auto_ptr<Value<double> > eta_, phi0_, z0_, pt_, invPt_;  // auto_ptr because I don't want to be bothered with deletion
-  std::auto_ptr<Value<int> > charge_;
+  std::unique_ptr<Value<double> > eta_, phi0_, z0_, pt_, invPt_;
+  std::unique_ptr<Value<int> > charge_;
   bool useInvPt_;
+  UInt_t seed_;
 
   long int numEvents_, numTracksEv_, eventOffset_;
+  int numThreads_;
   std::string instanceId_;
   std::string tracksDir_;
 
-  int detectCollisionSlanted(const Helix& helix, const Polygon3d<4>& poly, std::vector<XYZVector>& collisions);
-  int detectCollisionBarrel(const Helix& helix, const Polygon3d<4>& poly, std::vector<XYZVector>& collisions);
-  int detectCollisionEndcap(const Helix& helix, const Polygon3d<4>& poly, std::vector<XYZVector>& collisions);
+  struct EventBlock { // the tracks of consecutive events, with their hits one after the other
+    Tracks tracks;
+    Hits hits;
+    std::vector<int> firstHits; // index of the first hit of each track
+    bool ready;
+    EventBlock() : tracks("tracks"), hits("hits"), ready(false) {}
+  };
+
+  int detectCollisionBarrel(const Helix& helix, const Polygon3d<4>& poly, std::vector<XYZVector>& collisions) const;
+  int detectCollisionEndcap(const Helix& helix, const Polygon3d<4>& poly, std::vector<XYZVector>& collisions) const;
 
   XYVector convertToLocalCoords(const XYZVector& globalHit, const BarrelModule* mod) const;
   XYVector convertToLocalCoords(const XYZVector& globalHit, const EndcapModule* mod) const;
 
-  void shootTracks();
+  void addHit(const XYZVector& hit, const XYVector& local, const DetectorModule* mod, double pt, Hits& hits) const;
+  void shootTrack(const Helix& helix, std::vector<XYZVector>& collisions, Hits& hits) const;
+  void shootEvents(long int firstEvent, long int lastEvent, TRandom& die, std::vector<XYZVector>& collisions, EventBlock& block) const;
+  UInt_t blockSeed(UInt_t baseSeed, long int block) const;
+
+  bool shootTracks();
 
   void setDefaultParameters();
 
@@ -335,12 +371,10 @@ public:
   TrackShooter() : trackerMaxRho_(std::numeric_limits<double>::max()), barrelMinZ_(0.), barrelMaxZ_(0.) { setDefaultParameters(); }
   void setOutput(std::ostream& output, const char* fieldSeparator = "\t", const char* lineSeparator = "\n", bool synced = false);
   void setTrackerBoundaries(double trackerMaxRho, double barrelMinZ, double barrelMaxZ);  // if not set the tracker is considered infinite in the rho direction and no particle can escape without ever curving back
-  void addModule(Module* module);
-  void shootTracks(long int numEvents, long int numTracksPerEvent, int seed);
-  void shootTracks(const po::variables_map& varmap, int seed);
+  void addModule(DetectorModule* module);
+  bool shootTracks(long int numEvents, long int numTracksPerEvent, int seed);
+  bool shootTracks(const po::variables_map& varmap, int seed);
   void exportGeometryData();
-  //void manualPolygonTestBench();
-  //void moduleTestBench();
 };
 
 #endif
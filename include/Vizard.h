@@ -51,6 +51,8 @@
 #include <vector>
 #include <set>
 #include <Palette.h>
+#include <Profiler.h>
+#include <MemoryMonitor.h>
 
 #include <PlotDrawer.h>
 
@@ -190,7 +192,10 @@ namespace insur {
     void drawInactiveSurfacesSummary(MaterialBudget& mb, RootWPage& page); 
     bool additionalInfoSite(const std::string& settingsfile,
                             Analyzer& analyzer, Analyzer& pixelAnalyzer, Tracker& tracker, SimParms& simparms, RootWSite& site);
-    bool makeLogPage(RootWSite& site);
+    void makeLogPage(RootWSite& site);
+    bool makeLogPage(RootWPage& myPage);
+    bool makeProfileSummary(RootWPage& myPage);
+    bool makeMemorySummary(RootWPage& myPage);
     std::string getSummaryString();
     std::string getSummaryLabelString();
     void setCommandLine(std::string commandLine) { commandLine_ = commandLine; }
@@ -1,22 +1,55 @@
 #ifndef WEIGHTDISTRIBUTIONGRID_H
 #define WEIGHTDISTRIBUTIONGRID_H
 
+#include <cstddef>
 #include <map>
+#include <utility>
+#include <vector>
 
 namespace material {
 
   class MaterialObject;
-  
-  typedef std::map<std::pair<int, int>,double> WeightDistributionGridMapType;
 
-  class WeightDistributionGrid : public WeightDistributionGridMapType {
+  /**
+   * @class WeightDistributionGrid
+   * @brief Sparse (z, r) grid of deposited grams
+   *
+   * Bins are square with side binDimension, bin (i, j) covering
+   * [i*binDimension, (i+1)*binDimension) in z and the same in r. The bins
+   * are grouped in square tiles of TileSize x TileSize bins, stored row-wise
+   * and allocated the first time one of their bins is filled: only the
+   * region actually reached by the material costs memory, and rectangular
+   * fills still run over contiguous rows. Grids with the same binning can be
+   * merged, which allows filling one private grid per thread and summing
+   * them at the end.
+   */
+  class WeightDistributionGrid {
   public:
+    static const int TileSize = 64;
+
     WeightDistributionGrid(double binDimension);
     virtual ~WeightDistributionGrid() {};
+
     void addTotalGrams(double minZ, double minR, double maxZ, double maxR, double length, double surface, const MaterialObject& materialObject);
+    void addGrams(double minZ, double minR, double maxZ, double maxR, double grams);
+    void merge(const WeightDistributionGrid& other);
+    void reset();
+
     double binDimension() const;
+    bool empty() const { return tiles_.empty(); }
+    size_t numTiles() const { return tiles_.size(); }
+    double grams(int binIndexZ, int binIndexR) const;
+    double totalGrams() const;
   private:
+    typedef std::pair<int, int> TileIndex; // (z, r) index of the tile
+    typedef std::vector<double> Tile;      // TileSize rows of TileSize bins
+
+    static int tileOf(int binIndex) { return binIndex >= 0 ? binIndex / TileSize : -((-binIndex - 1) / TileSize) - 1; }
+    Tile& tile(int tileZ, int tileR);
+
     double binDimension_;
+    std::map<TileIndex, Tile> tiles_;
+    std::vector<double> zFractions_;   // scratch row of z overlaps, reused between fills
   };
 }
 
@@ -0,0 +1,80 @@
+/**
+ * @file XMLStream.h
+ * @brief This is the header file for the buffered output stream and the preloaded skeleton files used to write CMSSW XML
+ */
+
+#ifndef _XMLSTREAM_H
+#define	_XMLSTREAM_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <ostream>
+
+namespace insur {
+    /**
+     * @class XMLStream
+     * @brief A minimal output stream for CMSSW XML files that writes through a large fixed buffer.
+     *
+     * Text is copied straight into the buffer, which is handed over to the underlying stream whenever it fills up,
+     * so that a document never has to be assembled in memory as a whole. Numbers are formatted without going through
+     * the iostream machinery, but the result is the same as for a <i>std::ostream</i> with default formatting (six
+     * significant digits, trailing zeros removed). The buffer is flushed when the stream goes out of scope.
+     */
+    class XMLStream {
+    public:
+        static const size_t bufferSize = 1 << 20;
+        explicit XMLStream(std::ostream& out);
+        ~XMLStream();
+        XMLStream& operator<<(const std::string& s) { write(s.data(), s.size()); return *this; }
+        XMLStream& operator<<(const char* s);
+        XMLStream& operator<<(char c) { if (used_ == buffer_.size()) flush(); buffer_[used_++] = c; return *this; }
+        XMLStream& operator<<(int i) { return writeInteger(i); }
+        XMLStream& operator<<(long i) { return writeInteger(i); }
+        XMLStream& operator<<(long long i) { return writeInteger(i); }
+        XMLStream& operator<<(unsigned int i) { return writeUnsigned(i, false); }
+        XMLStream& operator<<(unsigned long i) { return writeUnsigned(i, false); }
+        XMLStream& operator<<(unsigned long long i) { return writeUnsigned(i, false); }
+        XMLStream& operator<<(double d);
+        XMLStream& operator<<(float f) { return operator<<(double(f)); }
+        void write(const char* data, size_t size);
+        void flush();
+        bool fail() const { return out_.fail(); }
+        static size_t formatDouble(double d, char* result);
+    private:
+        XMLStream& writeInteger(long long i) { return (i < 0) ? writeUnsigned(0ULL - (unsigned long long)i, true) : writeUnsigned(i, false); }
+        XMLStream& writeUnsigned(unsigned long long i, bool negative);
+        std::ostream& out_;
+        std::vector<char> buffer_;
+        size_t used_;
+
+        XMLStream(const XMLStream&);
+        XMLStream& operator=(const XMLStream&);
+    };
+
+    /**
+     * @class XMLTemplate
+     * @brief A skeleton file for one of the CMSSW XML files, loaded into memory once.
+     *
+     * The lines carrying the XML preamble and the insertion markers are located when the file is loaded, so writing
+     * a document from the skeleton only copies the text between precomputed offsets into the output. Copying works
+     * line by line as when reading the skeleton with <i>std::getline()</i>: the line with a marker is not copied itself,
+     * and a missing newline at the end of the file is added.
+     */
+    class XMLTemplate {
+    public:
+        enum Marker { preamble, insertion };
+        static const size_t npos = std::string::npos;
+        bool load(const std::string& filename);
+        bool empty() const { return text_.empty(); }
+        size_t copyUntil(size_t from, Marker marker, XMLStream& out, std::string* markerLine = NULL) const;
+        void copyRest(size_t from, XMLStream& out) const;
+        void copyReplacingMarkers(const std::string& replacement, XMLStream& out) const;
+    private:
+        struct Line { size_t begin, marker, end; }; // marker is the offset of the marker text within the line
+        void findLines(const std::string& marker, std::vector<Line>& lines) const;
+        std::string text_;
+        std::vector<Line> preambleLines_, insertionLines_;
+    };
+}
+#endif	/* _XMLSTREAM_H */
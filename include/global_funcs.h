@@ -50,6 +50,23 @@ public:
   }
 };
 
+// Arithmetic types are converted without a stream (see global_funcs.cpp), with the same results
+#define declare_numeric_conversions(T) \
+  template<> T StringConverter<_NOT_STRING_ENUM>::str2any<T>(const std::string& from); \
+  template<> std::string StringConverter<_NOT_STRING_ENUM>::any2str<T>(const T& from, int precision)
+
+declare_numeric_conversions(short);
+declare_numeric_conversions(unsigned short);
+declare_numeric_conversions(int);
+declare_numeric_conversions(unsigned int);
+declare_numeric_conversions(long);
+declare_numeric_conversions(unsigned long);
+declare_numeric_conversions(long long);
+declare_numeric_conversions(unsigned long long);
+declare_numeric_conversions(float);
+declare_numeric_conversions(double);
+declare_numeric_conversions(long double);
+
 
 
 
@@ -15,6 +15,7 @@
 #include <TMatrixT.h>
 #include <TMatrixTSym.h>
 #include <messageLogger.h>
+#include <MemoryMonitor.h>
 
 
 #include <TFile.h>
@@ -44,7 +45,7 @@ typedef double momentum;  // Track momentum in MeV
  * All the other information is available to both categories. For convenience, the scaled radiation and interaction lengths are stored in
  * here as well to avoid additional computation and callbacks to the material property objects.
  */
-class Hit {
+class Hit : public MemoryCounted<MemoryMonitor::Hits> {
 protected:
   double distance_;   // distance of hit from origin in 3D
   double radius_; // distance of hit from origin in the x/y plane
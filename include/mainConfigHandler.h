@@ -9,6 +9,8 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <map>
+#include <ctime>
 #include <global_constants.h>
 #include <global_funcs.h>
 
@@ -65,10 +67,42 @@ public:
   string getGeometriesDirectory();
   string getConfigFileName();
   std::set<string> preprocessConfiguration(ConfigInputOutput);
+  void clearPreprocessCache() { preprocessCache_.clear(); } // the next includes are read again from their files
   vector<double>& getMomenta();
   vector<double>& getTriggerMomenta();
   vector<double>& getThresholdProbabilities();
 private:
+  // One file of the include graph, with the files it includes
+  struct IncludeNode {
+    string absoluteFileName;
+    string relativeFileName;
+    bool standardInclude;
+    vector<IncludeNode> children;
+  };
+  // What tells whether a file changed: the modification time alone has a 1 s granularity on some file systems
+  struct FileStamp {
+    std::time_t seconds = -1;
+    long nanoseconds = 0;
+    long long size = -1;
+    bool operator==(const FileStamp& other) const { return seconds == other.seconds && nanoseconds == other.nanoseconds && size == other.size; }
+  };
+  static FileStamp fileStamp(const string& fileName);
+  // The expansion of a configuration file, with all its includes
+  struct PreprocessedFile {
+    string content;
+    std::set<string> includeSet;                      // this file and all the files it includes
+    vector<std::pair<string, FileStamp> > fileStamps; // modification times and sizes of the same files when they were read
+    IncludeNode node;
+    bool usesIncludePath = false;                     // some @include was looked up in the include path list
+    bool complete = true;                             // every include could be read
+  };
+  // Included files already expanded, by canonical path and context (see preprocessCacheKey),
+  // emptied when it would hold more than MaxPreprocessedFiles
+  static const size_t MaxPreprocessedFiles = 1000;
+  std::map<string, PreprocessedFile> preprocessCache_;
+  bool expandConfiguration(ConfigInputOutput& cfgInOut, PreprocessedFile& result);
+  const PreprocessedFile* expandInclude(const ConfigInputOutput& parent, const string& fullIncludedFileName, const string& relativeFileName, bool standardInclude);
+  void replayIncludeNode(const IncludeNode& node, const string& relativeFileName, bool webOutput);
   bool goodConfigurationRead_;
   //string styleDirectory_;
   string binDirectory_;
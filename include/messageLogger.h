@@ -1,10 +1,14 @@
 #ifndef MESSAGELOGGER_H
 #define MESSAGELOGGER_H
 
+#include <atomic>
+#include <cstdint>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <set>
 #include <list>
+#include <unordered_map>
 #include <vector>
 #include <string>
 #include <sstream>
@@ -19,6 +23,12 @@
 #define logUniqueINFO(message) MessageLogger::instance()->addMessage(__func__, message, MessageLogger::INFO, MessageLogger::UNIQUE)
 #define logUniqueDEBUG(message) MessageLogger::instance()->addMessage(__func__, message, MessageLogger::DEBUG, MessageLogger::UNIQUE)
 
+// Versions of the above which can be used from any thread
+#define logConcurrentERROR(message) MessageLogger::enqueueMessage(__func__, message, MessageLogger::ERROR)
+#define logConcurrentWARNING(message) MessageLogger::enqueueMessage(__func__, message, MessageLogger::WARNING)
+#define logConcurrentINFO(message) MessageLogger::enqueueMessage(__func__, message, MessageLogger::INFO)
+#define logConcurrentDEBUG(message) MessageLogger::enqueueMessage(__func__, message, MessageLogger::DEBUG)
+
 using namespace std;
 
 class LogMessage {
@@ -27,13 +37,28 @@ class LogMessage {
   ~LogMessage() {};
   int level;
   string message;
+  unsigned long sequence; // order of arrival over all levels
 };
 
+/**
+ * @class MessageLogger
+ * @brief Collects the messages of the program by level, to be shown on screen and on the log page
+ *
+ * Messages are kept in one buffer per level, so that the log of a level
+ * is read and emptied in a single pass. Unique messages are looked up by
+ * a 64-bit hash of their text, and compared by text when the hash is
+ * already known. Messages from threads other than the main one should go
+ * through enqueueMessage(), which only pushes them on a lock-free list:
+ * they are moved to the level buffers, and echoed on screen, by the next
+ * call to the logger, or at exit. The buffers are guarded by a mutex, so
+ * any call is safe from any thread.
+ */
 class MessageLogger {
  public:
   static MessageLogger* instance();
   bool addMessage(string sourceFunction, string message, int level=UNKNOWN, bool unique=false);
   bool addMessage(string sourceFunction, ostringstream& message, int level=UNKNOWN, bool unique=false);
+  static bool enqueueMessage(const string& sourceFunction, const string& message, int level=UNKNOWN, bool unique=false);
   static string getLatestLog();
   static string getLatestLog(int level);
   // NumberOfLevels should always be the last here
@@ -44,15 +69,30 @@ class MessageLogger {
   static bool hasEmptyLog(int level);
   void setScreenLevel(int screenLevel) { screenLevel_ = screenLevel; }
  private:
+  struct PendingMessage {
+    string sourceFunction;
+    LogMessage logMessage;
+    bool unique;
+    PendingMessage* next;
+  };
+
   ~MessageLogger();
   MessageLogger();
   MessageLogger(MessageLogger const&){};
-  static MessageLogger* myInstance_;
-  static std::vector<LogMessage> logMessageV;
+  // the following ones expect the mutex to be held
+  static bool storeMessage(const string& sourceFunction, LogMessage& newMessage, bool unique);
+  static void collectPending();
+  static void collectPendingAtExit();
+  static void sortLevel(int level);
+  static uint64_t messageHash(const string& message);
+  static std::vector<LogMessage> levelMessages_[];
+  static std::unordered_multimap<uint64_t, string> uniqueMessages_; // by hash of the text
+  static std::mutex mutex_;
+  static std::atomic<unsigned long> nextSequence_;
+  static std::atomic<PendingMessage*> pendingMessages_;
   static int countInstances;
   static int messageCounter[];
-  int screenLevel_;
-  std::set<std::string> uniqueMessages;
+  static std::atomic<int> screenLevel_; // shared by all the callers, hence static
 };
 
 #endif
@@ -48,7 +48,7 @@ class ptError {
 
   public:
    // Constructor and destructor
-   ptError() {}
+   ptError() { defaultParameters(); }
    ~ptError() {}
 
    // Parameter setters
@@ -78,13 +78,17 @@ class ptError {
    RILength getMaterial() { return material ; }
 
    // Conversion between strips and p
-//   double stripsToP(double strips);
-//   double pToStrips(double p);
+   double stripsToP(double strips) const;
+   double pToStrips(double p) const;
+   // Fraction of the module where both sensors can be hit by the same track
+   double geometricEfficiency() const;
    // Error computation
    double computeErrorBE(double p); // CUIDADO only for testing, called by computeError after previously setting the correct parameters
    double computeError(double p);
    // Efficiency computation
    double probabilityInside(double cut, double value, double value_err);
+   double triggerProbability(double p, double ptCut, double geometricEfficiency);
+   double findProbability(double target, double ptCut, double geometricEfficiency);
 };
 
 #endif
@@ -7,6 +7,7 @@
 #include <boost/filesystem/exception.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <map>
@@ -286,6 +287,8 @@ private:
   static const int least_relevant = -1000;
   bool createSummaryFile_;
   string summaryFileName_;
+  bool targetPrepared_;
+  bool prepareTarget();
 public:
   ~RootWSite();
   RootWSite();
@@ -307,6 +310,7 @@ public:
   void setTargetDirectory(string newTargetDirectory) {targetDirectory_ = newTargetDirectory; };
   //void setStyleDirectory(string newStyleDirectory) {styleDirectory_ = newStyleDirectory; } ;
   bool makeSite(bool verbose);
+  bool renderPages();
   void setSummaryFile(bool);
   TFile* getSummaryFile();
   void setSummaryFileName(std::string);
@@ -321,6 +325,9 @@ private:
   string targetDirectory_;
   double alert_;
   int relevance;
+  std::function<void(RootWPage&)> builder_; // fills the page, when it is rendered
+  bool rendered_;
+  string body_; // the html of the contents, once rendered
 public:
   ~RootWPage();
   RootWPage();
@@ -339,6 +346,9 @@ public:
   void setRelevance(int newRelevance);
   int getRelevance();
   TFile* getSummaryFile();
+  void setBuilder(std::function<void(RootWPage&)> builder) { builder_ = builder; }
+  void render();
+  bool isRendered() { return rendered_; }
 };
 
 class RootWItemCollection {
@@ -16,6 +16,8 @@
 #include <tk2CMSSW_datatypes.h>
 #include <tk2CMSSW_strings.h>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <sstream>
 #include <stdexcept>
 #include <pwd.h>
@@ -61,6 +63,7 @@ namespace insur {
     private:
         std::vector<ConfigFile> configFiles_;
         void print();
+        void writeXmlFile(const std::string& filename, const std::string& what, std::function<void(XMLStream&)> writer);
         void writeSimpleHeader(std::ostream& os);
         void writeExtendedHeader(std::ostream& os);
         std::string currentDateTime() const;
@@ -9,6 +9,7 @@
 #include <string>
 #include <vector>
 #include<map>
+#include <unordered_map>
 
 namespace insur {
     /**
@@ -316,6 +317,34 @@ namespace insur {
         bool barrel;
         std::vector<std::string> paths;
     };
+    /**
+     * @class NameIndex
+     * @brief A hash index from the names of the entries in one of the collections above to their positions in that collection.
+     *
+     * The collection itself is left untouched and keeps the entries in insertion order, which is the order in which they are
+     * written to XML; the index only replaces linear searches by name. Entries appended to the collection after the index was
+     * built are picked up by calling <i>update()</i> again. If several entries share a name, the first one is found, as with a
+     * linear search.
+     */
+    template<typename T, std::string T::*Name> class NameIndex {
+    public:
+      NameIndex() : indexed_(0) {}
+      explicit NameIndex(const std::vector<T>& data) : indexed_(0) { update(data); }
+      void update(const std::vector<T>& data) {
+        if (data.size() < indexed_) clear(); // the collection was emptied or replaced
+        for (; indexed_ < data.size(); indexed_++) positions_.insert(std::make_pair(data[indexed_].*Name, (int)indexed_));
+      }
+      void clear() { positions_.clear(); indexed_ = 0; }
+      int find(const std::string& name) const {
+        std::unordered_map<std::string, int>::const_iterator it = positions_.find(name);
+        return (it == positions_.end()) ? -1 : it->second;
+      }
+    private:
+      std::unordered_map<std::string, int> positions_;
+      size_t indexed_;
+    };
+    typedef NameIndex<SpecParInfo, &SpecParInfo::name> SpecParIndex;
+    typedef NameIndex<PathInfo, &PathInfo::block_name> PathIndex;
     /**
      * @struct CMSSWBundle
      * @brief 
@@ -0,0 +1,248 @@
+#include "AnalysisServer.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <set>
+#include <sstream>
+#include <iomanip>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Analyzer.h"
+#include "MaterialBudget.h"
+#include "Tracker.h"
+#include "SimParms.h"
+#include "DetectorModule.h"
+#include "PtErrorAdapter.h"
+#include "Visitor.h"
+#include "global_constants.h"
+#include "hit.hh"
+#include "messageLogger.h"
+
+namespace insur {
+
+  namespace {
+    const size_t MaxRequestLength = 4096; // longer lines are not requests, the client is dropped
+    const int ClientTimeout = 60;         // seconds a client may stay silent before it is dropped
+    const double MaterialEtaStep = 0.001; // of the table of services and supports crossed by the material requests
+
+    std::string moduleKey(const std::string& section, int layer, int ring, int phi, int side) {
+      std::ostringstream key;
+      key << section << " " << layer << " " << ring << " " << phi << " " << side;
+      return key.str();
+    }
+
+    // Writes the whole reply, even if the socket takes it in several parts
+    bool writeAll(int fd, const std::string& data) {
+      for (size_t written = 0; written < data.size(); ) {
+        ssize_t n = send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        written += n;
+      }
+      return true;
+    }
+  }
+
+  AnalysisServer::AnalysisServer(Tracker& tracker, const SimParms& simParms, Analyzer& analyzer, MaterialBudget& mb, MaterialBudget* pm) :
+      tracker_(tracker), simParms_(simParms), analyzer_(analyzer), mb_(mb), pm_(pm), stopping_(false) {
+    class ModuleIndexVisitor : public GeometryVisitor {
+      std::map<std::string, DetectorModule*>& modules_;
+    public:
+      ModuleIndexVisitor(std::map<std::string, DetectorModule*>& modules) : modules_(modules) {}
+      void visit(DetectorModule& m) {
+        UniRef ref = m.uniRef();
+        modules_[moduleKey(ref.cnt, ref.layer, ref.ring, ref.phi, ref.side)] = &m;
+      }
+    };
+    ModuleIndexVisitor v(modules_);
+    tracker_.accept(v);
+
+    inactive_.addInactive(mb_, pm_);
+    inactive_.buildInactive(insur::geom_max_eta_coverage, int(ceil(insur::geom_max_eta_coverage / MaterialEtaStep)) + 1);
+  }
+
+  /**
+   * Listens on the socket and serves the clients one after the other, until
+   * one of them asks for a shutdown. A socket file left by a previous server
+   * is replaced.
+   * @return false if the socket could not be set up
+   */
+  bool AnalysisServer::run(const std::string& socketPath) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+      logERROR("The socket path " + socketPath + " is too long");
+      return false;
+    }
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    struct stat status;
+    if (lstat(socketPath.c_str(), &status) == 0 && S_ISSOCK(status.st_mode)) unlink(socketPath.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) < 0 || listen(listener, 8) < 0) {
+      logERROR("Could not listen on " + socketPath + ": " + strerror(errno));
+      if (listener >= 0) close(listener);
+      return false;
+    }
+    std::cout << "Serving analysis requests on " << socketPath << std::endl;
+
+    bool result = true;
+    stopping_ = false;
+    while (!stopping_) {
+      int client = accept(listener, nullptr, nullptr);
+      if (client < 0) {
+        if (errno == EINTR) continue;
+        logERROR(std::string("Could not accept a connection: ") + strerror(errno));
+        result = false;
+        break;
+      }
+      timeval timeout = { ClientTimeout, 0 };
+      if (setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
+        logERROR(std::string("Could not set the timeout of a connection: ") + strerror(errno));
+      } else {
+        serveClient(client);
+      }
+      close(client);
+    }
+
+    close(listener);
+    unlink(socketPath.c_str());
+    return result;
+  }
+
+  // Answers the requests of a client until it disconnects, quits, stays silent for too long or sends a line too long
+  void AnalysisServer::serveClient(int client) {
+    std::string pending;
+    char buffer[4096];
+    while (true) {
+      ssize_t n = read(client, buffer, sizeof(buffer));
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return;
+      pending.append(buffer, n);
+      size_t start = 0;
+      for (size_t newline; (newline = pending.find('\n', start)) != std::string::npos; start = newline + 1) {
+        if (newline - start > MaxRequestLength) break;
+        std::ostringstream reply;
+        bool more = answer(pending.substr(start, newline - start), reply);
+        if (!writeAll(client, reply.str()) || !more) return;
+      }
+      pending.erase(0, start);
+      // The first line left, complete or not, is too long to be a request
+      if (pending.size() > MaxRequestLength && pending.find('\n') > MaxRequestLength) {
+        writeAll(client, "error request too long\n");
+        return;
+      }
+    }
+  }
+
+  /**
+   * Answers one request line
+   * @return false if the connection must be closed after the reply
+   */
+  bool AnalysisServer::answer(const std::string& request, std::ostream& reply) {
+    std::istringstream arguments(request);
+    std::string command, error;
+    arguments >> command;
+    reply << std::setprecision(10);
+    if (command == "material") error = material(arguments, reply);
+    else if (command == "resolution") error = resolution(arguments, reply);
+    else if (command == "module") error = module(arguments, reply);
+    else if (command == "help") {
+      reply << "material <eta> [<phi>]" << std::endl
+            << "resolution <eta> <pt> [<phi>]" << std::endl
+            << "module <section> <layer> <ring> <phi> <side>" << std::endl
+            << "quit" << std::endl
+            << "shutdown" << std::endl;
+    }
+    else if (command == "quit" || command == "shutdown") {
+      stopping_ = command == "shutdown";
+      reply << "ok" << std::endl;
+      return false;
+    }
+    else if (command.empty()) error = "empty request";
+    else error = "unknown request " + command;
+
+    if (error.empty()) reply << "ok" << std::endl;
+    else reply << "error " << error << std::endl;
+    return true;
+  }
+
+  std::string AnalysisServer::material(std::istream& arguments, std::ostream& reply) {
+    double eta, phi = 0;
+    if (!(arguments >> eta)) return "expected material <eta> [<phi>]";
+    if (eta < 0) return "negative eta"; // the services and supports are only known in z+
+    arguments >> phi;
+    Track track;
+    Material crossed = analyzer_.shootTrack(mb_, pm_, eta, phi, track, fabs(eta) <= inactive_.etaMax() ? &inactive_ : nullptr);
+    reply << crossed.radiation << " " << crossed.interaction << std::endl;
+    return "";
+  }
+
+  // Same tracks as the resolution scan of Analyzer::analyzeTaggedTracking(), for one direction and one pt
+  std::string AnalysisServer::resolution(std::istream& arguments, std::ostream& reply) {
+    double eta, pt, phi = 0;
+    if (!(arguments >> eta >> pt) || pt <= 0) return "expected resolution <eta> <pt> [<phi>]";
+    if (eta < 0) return "negative eta";
+    arguments >> phi;
+    Track track;
+    analyzer_.shootTrack(mb_, pm_, eta, phi, track);
+    if (track.noHits()) return "";
+
+    double R = pt / insur::magnetic_field / 0.3 * 1E3; // radius in mm
+    auto print = [&](const std::string& tag, const char* kind, const Track& t) {
+      reply << tag << " " << kind << " " << t.getDeltaRho() * R << " " << t.getDeltaP() << " "
+            << t.getDeltaD() << " " << t.getDeltaZ0() << " " << t.getDeltaPhi() << " " << t.getDeltaCtgTheta() << " "
+            << t.nActiveHits(true) << std::endl;
+    };
+    std::set<std::string> tags = track.tags();
+    for (const std::string& tag : tags) {
+      analyzer_.prepareTaggedTrack(track, tag);
+      Track trackPt(track);
+      trackPt.setTransverseMomentum(pt);
+      trackPt.pruneHits();
+      Track idealTrackPt(trackPt);
+      if (trackPt.nActiveHits(true) >= 3) {
+        trackPt.computeErrors();
+        print(tag, "real", trackPt);
+      }
+      idealTrackPt.removeMaterial();
+      if (idealTrackPt.nActiveHits(true) >= 3) {
+        idealTrackPt.computeErrors();
+        print(tag, "ideal", idealTrackPt);
+      }
+    }
+    return "";
+  }
+
+  // Same rates as the trigger frequency and bandwidth analyses, as in ResultsExporter::fillModules()
+  std::string AnalysisServer::module(std::istream& arguments, std::ostream& reply) {
+    std::string section;
+    int layer, ring, phi, side;
+    if (!(arguments >> section >> layer >> ring >> phi >> side)) return "expected module <section> <layer> <ring> <phi> <side>";
+    auto found = modules_.find(moduleKey(section, layer, ring, phi, side));
+    if (found == modules_.end()) return "no module " + moduleKey(section, layer, ring, phi, side);
+    DetectorModule& m = *found->second;
+
+    double nMB = simParms_.numMinBiasEvents();
+    double hitChannels = 0;
+    for (const auto& s : m.sensors()) hitChannels += m.hitOccupancyPerEvent() * nMB * s.numChannels();
+    double trueStubs = 0, fakeStubs = 0;
+    if (m.dsDistance() != 0.0) {
+      PtErrorAdapter pterr(m);
+      trueStubs = pterr.getTriggerFrequencyTruePerEventAbove(simParms_.triggerPtCut())*nMB;
+      fakeStubs = pterr.getTriggerFrequencyTruePerEventBelow(simParms_.triggerPtCut())*nMB + pterr.getTriggerFrequencyFakePerEvent()*pow(nMB, 2);
+    }
+    reply << m.center().Rho() << " " << m.center().Z() << " " << m.center().Phi() << " " << m.irradiationPower() << " "
+          << hitChannels << " " << trueStubs << " " << fakeStubs << std::endl;
+    return "";
+  }
+
+}
@@ -11,6 +11,7 @@
 
 #include "AnalyzerVisitors/MaterialBillAnalyzer.h"
 #include <Units.h>
+#include <Profiler.h>
 
 #undef MATERIAL_SHADOW
 
@@ -68,6 +69,7 @@ namespace insur {
     geomLiteEC         = nullptr; geomLiteECCreated=false;
     geometryTracksUsed = 0;
     materialTracksUsed = 0;
+    resultsExporter_ = nullptr;
   }
 
   // private
@@ -77,15 +79,26 @@ namespace insur {
    * @param momenta A list of momentum values for which to perform the efficiency measurements
    * @param etaSteps The number of wedges in the fan of tracks covered by the eta scan
    * @param pm A pointer to a second material budget associated to a pixel detector; may be <i>NULL</i>
+   * @param inactive A table of the inactive surfaces of both material budgets, built on a grid containing eta;
+   * the inactive surfaces are scanned if <i>NULL</i>
    * @return the total crossed material amount
    */
   Material Analyzer::findAllHits(MaterialBudget& mb, MaterialBudget* pm, 
-                                 double& eta, double& theta, double& phi, Track& track) {
+                                 double& eta, double& theta, double& phi, Track& track, const MaterialResponse* inactive) {
     Material totalMaterial;
     //      active volumes, barrel
     totalMaterial  = findHitsModules(mb.getBarrelModuleCaps(), eta, theta, phi, track);
     //      active volumes, endcap
     totalMaterial += findHitsModules(mb.getEndcapModuleCaps(), eta, theta, phi, track);
+    if (inactive) {
+      //      services and supports do not depend on phi: they come from the table
+      if (pm != NULL) {
+        totalMaterial += findHitsModules(pm->getBarrelModuleCaps(), eta, theta, phi, track, true);
+        totalMaterial += findHitsModules(pm->getEndcapModuleCaps(), eta, theta, phi, track, true);
+      }
+      totalMaterial += inactive->fillTrack(eta, track);
+      return totalMaterial;
+    }
     //      services, barrel
     totalMaterial += findHitsInactiveSurfaces(mb.getInactiveSurfaces().getBarrelServices(), eta, theta, track);
     //      services, endcap
@@ -104,12 +117,56 @@ namespace insur {
   }
 
 
+  /**
+   * Sets the direction of a track from the origin and collects its hits on
+   * the modules and inactive surfaces, and on the beam pipe
+   * @param inactive A table of the inactive surfaces of both material budgets, see findAllHits(); may be <i>NULL</i>
+   * @return the material crossed by the track, beam pipe excluded
+   */
+  Material Analyzer::shootTrack(MaterialBudget& mb, MaterialBudget* pm, double eta, double phi, Track& track, const MaterialResponse* inactive) {
+    double theta = 2 * atan(exp(-eta));
+    track.setTheta(theta);
+    track.setPhi(phi);
+
+    Material totalMaterial = findAllHits(mb, pm, eta, theta, phi, track, inactive);
+
+    // TODO: add the beam pipe as a user material eveywhere!
+    // in a coherent way
+    // Add the hit on the beam pipe
+    Hit* hit = new Hit(23./sin(theta));
+    hit->setOrientation(Hit::Horizontal);
+    hit->setObjectKind(Hit::Inactive);
+    Material beamPipeMat;
+    beamPipeMat.radiation = 0.0023 / sin(theta);
+    beamPipeMat.interaction = 0.0019 / sin(theta);
+    hit->setCorrectedMaterial(beamPipeMat);
+    track.addHit(hit);
+
+    return totalMaterial;
+  }
+
+  /**
+   * Keeps the hits of a track that belong to the given tag, adding the IP
+   * constraint and the hit efficiency of the simulation parameters. The
+   * errors can then be computed for any momentum on copies of the track.
+   */
+  void Analyzer::prepareTaggedTrack(Track& track, const std::string& tag) {
+    track.keepTaggedOnly(tag);
+    if (simParms().useIPConstraint()) track.addIPConstraint(simParms().rError(), simParms().zErrorCollider());
+    track.sort();
+    track.setTriggerResolution(true); // TODO: remove this (?)
+
+    double efficiency = simParms().efficiency();
+    if (efficiency!=1) track.addEfficiency(efficiency, false);
+  }
+
   /* TODO: finish this :-)
 void Analyzer::createTaggedTrackCollection(std::vector<MaterialBudget*> materialBudgets,
                                            int etaSteps,
                                            double maxEta,
                                            bool forceClean = false) {
   
+  profileZone("Tagged track collection");
   if (forceClean) taggedTrackCollectionMap_.clear();
   if (taggedTrackCollectionMap_.size()!=0) return;
     
@@ -135,7 +192,7 @@ void Analyzer::createTaggedTrackCollection(std::vector<MaterialBudget*> material
 				       int etaSteps,
 				       MaterialBudget* pm) {
 
-  double efficiency = simParms().efficiency();
+  profileZone("Tagged tracking analysis");
 
   materialTracksUsed = etaSteps;
 
@@ -149,6 +206,11 @@ void Analyzer::createTaggedTrackCollection(std::vector<MaterialBudget*> material
 
   // prepareTriggerPerformanceHistograms(nTracks, getEtaMaxTrigger(), triggerMomenta, thresholdProbabilities);
 
+  // the inactive surfaces do not depend on phi: their crossings are tabulated once on the eta grid of the scan
+  MaterialResponse inactive;
+  inactive.addInactive(mb, pm);
+  inactive.buildInactive(getEtaMaxTrigger(), nTracks);
+
   // reset the list of tracks
   //std::map<string, std::vector<Track>> tv;
   //std::map<string, std::vector<Track>> tvIdeal;
@@ -160,42 +222,15 @@ void Analyzer::createTaggedTrackCollection(std::vector<MaterialBudget*> material
 
   for (int i_eta = 0; i_eta < nTracks; i_eta++) {
     phi = myDice.Rndm() * M_PI * 2.0;
-    Material tmp;
     Track track;
     eta = i_eta * etaStep;
     theta = 2 * atan(exp(-eta));
     //std::cout << " track's phi = " << phi << std::endl; 
-    track.setTheta(theta);
-    track.setPhi(phi);
-
-    tmp = findAllHits(mb, pm, eta, theta, phi, track);
-
-    // Debug: material amount
-    // std::cerr << "eta = " << eta
-    //           << ", material.radiation = " << tmp.radiation
-    //           << ", material.interaction = " << tmp.interaction
-    //           << std::endl;
-
-    // TODO: add the beam pipe as a user material eveywhere!
-    // in a coherent way
-    // Add the hit on the beam pipe
-    Hit* hit = new Hit(23./sin(theta));
-    hit->setOrientation(Hit::Horizontal);
-    hit->setObjectKind(Hit::Inactive);
-    Material beamPipeMat;
-    beamPipeMat.radiation = 0.0023 / sin(theta);
-    beamPipeMat.interaction = 0.0019 / sin(theta);
-    hit->setCorrectedMaterial(beamPipeMat);
-    track.addHit(hit);
+    shootTrack(mb, pm, eta, phi, track, &inactive);
 
     if (!track.noHits()) {
       for (string tag : track.tags()) {
-        track.keepTaggedOnly(tag);
-        if (simParms().useIPConstraint()) track.addIPConstraint(simParms().rError(), simParms().zErrorCollider());
-        track.sort();
-        track.setTriggerResolution(true); // TODO: remove this (?)
-
-        if (efficiency!=1) track.addEfficiency(efficiency, false);
+        prepareTaggedTrack(track, tag);
         // For each momentum/transverse momentum compute the tracks error
         for (const auto& pIter : momenta ) {
           int    parameter = pIter * 1000; // Store p or pT in MeV as int (key to the map)
@@ -213,6 +248,7 @@ void Analyzer::createTaggedTrackCollection(std::vector<MaterialBudget*> material
             TrackCollectionMap &myMap     = taggedTrackPtCollectionMap[tag];
             TrackCollection &myCollection = myMap[parameter];
             myCollection.push_back(trackPt);
+            if (resultsExporter_) resultsExporter_->fillResolutionTrack(trackPt, resultsDetector_, tag, false, false);
           }
 
           // Ideal (no material)
@@ -223,6 +259,7 @@ void Analyzer::createTaggedTrackCollection(std::vector<MaterialBudget*> material
             TrackCollectionMap &myMapIdeal     = taggedTrackPtCollectionMapIdeal[tag];
             TrackCollection &myCollectionIdeal = myMapIdeal[parameter];
             myCollectionIdeal.push_back(idealTrackPt);
+            if (resultsExporter_) resultsExporter_->fillResolutionTrack(idealTrackPt, resultsDetector_, tag, false, true);
           }
 
           // Case II) Initial momentum is equal to p
@@ -237,6 +274,7 @@ void Analyzer::createTaggedTrackCollection(std::vector<MaterialBudget*> material
             TrackCollectionMap &myMapII     = taggedTrackPCollectionMap[tag];
             TrackCollection &myCollectionII = myMapII[parameter];
             myCollectionII.push_back(trackP);
+            if (resultsExporter_) resultsExporter_->fillResolutionTrack(trackP, resultsDetector_, tag, true, false);
           }
 
           // Ideal (no material)
@@ -247,6 +285,7 @@ void Analyzer::createTaggedTrackCollection(std::vector<MaterialBudget*> material
             TrackCollectionMap &myMapIdealII     = taggedTrackPCollectionMapIdeal[tag];
             TrackCollection &myCollectionIdealII = myMapIdealII[parameter];
             myCollectionIdealII.push_back(idealTrackP);
+            if (resultsExporter_) resultsExporter_->fillResolutionTrack(idealTrackP, resultsDetector_, tag, true, true);
           }
         }
       }
@@ -314,6 +353,7 @@ void Analyzer::createTaggedTrackCollection(std::vector<MaterialBudget*> material
                                           const std::vector<double>& thresholdProbabilities,
                                           int etaSteps) {
 
+    profileZone("Trigger efficiency analysis");
     double efficiency = simParms().efficiency();
 
     materialTracksUsed = etaSteps;
@@ -503,6 +543,7 @@ void Analyzer::fillTriggerEfficiencyGraphs(const Tracker& tracker,
 void Analyzer::analyzeMaterialBudget(MaterialBudget& mb, const std::vector<double>& momenta, int etaSteps,
                                      MaterialBudget* pm) {
 
+  profileZone("Material budget analysis");
   Tracker& tracker = mb.getTracker();
   double efficiency = simParms().efficiency();
   double pixelEfficiency = simParms().pixelEfficiency();
@@ -523,6 +564,24 @@ void Analyzer::analyzeMaterialBudget(MaterialBudget& mb, const std::vector<doubl
   // std::vector<Track> tv;
   // std::vector<Track> tvIdeal;
 
+  // the inactive surfaces do not depend on phi: the crossed ones are tabulated once on the eta grid of the scan
+  InactiveSurfaces& is = mb.getInactiveSurfaces();
+  MaterialResponse inactive;
+  const int barrelServices = inactive.addInactive(is.getBarrelServices(), false);
+  const int endcapServices = inactive.addInactive(is.getEndcapServices(), false);
+  const int barrelSupports = inactive.addInactive(is.getSupports(), false, MaterialProperties::b_sup);
+  const int endcapSupports = inactive.addInactive(is.getSupports(), false, MaterialProperties::e_sup);
+  const int tubeSupports = inactive.addInactive(is.getSupports(), false, MaterialProperties::o_sup);
+  const int barrelTubeSupports = inactive.addInactive(is.getSupports(), false, MaterialProperties::t_sup);
+  const int userSupports = inactive.addInactive(is.getSupports(), false, MaterialProperties::u_sup);
+  int pixelBarrelServices = -1, pixelEndcapServices = -1, pixelSupports = -1;
+  if (pm) {
+    pixelBarrelServices = inactive.addInactive(pm->getInactiveSurfaces().getBarrelServices(), true);
+    pixelEndcapServices = inactive.addInactive(pm->getInactiveSurfaces().getEndcapServices(), true);
+    pixelSupports = inactive.addInactive(pm->getInactiveSurfaces().getSupports(), true);
+  }
+  inactive.buildInactive(getEtaMaxMaterial(), nTracks);
+
   for (int i_eta = 0; i_eta < nTracks; i_eta++) {
     phi = myDice.Rndm() * M_PI * 2.0;
     Material tmp;
@@ -585,7 +644,7 @@ void Analyzer::analyzeMaterialBudget(MaterialBudget& mb, const std::vector<doubl
       iComponents["Supports"]->SetBins(nTracks, 0.0, getEtaMaxMaterial()); 
     }
     //      services, barrel
-    tmp = analyzeInactiveSurfaces(mb.getInactiveSurfaces().getBarrelServices(), eta, theta, track, MaterialProperties::no_cat);
+    tmp = analyzeInactiveSurfaces(inactive.crossedEntries(eta, barrelServices), MaterialProperties::no_cat, eta, theta, track);
     rserfbarrel.Fill(eta, tmp.radiation);
     iserfbarrel.Fill(eta, tmp.interaction);
     rbarrelall.Fill(eta, tmp.radiation);
@@ -604,7 +663,7 @@ void Analyzer::analyzeMaterialBudget(MaterialBudget& mb, const std::vector<doubl
     rComponents["Services"]->Fill(eta, tmp.radiation);
     iComponents["Services"]->Fill(eta, tmp.interaction);
     //      services, endcap
-    tmp = analyzeInactiveSurfaces(mb.getInactiveSurfaces().getEndcapServices(), eta, theta, track, MaterialProperties::no_cat);
+    tmp = analyzeInactiveSurfaces(inactive.crossedEntries(eta, endcapServices), MaterialProperties::no_cat, eta, theta, track);
     rserfendcap.Fill(eta, tmp.radiation);
     iserfendcap.Fill(eta, tmp.interaction);
     rendcapall.Fill(eta, tmp.radiation);
@@ -616,7 +675,7 @@ void Analyzer::analyzeMaterialBudget(MaterialBudget& mb, const std::vector<doubl
     rComponents["Services"]->Fill(eta, tmp.radiation);
     iComponents["Services"]->Fill(eta, tmp.interaction);
     //      supports, barrel
-    tmp = analyzeInactiveSurfaces(mb.getInactiveSurfaces().getSupports(), eta, theta, track, MaterialProperties::b_sup);
+    tmp = analyzeInactiveSurfaces(inactive.crossedEntries(eta, barrelSupports), MaterialProperties::b_sup, eta, theta, track);
     rlazybarrel.Fill(eta, tmp.radiation);
     ilazybarrel.Fill(eta, tmp.interaction);
     rbarrelall.Fill(eta, tmp.radiation);
@@ -628,7 +687,7 @@ void Analyzer::analyzeMaterialBudget(MaterialBudget& mb, const std::vector<doubl
     rComponents["Supports"]->Fill(eta, tmp.radiation);
     iComponents["Supports"]->Fill(eta, tmp.interaction);
     //      supports, endcap
-    tmp = analyzeInactiveSurfaces(mb.getInactiveSurfaces().getSupports(), eta, theta, track, MaterialProperties::e_sup);
+    tmp = analyzeInactiveSurfaces(inactive.crossedEntries(eta, endcapSupports), MaterialProperties::e_sup, eta, theta, track);
     rlazyendcap.Fill(eta, tmp.radiation);
     ilazyendcap.Fill(eta, tmp.interaction);
     rendcapall.Fill(eta, tmp.radiation);
@@ -640,7 +699,7 @@ void Analyzer::analyzeMaterialBudget(MaterialBudget& mb, const std::vector<doubl
     rComponents["Supports"]->Fill(eta, tmp.radiation);
     iComponents["Supports"]->Fill(eta, tmp.interaction);
     //      supports, tubes
-    tmp = analyzeInactiveSurfaces(mb.getInactiveSurfaces().getSupports(), eta, theta, track, MaterialProperties::o_sup);
+    tmp = analyzeInactiveSurfaces(inactive.crossedEntries(eta, tubeSupports), MaterialProperties::o_sup, eta, theta, track);
     rlazytube.Fill(eta, tmp.radiation);
     ilazytube.Fill(eta, tmp.interaction);
     rlazyall.Fill(eta, tmp.radiation);
@@ -650,7 +709,7 @@ void Analyzer::analyzeMaterialBudget(MaterialBudget& mb, const std::vector<doubl
     rComponents["Supports"]->Fill(eta, tmp.radiation);
     iComponents["Supports"]->Fill(eta, tmp.interaction);
     //      supports, barrel tubes
-    tmp = analyzeInactiveSurfaces(mb.getInactiveSurfaces().getSupports(), eta, theta, track, MaterialProperties::t_sup);
+    tmp = analyzeInactiveSurfaces(inactive.crossedEntries(eta, barrelTubeSupports), MaterialProperties::t_sup, eta, theta, track);
     rlazybtube.Fill(eta, tmp.radiation);
     ilazybtube.Fill(eta, tmp.interaction);
     rlazyall.Fill(eta, tmp.radiation);
@@ -660,7 +719,7 @@ void Analyzer::analyzeMaterialBudget(MaterialBudget& mb, const std::vector<doubl
     rComponents["Supports"]->Fill(eta, tmp.radiation);
     iComponents["Supports"]->Fill(eta, tmp.interaction);
     //      supports, user defined
-    tmp = analyzeInactiveSurfaces(mb.getInactiveSurfaces().getSupports(), eta, theta, track, MaterialProperties::u_sup);
+    tmp = analyzeInactiveSurfaces(inactive.crossedEntries(eta, userSupports), MaterialProperties::u_sup, eta, theta, track);
     rlazyuserdef.Fill(eta, tmp.radiation);
     ilazyuserdef.Fill(eta, tmp.interaction);
     rlazyall.Fill(eta, tmp.radiation);
@@ -674,11 +733,13 @@ void Analyzer::analyzeMaterialBudget(MaterialBudget& mb, const std::vector<doubl
       std::map<std::string, Material> ignoredPixelSumComponentsRI;
       analyzeModules(pm->getBarrelModuleCaps(), eta, theta, phi, track, ignoredPixelSumComponentsRI, true);
       analyzeModules(pm->getEndcapModuleCaps(), eta, theta, phi, track, ignoredPixelSumComponentsRI, true);
-      analyzeInactiveSurfaces(pm->getInactiveSurfaces().getBarrelServices(), eta, theta, track, MaterialProperties::no_cat, true);
-      analyzeInactiveSurfaces(pm->getInactiveSurfaces().getEndcapServices(), eta, theta, track, MaterialProperties::no_cat, true);
-      analyzeInactiveSurfaces(pm->getInactiveSurfaces().getSupports(), eta, theta, track, MaterialProperties::no_cat, true);
+      analyzeInactiveSurfaces(inactive.crossedEntries(eta, pixelBarrelServices), MaterialProperties::no_cat, eta, theta, track, true);
+      analyzeInactiveSurfaces(inactive.crossedEntries(eta, pixelEndcapServices), MaterialProperties::no_cat, eta, theta, track, true);
+      analyzeInactiveSurfaces(inactive.crossedEntries(eta, pixelSupports), MaterialProperties::no_cat, eta, theta, track, true);
     }
 
+    if (resultsExporter_) resultsExporter_->fillMaterialTrack(track, resultsDetector_);
+
     // Add the hit on the beam pipe
     Hit* hit = new Hit(23./sin(theta));
     hit->setOrientation(Hit::Horizontal);
@@ -1006,6 +1067,7 @@ void Analyzer::computeDetailedWeights(std::vector<std::vector<ModuleCap> >& trac
  */
 void Analyzer::computeWeightSummary(MaterialBudget& mb) {
 
+  profileZone("Weight summary");
   typeWeight.clear();
   tagWeight.clear();
   barrelWeights.clear();
@@ -1291,183 +1353,166 @@ Material Analyzer::findHitsModuleLayer(std::vector<ModuleCap>& layer,
  * the given track. If one is found, the radiation and interaction lengths are scaled with respect to theta, then summed
  * up into a grand total, which is returned. As all inactive volumes are symmetric with respect to rotation around the
  * z-axis, the track angle phi is not necessary.
- * @param elements A reference to the collection of inactive surfaces that is to be checked for collisions with the track
+ * @param crossed The inactive surfaces of the category crossed at the grid point of eta, as tabulated by a <i>MaterialResponse</i>
+ * @param cat The category of the surfaces
  * @param eta The pseudorapidity of the current track
  * @param theta The track angle in the yz-plane
  * @param t A reference to the current track object
- * @param cat The category of inactive surfaces that need to be considered within the collection; none if the function is to look at all of them
  * @param A boolean flag to indicate which set of active surfaces isa nalysed: true if the belong to a pixel detector, false if they belong to the tracker
  * @return The scaled and summed up radiation and interaction lengths for the given collection of elements and track, bundled into a <i>std::pair</i>
  */
 
-Material Analyzer::analyzeInactiveSurfaces(std::vector<InactiveElement>& elements, double eta,
-                                           double theta, Track& t, MaterialProperties::Category cat, bool isPixel) {
+Material Analyzer::analyzeInactiveSurfaces(const InactiveElementIndex::EntryList& crossed, MaterialProperties::Category cat,
+                                           double eta, double theta, Track& t, bool isPixel) {
 
-  /*
-  for (InactiveElement& currElem : elements) {
-    currElem.calculateTotalMass();
-    currElem.calculateRadiationLength();
-    currElem.calculateInteractionLength();
-  }
-  */
-  
-  std::vector<InactiveElement>::iterator iter = elements.begin();
-  std::vector<InactiveElement>::iterator guard = elements.end();
   Material res, corr;
-  std::pair<double, double> tmp;
   double s = 0.0;
-  while ((iter != guard)) {
-    //if  ((iter->getInteractionLength() > 0) && (iter->getRadiationLength() > 0)) {
-    // collision detection: rays are in z+ only, so only volumes in z+ need to be considered
-    // only volumes of the requested category, or those without one (which should not exist) are examined
-    if (((iter->getZOffset() + iter->getZLength()) > 0)
-        && ((cat == MaterialProperties::no_cat) || (cat == iter->getCategory()))) {
-      // collision detection: check eta range
-      tmp = iter->getEtaMinMax();
-      // volume was hit
-      if ((tmp.first < eta) && (tmp.second > eta)) {
-        double r, z;
-        /*
-        if (eta<0.01) {
-          std::cout << "Hitting an inactive surface at z=("
-                    << iter->getZOffset() << " to " << iter->getZOffset()+iter->getZLength()
-                    << ") r=(" << iter->getInnerRadius() << " to " << iter->getInnerRadius()+iter->getRWidth() << ")" << std::endl;
-          const std::map<std::string, double>& localMasses = iter->getLocalMasses();
-          for (auto massIt : localMasses) std::cerr   << "       localMass" <<  massIt.first << " = " << any2str(massIt.second) << " g" << std::endl;
-        }
-        */
-        // radiation and interaction lenth scaling for vertical volumes
-        if (iter->isVertical()) {
-          z = iter->getZOffset() + iter->getZLength() / 2.0;
-          r = z * tan(theta);
-          // 2D maps for vertical surfaces
-          fillMapRZ(r,z,iter->getMaterialLengths());
-          // special treatment for user-defined supports as they can be very close to z=0
-          if (cat == MaterialProperties::u_sup) {
-            s = iter->getZLength() / cos(theta);
-            if (s > (iter->getRWidth() / sin(theta))) s = iter->getRWidth() / sin(theta);
-            // add the hit if it's declared as inside the tracking volume, add it to 'others' if not
-            if (iter->track()) {
-              corr.radiation = iter->getRadiationLength() * s / iter->getZLength();
-              corr.interaction = iter->getInteractionLength() * s / iter->getZLength();
-              res += corr;
-              if (!isPixel) {
-                Material thisLength;
-                thisLength.radiation = iter->getRadiationLength() * s / iter->getZLength();
-                thisLength.interaction = iter->getInteractionLength() * s / iter->getZLength(); 
-                fillCell(r, eta, theta, thisLength); 
-              }
+  // only the elements of the requested category in z+ crossed at the grid point are listed,
+  // in the order of their collection
+  for (const InactiveElementIndex::Entry* entry : crossed) {
+    // collision detection: check eta range
+    InactiveElement* element = entry->element;
+    // volume was hit
+    if (entry->crossedBy(eta)) {
+      double r, z;
+      /*
+      if (eta<0.01) {
+        std::cout << "Hitting an inactive surface at z=("
+                  << element->getZOffset() << " to " << element->getZOffset()+element->getZLength()
+                  << ") r=(" << element->getInnerRadius() << " to " << element->getInnerRadius()+element->getRWidth() << ")" << std::endl;
+        const std::map<std::string, double>& localMasses = element->getLocalMasses();
+        for (auto massIt : localMasses) std::cerr   << "       localMass" <<  massIt.first << " = " << any2str(massIt.second) << " g" << std::endl;
+      }
+      */
+      // radiation and interaction lenth scaling for vertical volumes
+      if (element->isVertical()) {
+        z = element->getZOffset() + element->getZLength() / 2.0;
+        r = z * tan(theta);
+        // 2D maps for vertical surfaces
+        fillMapRZ(r,z,element->getMaterialLengths());
+        // special treatment for user-defined supports as they can be very close to z=0
+        if (cat == MaterialProperties::u_sup) {
+          s = element->getZLength() / cos(theta);
+          if (s > (element->getRWidth() / sin(theta))) s = element->getRWidth() / sin(theta);
+          // add the hit if it's declared as inside the tracking volume, add it to 'others' if not
+          if (element->track()) {
+            corr.radiation = entry->radiationLength * s / element->getZLength();
+            corr.interaction = entry->interactionLength * s / element->getZLength();
+            res += corr;
+            if (!isPixel) {
+              Material thisLength;
+              thisLength.radiation = entry->radiationLength * s / element->getZLength();
+              thisLength.interaction = entry->interactionLength * s / element->getZLength(); 
+              fillCell(r, eta, theta, thisLength); 
             }
-            else {
-              if (!isPixel) {
-                rextrasupports.Fill(eta, iter->getRadiationLength() * s / iter->getZLength());
-                iextrasupports.Fill(eta, iter->getInteractionLength() * s / iter->getZLength());
-              }
+          }
+          else {
+            if (!isPixel) {
+              rextrasupports.Fill(eta, entry->radiationLength * s / element->getZLength());
+              iextrasupports.Fill(eta, entry->interactionLength * s / element->getZLength());
+            }
+          }
+        }
+        else {
+          // add the hit if it's declared as inside the tracking volume, add it to 'others' if not
+          if (element->track()) {
+            corr.radiation = entry->radiationLength / cos(theta);
+            corr.interaction = entry->interactionLength / cos(theta);
+            res += corr;
+            if (!isPixel) {
+              Material thisLength;
+              thisLength.radiation = entry->radiationLength / cos(theta); 
+              thisLength.interaction = entry->interactionLength / cos(theta);
+              fillCell(r, eta, theta, thisLength);
             }
           }
           else {
-            // add the hit if it's declared as inside the tracking volume, add it to 'others' if not
-            if (iter->track()) {
-              corr.radiation = iter->getRadiationLength() / cos(theta);
-              corr.interaction = iter->getInteractionLength() / cos(theta);
-              res += corr;
-              if (!isPixel) {
-                Material thisLength;
-                thisLength.radiation = iter->getRadiationLength() / cos(theta); 
-                thisLength.interaction = iter->getInteractionLength() / cos(theta);
-                fillCell(r, eta, theta, thisLength);
+            if (!isPixel) {
+              if ((element->getCategory() == MaterialProperties::b_ser)
+                  || (element->getCategory() == MaterialProperties::e_ser)) {
+                rextraservices.Fill(eta, entry->radiationLength / cos(theta));
+                iextraservices.Fill(eta, entry->interactionLength / cos(theta));
               }
-            }
-            else {
-              if (!isPixel) {
-                if ((iter->getCategory() == MaterialProperties::b_ser)
-                    || (iter->getCategory() == MaterialProperties::e_ser)) {
-                  rextraservices.Fill(eta, iter->getRadiationLength() / cos(theta));
-                  iextraservices.Fill(eta, iter->getInteractionLength() / cos(theta));
-                }
-                else if ((iter->getCategory() == MaterialProperties::b_sup)
-                         || (iter->getCategory() == MaterialProperties::e_sup)
-                         || (iter->getCategory() == MaterialProperties::o_sup)
-                         || (iter->getCategory() == MaterialProperties::t_sup)) {
-                  rextrasupports.Fill(eta, iter->getRadiationLength() / cos(theta));
-                  iextrasupports.Fill(eta, iter->getInteractionLength() / cos(theta));
-                }
+              else if ((element->getCategory() == MaterialProperties::b_sup)
+                       || (element->getCategory() == MaterialProperties::e_sup)
+                       || (element->getCategory() == MaterialProperties::o_sup)
+                       || (element->getCategory() == MaterialProperties::t_sup)) {
+                rextrasupports.Fill(eta, entry->radiationLength / cos(theta));
+                iextrasupports.Fill(eta, entry->interactionLength / cos(theta));
               }
             }
           }
         }
-        // radiation and interaction length scaling for horizontal volumes
-        else {
-          r = iter->getInnerRadius() + iter->getRWidth() / 2.0;
-          // 2D maps for horizontal surfaces
-          fillMapRT(r,theta,iter->getMaterialLengths());
-          // special treatment for user-defined supports; should not be necessary for now
-          // as all user-defined supports are vertical, but just in case...
-          if (cat == MaterialProperties::u_sup) {
-            s = iter->getZLength() / sin(theta);
-            if (s > (iter->getRWidth() / cos(theta))) s = iter->getRWidth() / cos(theta);
-            // add the hit if it's declared as inside the tracking volume, add it to 'others' if not
-            if (iter->track()) {
-              corr.radiation = iter->getRadiationLength() * s / iter->getZLength();
-              corr.interaction = iter->getInteractionLength() * s / iter->getZLength();
-              res += corr;
-              if (!isPixel) {
-                Material thisLength;
-                thisLength.radiation = iter->getRadiationLength() * s / iter->getZLength(); 
-                thisLength.interaction = iter->getInteractionLength() * s / iter->getZLength();
-                fillCell(r, eta, theta, thisLength);
-              }
+      }
+      // radiation and interaction length scaling for horizontal volumes
+      else {
+        r = element->getInnerRadius() + element->getRWidth() / 2.0;
+        // 2D maps for horizontal surfaces
+        fillMapRT(r,theta,element->getMaterialLengths());
+        // special treatment for user-defined supports; should not be necessary for now
+        // as all user-defined supports are vertical, but just in case...
+        if (cat == MaterialProperties::u_sup) {
+          s = element->getZLength() / sin(theta);
+          if (s > (element->getRWidth() / cos(theta))) s = element->getRWidth() / cos(theta);
+          // add the hit if it's declared as inside the tracking volume, add it to 'others' if not
+          if (element->track()) {
+            corr.radiation = entry->radiationLength * s / element->getZLength();
+            corr.interaction = entry->interactionLength * s / element->getZLength();
+            res += corr;
+            if (!isPixel) {
+              Material thisLength;
+              thisLength.radiation = entry->radiationLength * s / element->getZLength(); 
+              thisLength.interaction = entry->interactionLength * s / element->getZLength();
+              fillCell(r, eta, theta, thisLength);
             }
-            else {
-              if (!isPixel) {
-                rextrasupports.Fill(eta, iter->getRadiationLength() * s / iter->getZLength());
-                iextrasupports.Fill(eta, iter->getInteractionLength() * s / iter->getZLength());
-              }
+          }
+          else {
+            if (!isPixel) {
+              rextrasupports.Fill(eta, entry->radiationLength * s / element->getZLength());
+              iextrasupports.Fill(eta, entry->interactionLength * s / element->getZLength());
+            }
+          }
+        }
+        else {
+          // add the hit if it's declared as inside the tracking volume, add it to 'others' if not
+          if (element->track()) {
+            corr.radiation = entry->radiationLength / sin(theta);
+            corr.interaction = entry->interactionLength / sin(theta);
+            res += corr;
+            if (!isPixel) {
+              Material thisLength;
+              thisLength.radiation = entry->radiationLength / sin(theta);
+              thisLength.interaction =  entry->interactionLength / sin(theta);
+              fillCell(r, eta, theta, thisLength); 
             }
           }
           else {
-            // add the hit if it's declared as inside the tracking volume, add it to 'others' if not
-            if (iter->track()) {
-              corr.radiation = iter->getRadiationLength() / sin(theta);
-              corr.interaction = iter->getInteractionLength() / sin(theta);
-              res += corr;
-              if (!isPixel) {
-                Material thisLength;
-                thisLength.radiation = iter->getRadiationLength() / sin(theta);
-                thisLength.interaction =  iter->getInteractionLength() / sin(theta);
-                fillCell(r, eta, theta, thisLength); 
+            if (!isPixel) {
+              if ((element->getCategory() == MaterialProperties::b_ser)
+                  || (element->getCategory() == MaterialProperties::e_ser)) {
+                rextraservices.Fill(eta, entry->radiationLength / sin(theta));
+                iextraservices.Fill(eta, entry->interactionLength / sin(theta));
               }
-            }
-            else {
-              if (!isPixel) {
-                if ((iter->getCategory() == MaterialProperties::b_ser)
-                    || (iter->getCategory() == MaterialProperties::e_ser)) {
-                  rextraservices.Fill(eta, iter->getRadiationLength() / sin(theta));
-                  iextraservices.Fill(eta, iter->getInteractionLength() / sin(theta));
-                }
-                else if ((iter->getCategory() == MaterialProperties::b_sup)
-                         || (iter->getCategory() == MaterialProperties::e_sup)
-                         || (iter->getCategory() == MaterialProperties::o_sup)
-                         || (iter->getCategory() == MaterialProperties::t_sup)) {
-                  rextrasupports.Fill(eta, iter->getRadiationLength() / sin(theta));
-                  iextrasupports.Fill(eta, iter->getInteractionLength() / sin(theta));
-                }
+              else if ((element->getCategory() == MaterialProperties::b_sup)
+                       || (element->getCategory() == MaterialProperties::e_sup)
+                       || (element->getCategory() == MaterialProperties::o_sup)
+                       || (element->getCategory() == MaterialProperties::t_sup)) {
+                rextrasupports.Fill(eta, entry->radiationLength / sin(theta));
+                iextrasupports.Fill(eta, entry->interactionLength / sin(theta));
               }
             }
           }
         }
-        // create Hit object with appropriate parameters, add to Track t
-        Hit* hit = new Hit((theta == 0) ? r : (r / sin(theta)));
-        if (iter->isVertical()) hit->setOrientation(Hit::Vertical);
-        else hit->setOrientation(Hit::Horizontal);
-        hit->setObjectKind(Hit::Inactive);
-        hit->setCorrectedMaterial(corr);
-        hit->setPixel(isPixel);
-        t.addHit(hit);
       }
+      // create Hit object with appropriate parameters, add to Track t
+      Hit* hit = new Hit((theta == 0) ? r : (r / sin(theta)));
+      if (element->isVertical()) hit->setOrientation(Hit::Vertical);
+      else hit->setOrientation(Hit::Horizontal);
+      hit->setObjectKind(Hit::Inactive);
+      hit->setCorrectedMaterial(corr);
+      hit->setPixel(isPixel);
+      t.addHit(hit);
     }
-    iter++;
-    //}
   }
   return res;
 }
@@ -2675,6 +2720,7 @@ std::pair<double, double> Analyzer::computeMinMaxTracksEta(const Tracker& t) con
  * @param nTracker the number of tracks to be used to analyze the coverage (defaults to 1000)
  */
 void Analyzer::analyzeGeometry(Tracker& tracker, int nTracks /*=1000*/ ) {
+  profileZone("Geometry analysis");
   geometryTracksUsed = nTracks;
   savingGeometryV.clear();
   clearGeometryHistograms();
@@ -10,9 +10,30 @@
 
 #include <Extractor.h>
 #include <cstdlib>
+#include <future>
+#include <iterator>
 
 namespace insur {
+#if defined(__FLIPSENSORS_IN__) || defined(__FLIPSENSORS_OUT__)
+  // The sensor flip rotation is left in the positioning template from one layer or disc to the next,
+  // so they have to be analysed in sequence for the output to stay the same
+  static const bool canAnalyseConcurrently = false;
+#else
+  static const bool canAnalyseConcurrently = true;
+#endif
+
   //public
+  Extractor::Extractor() : concurrentAnalysis_(canAnalyseConcurrently) {}
+
+  /**
+   * Chooses whether the barrel layers and endcap discs are analysed on their own threads; the output is the same either way.
+   * The analysis always runs in sequence when the sensors are flipped.
+   * @param concurrent True to analyse the layers and discs concurrently
+   */
+  void Extractor::setConcurrentAnalysis(bool concurrent) {
+    concurrentAnalysis_ = concurrent && canAnalyseConcurrently;
+  }
+
   /**
    * This is the public analysis function that extracts the information that is necessary to convert a given material budget to a
    * series of CMSSW XML files. None of this information is written to file, though. Instead, it is stored in a custom struct that
@@ -57,6 +78,7 @@ namespace insur {
     r.clear(); // Rotation
     t.clear(); // SpecParInfo
     ri.clear(); // RILengthInfo
+    composites_.clear();
 
     // Initialization
 
@@ -430,6 +452,7 @@ namespace insur {
    * They is also some topology, such as which volumes contain the active surfaces, and how those active surfaces are subdivided
    * and connected to the readout electronics. Last but not least, overall radiation and interaction lengths for each layer are 
    * calculated and stored; those are used as approximative values for certain CMSSW functions later on.
+   * Each layer is analysed on a thread of its own by analyseLayer(), and the results are merged in the order of the layers.
    * @param mt A reference to the global material table; used as input
    * @param bc A reference to the collection of material properties of the barrel modules; used as input
    * @param tr A reference to the tracker object; used as input
@@ -454,32 +477,13 @@ namespace insur {
 
 
     // Container inits
-    ShapeInfo shape;
-    shape.dyy = 0.0;
-
-    ShapeOperationInfo shapeOp;
-
-    LogicalInfo logic;
-
     PosInfo pos;
     pos.copy = 1;
     pos.trans.dx = 0.0;
     pos.trans.dy = 0.0;
     pos.trans.dz = 0.0;
 
-    AlgoInfo alg;
-
-    Rotation rot;
-    rot.phix = 0.0;
-    rot.phiy = 0.0;
-    rot.phiz = 0.0;
-    rot.thetax = 0.0;
-    rot.thetay = 0.0;
-    rot.thetaz = 0.0;
-
-    ModuleROCInfo minfo;
-    ModuleROCInfo minfo_zero={};
-    SpecParInfo rocdims, lspec, rspec, sspec, mspec;
+    SpecParInfo lspec, rspec, sspec, mspec;
     // Layer
     lspec.name = xml_subdet_layer + xml_par_tail;
     lspec.parameter.first = xml_tkddd_structure;
@@ -496,12 +500,7 @@ namespace insur {
     mspec.name = xml_subdet_tobdet + xml_par_tail;
     mspec.parameter.first = xml_tkddd_structure;
     mspec.parameter.second = xml_det_tobdet;
-
-
-    // material properties
-    RILengthInfo ril;
-    ril.barrel = true;
-    ril.index = 0;
+    SpecParInfo* specs[] = { &lspec, &rspec, &sspec, &mspec };
 
 
     // aggregate information about the modules
@@ -509,293 +508,401 @@ namespace insur {
     tr.accept(lagg);
     lagg.postVisit();
     std::vector<std::vector<ModuleCap> >& bc = lagg.getBarrelCap();
+    std::vector<Layer*>& layers = *lagg.getBarrelLayers();
+
+    // Each layer goes into its own fragment, on its own thread, numbered as if no layer before it were skipped
+    std::vector<CMSSWBundle> fragments(bc.size());
+    std::vector<std::future<bool> > jobs;
+    if (concurrentAnalysis_) {
+      for (unsigned int i = 0; i < bc.size(); i++) {
+        jobs.push_back(std::async(std::launch::async, [&, i, pos]() mutable {
+          return analyseLayer(*layers.at(i), bc.at(i), i + 1, nspace, pos, fragments.at(i));
+        }));
+      }
+    }
 
-    std::vector<std::vector<ModuleCap> >::iterator oiter;
-    std::vector<ModuleCap>::iterator iiter;
-    
     int layer = 1;
 
 
-    // LOOP ON LAYERS
-    for (oiter = bc.begin(); oiter != bc.end(); oiter++) {
-      
-      // is the layer tilted ?
-      bool isTilted = lagg.getBarrelLayers()->at(layer - 1)->isTilted();
-     
-      // Calculate geometrical extrema of rod (straight layer), or of rod part + tilted ring (tilted layer)
-      // straight layer : x and y extrema of rod
-      double xmin = std::numeric_limits<double>::max();
-      double xmax = 0;
-      double ymin = std::numeric_limits<double>::max();
-      double ymax = 0;
-      // straight or tilted layer : z and r extrema of rod (straight layer), or of {rod part + tilted ring} (tilted layer)
-      //double zmin = std::numeric_limits<double>::max();
-      double zmax = 0;
-      double rmin = std::numeric_limits<double>::max();
-      double rmax = 0;
-      // tilted layer : x, y, z, and r extrema of rod part
-      double flatPartMinX = std::numeric_limits<double>::max();
-      double flatPartMaxX = 0;
-      double flatPartMinY = std::numeric_limits<double>::max();
-      double flatPartMaxY = 0;
-      double flatPartMaxZ = 0;
-      double flatPartMinR = std::numeric_limits<double>::max();
-      double flatPartMaxR = 0;
-      // straight or tilted layer : radii of rods (straight layer) or of rod parts (tilted layer)
-      double RadiusIn = 0;
-      double RadiusOut = 0;
-      // loop on module caps
-      for (iiter = oiter->begin(); iiter != oiter->end(); iiter++) {
-	// only positive side, and modules with uniref phi == 1 or 2
-	if (iiter->getModule().uniRef().side > 0 && (iiter->getModule().uniRef().phi == 1 || iiter->getModule().uniRef().phi == 2)) {
-	  int modRing = iiter->getModule().uniRef().ring;
-	  // layer name
-	  std::ostringstream lname;
-	  lname << xml_layer << layer; // e.g. Layer1
-	  // module name
-	  std::ostringstream mname;
-	  mname << xml_barrel_module << modRing << lname.str(); //.e.g. BModule1Layer1
-	  // parent module name
-	  std::string parentName = mname.str();
-	  // build module volumes, with hybrids taken into account
-	  ModuleComplex modcomplex(mname.str(),parentName,*iiter);
-	  modcomplex.buildSubVolumes();
-	  if (iiter->getModule().uniRef().phi == 1) {
-	    xmin = MIN(xmin, modcomplex.getXmin());
-	    xmax = MAX(xmax, modcomplex.getXmax());
-	    ymin = MIN(ymin, modcomplex.getYmin());
-	    ymax = MAX(ymax, modcomplex.getYmax());
-	    // tilted layer : rod part
-	    if (isTilted && iiter->getModule().tiltAngle() == 0) {
-	      flatPartMinX = MIN(flatPartMinX, modcomplex.getXmin());
-	      flatPartMaxX = MAX(flatPartMaxX, modcomplex.getXmax());
-	      flatPartMinY = MIN(flatPartMinY, modcomplex.getYmin());
-	      flatPartMaxY = MAX(flatPartMaxY, modcomplex.getYmax());
-	    }
-	  }
-	  // for z and r, uniref phi == 2 has to be taken into account too
-	  // (because different from uniref phi == 1 in case of tilted layer)
-	  zmax = MAX(zmax, modcomplex.getZmax());
-	  //zmin = -zmax;
-	  rmin = MIN(rmin, modcomplex.getRmin());
-	  rmax = MAX(rmax, modcomplex.getRmax());
-	  // tilted layer : rod part
-	  if (isTilted && (iiter->getModule().tiltAngle() == 0)) {
-	    flatPartMaxZ = MAX(flatPartMaxZ, modcomplex.getZmax());
-	    flatPartMinR = MIN(flatPartMinR, modcomplex.getRmin());
-	    flatPartMaxR = MAX(flatPartMaxR, modcomplex.getRmax());
-	  }
-	  // both modRings 1 and 2 have to be taken into account because of small delta
-	  if (iiter->getModule().uniRef().phi == 1 && (modRing == 1 || modRing == 2)) { RadiusIn = RadiusIn + iiter->getModule().center().Rho() / 2; }
-	  if (iiter->getModule().uniRef().phi == 2 && (modRing == 1 || modRing == 2)) { RadiusOut = RadiusOut + iiter->getModule().center().Rho() / 2; }
-	}
+    // LOOP ON LAYERS: the fragments are merged in order
+    for (unsigned int i = 0; i < bc.size(); i++) {
+      bool analysed = concurrentAnalysis_ ? jobs.at(i).get() : false;
+      // a skipped layer does not take a number, so the layers after it are done again with the right one
+      if (!concurrentAnalysis_ || layer != int(i + 1)) {
+        fragments.at(i) = CMSSWBundle();
+        analysed = analyseLayer(*layers.at(layer - 1), bc.at(i), layer, nspace, pos, fragments.at(i));
       }
+      so.insert(so.end(), fragments.at(i).shapeOps.begin(), fragments.at(i).shapeOps.end());
+      appendFragment(fragments.at(i), c, l, s, p, a, r, ri, specs);
+      if (analysed) layer++;
+    }
+    if (!lspec.partselectors.empty()) t.push_back(lspec);
+    if (!rspec.partselectors.empty()) t.push_back(rspec);
+    if (!sspec.partselectors.empty()) t.push_back(sspec);
+    if (!mspec.partselectors.empty()) t.push_back(mspec);
+  }
 
+  /**
+   * Analyses one barrel layer for analyseLayers() into a fragment of the output, which depends on nothing but the layer itself.
+   * @param barrelLayer A reference to the layer object; used as input
+   * @param caps A reference to the collection of material properties of the layer modules; used as input
+   * @param layer The number of the layer in the volume names
+   * @param nspace The namespace of the volume names
+   * @param pos A reference to the positioning template, left as the layer leaves it
+   * @param f A reference to the fragment; its specs are the layer, rod, module stack and module part selectors, in this order; used for output
+   * @return False if the layer was skipped, true otherwise
+   */
+  bool Extractor::analyseLayer(Layer& barrelLayer, std::vector<ModuleCap>& caps, int layer, const std::string& nspace, PosInfo& pos, CMSSWBundle& f) {
 
-      if ((rmax - rmin) == 0.0) continue;
+    std::vector<Composite>& c = f.composites;
+    std::vector<LogicalInfo>& l = f.logic;
+    std::vector<ShapeInfo>& s = f.shapes;
+    std::vector<ShapeOperationInfo>& so = f.shapeOps;
+    std::vector<PosInfo>& p = f.positions;
+    std::vector<AlgoInfo>& a = f.algos;
+    std::map<std::string,Rotation>& r = f.rots;
+    std::vector<RILengthInfo>& ri = f.lrilength;
 
+    // Container inits
+    ShapeInfo shape;
+    shape.dyy = 0.0;
 
-      shape.type = bx; // box
-      shape.rmin = 0.0;
-      shape.rmax = 0.0;
+    ShapeOperationInfo shapeOp;
 
+    LogicalInfo logic;
 
-      // for material properties
-      double rtotal = 0.0, itotal = 0.0;     
-      int count = 0;
-      ril.index = layer;
-      
+    AlgoInfo alg;
 
-      std::ostringstream lname, rodname, pconverter;
-      lname << xml_layer << layer; // e.g. Layer1
-      rodname << xml_rod << layer; // e.g.Rod1
+    Rotation rot;
+    rot.phix = 0.0;
+    rot.phiy = 0.0;
+    rot.phiz = 0.0;
+    rot.thetax = 0.0;
+    rot.thetay = 0.0;
+    rot.thetaz = 0.0;
 
-      // information on tilted rings, indexed by ring number
-      std::map<int, BTiltedRingInfo> rinfoplus; // positive-z side
-      std::map<int, BTiltedRingInfo> rinfominus; // negative-z side
+    ModuleROCInfo minfo;
+    ModuleROCInfo minfo_zero={};
+    SpecParInfo lspec, rspec, sspec, mspec;
 
+    // material properties
+    RILengthInfo ril;
+    ril.barrel = true;
+    ril.index = 0;
 
-      // LOOP ON MODULE CAPS 
-      for (iiter = oiter->begin(); iiter != oiter->end(); iiter++) {
-        
-	// ONLY POSITIVE SIDE, AND MODULES WITH UNIREF PHI == 1 OR 2
-	if (iiter->getModule().uniRef().side > 0 && (iiter->getModule().uniRef().phi == 1 || iiter->getModule().uniRef().phi == 2)) {
+    std::vector<ModuleCap>::iterator iiter;
 
-	  // ring number (position on rod, or tilted ring number)
-	  int modRing = iiter->getModule().uniRef().ring; 
+    // is the layer tilted ?
+    bool isTilted = barrelLayer.isTilted();
+   
+    // Calculate geometrical extrema of rod (straight layer), or of rod part + tilted ring (tilted layer)
+    // straight layer : x and y extrema of rod
+    double xmin = std::numeric_limits<double>::max();
+    double xmax = 0;
+    double ymin = std::numeric_limits<double>::max();
+    double ymax = 0;
+    // straight or tilted layer : z and r extrema of rod (straight layer), or of {rod part + tilted ring} (tilted layer)
+    //double zmin = std::numeric_limits<double>::max();
+    double zmax = 0;
+    double rmin = std::numeric_limits<double>::max();
+    double rmax = 0;
+    // tilted layer : x, y, z, and r extrema of rod part
+    double flatPartMinX = std::numeric_limits<double>::max();
+    double flatPartMaxX = 0;
+    double flatPartMinY = std::numeric_limits<double>::max();
+    double flatPartMaxY = 0;
+    double flatPartMaxZ = 0;
+    double flatPartMinR = std::numeric_limits<double>::max();
+    double flatPartMaxR = 0;
+    // straight or tilted layer : radii of rods (straight layer) or of rod parts (tilted layer)
+    double RadiusIn = 0;
+    double RadiusOut = 0;
+    // loop on module caps
+    for (iiter = caps.begin(); iiter != caps.end(); iiter++) {
+      // only positive side, and modules with uniref phi == 1 or 2
+      if (iiter->getModule().uniRef().side > 0 && (iiter->getModule().uniRef().phi == 1 || iiter->getModule().uniRef().phi == 2)) {
+        int modRing = iiter->getModule().uniRef().ring;
+        // layer name
+        std::ostringstream lname;
+        lname << xml_layer << layer; // e.g. Layer1
+        // module name
+        std::ostringstream mname;
+        mname << xml_barrel_module << modRing << lname.str(); //.e.g. BModule1Layer1
+        // parent module name
+        std::string parentName = mname.str();
+        // build module volumes, with hybrids taken into account
+        ModuleComplex modcomplex(mname.str(),parentName,*iiter);
+        modcomplex.buildSubVolumes();
+        if (iiter->getModule().uniRef().phi == 1) {
+          xmin = MIN(xmin, modcomplex.getXmin());
+          xmax = MAX(xmax, modcomplex.getXmax());
+          ymin = MIN(ymin, modcomplex.getYmin());
+          ymax = MAX(ymax, modcomplex.getYmax());
+          // tilted layer : rod part
+          if (isTilted && iiter->getModule().tiltAngle() == 0) {
+            flatPartMinX = MIN(flatPartMinX, modcomplex.getXmin());
+            flatPartMaxX = MAX(flatPartMaxX, modcomplex.getXmax());
+            flatPartMinY = MIN(flatPartMinY, modcomplex.getYmin());
+            flatPartMaxY = MAX(flatPartMaxY, modcomplex.getYmax());
+          }
+        }
+        // for z and r, uniref phi == 2 has to be taken into account too
+        // (because different from uniref phi == 1 in case of tilted layer)
+        zmax = MAX(zmax, modcomplex.getZmax());
+        //zmin = -zmax;
+        rmin = MIN(rmin, modcomplex.getRmin());
+        rmax = MAX(rmax, modcomplex.getRmax());
+        // tilted layer : rod part
+        if (isTilted && (iiter->getModule().tiltAngle() == 0)) {
+          flatPartMaxZ = MAX(flatPartMaxZ, modcomplex.getZmax());
+          flatPartMinR = MIN(flatPartMinR, modcomplex.getRmin());
+          flatPartMaxR = MAX(flatPartMaxR, modcomplex.getRmax());
+        }
+        // both modRings 1 and 2 have to be taken into account because of small delta
+        if (iiter->getModule().uniRef().phi == 1 && (modRing == 1 || modRing == 2)) { RadiusIn = RadiusIn + iiter->getModule().center().Rho() / 2; }
+        if (iiter->getModule().uniRef().phi == 2 && (modRing == 1 || modRing == 2)) { RadiusOut = RadiusOut + iiter->getModule().center().Rho() / 2; }
+      }
+    }
+
+
+    if ((rmax - rmin) == 0.0) return false;
+
+
+    shape.type = bx; // box
+    shape.rmin = 0.0;
+    shape.rmax = 0.0;
+
+
+    // for material properties
+    double rtotal = 0.0, itotal = 0.0;     
+    int count = 0;
+    ril.index = layer;
     
-	  // tilt angle of the module
-	  double tiltAngle = 0;
-	  if (isTilted) { tiltAngle = iiter->getModule().tiltAngle() * 180 / M_PI; }
+
+    std::ostringstream lname, rodname, pconverter;
+    lname << xml_layer << layer; // e.g. Layer1
+    rodname << xml_rod << layer; // e.g.Rod1
+
+    // information on tilted rings, indexed by ring number
+    std::map<int, BTiltedRingInfo> rinfoplus; // positive-z side
+    std::map<int, BTiltedRingInfo> rinfominus; // negative-z side
+
+
+    // LOOP ON MODULE CAPS 
+    for (iiter = caps.begin(); iiter != caps.end(); iiter++) {
+      
+      // ONLY POSITIVE SIDE, AND MODULES WITH UNIREF PHI == 1 OR 2
+      if (iiter->getModule().uniRef().side > 0 && (iiter->getModule().uniRef().phi == 1 || iiter->getModule().uniRef().phi == 2)) {
+
+        // ring number (position on rod, or tilted ring number)
+        int modRing = iiter->getModule().uniRef().ring; 
+  
+        // tilt angle of the module
+        double tiltAngle = 0;
+        if (isTilted) { tiltAngle = iiter->getModule().tiltAngle() * 180 / M_PI; }
 	    
-	  //std::cout << "iiter->getModule().uniRef().phi = " << iiter->getModule().uniRef().phi << " iiter->getModule().center().Rho() = " << iiter->getModule().center().Rho() << " iiter->getModule().center().X() = " << iiter->getModule().center().X() << " iiter->getModule().center().Y() = " << iiter->getModule().center().Y() << " iiter->getModule().center().Z() = " << iiter->getModule().center().Z() << " tiltAngle = " << tiltAngle << " iiter->getModule().flipped() = " << iiter->getModule().flipped() << " iiter->getModule().moduleType() = " << iiter->getModule().moduleType() << std::endl;
+        //std::cout << "iiter->getModule().uniRef().phi = " << iiter->getModule().uniRef().phi << " iiter->getModule().center().Rho() = " << iiter->getModule().center().Rho() << " iiter->getModule().center().X() = " << iiter->getModule().center().X() << " iiter->getModule().center().Y() = " << iiter->getModule().center().Y() << " iiter->getModule().center().Z() = " << iiter->getModule().center().Z() << " tiltAngle = " << tiltAngle << " iiter->getModule().flipped() = " << iiter->getModule().flipped() << " iiter->getModule().moduleType() = " << iiter->getModule().moduleType() << std::endl;
 
-	  // module name
-	  std::ostringstream mname;
-	  mname << xml_barrel_module << modRing << lname.str(); // e.g. BModule1Layer1
+        // module name
+        std::ostringstream mname;
+        mname << xml_barrel_module << modRing << lname.str(); // e.g. BModule1Layer1
 
-	  // parent module name
-	  std::string parentName = mname.str();
+        // parent module name
+        std::string parentName = mname.str();
 
-	  // build module volumes, with hybrids taken into account
-	  ModuleComplex modcomplex(mname.str(),parentName,*iiter);
-	  modcomplex.buildSubVolumes();
+        // build module volumes, with hybrids taken into account
+        ModuleComplex modcomplex(mname.str(),parentName,*iiter);
+        modcomplex.buildSubVolumes();
 #ifdef __DEBUGPRINT__
-	  modcomplex.print();
+        modcomplex.print();
 #endif
 
-	  // ROD 1 (STRAIGHT LAYER), OR ROD 1 + MODULES WITH UNIREF PHI == 1 OF THE TILTED RINGS (TILTED LAYER)
-	  if (iiter->getModule().uniRef().phi == 1) {
+        // ROD 1 (STRAIGHT LAYER), OR ROD 1 + MODULES WITH UNIREF PHI == 1 OF THE TILTED RINGS (TILTED LAYER)
+        if (iiter->getModule().uniRef().phi == 1) {
 
-            std::vector<ModuleCap>::iterator partner;
+          std::vector<ModuleCap>::iterator partner;
 
-            std::ostringstream ringname, matname, specname;
-	    ringname << xml_ring << modRing << lname.str();
+          std::ostringstream ringname, matname, specname;
+          ringname << xml_ring << modRing << lname.str();
 
 
-	    // MODULE
+          // MODULE
 
-	    // For SolidSection in tracker.xml : module's box shape
-            shape.name_tag = mname.str();
-            //shape.dx = iiter->getModule().area() / iiter->getModule().length() / 2.0;
-            //shape.dy = iiter->getModule().length() / 2.0;
-            //shape.dz = iiter->getModule().thickness() / 2.0;
-            shape.dx = modcomplex.getExpandedModuleWidth()/2.0;
-            shape.dy = modcomplex.getExpandedModuleLength()/2.0;
-            shape.dz = modcomplex.getExpandedModuleThickness()/2.0;
-	    s.push_back(shape);
+          // For SolidSection in tracker.xml : module's box shape
+          shape.name_tag = mname.str();
+          //shape.dx = iiter->getModule().area() / iiter->getModule().length() / 2.0;
+          //shape.dy = iiter->getModule().length() / 2.0;
+          //shape.dz = iiter->getModule().thickness() / 2.0;
+          shape.dx = modcomplex.getExpandedModuleWidth()/2.0;
+          shape.dy = modcomplex.getExpandedModuleLength()/2.0;
+          shape.dz = modcomplex.getExpandedModuleThickness()/2.0;
+          s.push_back(shape);
 	    
 
-	    // For LogicalPartSection in tracker.xml : module's material
-            //logic.material_tag = nspace + ":" + matname.str();
-            logic.material_tag = xml_material_air;
-            logic.name_tag = mname.str();
-            logic.shape_tag = nspace + ":" + logic.name_tag;
-	    l.push_back(logic);	    
-	    // module composite material
-            //matname << xml_base_actcomp << "L" << layer << "P" << modRing;
-            //c.push_back(createComposite(matname.str(), compositeDensity(*iiter, true), *iiter, true));
-            
-
-	    // For PosPart section in tracker.xml : module's positions in rod (straight layer) or rod part (tilted layer)
-            if (!isTilted || (isTilted && (tiltAngle == 0))) {
-	      pos.parent_tag = nspace + ":" + rodname.str();
-	      pos.child_tag = nspace + ":" + mname.str();
-	      partner = findPartnerModule(iiter, oiter->end(), modRing);
-
-	      pos.trans.dx = iiter->getModule().center().Rho() - RadiusIn;
-	      pos.trans.dz = iiter->getModule().center().Z();
-	      if (!iiter->getModule().flipped()) { pos.rotref = nspace + ":" + xml_places_unflipped_mod_in_rod; }
-	      else { pos.rotref = nspace + ":" + xml_places_flipped_mod_in_rod; }
-	      p.push_back(pos);
+          // For LogicalPartSection in tracker.xml : module's material
+          //logic.material_tag = nspace + ":" + matname.str();
+          logic.material_tag = xml_material_air;
+          logic.name_tag = mname.str();
+          logic.shape_tag = nspace + ":" + logic.name_tag;
+          l.push_back(logic);	    
+          // module composite material
+          //matname << xml_base_actcomp << "L" << layer << "P" << modRing;
+          //c.push_back(createComposite(matname.str(), compositeDensity(*iiter, true), *iiter, true));
+          
+
+          // For PosPart section in tracker.xml : module's positions in rod (straight layer) or rod part (tilted layer)
+          if (!isTilted || (isTilted && (tiltAngle == 0))) {
+            pos.parent_tag = nspace + ":" + rodname.str();
+            pos.child_tag = nspace + ":" + mname.str();
+            partner = findPartnerModule(iiter, caps.end(), modRing);
+
+            pos.trans.dx = iiter->getModule().center().Rho() - RadiusIn;
+            pos.trans.dz = iiter->getModule().center().Z();
+            if (!iiter->getModule().flipped()) { pos.rotref = nspace + ":" + xml_places_unflipped_mod_in_rod; }
+            else { pos.rotref = nspace + ":" + xml_places_flipped_mod_in_rod; }
+            p.push_back(pos);
 	      
-	      // This is a copy of the BModule (FW/BW barrel half)
-	      if (partner != oiter->end()) {
-		pos.trans.dx = partner->getModule().center().Rho() - RadiusIn;
-		pos.trans.dz = partner->getModule().center().Z();
-		if (!partner->getModule().flipped()) { pos.rotref = nspace + ":" + xml_places_unflipped_mod_in_rod; }
-		else { pos.rotref = nspace + ":" + xml_places_flipped_mod_in_rod; }
-		pos.copy = 2; 
-		p.push_back(pos);
-		pos.copy = 1;
-	      }
-	      pos.rotref = "";
-	    }
-
-	    // Topology
-	    sspec.partselectors.push_back(mname.str());
-	    sspec.moduletypes.push_back(minfo_zero);
-
-
-            // WAFER
-            string xml_base_lowerupper = "";
-            if (iiter->getModule().numSensors() == 2) xml_base_lowerupper = xml_base_lower;
-
-	    // SolidSection
+            // This is a copy of the BModule (FW/BW barrel half)
+            if (partner != caps.end()) {
+              pos.trans.dx = partner->getModule().center().Rho() - RadiusIn;
+              pos.trans.dz = partner->getModule().center().Z();
+              if (!partner->getModule().flipped()) { pos.rotref = nspace + ":" + xml_places_unflipped_mod_in_rod; }
+              else { pos.rotref = nspace + ":" + xml_places_flipped_mod_in_rod; }
+              pos.copy = 2; 
+              p.push_back(pos);
+              pos.copy = 1;
+            }
+            pos.rotref = "";
+          }
+
+          // Topology
+          sspec.partselectors.push_back(mname.str());
+          sspec.moduletypes.push_back(minfo_zero);
+
+
+          // WAFER
+          string xml_base_lowerupper = "";
+          if (iiter->getModule().numSensors() == 2) xml_base_lowerupper = xml_base_lower;
+
+          // SolidSection
+          shape.name_tag = mname.str() + xml_base_lowerupper + xml_base_waf;
+          shape.dx = iiter->getModule().area() / iiter->getModule().length() / 2.0;
+          shape.dy = iiter->getModule().length() / 2.0;
+          shape.dz = iiter->getModule().sensorThickness() / 2.0;
+          s.push_back(shape);   
+
+          // LogicalPartSection
+          logic.name_tag = mname.str() + xml_base_lowerupper + xml_base_waf;
+          logic.shape_tag = nspace + ":" + logic.name_tag;
+          logic.material_tag = xml_material_air;
+          l.push_back(logic);
+
+          // PosPart section
+          pos.parent_tag = nspace + ":" + mname.str();
+          pos.child_tag = nspace + ":" + mname.str() + xml_base_lowerupper + xml_base_waf;
+          pos.trans.dx = 0.0;
+          pos.trans.dz = /*shape.dz*/ - iiter->getModule().dsDistance() / 2.0; 
+          p.push_back(pos);
+
+          if (iiter->getModule().numSensors() == 2) {
+
+            xml_base_lowerupper = xml_base_upper;
+
+            // SolidSection
             shape.name_tag = mname.str() + xml_base_lowerupper + xml_base_waf;
-	    shape.dx = iiter->getModule().area() / iiter->getModule().length() / 2.0;
-	    shape.dy = iiter->getModule().length() / 2.0;
-            shape.dz = iiter->getModule().sensorThickness() / 2.0;
-            s.push_back(shape);   
+            s.push_back(shape);
 
-	    // LogicalPartSection
+            // LogicalPartSection
             logic.name_tag = mname.str() + xml_base_lowerupper + xml_base_waf;
             logic.shape_tag = nspace + ":" + logic.name_tag;
-            logic.material_tag = xml_material_air;
             l.push_back(logic);
 
-	    // PosPart section
-            pos.parent_tag = nspace + ":" + mname.str();
+            // PosPart section
             pos.child_tag = nspace + ":" + mname.str() + xml_base_lowerupper + xml_base_waf;
-            pos.trans.dx = 0.0;
-            pos.trans.dz = /*shape.dz*/ - iiter->getModule().dsDistance() / 2.0; 
+            pos.trans.dz = pos.trans.dz + /*2 * shape.dz +*/ iiter->getModule().dsDistance();  // CUIDADO: was with 2*shape.dz, but why???
+            //pos.copy = 2;
+
+            if (iiter->getModule().stereoRotation() != 0) {
+              rot.name = type_stereo + mname.str();
+              rot.thetax = 90.0;
+              rot.phix = iiter->getModule().stereoRotation() / M_PI * 180;
+              rot.thetay = 90.0;
+              rot.phiy = 90.0 + iiter->getModule().stereoRotation() / M_PI * 180;
+              r.insert(std::pair<const std::string,Rotation>(rot.name,rot));
+              pos.rotref = nspace + ":" + rot.name;
+            }
             p.push_back(pos);
 
-            if (iiter->getModule().numSensors() == 2) {
-
-              xml_base_lowerupper = xml_base_upper;
-
-	      // SolidSection
-              shape.name_tag = mname.str() + xml_base_lowerupper + xml_base_waf;
-              s.push_back(shape);
-
-	      // LogicalPartSection
-              logic.name_tag = mname.str() + xml_base_lowerupper + xml_base_waf;
-              logic.shape_tag = nspace + ":" + logic.name_tag;
-              l.push_back(logic);
-
-	      // PosPart section
-              pos.child_tag = nspace + ":" + mname.str() + xml_base_lowerupper + xml_base_waf;
-              pos.trans.dz = pos.trans.dz + /*2 * shape.dz +*/ iiter->getModule().dsDistance();  // CUIDADO: was with 2*shape.dz, but why???
-              //pos.copy = 2;
-
-              if (iiter->getModule().stereoRotation() != 0) {
-                rot.name = type_stereo + mname.str();
-                rot.thetax = 90.0;
-                rot.phix = iiter->getModule().stereoRotation() / M_PI * 180;
-                rot.thetay = 90.0;
-                rot.phiy = 90.0 + iiter->getModule().stereoRotation() / M_PI * 180;
-                r.insert(std::pair<const std::string,Rotation>(rot.name,rot));
-                pos.rotref = nspace + ":" + rot.name;
-              }
-              p.push_back(pos);
+            // Now reset
+            pos.rotref.clear();
+            rot.name.clear();
+            rot.thetax = 0.0;
+            rot.phix = 0.0;
+            rot.thetay = 0.0;
+            rot.phiy = 0.0;
+            pos.copy = 1;
+          }
 
-              // Now reset
-              pos.rotref.clear();
-              rot.name.clear();
-              rot.thetax = 0.0;
-              rot.phix = 0.0;
-              rot.thetay = 0.0;
-              rot.phiy = 0.0;
-              pos.copy = 1;
-            }
 
+          // ACTIVE SURFACE
+          xml_base_lowerupper = "";
+          if (iiter->getModule().numSensors() == 2) xml_base_lowerupper = xml_base_lower;
 
-            // ACTIVE SURFACE
-            xml_base_lowerupper = "";
-            if (iiter->getModule().numSensors() == 2) xml_base_lowerupper = xml_base_lower;
+          if (iiter->getModule().moduleType() == "ptPS") shape.name_tag = mname.str() + xml_base_lowerupper + xml_base_ps + xml_base_pixel + xml_base_act;
+          else if (iiter->getModule().moduleType() == "pt2S") shape.name_tag = mname.str() + xml_base_lowerupper + xml_base_2s+ xml_base_act;
+          else { std::cerr << "Unknown module type : " << iiter->getModule().moduleType() << " ." << std::endl; }
 
-	    if (iiter->getModule().moduleType() == "ptPS") shape.name_tag = mname.str() + xml_base_lowerupper + xml_base_ps + xml_base_pixel + xml_base_act;
-	    else if (iiter->getModule().moduleType() == "pt2S") shape.name_tag = mname.str() + xml_base_lowerupper + xml_base_2s+ xml_base_act;
-	    else { std::cerr << "Unknown module type : " << iiter->getModule().moduleType() << " ." << std::endl; }
+          // SolidSection
+          shape.dx = iiter->getModule().area() / iiter->getModule().length() / 2.0;
+          shape.dy = iiter->getModule().length() / 2.0;
+          shape.dz = iiter->getModule().sensorThickness() / 2.0;
+          s.push_back(shape);   
 
-	    // SolidSection
-	    shape.dx = iiter->getModule().area() / iiter->getModule().length() / 2.0;
-	    shape.dy = iiter->getModule().length() / 2.0;
-            shape.dz = iiter->getModule().sensorThickness() / 2.0;
-            s.push_back(shape);   
+          // LogicalPartSection
+          logic.name_tag = shape.name_tag;
+          logic.shape_tag = nspace + ":" + logic.name_tag;
+          logic.material_tag = nspace + ":" + xml_sensor_silicon;
+          l.push_back(logic);
 
-	    // LogicalPartSection
+          // PosPart section
+          pos.parent_tag = nspace + ":" + mname.str() + xml_base_lowerupper + xml_base_waf;
+          pos.child_tag = nspace + ":" + shape.name_tag;
+          pos.trans.dz = 0.0;
+#ifdef __FLIPSENSORS_IN__ // Flip INNER sensors
+          pos.rotref = nspace + ":" + rot_sensor_tag;
+#endif
+          p.push_back(pos);
+
+          // Topology
+          mspec.partselectors.push_back(shape.name_tag);
+
+          minfo.name		= iiter->getModule().moduleType();
+          minfo.rocrows	= any2str<int>(iiter->getModule().innerSensor().numROCRows());  // in case of single sensor module innerSensor() and outerSensor() point to the same sensor
+          minfo.roccols	= any2str<int>(iiter->getModule().innerSensor().numROCCols());
+          minfo.rocx		= any2str<int>(iiter->getModule().innerSensor().numROCX());
+          minfo.rocy		= any2str<int>(iiter->getModule().innerSensor().numROCY());
+
+          mspec.moduletypes.push_back(minfo);
+
+          if (iiter->getModule().numSensors() == 2) { 
+
+            xml_base_lowerupper = xml_base_upper;
+
+            // SolidSection
+            if (iiter->getModule().moduleType() == "ptPS") shape.name_tag = mname.str() + xml_base_lowerupper + xml_base_ps + xml_base_strip + xml_base_act;
+            else if (iiter->getModule().moduleType() == "pt2S") shape.name_tag = mname.str() + xml_base_lowerupper + xml_base_2s+ xml_base_act;
+            else { std::cerr << "Unknown module type : " << iiter->getModule().moduleType() << " ." << std::endl; }
+            s.push_back(shape);
+
+            // LogicalPartSection
             logic.name_tag = shape.name_tag;
             logic.shape_tag = nspace + ":" + logic.name_tag;
-            logic.material_tag = nspace + ":" + xml_sensor_silicon;
             l.push_back(logic);
 
-	    // PosPart section
+            // PosPart section
             pos.parent_tag = nspace + ":" + mname.str() + xml_base_lowerupper + xml_base_waf;
             pos.child_tag = nspace + ":" + shape.name_tag;
-            pos.trans.dz = 0.0;
-#ifdef __FLIPSENSORS_IN__ // Flip INNER sensors
+#ifdef __FLIPSENSORS_OUT__ // Flip OUTER sensors
             pos.rotref = nspace + ":" + rot_sensor_tag;
 #endif
             p.push_back(pos);
@@ -803,337 +910,302 @@ namespace insur {
             // Topology
             mspec.partselectors.push_back(shape.name_tag);
 
-            minfo.name		= iiter->getModule().moduleType();
-            minfo.rocrows	= any2str<int>(iiter->getModule().innerSensor().numROCRows());  // in case of single sensor module innerSensor() and outerSensor() point to the same sensor
-            minfo.roccols	= any2str<int>(iiter->getModule().innerSensor().numROCCols());
-            minfo.rocx		= any2str<int>(iiter->getModule().innerSensor().numROCX());
-            minfo.rocy		= any2str<int>(iiter->getModule().innerSensor().numROCY());
+            minfo.rocrows	= any2str<int>(iiter->getModule().outerSensor().numROCRows());
+            minfo.roccols	= any2str<int>(iiter->getModule().outerSensor().numROCCols());
+            minfo.rocx	= any2str<int>(iiter->getModule().outerSensor().numROCX());
+            minfo.rocy	= any2str<int>(iiter->getModule().outerSensor().numROCY());
 
             mspec.moduletypes.push_back(minfo);
+            modcomplex.addMaterialInfo(c, composites_);
+            modcomplex.addShapeInfo(s);
+            modcomplex.addLogicInfo(l);
+            modcomplex.addPositionInfo(p);
+#ifdef __DEBUGPRINT__
+            modcomplex.print();
+#endif
+          } // End of replica for Pt-modules
+
+
+          // collect tilted ring info
+          if (isTilted && (tiltAngle != 0)) {
+            BTiltedRingInfo rinf;
+            // ring on positive-z side
+            rinf.name = ringname.str() + xml_plus;	      
+            rinf.childname = mname.str();
+            rinf.isZPlus = 1;
+            rinf.tiltAngle = tiltAngle;
+            rinf.bw_flipped = iiter->getModule().flipped();
+            rinf.phi = iiter->getModule().uniRef().phi;
+            rinf.modules = barrelLayer.numRods();
+            rinf.r1 = iiter->getModule().center().Rho();
+            rinf.z1 = iiter->getModule().center().Z();      
+            rinf.rmin = modcomplex.getRmin();
+            rinf.zmin = modcomplex.getZmin();
+            rinf.rminatzmin = modcomplex.getRminatZmin();      
+            rinfoplus.insert(std::pair<int, BTiltedRingInfo>(modRing, rinf));
+
+            // same ring on negative-z side
+            rinf.name = ringname.str() + xml_minus;
+            rinf.isZPlus = 0;
+            rinf.z1 = - iiter->getModule().center().Z();
+            rinfominus.insert(std::pair<int, BTiltedRingInfo>(modRing, rinf));
+          }
 
-            if (iiter->getModule().numSensors() == 2) { 
-
-              xml_base_lowerupper = xml_base_upper;
-
-	      // SolidSection
-	      if (iiter->getModule().moduleType() == "ptPS") shape.name_tag = mname.str() + xml_base_lowerupper + xml_base_ps + xml_base_strip + xml_base_act;
-	      else if (iiter->getModule().moduleType() == "pt2S") shape.name_tag = mname.str() + xml_base_lowerupper + xml_base_2s+ xml_base_act;
-	      else { std::cerr << "Unknown module type : " << iiter->getModule().moduleType() << " ." << std::endl; }
-              s.push_back(shape);
 
-	      // LogicalPartSection
-              logic.name_tag = shape.name_tag;
-              logic.shape_tag = nspace + ":" + logic.name_tag;
-              l.push_back(logic);
+          // material properties
+          rtotal = rtotal + iiter->getRadiationLength();
+          itotal = itotal + iiter->getInteractionLength();
+          count++;
+          //double dt = modcomplex.getExpandedModuleThickness();
+        }
 
-	      // PosPart section
-	      pos.parent_tag = nspace + ":" + mname.str() + xml_base_lowerupper + xml_base_waf;
-              pos.child_tag = nspace + ":" + shape.name_tag;
-#ifdef __FLIPSENSORS_OUT__ // Flip OUTER sensors
-              pos.rotref = nspace + ":" + rot_sensor_tag;
-#endif
-              p.push_back(pos);
 
-              // Topology
-              mspec.partselectors.push_back(shape.name_tag);
+        // ONLY MODULES WITH UNIREF PHI == 2 OF THE TILTED RINGS (TILTED LAYER)
+        if (isTilted && (iiter->getModule().uniRef().phi == 2)) {
+          std::map<int,BTiltedRingInfo>::iterator it;
+          // fill the info of the z-positive ring with matching ring number
+          it = rinfoplus.find(modRing);
+          if (it != rinfoplus.end()) {
+            it->second.fw_flipped = iiter->getModule().flipped();
+            it->second.r2 = iiter->getModule().center().Rho();
+            it->second.z2 = iiter->getModule().center().Z();
+            it->second.rmax = modcomplex.getRmax();
+            it->second.zmax = modcomplex.getZmax();
+            it->second.rmaxatzmax = modcomplex.getRmaxatZmax();
+          }
+          // fill the info of the z-negative ring with matching ring number
+          it = rinfominus.find(modRing);
+          if (it != rinfominus.end()) {
+            it->second.fw_flipped = iiter->getModule().flipped();
+            it->second.r2 = iiter->getModule().center().Rho();
+            it->second.z2 = - iiter->getModule().center().Z();
+            it->second.rmax = modcomplex.getRmax();
+            it->second.zmax = modcomplex.getZmax();
+            it->second.rmaxatzmax = modcomplex.getRmaxatZmax();
+          }
+        }
+      }
+    }
+    // material properties
+    if (count > 0) {
+      ril.rlength = rtotal / (double)count;
+      ril.ilength = itotal / (double)count;
+      ri.push_back(ril);
+    }
 
-              minfo.rocrows	= any2str<int>(iiter->getModule().outerSensor().numROCRows());
-              minfo.roccols	= any2str<int>(iiter->getModule().outerSensor().numROCCols());
-              minfo.rocx	= any2str<int>(iiter->getModule().outerSensor().numROCX());
-              minfo.rocy	= any2str<int>(iiter->getModule().outerSensor().numROCY());
 
-              mspec.moduletypes.push_back(minfo);
-              modcomplex.addMaterialInfo(c);
-              modcomplex.addShapeInfo(s);
-              modcomplex.addLogicInfo(l);
-              modcomplex.addPositionInfo(p);
-#ifdef __DEBUGPRINT__
-              modcomplex.print();
-#endif
-            } // End of replica for Pt-modules
-
-
-	    // collect tilted ring info
-	    if (isTilted && (tiltAngle != 0)) {
-	      BTiltedRingInfo rinf;
-	      // ring on positive-z side
-	      rinf.name = ringname.str() + xml_plus;	      
-	      rinf.childname = mname.str();
-	      rinf.isZPlus = 1;
-	      rinf.tiltAngle = tiltAngle;
-	      rinf.bw_flipped = iiter->getModule().flipped();
-	      rinf.phi = iiter->getModule().uniRef().phi;
-	      rinf.modules = lagg.getBarrelLayers()->at(layer - 1)->numRods();
-	      rinf.r1 = iiter->getModule().center().Rho();
-	      rinf.z1 = iiter->getModule().center().Z();      
-	      rinf.rmin = modcomplex.getRmin();
-	      rinf.zmin = modcomplex.getZmin();
-	      rinf.rminatzmin = modcomplex.getRminatZmin();      
-	      rinfoplus.insert(std::pair<int, BTiltedRingInfo>(modRing, rinf));
-
-	      // same ring on negative-z side
-	      rinf.name = ringname.str() + xml_minus;
-	      rinf.isZPlus = 0;
-	      rinf.z1 = - iiter->getModule().center().Z();
-	      rinfominus.insert(std::pair<int, BTiltedRingInfo>(modRing, rinf));
-	    }
-
-
-            // material properties
-            rtotal = rtotal + iiter->getRadiationLength();
-            itotal = itotal + iiter->getInteractionLength();
-            count++;
-	    //double dt = modcomplex.getExpandedModuleThickness();
-	  }
+    // rod(s)
+    shape.name_tag = rodname.str();
+    shape.dx = (ymax - ymin) / 2 + xml_epsilon;
+    if (isTilted) shape.dx = (flatPartMaxY - flatPartMinY) / 2 + xml_epsilon;
+    shape.dy = (xmax - xmin) / 2 + xml_epsilon;
+    if (isTilted) shape.dy = (flatPartMaxX - flatPartMinX) / 2 + xml_epsilon;
+    shape.dz = zmax + xml_epsilon;
+    if (isTilted) shape.dz = flatPartMaxZ + xml_epsilon;
+    s.push_back(shape);
+    logic.name_tag = rodname.str();
+    logic.shape_tag = nspace + ":" + logic.name_tag;
+    logic.material_tag = xml_material_air;
+    l.push_back(logic);
+    rspec.partselectors.push_back(rodname.str());
+    rspec.moduletypes.push_back(minfo_zero);
+      
 
+    // rods in layer algorithm(s)
+    alg.name = xml_phialt_algo;
+    alg.parent = nspace + ":" + lname.str();
+    pconverter <<  nspace + ":" + rodname.str();
+    alg.parameters.push_back(stringParam(xml_childparam, pconverter.str()));
+    pconverter.str("");
+    pconverter << (barrelLayer.tilt() + 90) << "*deg";
+    alg.parameters.push_back(numericParam(xml_tilt, pconverter.str()));
+    pconverter.str("");
+    pconverter << barrelLayer.startAngle() << "*deg";
+    alg.parameters.push_back(numericParam(xml_startangle, pconverter.str()));
+    pconverter.str("");
+    alg.parameters.push_back(numericParam(xml_rangeangle, "360*deg"));
+    pconverter << RadiusIn << "*mm";
+    alg.parameters.push_back(numericParam(xml_radiusin, pconverter.str()));
+    pconverter.str("");
+    pconverter << RadiusOut << "*mm";
+    alg.parameters.push_back(numericParam(xml_radiusout, pconverter.str()));
+    pconverter.str("");
+    alg.parameters.push_back(numericParam(xml_zposition, "0.0*mm"));
+    pconverter << barrelLayer.numRods();
+    alg.parameters.push_back(numericParam(xml_number, pconverter.str()));
+    pconverter.str("");
+    alg.parameters.push_back(numericParam(xml_startcopyno, "1"));
+    alg.parameters.push_back(numericParam(xml_incrcopyno, "1"));
+    a.push_back(alg);
+    alg.parameters.clear();
+
+    // reset
+    shape.dx = 0.0;
+    shape.dy = 0.0;
+    shape.dyy = 0.0;	  
+    pos.trans.dx = 0;
+    pos.trans.dy = 0;
+    pos.trans.dz = 0;
+
+    // tilted rings
+    if ( !rinfoplus.empty() || !rinfominus.empty() ) {
+
+      std::map<std::string, std::map<int,BTiltedRingInfo>> rinfototal;
+      if ( !rinfoplus.empty() ) { rinfototal.insert({"rinfoplus", rinfoplus}); }
+      if ( !rinfominus.empty() ) { rinfototal.insert({"rinfominus", rinfominus}); }
+
+      for (auto const &rinfoside : rinfototal) {
+
+        for (auto const &ringinfo : rinfoside.second) {
+          auto const& rinfo = ringinfo.second;
+          if (rinfo.modules > 0) {
+
+            // reset
+            shape.rmin = 0.0;
+            shape.rmax = 0.0;
+
+            // section of cone
+            shape.name_tag = rinfo.name + "Cone";
+            shape.type = co;
+            shape.dz = (rinfo.zmax - rinfo.zmin) / 2. + xml_epsilon;
+            if (rinfo.isZPlus) {
+              shape.rmin1 = rinfo.rminatzmin - xml_epsilon * tan(rinfo.tiltAngle * M_PI / 180.0);
+              shape.rmax1 = rinfo.rmaxatzmax + 2 * shape.dz * tan(rinfo.tiltAngle * M_PI / 180.0) + xml_epsilon * tan(rinfo.tiltAngle * M_PI / 180.0);
+              shape.rmin2 = rinfo.rminatzmin - 2 * shape.dz * tan(rinfo.tiltAngle * M_PI / 180.0) - xml_epsilon * tan(rinfo.tiltAngle * M_PI / 180.0);
+              shape.rmax2 = rinfo.rmaxatzmax + xml_epsilon * tan(rinfo.tiltAngle * M_PI / 180.0);
+            }
+            else {
+              shape.rmin1 = rinfo.rminatzmin - 2 * shape.dz * tan(rinfo.tiltAngle * M_PI / 180.0) - xml_epsilon * tan(rinfo.tiltAngle * M_PI / 180.0);
+              shape.rmax1 = rinfo.rmaxatzmax + xml_epsilon * tan(rinfo.tiltAngle * M_PI / 180.0);
+              shape.rmin2 = rinfo.rminatzmin - xml_epsilon * tan(rinfo.tiltAngle * M_PI / 180.0);
+              shape.rmax2 = rinfo.rmaxatzmax + 2 * shape.dz * tan(rinfo.tiltAngle * M_PI / 180.0) + xml_epsilon * tan(rinfo.tiltAngle * M_PI / 180.0);
+            }
+            s.push_back(shape);
 
-	  // ONLY MODULES WITH UNIREF PHI == 2 OF THE TILTED RINGS (TILTED LAYER)
-	  if (isTilted && (iiter->getModule().uniRef().phi == 2)) {
-	    std::map<int,BTiltedRingInfo>::iterator it;
-	    // fill the info of the z-positive ring with matching ring number
-	    it = rinfoplus.find(modRing);
-	    if (it != rinfoplus.end()) {
-	      it->second.fw_flipped = iiter->getModule().flipped();
-	      it->second.r2 = iiter->getModule().center().Rho();
-	      it->second.z2 = iiter->getModule().center().Z();
-	      it->second.rmax = modcomplex.getRmax();
-	      it->second.zmax = modcomplex.getZmax();
-	      it->second.rmaxatzmax = modcomplex.getRmaxatZmax();
-	    }
-	    // fill the info of the z-negative ring with matching ring number
-	    it = rinfominus.find(modRing);
-	    if (it != rinfominus.end()) {
-	      it->second.fw_flipped = iiter->getModule().flipped();
-	      it->second.r2 = iiter->getModule().center().Rho();
-	      it->second.z2 = - iiter->getModule().center().Z();
-	      it->second.rmax = modcomplex.getRmax();
-	      it->second.zmax = modcomplex.getZmax();
-	      it->second.rmaxatzmax = modcomplex.getRmaxatZmax();
-	    }
-	  }
-	}
-      }
-      // material properties
-      if (count > 0) {
-	ril.rlength = rtotal / (double)count;
-	ril.ilength = itotal / (double)count;
-	ri.push_back(ril);
-      }
+            // reset
+            shape.rmin1 = 0.0;
+            shape.rmax1 = 0.0;
+            shape.rmin2 = 0.0;
+            shape.rmax2 = 0.0;
+
+            // section of tub
+            shape.type = tb;
+            shape.name_tag = rinfo.name + "Tub";
+            shape.dz = (rinfo.zmax - rinfo.zmin) / 2. + xml_epsilon;
+            shape.rmin = rinfo.rmin - xml_epsilon;
+            shape.rmax = rinfo.rmax + xml_epsilon;
+            s.push_back(shape);
 
+            // intersection of sections of cone and tub
+            // Please note that the layer's dimensions rely on the fact this intersection is made,
+            // so that layer's extrema are ~rmin and ~rmax
+            shapeOp.name_tag = rinfo.name;
+            shapeOp.type = intersec;
+            shapeOp.rSolid1 = rinfo.name + "Cone";
+            shapeOp.rSolid2 = rinfo.name + "Tub";
+            so.push_back(shapeOp);
 
-      // rod(s)
-      shape.name_tag = rodname.str();
-      shape.dx = (ymax - ymin) / 2 + xml_epsilon;
-      if (isTilted) shape.dx = (flatPartMaxY - flatPartMinY) / 2 + xml_epsilon;
-      shape.dy = (xmax - xmin) / 2 + xml_epsilon;
-      if (isTilted) shape.dy = (flatPartMaxX - flatPartMinX) / 2 + xml_epsilon;
-      shape.dz = zmax + xml_epsilon;
-      if (isTilted) shape.dz = flatPartMaxZ + xml_epsilon;
-      s.push_back(shape);
-      logic.name_tag = rodname.str();
-      logic.shape_tag = nspace + ":" + logic.name_tag;
-      logic.material_tag = xml_material_air;
-      l.push_back(logic);
-      rspec.partselectors.push_back(rodname.str());
-      rspec.moduletypes.push_back(minfo_zero);
-        
-
-      // rods in layer algorithm(s)
-      alg.name = xml_phialt_algo;
-      alg.parent = nspace + ":" + lname.str();
-      pconverter <<  nspace + ":" + rodname.str();
-      alg.parameters.push_back(stringParam(xml_childparam, pconverter.str()));
-      pconverter.str("");
-      pconverter << (lagg.getBarrelLayers()->at(layer - 1)->tilt() + 90) << "*deg";
-      alg.parameters.push_back(numericParam(xml_tilt, pconverter.str()));
-      pconverter.str("");
-      pconverter << lagg.getBarrelLayers()->at(layer - 1)->startAngle() << "*deg";
-      alg.parameters.push_back(numericParam(xml_startangle, pconverter.str()));
-      pconverter.str("");
-      alg.parameters.push_back(numericParam(xml_rangeangle, "360*deg"));
-      pconverter << RadiusIn << "*mm";
-      alg.parameters.push_back(numericParam(xml_radiusin, pconverter.str()));
-      pconverter.str("");
-      pconverter << RadiusOut << "*mm";
-      alg.parameters.push_back(numericParam(xml_radiusout, pconverter.str()));
-      pconverter.str("");
-      alg.parameters.push_back(numericParam(xml_zposition, "0.0*mm"));
-      pconverter << lagg.getBarrelLayers()->at(layer - 1)->numRods();
-      alg.parameters.push_back(numericParam(xml_number, pconverter.str()));
-      pconverter.str("");
-      alg.parameters.push_back(numericParam(xml_startcopyno, "1"));
-      alg.parameters.push_back(numericParam(xml_incrcopyno, "1"));
-      a.push_back(alg);
-      alg.parameters.clear();
-
-      // reset
-      shape.dx = 0.0;
-      shape.dy = 0.0;
-      shape.dyy = 0.0;	  
-      pos.trans.dx = 0;
-      pos.trans.dy = 0;
-      pos.trans.dz = 0;
-
-      // tilted rings
-      if ( !rinfoplus.empty() || !rinfominus.empty() ) {
-
-	std::map<std::string, std::map<int,BTiltedRingInfo>> rinfototal;
-	if ( !rinfoplus.empty() ) { rinfototal.insert({"rinfoplus", rinfoplus}); }
-	if ( !rinfominus.empty() ) { rinfototal.insert({"rinfominus", rinfominus}); }
-
-	for (auto const &rinfoside : rinfototal) {
-
-	  for (auto const &ringinfo : rinfoside.second) {
-	    auto const& rinfo = ringinfo.second;
-	    if (rinfo.modules > 0) {
-
-	      // reset
-	      shape.rmin = 0.0;
-	      shape.rmax = 0.0;
-
-	      // section of cone
-	      shape.name_tag = rinfo.name + "Cone";
-	      shape.type = co;
-	      shape.dz = (rinfo.zmax - rinfo.zmin) / 2. + xml_epsilon;
-	      if (rinfo.isZPlus) {
-		shape.rmin1 = rinfo.rminatzmin - xml_epsilon * tan(rinfo.tiltAngle * M_PI / 180.0);
-		shape.rmax1 = rinfo.rmaxatzmax + 2 * shape.dz * tan(rinfo.tiltAngle * M_PI / 180.0) + xml_epsilon * tan(rinfo.tiltAngle * M_PI / 180.0);
-		shape.rmin2 = rinfo.rminatzmin - 2 * shape.dz * tan(rinfo.tiltAngle * M_PI / 180.0) - xml_epsilon * tan(rinfo.tiltAngle * M_PI / 180.0);
-		shape.rmax2 = rinfo.rmaxatzmax + xml_epsilon * tan(rinfo.tiltAngle * M_PI / 180.0);
-	      }
-	      else {
-		shape.rmin1 = rinfo.rminatzmin - 2 * shape.dz * tan(rinfo.tiltAngle * M_PI / 180.0) - xml_epsilon * tan(rinfo.tiltAngle * M_PI / 180.0);
-		shape.rmax1 = rinfo.rmaxatzmax + xml_epsilon * tan(rinfo.tiltAngle * M_PI / 180.0);
-		shape.rmin2 = rinfo.rminatzmin - xml_epsilon * tan(rinfo.tiltAngle * M_PI / 180.0);
-		shape.rmax2 = rinfo.rmaxatzmax + 2 * shape.dz * tan(rinfo.tiltAngle * M_PI / 180.0) + xml_epsilon * tan(rinfo.tiltAngle * M_PI / 180.0);
-	      }
-	      s.push_back(shape);
-
-	      // reset
-	      shape.rmin1 = 0.0;
-	      shape.rmax1 = 0.0;
-	      shape.rmin2 = 0.0;
-	      shape.rmax2 = 0.0;
-
-	      // section of tub
-	      shape.type = tb;
-	      shape.name_tag = rinfo.name + "Tub";
-	      shape.dz = (rinfo.zmax - rinfo.zmin) / 2. + xml_epsilon;
-	      shape.rmin = rinfo.rmin - xml_epsilon;
-	      shape.rmax = rinfo.rmax + xml_epsilon;
-	      s.push_back(shape);
-
-	      // intersection of sections of cone and tub
-	      // Please note that the layer's dimensions rely on the fact this intersection is made,
-	      // so that layer's extrema are ~rmin and ~rmax
-	      shapeOp.name_tag = rinfo.name;
-	      shapeOp.type = intersec;
-	      shapeOp.rSolid1 = rinfo.name + "Cone";
-	      shapeOp.rSolid2 = rinfo.name + "Tub";
-	      so.push_back(shapeOp);
-
-	      logic.name_tag = rinfo.name;
-	      logic.shape_tag = nspace + ":" + logic.name_tag;
-	      logic.material_tag = xml_material_air;
-	      l.push_back(logic);
+            logic.name_tag = rinfo.name;
+            logic.shape_tag = nspace + ":" + logic.name_tag;
+            logic.material_tag = xml_material_air;
+            l.push_back(logic);
 	      
-	      pos.parent_tag = nspace + ":" + lname.str();
-	      pos.child_tag = nspace + ":" + rinfo.name;
-	      pos.trans.dz = (rinfo.z1 + rinfo.z2) / 2.0; 
-	      p.push_back(pos);
+            pos.parent_tag = nspace + ":" + lname.str();
+            pos.child_tag = nspace + ":" + rinfo.name;
+            pos.trans.dz = (rinfo.z1 + rinfo.z2) / 2.0; 
+            p.push_back(pos);
 	      
-	      rspec.partselectors.push_back(rinfo.name);
-	      //rspec.moduletypes.push_back(minfo_zero);
+            rspec.partselectors.push_back(rinfo.name);
+            //rspec.moduletypes.push_back(minfo_zero);
 	      
-	      // backward part of the ring
-	      alg.name = xml_trackerring_algo;
-	      alg.parent = nspace + ":" + rinfo.name;
-	      alg.parameters.push_back(stringParam(xml_childparam, nspace + ":" + rinfo.childname));
-	      pconverter << (rinfo.modules / 2);
-	      alg.parameters.push_back(numericParam(xml_nmods, pconverter.str()));
-	      pconverter.str("");
-	      alg.parameters.push_back(numericParam(xml_startcopyno, "1"));
-	      alg.parameters.push_back(numericParam(xml_incrcopyno, "2"));
-	      alg.parameters.push_back(numericParam(xml_rangeangle, "360*deg"));
-	      pconverter << 90. + 360. / (double)(rinfo.modules) * (rinfo.phi - 1) << "*deg";
-	      alg.parameters.push_back(numericParam(xml_startangle, pconverter.str()));
-	      pconverter.str("");
-	      pconverter << rinfo.r1;
-	      alg.parameters.push_back(numericParam(xml_radius, pconverter.str()));
-	      pconverter.str("");
-	      alg.parameters.push_back(vectorParam(0, 0, (rinfo.z1 - rinfo.z2) / 2.0));	      
-	      pconverter << rinfo.isZPlus;
-	      alg.parameters.push_back(numericParam(xml_iszplus, pconverter.str()));
-	      pconverter.str("");
-	      pconverter << rinfo.tiltAngle << "*deg";
-	      alg.parameters.push_back(numericParam(xml_tiltangle, pconverter.str()));
-	      pconverter.str("");
-	      pconverter << rinfo.bw_flipped;
-	      alg.parameters.push_back(numericParam(xml_isflipped, pconverter.str()));
-	      pconverter.str("");
-	      a.push_back(alg);
-	      alg.parameters.clear();
+            // backward part of the ring
+            alg.name = xml_trackerring_algo;
+            alg.parent = nspace + ":" + rinfo.name;
+            alg.parameters.push_back(stringParam(xml_childparam, nspace + ":" + rinfo.childname));
+            pconverter << (rinfo.modules / 2);
+            alg.parameters.push_back(numericParam(xml_nmods, pconverter.str()));
+            pconverter.str("");
+            alg.parameters.push_back(numericParam(xml_startcopyno, "1"));
+            alg.parameters.push_back(numericParam(xml_incrcopyno, "2"));
+            alg.parameters.push_back(numericParam(xml_rangeangle, "360*deg"));
+            pconverter << 90. + 360. / (double)(rinfo.modules) * (rinfo.phi - 1) << "*deg";
+            alg.parameters.push_back(numericParam(xml_startangle, pconverter.str()));
+            pconverter.str("");
+            pconverter << rinfo.r1;
+            alg.parameters.push_back(numericParam(xml_radius, pconverter.str()));
+            pconverter.str("");
+            alg.parameters.push_back(vectorParam(0, 0, (rinfo.z1 - rinfo.z2) / 2.0));	      
+            pconverter << rinfo.isZPlus;
+            alg.parameters.push_back(numericParam(xml_iszplus, pconverter.str()));
+            pconverter.str("");
+            pconverter << rinfo.tiltAngle << "*deg";
+            alg.parameters.push_back(numericParam(xml_tiltangle, pconverter.str()));
+            pconverter.str("");
+            pconverter << rinfo.bw_flipped;
+            alg.parameters.push_back(numericParam(xml_isflipped, pconverter.str()));
+            pconverter.str("");
+            a.push_back(alg);
+            alg.parameters.clear();
 	      
-	      // forward part of the ring
-	      alg.name =  xml_trackerring_algo;
-	      alg.parent = nspace + ":" + rinfo.name;
-	      alg.parameters.push_back(stringParam(xml_childparam, nspace + ":" + rinfo.childname));
-	      pconverter << (rinfo.modules / 2);
-	      alg.parameters.push_back(numericParam(xml_nmods, pconverter.str()));
-	      pconverter.str("");
-	      alg.parameters.push_back(numericParam(xml_startcopyno, "2"));
-	      alg.parameters.push_back(numericParam(xml_incrcopyno, "2"));
-	      alg.parameters.push_back(numericParam(xml_rangeangle, "360*deg"));
-	      pconverter << 90. + 360. / (double)(rinfo.modules) * (rinfo.phi) << "*deg";
-	      alg.parameters.push_back(numericParam(xml_startangle, pconverter.str()));
-	      pconverter.str("");
-	      pconverter << rinfo.r2;
-	      alg.parameters.push_back(numericParam(xml_radius, pconverter.str()));
-	      pconverter.str("");
-	      alg.parameters.push_back(vectorParam(0, 0, (rinfo.z2 - rinfo.z1) / 2.0));
-	      pconverter << rinfo.isZPlus;
-	      alg.parameters.push_back(numericParam(xml_iszplus, pconverter.str()));
-	      pconverter.str("");
-	      pconverter << rinfo.tiltAngle << "*deg";
-	      alg.parameters.push_back(numericParam(xml_tiltangle, pconverter.str()));
-	      pconverter.str("");
-	      pconverter << rinfo.fw_flipped;
-	      alg.parameters.push_back(numericParam(xml_isflipped, pconverter.str()));
-	      pconverter.str("");
-	      a.push_back(alg);
-	      alg.parameters.clear();
-	    }
-	  }
-	}
+            // forward part of the ring
+            alg.name =  xml_trackerring_algo;
+            alg.parent = nspace + ":" + rinfo.name;
+            alg.parameters.push_back(stringParam(xml_childparam, nspace + ":" + rinfo.childname));
+            pconverter << (rinfo.modules / 2);
+            alg.parameters.push_back(numericParam(xml_nmods, pconverter.str()));
+            pconverter.str("");
+            alg.parameters.push_back(numericParam(xml_startcopyno, "2"));
+            alg.parameters.push_back(numericParam(xml_incrcopyno, "2"));
+            alg.parameters.push_back(numericParam(xml_rangeangle, "360*deg"));
+            pconverter << 90. + 360. / (double)(rinfo.modules) * (rinfo.phi) << "*deg";
+            alg.parameters.push_back(numericParam(xml_startangle, pconverter.str()));
+            pconverter.str("");
+            pconverter << rinfo.r2;
+            alg.parameters.push_back(numericParam(xml_radius, pconverter.str()));
+            pconverter.str("");
+            alg.parameters.push_back(vectorParam(0, 0, (rinfo.z2 - rinfo.z1) / 2.0));
+            pconverter << rinfo.isZPlus;
+            alg.parameters.push_back(numericParam(xml_iszplus, pconverter.str()));
+            pconverter.str("");
+            pconverter << rinfo.tiltAngle << "*deg";
+            alg.parameters.push_back(numericParam(xml_tiltangle, pconverter.str()));
+            pconverter.str("");
+            pconverter << rinfo.fw_flipped;
+            alg.parameters.push_back(numericParam(xml_isflipped, pconverter.str()));
+            pconverter.str("");
+            a.push_back(alg);
+            alg.parameters.clear();
+          }
+        }
       }
-
-      // layer
-      shape.type = tb;
-      shape.dx = 0.0;
-      shape.dy = 0.0;
-      pos.trans.dx = 0.0;
-      pos.trans.dz = 0.0;
-      shape.name_tag = lname.str();
-      shape.rmin = rmin - 2 * xml_epsilon;
-      shape.rmax = rmax + 2 * xml_epsilon;
-      shape.dz = zmax + 2 * xml_epsilon;
-      s.push_back(shape);
-      logic.name_tag = lname.str();
-      logic.shape_tag = nspace + ":" + logic.name_tag;
-      l.push_back(logic);
-      pos.parent_tag = xml_pixbarident + ":" + xml_2OTbar;
-      pos.child_tag = nspace + ":" + lname.str();
-      p.push_back(pos);
-      lspec.partselectors.push_back(lname.str());
-      //lspec.moduletypes.push_back("");
-      lspec.moduletypes.push_back(minfo_zero);
-
-      layer++;
     }
-    if (!lspec.partselectors.empty()) t.push_back(lspec);
-    if (!rspec.partselectors.empty()) t.push_back(rspec);
-    if (!sspec.partselectors.empty()) t.push_back(sspec);
-    if (!mspec.partselectors.empty()) t.push_back(mspec);
+
+    // layer
+    shape.type = tb;
+    shape.dx = 0.0;
+    shape.dy = 0.0;
+    pos.trans.dx = 0.0;
+    pos.trans.dz = 0.0;
+    shape.name_tag = lname.str();
+    shape.rmin = rmin - 2 * xml_epsilon;
+    shape.rmax = rmax + 2 * xml_epsilon;
+    shape.dz = zmax + 2 * xml_epsilon;
+    s.push_back(shape);
+    logic.name_tag = lname.str();
+    logic.shape_tag = nspace + ":" + logic.name_tag;
+    l.push_back(logic);
+    pos.parent_tag = xml_pixbarident + ":" + xml_2OTbar;
+    pos.child_tag = nspace + ":" + lname.str();
+    p.push_back(pos);
+    lspec.partselectors.push_back(lname.str());
+    //lspec.moduletypes.push_back("");
+    lspec.moduletypes.push_back(minfo_zero);
+
+    f.specs.push_back(lspec);
+    f.specs.push_back(rspec);
+    f.specs.push_back(sspec);
+    f.specs.push_back(mspec);
+    return true;
   }
   
   /**
@@ -1145,6 +1217,7 @@ namespace insur {
    * They is also some topology, such as which volumes contain the active surfaces, and how those active surfaces are subdivided
    * and connected to the readout electronics. Last but not least, overall radiation and interaction lengths for each layer are 
    * calculated and stored; those are used as approximative values for certain CMSSW functions later on.
+   * Each disc is analysed on a thread of its own by analyseDisc(), and the results are merged in the order of the discs.
    * @param mt A reference to the global material table; used as input
    * @param ec A reference to the collection of material properties of the endcap modules; used as input
    * @param tr A reference to the tracker object; used as input
@@ -1167,30 +1240,13 @@ namespace insur {
 
 
     // Container inits
-    ShapeInfo shape;
-    shape.dyy = 0.0;
-
-    LogicalInfo logic;
-
     PosInfo pos;
     pos.copy = 1;
     pos.trans.dx = 0.0;
     pos.trans.dy = 0.0;
     pos.trans.dz = 0.0;
 
-    AlgoInfo alg;
-
-    Rotation rot;
-    rot.phix = 0.0;
-    rot.phiy = 0.0;
-    rot.phiz = 0.0;
-    rot.thetax = 0.0;
-    rot.thetay = 0.0;
-    rot.thetaz = 0.0;
-
-    ModuleROCInfo minfo;
-    ModuleROCInfo minfo_zero={}; 
-    SpecParInfo rocdims, dspec, rspec, sspec, mspec;
+    SpecParInfo dspec, rspec, sspec, mspec;
     // Disk
     dspec.name = xml_subdet_wheel + xml_par_tail;
     dspec.parameter.first = xml_tkddd_structure;
@@ -1207,472 +1263,563 @@ namespace insur {
     mspec.name = xml_subdet_tiddet + xml_par_tail;
     mspec.parameter.first = xml_tkddd_structure;
     mspec.parameter.second = xml_det_tiddet;
+    SpecParInfo* specs[] = { &dspec, &rspec, &sspec, &mspec };
+
+
+    LayerAggregator lagg;
+    tr.accept(lagg);
+    std::vector<Disk*>& discs = *lagg.getEndcapLayers();
+
+    // only the discs in z+ are written; this is settled before any thread looks at the discs
+    std::vector<bool> positive;
+    for (unsigned int i = 0; i < ec.size(); i++) positive.push_back(discs.at(i)->minZ() > 0);
+
+    // Each disc goes into its own fragment, on its own thread
+    std::vector<CMSSWBundle> fragments(ec.size());
+    std::vector<std::future<void> > jobs(ec.size());
+    if (concurrentAnalysis_) {
+      for (unsigned int i = 0; i < ec.size(); i++) {
+        if (!positive.at(i)) continue;
+        jobs.at(i) = std::async(std::launch::async, [&, i, pos]() mutable {
+          analyseDisc(*discs.at(i), ec.at(i), i + 1, nspace, pos, fragments.at(i));
+        });
+      }
+    }
+
+
+    // LOOP ON DISKS: the fragments are merged in order
+    for (unsigned int i = 0; i < ec.size(); i++) {
+      if (!positive.at(i)) continue;
+      if (concurrentAnalysis_) jobs.at(i).get();
+      else analyseDisc(*discs.at(i), ec.at(i), i + 1, nspace, pos, fragments.at(i));
+      appendFragment(fragments.at(i), c, l, s, p, a, r, ri, specs);
+    }
+    if (!dspec.partselectors.empty()) t.push_back(dspec);
+    if (!rspec.partselectors.empty()) t.push_back(rspec);
+    if (!sspec.partselectors.empty()) t.push_back(sspec);
+    if (!mspec.partselectors.empty()) t.push_back(mspec);
+  }
+
+  /**
+   * Analyses one endcap disc in z+ for analyseDiscs() into a fragment of the output, which depends on nothing but the disc itself.
+   * @param disc A reference to the disc object; used as input
+   * @param caps A reference to the collection of material properties of the disc modules; used as input
+   * @param layer The number of the disc in the volume names
+   * @param nspace The namespace of the volume names
+   * @param pos A reference to the positioning template, left as the disc leaves it
+   * @param f A reference to the fragment; its specs are the disc, ring, module stack and module part selectors, in this order; used for output
+   */
+  void Extractor::analyseDisc(Disk& disc, std::vector<ModuleCap>& caps, int layer, const std::string& nspace, PosInfo& pos, CMSSWBundle& f) {
+
+    std::vector<Composite>& c = f.composites;
+    std::vector<LogicalInfo>& l = f.logic;
+    std::vector<ShapeInfo>& s = f.shapes;
+    std::vector<PosInfo>& p = f.positions;
+    std::vector<AlgoInfo>& a = f.algos;
+    std::map<std::string,Rotation>& r = f.rots;
+    std::vector<RILengthInfo>& ri = f.lrilength;
+
+    // Container inits
+    ShapeInfo shape;
+    shape.dyy = 0.0;
+
+    LogicalInfo logic;
+
+    AlgoInfo alg;
+
+    Rotation rot;
+    rot.phix = 0.0;
+    rot.phiy = 0.0;
+    rot.phiz = 0.0;
+    rot.thetax = 0.0;
+    rot.thetay = 0.0;
+    rot.thetaz = 0.0;
 
+    ModuleROCInfo minfo;
+    ModuleROCInfo minfo_zero={}; 
+    SpecParInfo dspec, rspec, sspec, mspec;
 
     // material properties
     RILengthInfo ril;
     ril.barrel = false;
     ril.index = 0;  
 
+    std::vector<ModuleCap>::iterator iiter;
 
-    LayerAggregator lagg;
-    tr.accept(lagg);
+    int numRings = disc.numRings();
+
+    // Calculate z extrema of the disk, and diskThickness
+    // r extrema of disk and ring
+    double rmin = std::numeric_limits<double>::max();
+    double rmax = 0;
+    // z extrema of disk
+    double zmin = std::numeric_limits<double>::max();
+    double zmax = 0;
+    // z extrema of ring
+    std::vector<double> ringzmin (numRings, std::numeric_limits<double>::max());
+    std::vector<double> ringzmax (numRings, 0);
+
+    // loop on module caps
+    for (iiter = caps.begin(); iiter != caps.end(); iiter++) {
+      if (iiter->getModule().uniRef().side > 0 && (iiter->getModule().uniRef().phi == 1 || iiter->getModule().uniRef().phi == 2)) {
+        int modRing = iiter->getModule().uniRef().ring;
+        //disk name
+        std::ostringstream dname;
+        dname << xml_disc << layer; // e.g. Disc6
+        // module name
+        std::ostringstream mname;
+        mname << xml_endcap_module << modRing << dname.str(); // e.g. EModule1Disc6
+        // parent module name
+        std::string parentName = mname.str();
+        // build module volumes, with hybrids taken into account
+        ModuleComplex modcomplex(mname.str(),parentName,*iiter);
+        modcomplex.buildSubVolumes();
+        rmin = MIN(rmin, modcomplex.getRmin());
+        rmax = MAX(rmax, modcomplex.getRmax());
+        zmin = MIN(zmin, modcomplex.getZmin());
+        zmax = MAX(zmax, modcomplex.getZmax());
+        ringzmin.at(modRing - 1) = MIN(ringzmin.at(modRing - 1), modcomplex.getZmin());  
+        ringzmax.at(modRing - 1) = MAX(ringzmax.at(modRing - 1), modcomplex.getZmax());
+      }
+    }
+    double diskThickness = zmax - zmin;
 
-    std::vector<std::vector<ModuleCap> >::iterator oiter;
-    std::vector<ModuleCap>::iterator iiter;
+    //shape.type = tp;
+    shape.rmin = 0.0;
+    shape.rmax = 0.0;
+    pos.trans.dz = 0.0;
 
-    int layer = 1;
 
+    // for material properties
+    double rtotal = 0.0, itotal = 0.0;
+    int count = 0;
+    ril.index = layer;
 
-    // LOOP ON DISKS
-    for (oiter = ec.begin(); oiter != ec.end(); oiter++) {
 
-      if (lagg.getEndcapLayers()->at(layer - 1)->minZ() > 0) {
-   
-	int numRings = lagg.getEndcapLayers()->at(layer - 1)->numRings();
-
-	// Calculate z extrema of the disk, and diskThickness
-	// r extrema of disk and ring
-	double rmin = std::numeric_limits<double>::max();
-	double rmax = 0;
-	// z extrema of disk
-	double zmin = std::numeric_limits<double>::max();
-	double zmax = 0;
-	// z extrema of ring
-	std::vector<double> ringzmin (numRings, std::numeric_limits<double>::max());
-	std::vector<double> ringzmax (numRings, 0);
-
-	// loop on module caps
-	for (iiter = oiter->begin(); iiter != oiter->end(); iiter++) {
-	  if (iiter->getModule().uniRef().side > 0 && (iiter->getModule().uniRef().phi == 1 || iiter->getModule().uniRef().phi == 2)) {
-	    int modRing = iiter->getModule().uniRef().ring;
-	    //disk name
-	    std::ostringstream dname;
-	    dname << xml_disc << layer; // e.g. Disc6
-	    // module name
-	    std::ostringstream mname;
-	    mname << xml_endcap_module << modRing << dname.str(); // e.g. EModule1Disc6
-	    // parent module name
-	    std::string parentName = mname.str();
-	    // build module volumes, with hybrids taken into account
-	    ModuleComplex modcomplex(mname.str(),parentName,*iiter);
-	    modcomplex.buildSubVolumes();
-	    rmin = MIN(rmin, modcomplex.getRmin());
-	    rmax = MAX(rmax, modcomplex.getRmax());
-	    zmin = MIN(zmin, modcomplex.getZmin());
-	    zmax = MAX(zmax, modcomplex.getZmax());
-	    ringzmin.at(modRing - 1) = MIN(ringzmin.at(modRing - 1), modcomplex.getZmin());  
-	    ringzmax.at(modRing - 1) = MAX(ringzmax.at(modRing - 1), modcomplex.getZmax());
-	  }
-	}
-	double diskThickness = zmax - zmin;
+    //if (zmin > 0) {	
+    std::ostringstream dname, pconverter;
+    //disk name
+    dname << xml_disc << layer; // e.g. Disc6
 
-	//shape.type = tp;
-        shape.rmin = 0.0;
-        shape.rmax = 0.0;
-        pos.trans.dz = 0.0;
+    std::map<int, ERingInfo> rinfo;
+    std::set<int> ridx;
 
 
-	// for material properties
-        double rtotal = 0.0, itotal = 0.0;
-        int count = 0;
-	ril.index = layer;
+    // LOOP ON MODULE CAPS
+    for (iiter = caps.begin(); iiter != caps.end(); iiter++) {
+      if (iiter->getModule().uniRef().side > 0 && (iiter->getModule().uniRef().phi == 1 || iiter->getModule().uniRef().phi == 2)) {
+        // ring number
+        int modRing = iiter->getModule().uniRef().ring;
 
+        //if (iiter->getModule().uniRef().side > 0 && (iiter->getModule().uniRef().phi == 1 || iiter->getModule().uniRef().phi == 2)){ std::cout << "modRing = " << modRing << " iiter->getModule().uniRef().phi = " << iiter->getModule().uniRef().phi << " iiter->getModule().center().Rho() = " << iiter->getModule().center().Rho() << " iiter->getModule().center().X() = " << iiter->getModule().center().X() << " iiter->getModule().center().Y() = " << iiter->getModule().center().Y() << " iiter->getModule().center().Z() = " << iiter->getModule().center().Z() << " iiter->getModule().flipped() = " << iiter->getModule().flipped() << " iiter->getModule().moduleType() = " << iiter->getModule().moduleType() << std::endl; }
 
-	//if (zmin > 0) {	
-        std::ostringstream dname, pconverter;
-	//disk name
-        dname << xml_disc << layer; // e.g. Disc6
+        if (iiter->getModule().uniRef().phi == 1) {
 
-        std::map<int, ERingInfo> rinfo;
-	std::set<int> ridx;
+          // new ring
+          //if (ridx.find(modRing) == ridx.end()) {
+          ridx.insert(modRing);
 
+          std::ostringstream matname, rname, mname, specname;
+          // ring name
+          rname << xml_ring << modRing << dname.str(); // e.g. Ring1Disc6
+          // module name
+          mname << xml_endcap_module << modRing << dname.str(); // e.g. EModule1Disc6
 
-        // LOOP ON MODULE CAPS
-        for (iiter = oiter->begin(); iiter != oiter->end(); iiter++) {
-	  if (iiter->getModule().uniRef().side > 0 && (iiter->getModule().uniRef().phi == 1 || iiter->getModule().uniRef().phi == 2)) {
-	    // ring number
-	    int modRing = iiter->getModule().uniRef().ring;
+          // parent module name
+          std::string parentName = mname.str();
 
-	    //if (iiter->getModule().uniRef().side > 0 && (iiter->getModule().uniRef().phi == 1 || iiter->getModule().uniRef().phi == 2)){ std::cout << "modRing = " << modRing << " iiter->getModule().uniRef().phi = " << iiter->getModule().uniRef().phi << " iiter->getModule().center().Rho() = " << iiter->getModule().center().Rho() << " iiter->getModule().center().X() = " << iiter->getModule().center().X() << " iiter->getModule().center().Y() = " << iiter->getModule().center().Y() << " iiter->getModule().center().Z() = " << iiter->getModule().center().Z() << " iiter->getModule().flipped() = " << iiter->getModule().flipped() << " iiter->getModule().moduleType() = " << iiter->getModule().moduleType() << std::endl; }
+          // build module volumes, with hybrids taken into account
+          ModuleComplex modcomplex(mname.str(),parentName,*iiter);
+          modcomplex.buildSubVolumes();          
+#ifdef __DEBUGPRINT__
+          modcomplex.print();
+#endif
 
-	    if (iiter->getModule().uniRef().phi == 1) {
 
-	      // new ring
-	      //if (ridx.find(modRing) == ridx.end()) {
-	      ridx.insert(modRing);
+          // MODULE
 
-	      std::ostringstream matname, rname, mname, specname;
-	      // ring name
-	      rname << xml_ring << modRing << dname.str(); // e.g. Ring1Disc6
-	      // module name
-	      mname << xml_endcap_module << modRing << dname.str(); // e.g. EModule1Disc6
- 
-	      // parent module name
-	      std::string parentName = mname.str();
+          // module box
+          shape.name_tag = mname.str();
+          shape.type = iiter->getModule().shape() == RECTANGULAR ? bx : tp;
+          //shape.dx = iiter->getModule().minWidth() / 2.0;
+          //shape.dxx = iiter->getModule().maxWidth() / 2.0;
+          //shape.dy = iiter->getModule().length() / 2.0;
+          //shape.dyy = iiter->getModule().length() / 2.0;
+          //shape.dz = iiter->getModule().thickness() / 2.0;    
+          if (shape.type==bx) {
+            shape.dx = modcomplex.getExpandedModuleWidth()/2.0;
+            shape.dy = modcomplex.getExpandedModuleLength()/2.0;
+            shape.dz = modcomplex.getExpandedModuleThickness()/2.0;
+          } else { // obsolete !
+            shape.dx = iiter->getModule().minWidth() / 2.0 + iiter->getModule().serviceHybridWidth();
+            shape.dxx = iiter->getModule().maxWidth() / 2.0 + iiter->getModule().serviceHybridWidth();
+            shape.dy = iiter->getModule().length() / 2.0 + iiter->getModule().frontEndHybridWidth();
+            shape.dyy = iiter->getModule().length() / 2.0 + iiter->getModule().frontEndHybridWidth();
+            shape.dz = iiter->getModule().thickness() / 2.0 + iiter->getModule().supportPlateThickness();
+          }
+          s.push_back(shape);
 
-	      // build module volumes, with hybrids taken into account
-	      ModuleComplex modcomplex(mname.str(),parentName,*iiter);
-	      modcomplex.buildSubVolumes();          
-#ifdef __DEBUGPRINT__
-	      modcomplex.print();
-#endif
+          // Get it back for sensors
+          shape.dx = iiter->getModule().minWidth() / 2.0;
+          shape.dxx = iiter->getModule().maxWidth() / 2.0;
+          shape.dy = iiter->getModule().length() / 2.0;
+          shape.dyy = iiter->getModule().length() / 2.0;
+          shape.dz = iiter->getModule().thickness() / 2.0;
 
+          logic.name_tag = mname.str();
+          logic.shape_tag = nspace + ":" + logic.name_tag;
 
-	      // MODULE
-
-	      // module box
-	      shape.name_tag = mname.str();
-	      shape.type = iiter->getModule().shape() == RECTANGULAR ? bx : tp;
-	      //shape.dx = iiter->getModule().minWidth() / 2.0;
-	      //shape.dxx = iiter->getModule().maxWidth() / 2.0;
-	      //shape.dy = iiter->getModule().length() / 2.0;
-	      //shape.dyy = iiter->getModule().length() / 2.0;
-	      //shape.dz = iiter->getModule().thickness() / 2.0;    
-	      if (shape.type==bx) {
-		shape.dx = modcomplex.getExpandedModuleWidth()/2.0;
-		shape.dy = modcomplex.getExpandedModuleLength()/2.0;
-		shape.dz = modcomplex.getExpandedModuleThickness()/2.0;
-	      } else { // obsolete !
-		shape.dx = iiter->getModule().minWidth() / 2.0 + iiter->getModule().serviceHybridWidth();
-		shape.dxx = iiter->getModule().maxWidth() / 2.0 + iiter->getModule().serviceHybridWidth();
-		shape.dy = iiter->getModule().length() / 2.0 + iiter->getModule().frontEndHybridWidth();
-		shape.dyy = iiter->getModule().length() / 2.0 + iiter->getModule().frontEndHybridWidth();
-		shape.dz = iiter->getModule().thickness() / 2.0 + iiter->getModule().supportPlateThickness();
-	      }
-	      s.push_back(shape);
-
-	      // Get it back for sensors
-	      shape.dx = iiter->getModule().minWidth() / 2.0;
-	      shape.dxx = iiter->getModule().maxWidth() / 2.0;
-	      shape.dy = iiter->getModule().length() / 2.0;
-	      shape.dyy = iiter->getModule().length() / 2.0;
-	      shape.dz = iiter->getModule().thickness() / 2.0;
-
-	      logic.name_tag = mname.str();
-	      logic.shape_tag = nspace + ":" + logic.name_tag;
-
-	      //logic.material_tag = nspace + ":" + matname.str();
-	      logic.material_tag = xml_material_air;
-	      l.push_back(logic);
-	      // module composite material
-	      //matname << xml_base_actcomp << "D" << layer << "R" << modRing;
-	      //c.push_back(createComposite(matname.str(), compositeDensity(*iiter, true), *iiter, true));
-
-	    //Topology
-	    sspec.partselectors.push_back(mname.str());
-            sspec.moduletypes.push_back(minfo_zero);
-
-
-
-	      // WAFER -- same x and y size of parent shape, but different thickness
-	      string xml_base_lowerupper = "";
-	      if (iiter->getModule().numSensors() == 2) xml_base_lowerupper = xml_base_lower;
-
-	      pos.parent_tag = logic.shape_tag;
-
-	      shape.name_tag = mname.str() + xml_base_lowerupper+ xml_base_waf;
-	      shape.dz = iiter->getModule().sensorThickness() / 2.0; // CUIDADO WAS calculateSensorThickness(*iiter, mt) / 2.0;
-	      //if (iiter->getModule().numSensors() == 2) shape.dz = shape.dz / 2.0; // CUIDADO calcSensThick returned 2x what getSensThick returns, it means that now one-sided sensors are half as thick if not compensated for in the config files
-	      s.push_back(shape);
-
-	      logic.name_tag = shape.name_tag;
-	      logic.shape_tag = nspace + ":" + logic.name_tag;
-	      logic.material_tag = xml_material_air;
-	      l.push_back(logic);
-
-	      pos.child_tag = logic.shape_tag;
-
-	      if (iiter->getModule().uniRef().side > 0) pos.trans.dz = /*shape.dz*/ - iiter->getModule().dsDistance() / 2.0; // CUIDADO WAS getModule().moduleThickness()
-	      else pos.trans.dz = iiter->getModule().dsDistance() / 2.0 /*- shape.dz*/; // DITTO HERE
-	      p.push_back(pos);
-	      if (iiter->getModule().numSensors() == 2) {
-
-		xml_base_lowerupper = xml_base_upper;
-
-		//pos.parent_tag = logic.shape_tag;
-
-		shape.name_tag = mname.str() + xml_base_lowerupper+ xml_base_waf;
-		s.push_back(shape);
-
-		logic.name_tag = shape.name_tag;
-		logic.shape_tag = nspace + ":" + logic.name_tag;
-		l.push_back(logic);
-
-		pos.child_tag = logic.shape_tag;
-
-		if (iiter->getModule().uniRef().side > 0) pos.trans.dz = /*pos.trans.dz + 2 * shape.dz +*/  iiter->getModule().dsDistance() / 2.0; // CUIDADO removed pos.trans.dz + 2*shape.dz, added / 2.0
-		else pos.trans.dz = /* pos.trans.dz - 2 * shape.dz -*/ - iiter->getModule().dsDistance() / 2.0;
-		//pos.copy = 2;
-		if (iiter->getModule().stereoRotation() != 0) {
-		  rot.name = type_stereo + xml_endcap_module + mname.str();
-		  rot.thetax = 90.0;
-		  rot.phix = iiter->getModule().stereoRotation() / M_PI * 180;
-		  rot.thetay = 90.0;
-		  rot.phiy = 90.0 + iiter->getModule().stereoRotation() / M_PI * 180;
-		  r.insert(std::pair<const std::string,Rotation>(rot.name,rot));
-		  pos.rotref = nspace + ":" + rot.name;
-		}
-
-		p.push_back(pos);
-
-		// Now reset
-		pos.rotref.clear();
-		rot.name.clear();
-		rot.thetax = 0.0;
-		rot.phix = 0.0;
-		rot.thetay = 0.0;
-		rot.phiy = 0.0;
-		pos.copy = 1;
-	      }
-
-
-	      // ACTIVE SURFACE
-	      xml_base_lowerupper = "";
-	      if (iiter->getModule().numSensors() == 2) xml_base_lowerupper = xml_base_lower;
-
-	      //pos.parent_tag = logic.shape_tag;
-	      pos.parent_tag = nspace + ":" + mname.str() + xml_base_lowerupper + xml_base_waf;
-
-	      if (iiter->getModule().moduleType() == "ptPS") shape.name_tag = mname.str() + xml_base_lowerupper + xml_base_ps + xml_base_pixel + xml_base_act;
-	      else if (iiter->getModule().moduleType() == "pt2S") shape.name_tag = mname.str() + xml_base_lowerupper + xml_base_2s+ xml_base_act;
-	      else { std::cerr << "Unknown module type : " << iiter->getModule().moduleType() << " ." << std::endl; }
-	      s.push_back(shape);
-
-	      logic.name_tag = shape.name_tag;
-	      logic.shape_tag = nspace + ":" + logic.name_tag;
-	      logic.material_tag = nspace + ":" + xml_sensor_silicon;
-	      l.push_back(logic);
+          //logic.material_tag = nspace + ":" + matname.str();
+          logic.material_tag = xml_material_air;
+          l.push_back(logic);
+          // module composite material
+          //matname << xml_base_actcomp << "D" << layer << "R" << modRing;
+          //c.push_back(createComposite(matname.str(), compositeDensity(*iiter, true), *iiter, true));
 
-	      pos.child_tag = logic.shape_tag;
-	      pos.trans.dz = 0.0;
-#ifdef __FLIPSENSORS_IN__ // Flip INNER sensors
-	      pos.rotref = nspace + ":" + rot_sensor_tag;
-#endif
-	      p.push_back(pos);
+        //Topology
+        sspec.partselectors.push_back(mname.str());
+        sspec.moduletypes.push_back(minfo_zero);
 
-	      // Topology
-	      mspec.partselectors.push_back(logic.name_tag);
 
-	      minfo.name		= iiter->getModule().moduleType();
-	      minfo.rocrows	= any2str<int>(iiter->getModule().innerSensor().numROCRows());
-	      minfo.roccols	= any2str<int>(iiter->getModule().innerSensor().numROCCols());
-	      minfo.rocx		= any2str<int>(iiter->getModule().innerSensor().numROCX());
-	      minfo.rocy		= any2str<int>(iiter->getModule().innerSensor().numROCY());
 
-	      mspec.moduletypes.push_back(minfo);
+          // WAFER -- same x and y size of parent shape, but different thickness
+          string xml_base_lowerupper = "";
+          if (iiter->getModule().numSensors() == 2) xml_base_lowerupper = xml_base_lower;
 
-	      if (iiter->getModule().numSensors() == 2) {
+          pos.parent_tag = logic.shape_tag;
 
-		xml_base_lowerupper = xml_base_upper;
+          shape.name_tag = mname.str() + xml_base_lowerupper+ xml_base_waf;
+          shape.dz = iiter->getModule().sensorThickness() / 2.0; // CUIDADO WAS calculateSensorThickness(*iiter, mt) / 2.0;
+          //if (iiter->getModule().numSensors() == 2) shape.dz = shape.dz / 2.0; // CUIDADO calcSensThick returned 2x what getSensThick returns, it means that now one-sided sensors are half as thick if not compensated for in the config files
+          s.push_back(shape);
 
-		//pos.parent_tag = logic.shape_tag;
-		pos.parent_tag = nspace + ":" + mname.str() + xml_base_lowerupper + xml_base_waf;
+          logic.name_tag = shape.name_tag;
+          logic.shape_tag = nspace + ":" + logic.name_tag;
+          logic.material_tag = xml_material_air;
+          l.push_back(logic);
 
-		if (iiter->getModule().moduleType() == "ptPS") shape.name_tag = mname.str() + xml_base_lowerupper + xml_base_ps + xml_base_strip + xml_base_act;
-		else if (iiter->getModule().moduleType() == "pt2S") shape.name_tag = mname.str() + xml_base_lowerupper + xml_base_2s+ xml_base_act;
-		else { std::cerr << "Unknown module type : " << iiter->getModule().moduleType() << " ." << std::endl; }
-		s.push_back(shape);
+          pos.child_tag = logic.shape_tag;
 
-		logic.name_tag = shape.name_tag;
-		logic.shape_tag = nspace + ":" + logic.name_tag;
-		logic.material_tag = nspace + ":" + xml_sensor_silicon;
-		l.push_back(logic);
+          if (iiter->getModule().uniRef().side > 0) pos.trans.dz = /*shape.dz*/ - iiter->getModule().dsDistance() / 2.0; // CUIDADO WAS getModule().moduleThickness()
+          else pos.trans.dz = iiter->getModule().dsDistance() / 2.0 /*- shape.dz*/; // DITTO HERE
+          p.push_back(pos);
+          if (iiter->getModule().numSensors() == 2) {
 
-		pos.child_tag = logic.shape_tag;
-		pos.trans.dz = 0.0;
-#ifdef __FLIPSENSORS_OUT__ // Flip OUTER sensors
-		pos.rotref = nspace + ":" + rot_sensor_tag;
-#endif
-		p.push_back(pos);
-
-		// Topology
-		mspec.partselectors.push_back(logic.name_tag);
-
-		minfo.rocrows	= any2str<int>(iiter->getModule().outerSensor().numROCRows());
-		minfo.roccols	= any2str<int>(iiter->getModule().outerSensor().numROCCols());
-		minfo.rocx		= any2str<int>(iiter->getModule().outerSensor().numROCX());
-		minfo.rocy		= any2str<int>(iiter->getModule().outerSensor().numROCY());
-
-		mspec.moduletypes.push_back(minfo);
-		//mspec.moduletypes.push_back(iiter->getModule().getType());
-		modcomplex.addMaterialInfo(c);
-		modcomplex.addShapeInfo(s);
-		modcomplex.addLogicInfo(l);
-		modcomplex.addPositionInfo(p);
-#ifdef __DEBUGPRINT__
-		modcomplex.print();
-#endif
-	      }
-
-
-	      // collect ring info
-	      ERingInfo rinf;
-	      rinf.name = rname.str();
-	      rinf.childname = mname.str();
-	      rinf.fw = (iiter->getModule().center().Z() > (zmin + zmax) / 2.0);
-	      rinf.isZPlus = iiter->getModule().uniRef().side;
-	      rinf.fw_flipped = iiter->getModule().flipped();
-	      rinf.phi = iiter->getModule().center().Phi();
-	      rinf.modules = lagg.getEndcapLayers()->at(layer - 1)->ringsMap().at(modRing)->numModules();
-	      rinf.mthk = modcomplex.getExpandedModuleThickness();
-	      rinf.rmin  = modcomplex.getRmin();
-	      rinf.rmid = iiter->getModule().center().Rho();
-	      rinf.rmax = modcomplex.getRmax();
-	      rinf.zmin = ringzmin.at(modRing - 1);
-	      rinf.zmax = ringzmax.at(modRing - 1);
-	      rinf.zfw = iiter->getModule().center().Z();
-	      rinfo.insert(std::pair<int, ERingInfo>(modRing, rinf));
-
-
-	      // material properties
-	      rtotal = rtotal + iiter->getRadiationLength();
-	      itotal = itotal + iiter->getInteractionLength();
-	      count++;
-	    }
-
-	    if (iiter->getModule().uniRef().phi == 2) {
-	      std::map<int,ERingInfo>::iterator it;
-	      // fill the info of the z-backward part of the ring with matching ring number
-	      it = rinfo.find(modRing);
-	      if (it != rinfo.end()) {
-		it->second.zbw = iiter->getModule().center().Z();
-	      }
-	    }
-	  }
-	}
+            xml_base_lowerupper = xml_base_upper;
 
-        if (count > 0) {
-          ril.rlength = rtotal / (double)count;
-          ril.ilength = itotal / (double)count;
-          ri.push_back(ril);
-        }
+            //pos.parent_tag = logic.shape_tag;
 
-        // rings
-        shape.type = tb;
-        shape.dx = 0.0;
-        shape.dy = 0.0;
-        shape.dyy = 0.0;
-        //findDeltaZ(lagg.getEndcapLayers()->at(layer - 1)->getModuleVector()->begin(), // CUIDADO what the hell is this??
-        //lagg.getEndcapLayers()->at(layer - 1)->getModuleVector()->end(), (zmin + zmax) / 2.0) / 2.0;
-
-        std::set<int>::const_iterator siter, sguard = ridx.end();
-        for (siter = ridx.begin(); siter != sguard; siter++) {
-          if (rinfo[*siter].modules > 0) {
-
-            shape.name_tag = rinfo[*siter].name;
-            shape.rmin = rinfo[*siter].rmin - xml_epsilon;
-            shape.rmax = rinfo[*siter].rmax + xml_epsilon;
-	    shape.dz = (rinfo[*siter].zmax - rinfo[*siter].zmin) / 2.0 + xml_epsilon;
+            shape.name_tag = mname.str() + xml_base_lowerupper+ xml_base_waf;
             s.push_back(shape);
 
             logic.name_tag = shape.name_tag;
             logic.shape_tag = nspace + ":" + logic.name_tag;
-            logic.material_tag = xml_material_air;
             l.push_back(logic);
 
-            pos.parent_tag = nspace + ":" + dname.str(); // CUIDADO ended with: + xml_plus;
             pos.child_tag = logic.shape_tag;
 
-	    pos.trans.dz = (rinfo[*siter].zmin + rinfo[*siter].zmax) / 2.0 - (zmin + zmax) / 2.0;
+            if (iiter->getModule().uniRef().side > 0) pos.trans.dz = /*pos.trans.dz + 2 * shape.dz +*/  iiter->getModule().dsDistance() / 2.0; // CUIDADO removed pos.trans.dz + 2*shape.dz, added / 2.0
+            else pos.trans.dz = /* pos.trans.dz - 2 * shape.dz -*/ - iiter->getModule().dsDistance() / 2.0;
+            //pos.copy = 2;
+            if (iiter->getModule().stereoRotation() != 0) {
+              rot.name = type_stereo + xml_endcap_module + mname.str();
+              rot.thetax = 90.0;
+              rot.phix = iiter->getModule().stereoRotation() / M_PI * 180;
+              rot.thetay = 90.0;
+              rot.phiy = 90.0 + iiter->getModule().stereoRotation() / M_PI * 180;
+              r.insert(std::pair<const std::string,Rotation>(rot.name,rot));
+              pos.rotref = nspace + ":" + rot.name;
+            }
+
             p.push_back(pos);
-            //pos.parent_tag = nspace + ":" + dname.str(); // CUIDADO ended with: + xml_minus;
-            //p.push_back(pos);
 
-            rspec.partselectors.push_back(logic.name_tag);
-            rspec.moduletypes.push_back(minfo_zero);
+            // Now reset
+            pos.rotref.clear();
+            rot.name.clear();
+            rot.thetax = 0.0;
+            rot.phix = 0.0;
+            rot.thetay = 0.0;
+            rot.phiy = 0.0;
+            pos.copy = 1;
+          }
 
-	    // forward part of the ring
-	    alg.name = xml_trackerring_algo;
-            alg.parent = logic.shape_tag;
-            alg.parameters.push_back(stringParam(xml_childparam, nspace + ":" + rinfo[*siter].childname));
-            pconverter << (rinfo[*siter].modules / 2);
-            alg.parameters.push_back(numericParam(xml_nmods, pconverter.str()));
-            pconverter.str("");
-            alg.parameters.push_back(numericParam(xml_startcopyno, "1"));
-            alg.parameters.push_back(numericParam(xml_incrcopyno, "2"));
-            alg.parameters.push_back(numericParam(xml_rangeangle, "360*deg"));
-            pconverter << 360. / (double)(rinfo[*siter].modules) * rinfo[*siter].phi << "*deg";
-            alg.parameters.push_back(numericParam(xml_startangle, pconverter.str()));
-            pconverter.str("");
-            pconverter << rinfo[*siter].rmid;
-            alg.parameters.push_back(numericParam(xml_radius, pconverter.str()));
-            pconverter.str("");
-	    alg.parameters.push_back(vectorParam(0, 0, rinfo[*siter].zfw - (rinfo[*siter].zmin + rinfo[*siter].zmax) / 2.0));
-	    pconverter << rinfo[*siter].isZPlus;
-	    alg.parameters.push_back(numericParam(xml_iszplus, pconverter.str()));
-	    pconverter.str("");
-	    alg.parameters.push_back(numericParam(xml_tiltangle, "90*deg"));
-	    pconverter << rinfo[*siter].fw_flipped;
-	    alg.parameters.push_back(numericParam(xml_isflipped, pconverter.str()));
-	    pconverter.str("");
-            a.push_back(alg);
-            alg.parameters.clear();
 
-	    // backward part of the ring
-	    alg.name = xml_trackerring_algo;
-            alg.parameters.push_back(stringParam(xml_childparam, nspace + ":" + rinfo[*siter].childname));
-            pconverter << (rinfo[*siter].modules / 2);
-            alg.parameters.push_back(numericParam(xml_nmods, pconverter.str()));
-            pconverter.str("");
-            alg.parameters.push_back(numericParam(xml_startcopyno, "2"));
-            alg.parameters.push_back(numericParam(xml_incrcopyno, "2"));
-            alg.parameters.push_back(numericParam(xml_rangeangle, "360*deg"));
-            pconverter << 360. / (double)(rinfo[*siter].modules) * (rinfo[*siter].phi + 1) << "*deg";
-            alg.parameters.push_back(numericParam(xml_startangle, pconverter.str()));
-            pconverter.str("");
-            pconverter << rinfo[*siter].rmid;
-            alg.parameters.push_back(numericParam(xml_radius, pconverter.str()));
-            pconverter.str("");
-	    alg.parameters.push_back(vectorParam(0, 0, rinfo[*siter].zbw - (rinfo[*siter].zmin + rinfo[*siter].zmax) / 2.0));
-	    pconverter << rinfo[*siter].isZPlus;
-	    alg.parameters.push_back(numericParam(xml_iszplus, pconverter.str()));
-	    pconverter.str("");
-	    alg.parameters.push_back(numericParam(xml_tiltangle, "90*deg"));
-	    pconverter << !rinfo[*siter].fw_flipped;
-	    alg.parameters.push_back(numericParam(xml_isflipped, pconverter.str()));
-	    pconverter.str("");
-            a.push_back(alg);
-            alg.parameters.clear();
+          // ACTIVE SURFACE
+          xml_base_lowerupper = "";
+          if (iiter->getModule().numSensors() == 2) xml_base_lowerupper = xml_base_lower;
+
+          //pos.parent_tag = logic.shape_tag;
+          pos.parent_tag = nspace + ":" + mname.str() + xml_base_lowerupper + xml_base_waf;
+
+          if (iiter->getModule().moduleType() == "ptPS") shape.name_tag = mname.str() + xml_base_lowerupper + xml_base_ps + xml_base_pixel + xml_base_act;
+          else if (iiter->getModule().moduleType() == "pt2S") shape.name_tag = mname.str() + xml_base_lowerupper + xml_base_2s+ xml_base_act;
+          else { std::cerr << "Unknown module type : " << iiter->getModule().moduleType() << " ." << std::endl; }
+          s.push_back(shape);
+
+          logic.name_tag = shape.name_tag;
+          logic.shape_tag = nspace + ":" + logic.name_tag;
+          logic.material_tag = nspace + ":" + xml_sensor_silicon;
+          l.push_back(logic);
+
+          pos.child_tag = logic.shape_tag;
+          pos.trans.dz = 0.0;
+#ifdef __FLIPSENSORS_IN__ // Flip INNER sensors
+          pos.rotref = nspace + ":" + rot_sensor_tag;
+#endif
+          p.push_back(pos);
+
+          // Topology
+          mspec.partselectors.push_back(logic.name_tag);
+
+          minfo.name		= iiter->getModule().moduleType();
+          minfo.rocrows	= any2str<int>(iiter->getModule().innerSensor().numROCRows());
+          minfo.roccols	= any2str<int>(iiter->getModule().innerSensor().numROCCols());
+          minfo.rocx		= any2str<int>(iiter->getModule().innerSensor().numROCX());
+          minfo.rocy		= any2str<int>(iiter->getModule().innerSensor().numROCY());
+
+          mspec.moduletypes.push_back(minfo);
+
+          if (iiter->getModule().numSensors() == 2) {
+
+            xml_base_lowerupper = xml_base_upper;
+
+            //pos.parent_tag = logic.shape_tag;
+            pos.parent_tag = nspace + ":" + mname.str() + xml_base_lowerupper + xml_base_waf;
+
+            if (iiter->getModule().moduleType() == "ptPS") shape.name_tag = mname.str() + xml_base_lowerupper + xml_base_ps + xml_base_strip + xml_base_act;
+            else if (iiter->getModule().moduleType() == "pt2S") shape.name_tag = mname.str() + xml_base_lowerupper + xml_base_2s+ xml_base_act;
+            else { std::cerr << "Unknown module type : " << iiter->getModule().moduleType() << " ." << std::endl; }
+            s.push_back(shape);
+
+            logic.name_tag = shape.name_tag;
+            logic.shape_tag = nspace + ":" + logic.name_tag;
+            logic.material_tag = nspace + ":" + xml_sensor_silicon;
+            l.push_back(logic);
+
+            pos.child_tag = logic.shape_tag;
+            pos.trans.dz = 0.0;
+#ifdef __FLIPSENSORS_OUT__ // Flip OUTER sensors
+            pos.rotref = nspace + ":" + rot_sensor_tag;
+#endif
+            p.push_back(pos);
+
+            // Topology
+            mspec.partselectors.push_back(logic.name_tag);
+
+            minfo.rocrows	= any2str<int>(iiter->getModule().outerSensor().numROCRows());
+            minfo.roccols	= any2str<int>(iiter->getModule().outerSensor().numROCCols());
+            minfo.rocx		= any2str<int>(iiter->getModule().outerSensor().numROCX());
+            minfo.rocy		= any2str<int>(iiter->getModule().outerSensor().numROCY());
+
+            mspec.moduletypes.push_back(minfo);
+            //mspec.moduletypes.push_back(iiter->getModule().getType());
+            modcomplex.addMaterialInfo(c, composites_);
+            modcomplex.addShapeInfo(s);
+            modcomplex.addLogicInfo(l);
+            modcomplex.addPositionInfo(p);
+#ifdef __DEBUGPRINT__
+            modcomplex.print();
+#endif
+          }
+
+
+          // collect ring info
+          ERingInfo rinf;
+          rinf.name = rname.str();
+          rinf.childname = mname.str();
+          rinf.fw = (iiter->getModule().center().Z() > (zmin + zmax) / 2.0);
+          rinf.isZPlus = iiter->getModule().uniRef().side;
+          rinf.fw_flipped = iiter->getModule().flipped();
+          rinf.phi = iiter->getModule().center().Phi();
+          rinf.modules = disc.ringsMap().at(modRing)->numModules();
+          rinf.mthk = modcomplex.getExpandedModuleThickness();
+          rinf.rmin  = modcomplex.getRmin();
+          rinf.rmid = iiter->getModule().center().Rho();
+          rinf.rmax = modcomplex.getRmax();
+          rinf.zmin = ringzmin.at(modRing - 1);
+          rinf.zmax = ringzmax.at(modRing - 1);
+          rinf.zfw = iiter->getModule().center().Z();
+          rinfo.insert(std::pair<int, ERingInfo>(modRing, rinf));
+
+
+          // material properties
+          rtotal = rtotal + iiter->getRadiationLength();
+          itotal = itotal + iiter->getInteractionLength();
+          count++;
+        }
+
+        if (iiter->getModule().uniRef().phi == 2) {
+          std::map<int,ERingInfo>::iterator it;
+          // fill the info of the z-backward part of the ring with matching ring number
+          it = rinfo.find(modRing);
+          if (it != rinfo.end()) {
+            it->second.zbw = iiter->getModule().center().Z();
           }
         }
+      }
+    }
 
-        //disc
-        shape.name_tag = dname.str();
-        shape.rmin = rmin - 2 * xml_epsilon;
-        shape.rmax = rmax + 2 * xml_epsilon;
-        shape.dz = diskThickness / 2.0 + 2 * xml_epsilon; //(zmax - zmin) / 2.0;
+    if (count > 0) {
+      ril.rlength = rtotal / (double)count;
+      ril.ilength = itotal / (double)count;
+      ri.push_back(ril);
+    }
+
+    // rings
+    shape.type = tb;
+    shape.dx = 0.0;
+    shape.dy = 0.0;
+    shape.dyy = 0.0;
+    //findDeltaZ(disc.getModuleVector()->begin(), // CUIDADO what the hell is this??
+    //disc.getModuleVector()->end(), (zmin + zmax) / 2.0) / 2.0;
+
+    std::set<int>::const_iterator siter, sguard = ridx.end();
+    for (siter = ridx.begin(); siter != sguard; siter++) {
+      if (rinfo[*siter].modules > 0) {
+
+        shape.name_tag = rinfo[*siter].name;
+        shape.rmin = rinfo[*siter].rmin - xml_epsilon;
+        shape.rmax = rinfo[*siter].rmax + xml_epsilon;
+        shape.dz = (rinfo[*siter].zmax - rinfo[*siter].zmin) / 2.0 + xml_epsilon;
         s.push_back(shape);
 
-        logic.name_tag = shape.name_tag; // CUIDADO ended with + xml_plus;
-        //logic.extra = xml_plus;
-        logic.shape_tag = nspace + ":" + shape.name_tag;
+        logic.name_tag = shape.name_tag;
+        logic.shape_tag = nspace + ":" + logic.name_tag;
         logic.material_tag = xml_material_air;
         l.push_back(logic);
 
-        pos.parent_tag = xml_pixfwdident + ":" + xml_2OTfwd;
-        pos.child_tag = nspace + ":" + logic.name_tag;
-        pos.trans.dz = (zmax + zmin) / 2.0 - xml_z_pixfwd;
-        p.push_back(pos);
+        pos.parent_tag = nspace + ":" + dname.str(); // CUIDADO ended with: + xml_plus;
+        pos.child_tag = logic.shape_tag;
 
-        dspec.partselectors.push_back(logic.name_tag);
-        dspec.moduletypes.push_back(minfo_zero);
-        dspec.partextras.push_back(logic.extra);
-        //   logic.name_tag = shape.name_tag; // CUIDADO ended with + xml_minus;
-        //   logic.extra = xml_minus;
-        //   l.push_back(logic);
-        //   pos.parent_tag = xml_pixfwdident + ":" + xml_2OTfwd;
-        //   pos.child_tag = nspace + ":" + logic.name_tag;
-        //   p.push_back(pos);
-        //dspec.partselectors.push_back(logic.name_tag); // CUIDADO dspec still needs to be duplicated for minus discs (I think)
-        //dspec.partextras.push_back(logic.extra);
+        pos.trans.dz = (rinfo[*siter].zmin + rinfo[*siter].zmax) / 2.0 - (zmin + zmax) / 2.0;
+        p.push_back(pos);
+        //pos.parent_tag = nspace + ":" + dname.str(); // CUIDADO ended with: + xml_minus;
+        //p.push_back(pos);
+
+        rspec.partselectors.push_back(logic.name_tag);
+        rspec.moduletypes.push_back(minfo_zero);
+
+        // forward part of the ring
+        alg.name = xml_trackerring_algo;
+        alg.parent = logic.shape_tag;
+        alg.parameters.push_back(stringParam(xml_childparam, nspace + ":" + rinfo[*siter].childname));
+        pconverter << (rinfo[*siter].modules / 2);
+        alg.parameters.push_back(numericParam(xml_nmods, pconverter.str()));
+        pconverter.str("");
+        alg.parameters.push_back(numericParam(xml_startcopyno, "1"));
+        alg.parameters.push_back(numericParam(xml_incrcopyno, "2"));
+        alg.parameters.push_back(numericParam(xml_rangeangle, "360*deg"));
+        pconverter << 360. / (double)(rinfo[*siter].modules) * rinfo[*siter].phi << "*deg";
+        alg.parameters.push_back(numericParam(xml_startangle, pconverter.str()));
+        pconverter.str("");
+        pconverter << rinfo[*siter].rmid;
+        alg.parameters.push_back(numericParam(xml_radius, pconverter.str()));
+        pconverter.str("");
+        alg.parameters.push_back(vectorParam(0, 0, rinfo[*siter].zfw - (rinfo[*siter].zmin + rinfo[*siter].zmax) / 2.0));
+        pconverter << rinfo[*siter].isZPlus;
+        alg.parameters.push_back(numericParam(xml_iszplus, pconverter.str()));
+        pconverter.str("");
+        alg.parameters.push_back(numericParam(xml_tiltangle, "90*deg"));
+        pconverter << rinfo[*siter].fw_flipped;
+        alg.parameters.push_back(numericParam(xml_isflipped, pconverter.str()));
+        pconverter.str("");
+        a.push_back(alg);
+        alg.parameters.clear();
+
+        // backward part of the ring
+        alg.name = xml_trackerring_algo;
+        alg.parameters.push_back(stringParam(xml_childparam, nspace + ":" + rinfo[*siter].childname));
+        pconverter << (rinfo[*siter].modules / 2);
+        alg.parameters.push_back(numericParam(xml_nmods, pconverter.str()));
+        pconverter.str("");
+        alg.parameters.push_back(numericParam(xml_startcopyno, "2"));
+        alg.parameters.push_back(numericParam(xml_incrcopyno, "2"));
+        alg.parameters.push_back(numericParam(xml_rangeangle, "360*deg"));
+        pconverter << 360. / (double)(rinfo[*siter].modules) * (rinfo[*siter].phi + 1) << "*deg";
+        alg.parameters.push_back(numericParam(xml_startangle, pconverter.str()));
+        pconverter.str("");
+        pconverter << rinfo[*siter].rmid;
+        alg.parameters.push_back(numericParam(xml_radius, pconverter.str()));
+        pconverter.str("");
+        alg.parameters.push_back(vectorParam(0, 0, rinfo[*siter].zbw - (rinfo[*siter].zmin + rinfo[*siter].zmax) / 2.0));
+        pconverter << rinfo[*siter].isZPlus;
+        alg.parameters.push_back(numericParam(xml_iszplus, pconverter.str()));
+        pconverter.str("");
+        alg.parameters.push_back(numericParam(xml_tiltangle, "90*deg"));
+        pconverter << !rinfo[*siter].fw_flipped;
+        alg.parameters.push_back(numericParam(xml_isflipped, pconverter.str()));
+        pconverter.str("");
+        a.push_back(alg);
+        alg.parameters.clear();
       }
-      layer++;
     }
-    if (!dspec.partselectors.empty()) t.push_back(dspec);
-    if (!rspec.partselectors.empty()) t.push_back(rspec);
-    if (!sspec.partselectors.empty()) t.push_back(sspec);
-    if (!mspec.partselectors.empty()) t.push_back(mspec);
+
+    //disc
+    shape.name_tag = dname.str();
+    shape.rmin = rmin - 2 * xml_epsilon;
+    shape.rmax = rmax + 2 * xml_epsilon;
+    shape.dz = diskThickness / 2.0 + 2 * xml_epsilon; //(zmax - zmin) / 2.0;
+    s.push_back(shape);
+
+    logic.name_tag = shape.name_tag; // CUIDADO ended with + xml_plus;
+    //logic.extra = xml_plus;
+    logic.shape_tag = nspace + ":" + shape.name_tag;
+    logic.material_tag = xml_material_air;
+    l.push_back(logic);
+
+    pos.parent_tag = xml_pixfwdident + ":" + xml_2OTfwd;
+    pos.child_tag = nspace + ":" + logic.name_tag;
+    pos.trans.dz = (zmax + zmin) / 2.0 - xml_z_pixfwd;
+    p.push_back(pos);
+
+    dspec.partselectors.push_back(logic.name_tag);
+    dspec.moduletypes.push_back(minfo_zero);
+    dspec.partextras.push_back(logic.extra);
+    //   logic.name_tag = shape.name_tag; // CUIDADO ended with + xml_minus;
+    //   logic.extra = xml_minus;
+    //   l.push_back(logic);
+    //   pos.parent_tag = xml_pixfwdident + ":" + xml_2OTfwd;
+    //   pos.child_tag = nspace + ":" + logic.name_tag;
+    //   p.push_back(pos);
+    //dspec.partselectors.push_back(logic.name_tag); // CUIDADO dspec still needs to be duplicated for minus discs (I think)
+    //dspec.partextras.push_back(logic.extra);
+
+    f.specs.push_back(dspec);
+    f.specs.push_back(rspec);
+    f.specs.push_back(sspec);
+    f.specs.push_back(mspec);
+  }
+
+  /**
+   * Moves a fragment from the analysis of one layer or disc to the end of the output collections.
+   * The shape operations, which only the barrel has, are left to the caller.
+   * @param f A reference to the fragment; emptied of its content
+   * @param c A reference to the collection of composite material information; used for output
+   * @param l A reference to the collection of volume hierarchy information; used for output
+   * @param s A reference to the collection of shape parameters; used for output
+   * @param p A reference to the collection of volume positionings; used for output
+   * @param a A reference to the collection of algorithm calls and their parameters; used for output
+   * @param r A reference to the collection of rotations; a rotation already there is kept, as with a direct insertion
+   * @param ri A reference to the collection of overall radiation and interaction lengths per layer or disc; used for output
+   * @param specs The topology blocks that the part selectors of the fragment specs go to, in the same order
+   */
+  void Extractor::appendFragment(CMSSWBundle& f, std::vector<Composite>& c, std::vector<LogicalInfo>& l, std::vector<ShapeInfo>& s,
+                                 std::vector<PosInfo>& p, std::vector<AlgoInfo>& a, std::map<std::string,Rotation>& r,
+                                 std::vector<RILengthInfo>& ri, SpecParInfo* specs[]) {
+    c.insert(c.end(), std::make_move_iterator(f.composites.begin()), std::make_move_iterator(f.composites.end()));
+    l.insert(l.end(), std::make_move_iterator(f.logic.begin()), std::make_move_iterator(f.logic.end()));
+    s.insert(s.end(), std::make_move_iterator(f.shapes.begin()), std::make_move_iterator(f.shapes.end()));
+    p.insert(p.end(), std::make_move_iterator(f.positions.begin()), std::make_move_iterator(f.positions.end()));
+    a.insert(a.end(), std::make_move_iterator(f.algos.begin()), std::make_move_iterator(f.algos.end()));
+    r.insert(f.rots.begin(), f.rots.end());
+    ri.insert(ri.end(), f.lrilength.begin(), f.lrilength.end());
+    for (unsigned int i = 0; i < f.specs.size(); i++) {
+      SpecParInfo& from = f.specs.at(i);
+      specs[i]->partselectors.insert(specs[i]->partselectors.end(), from.partselectors.begin(), from.partselectors.end());
+      specs[i]->partextras.insert(specs[i]->partextras.end(), from.partextras.begin(), from.partextras.end());
+      specs[i]->moduletypes.insert(specs[i]->moduletypes.end(), from.moduletypes.begin(), from.moduletypes.end());
+    }
+    f = CMSSWBundle();
   }
 
   /**
@@ -1985,20 +2132,78 @@ namespace insur {
    * @return A new instance of a <i>Composite</i> struct that bundles the material information for further processing
    */
   Composite Extractor::createComposite(std::string name, double density, MaterialProperties& mp, bool nosensors) {
+    if (!nosensors) return composites_.composite(name, density, mp.getLocalMasses());
+    std::map<std::string, double> masses;
+    for (std::map<std::string, double>::const_iterator it = mp.getLocalMasses().begin(); it != mp.getLocalMasses().end(); ++it) {
+      if (it->first.compare(xml_sensor_silicon) != 0) masses.insert(*it);
+    }
+    return composites_.composite(name, density, masses);
+  }
+
+  /**
+   * Make a composite from its material masses, with the element fractions of an earlier composite of the same composition
+   * and density if there is one.
+   * @param name The name of the new composite material
+   * @param density The overall density of the composite
+   * @param masses The masses of the materials, by name
+   * @return A new instance of a <i>Composite</i> struct that bundles the material information for further processing
+   */
+  Composite CompositeCache::composite(const std::string& name, double density, const std::map<std::string, double>& masses) {
+    if (!enabled_) return makeComposite(name, density, masses);
+    uint64_t key = hash(density, masses);
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Entry>& bucket = entries_[key];
+    for (std::vector<Entry>::const_iterator it = bucket.begin(); it != bucket.end(); ++it) {
+      if (it->density == density && it->masses == masses) {
+        Composite comp = shared_.at(it->id);
+        comp.name = name;
+        return comp;
+      }
+    }
+    Entry entry;
+    entry.masses = masses;
+    entry.density = density;
+    entry.id = shared_.size();
+    bucket.push_back(entry);
+    shared_.push_back(makeComposite(name, density, masses));
+    return shared_.back();
+  }
+
+  void CompositeCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    shared_.clear();
+  }
+
+  /**
+   * FNV-1a over the bits of the density and of the (material, mass) pairs, which come in the order of the material names.
+   */
+  uint64_t CompositeCache::hash(double density, const std::map<std::string, double>& masses) {
+    uint64_t h = 14695981039346656037ULL;
+    auto add = [&h](const void* data, size_t size) {
+      const unsigned char* bytes = static_cast<const unsigned char*>(data);
+      for (size_t i = 0; i < size; i++) {
+        h ^= bytes[i];
+        h *= 1099511628211ULL;
+      }
+    };
+    add(&density, sizeof(double));
+    for (std::map<std::string, double>::const_iterator it = masses.begin(); it != masses.end(); ++it) {
+      add(it->first.c_str(), it->first.size() + 1);
+      add(&it->second, sizeof(double));
+    }
+    return h;
+  }
+
+  Composite CompositeCache::makeComposite(const std::string& name, double density, const std::map<std::string, double>& masses) {
     Composite comp;
     comp.name = name;
     comp.density = density;
     comp.method = wt;
     double m = 0.0;
-   for (std::map<std::string, double>::const_iterator it = mp.getLocalMasses().begin(); it != mp.getLocalMasses().end(); ++it) {
-      if (!nosensors || (it->first.compare(xml_sensor_silicon) != 0)) {
-        //    std::pair<std::string, double> p;
-        //    p.first = mp.getLocalTag(i);
-        //    p.second = mp.getLocalMass(i);
-        comp.elements.push_back(*it);
-        //    m = m + mp.getLocalMass(i);
-        m += it->second;
-      }
+    for (std::map<std::string, double>::const_iterator it = masses.begin(); it != masses.end(); ++it) {
+      comp.elements.push_back(*it);
+      m += it->second;
     }
     for (unsigned int i = 0; i < comp.elements.size(); i++)
       comp.elements.at(i).second = comp.elements.at(i).second / m;
@@ -2630,26 +2835,11 @@ namespace insur {
     }
   }
 
-  void ModuleComplex::addMaterialInfo(std::vector<Composite>& vec) {
+  void ModuleComplex::addMaterialInfo(std::vector<Composite>& vec, CompositeCache& cache) {
     std::vector<Volume*>::const_iterator vit;
     for ( vit = volumes.begin(); vit != volumes.end(); vit++ ) {
       if ( !((*vit)->getDensity()>0.) ) continue; 
-      Composite comp;
-      comp.name    = prefix_material + (*vit)->getName();
-      comp.density = (*vit)->getDensity();
-      comp.method  = wt;
-
-      double m = 0.0;
-      for (std::map<std::string, double>::const_iterator it = (*vit)->getMaterialList().begin(); 
-                                                         it != (*vit)->getMaterialList().end(); ++it) {
-          comp.elements.push_back(*it);
-          m += it->second;
-      }
-   
-      for (unsigned int i = 0; i < comp.elements.size(); i++)
-        comp.elements.at(i).second = comp.elements.at(i).second / m;
-      
-      vec.push_back(comp);
+      vec.push_back(cache.composite(prefix_material + (*vit)->getName(), (*vit)->getDensity(), (*vit)->getMaterialList()));
     }
   }
 
@@ -1,10 +1,13 @@
 #include <HoughTrack.h>
 
+#include <future>
+#include <thread>
+
 
 HoughTrack::~HoughTrack() {
 }
 
-double HoughTrack::calcPhi0(double x, double y, double pt) {
+double HoughTrack::calcPhi0(double x, double y, double pt) const {
   /*
    * rotate hit to phi=0 (for ease of calculation)
   R^2 = (x - h)^2 + (y - k)^2
@@ -48,7 +51,7 @@ double myatan2(double y, double x) {
 }
 
 
-double HoughTrack::calcTheta(double x, double y, double z, double z0, double pt) {
+double HoughTrack::calcTheta(double x, double y, double z, double z0, double pt) const {
   
   double r = sqrt(x*x + y*y);
 
@@ -64,36 +67,48 @@ double HoughTrack::calcTheta(double x, double y, double z, double z0, double pt)
 
 
 
-double HoughTrack::rectangularSmear(double mean, double sigma, int nsteps, int step) {
+double HoughTrack::rectangularSmear(double mean, double sigma, int nsteps, int step) const {
   return mean - sigma + step*2*sigma/nsteps;
 }
 
 
-void HoughTrack::processHit(int evid, int hitid, double x, double y, double z, double pt, double ptError, double yResolution) { 
+void HoughTrack::processHit(HistoType& histo, TRandom& die, int evid, const HoughHit& hit) const { 
   const double sigmaZ0 = 70;
-  const double sigmaZ = yResolution*sqrt(12)/2;
-  double sigmaInvPt = 3*ptError*1/fabs(pt);
-  //double invPt = die_.Gaus(1/pt, ptError); 
-  double invPt = die_.Uniform(1/pt - sigmaInvPt, 1/pt + sigmaInvPt);
-  int nSamplesPt = 2*sigmaInvPt/histo_.getWbins(H_K); 
-  z = die_.Uniform(z-sigmaZ, z+sigmaZ);
+  const double sigmaZ = hit.yres*sqrt(12)/2;
+  double x = hit.x, y = hit.y, pt = hit.pt;
+  double sigmaInvPt = 3*hit.ptError*1/fabs(pt);
+  //double invPt = die.Gaus(1/pt, ptError); 
+  double invPt = die.Uniform(1/pt - sigmaInvPt, 1/pt + sigmaInvPt);
+  int nSamplesPt = 2*sigmaInvPt/histo.getWbins(H_K); 
+  double z = die.Uniform(hit.z-sigmaZ, hit.z+sigmaZ);
   for (int k = 0; k < nSamplesPt; k++) {
     double invPtSample = rectangularSmear(invPt, sigmaInvPt, nSamplesPt, k);
     double phi0 = calcPhi0(x, y, 1/invPtSample);
-    int nSamplesZ0 = 2*sigmaZ0/histo_.getWbins(H_Z0);
+    int nSamplesZ0 = 2*sigmaZ0/histo.getWbins(H_Z0);
     for (int l = 0; l < nSamplesZ0; l++) {
       double z0Sample = rectangularSmear(0, sigmaZ0, nSamplesZ0, l);
-      int nSamplesZ = 2*sigmaZ/histo_.getWbins(H_Z0);
+      int nSamplesZ = 2*sigmaZ/histo.getWbins(H_Z0);
       for (int m = 0; m < nSamplesZ; m++) {
         double zSample = rectangularSmear(z, sigmaZ, nSamplesZ, m);
         double theta = calcTheta(x, y, zSample, z0Sample, 1/invPtSample);
-        //histo_.fill(seq<4>(invPtSample)(phi0)(z0Sample)(theta));
-        histo_[invPtSample][phi0][z0Sample][theta] += SmartBin(1, evid, 1 << hitid);
+        double coords[4] = { invPtSample, phi0, z0Sample, theta };
+        histo.fill(coords, SmartBin(1, evid, 1 << hit.hitid));
       }
     }
   }
 }
 
+// Transforms consecutive events into histo, with a generator reseeded at each event so that the result does not depend on how the events are split
+void HoughTrack::processEvents(HistoType& histo, const std::vector<std::vector<HoughHit> >& events, long int first, long int last, long int startev) const {
+  TRandom3 die;
+  for (long int i = first; i < last; i++) {
+    long int evid = startev + i;
+    UInt_t seed = seed_ + UInt_t(evid);
+    die.SetSeed(seed ? seed : 1); // 0 would ask ROOT for a random seed
+    for (const HoughHit& hit : events[i]) processHit(histo, die, evid, hit);
+  }
+}
+
 void HoughTrack::loadGeometryData(TFile* infile) {
   TTree* tree;
   ModuleData mdata;
@@ -131,8 +146,6 @@ void HoughTrack::processTree(std::string filename, long int startev, long int ho
   TracksP tracks;
   HitsP hits;
 
-  ptError pterror;
-
   TFile* infile = new TFile(filename.c_str(), "read");
   if (infile->IsZombie()) {
     std::cerr << "Failed opening file \"" << filename << "\" for reading. Processing aborted." << std::endl;
@@ -172,33 +185,27 @@ void HoughTrack::processTree(std::string filename, long int startev, long int ho
   long int nevents = tree->GetEntriesFast();
 #ifdef GENERATE_HIT_MAP
   //TH2I* trackHitsHisto = new TH2I("track_hits", "track hits;pt;eta", 100, -50, 50, 100, -2, 2);
-  Histo<2, int> invPtEtaTrackCount(Seq<2,int>   (100)(100),
+  Histo<2, int, DenseBinKey<2> > invPtEtaTrackCount(Seq<2,int>   (100)(100),
                                    Seq<2,double>(-.6)(-2.2),
                                    Seq<2,double> (.6)(2.2));
-  Histo<2, double> invPtEtaAverageHits(Seq<2,int>   (100) (100),
+  HitMapType invPtEtaAverageHits(Seq<2,int>   (100) (100),
                                        Seq<2,double>(-.6)(-2.2),
                                        Seq<2,double> (.6) (2.2));
 #endif
   int minHits = 100, maxHits = 0;
   float minAvgHits = 100, maxAvgHits = 0;
+  std::vector<std::vector<HoughHit> > events; // the tree is only read here, the transform is done afterwards on all threads
   for (long int i = startev; i < howmany+startev && i < nevents; i++) {
     tree->GetEntry(i);
     /*if ((i-startev)%2 == 0)*/ std::cout << "Event " << i+1 << " of " << MIN(nevents,howmany+startev) << std::endl;
+    events.push_back(std::vector<HoughHit>());
     for (unsigned int j = 0; j < tracks.trackn->size(); j++) {
       minHits = tracks.nhits->at(j) < minHits ? hits.cnt->size() /*tracks.nhits->at(j)*/ : minHits;
       maxHits = tracks.nhits->at(j) > maxHits ? hits.cnt->size() /*tracks.nhits->at(j)*/ : maxHits;
 #ifndef GENERATE_HIT_MAP
       for (size_t k = 0; k < hits.cnt->size(); k++) {
         ModuleData& mdata = mods_[hits.cnt->at(k)][hits.z->at(k)][hits.rho->at(k)][hits.phi->at(k)];
-        pterror.setPitch((mdata.pitchhi+mdata.pitchlo)/2);
-        pterror.setStripLength(mdata.striplen);
-        pterror.setZ(mdata.z);
-        pterror.setR(mdata.rho);
-        pterror.setDistance(mdata.stereo);
-        pterror.setHeight(mdata.height);
-        pterror.setInefficiencyType((ptError::InefficiencyType)mdata.inefftype);
-        pterror.setModuleType(mdata.type);
-        processHit(i, k, hits.glox->at(k), hits.gloy->at(k), hits.gloz->at(k), tracks.pt->at(j), hits.pterr->at(k), mdata.yres);
+        events.back().push_back((HoughHit){ int(k), hits.glox->at(k), hits.gloy->at(k), hits.gloz->at(k), tracks.pt->at(j), hits.pterr->at(k), mdata.yres });
         //if (tracks.nhits->at(j) > 10) 
         //  std::cout << "  Mod z, rho, phi: " << mdata.z << "," << mdata.rho << "," << mdata.phi << " Hit invPt, pterr: " << 1/pt << "," << hits.pterr->at(k) << std::endl;
       }
@@ -210,15 +217,39 @@ void HoughTrack::processTree(std::string filename, long int startev, long int ho
 #endif
     }
   }
+
+#ifndef GENERATE_HIT_MAP
+  // Each thread transforms a contiguous range of events into its own histogram,
+  // and the histograms are merged in the order of the events. A partial histogram
+  // can grow as large as the final one, so the peak memory of the transform is up
+  // to numThreads+1 histograms: the threads are bounded by MaxHoughThreads for that
+  const long int MaxHoughThreads = 8;
+  long int numThreads = MAX(1L, MIN(MIN(long(std::thread::hardware_concurrency()), MaxHoughThreads), long(events.size())));
+  long int eventsPerThread = (events.size() + numThreads - 1)/numThreads;
+  std::vector<HistoType> partials(numThreads, histo_);
+  std::vector<std::future<void> > jobs;
+  for (long int t = 0; t < numThreads; t++) {
+    jobs.push_back(std::async(std::launch::async, [&, t]() {
+      long int first = MIN(long(events.size()), t*eventsPerThread);
+      processEvents(partials[t], events, first, MIN(long(events.size()), first + eventsPerThread), startev);
+    }));
+  }
+  for (long int t = 0; t < numThreads; t++) {
+    jobs[t].get();
+    histo_.merge(partials[t], [](SmartBin& bin, const SmartBin& later) { bin.merge(later); });
+    partials[t].clear();
+  }
+#endif
   cout << "Transform done. Histo size: " << histo_.size() << " entries. " << histo_.size()*(sizeof(BinKey<4, uint16_t>) + sizeof(SmartBin))/1048576 << " MB (no overhead)" << std::endl;
 
 #ifdef GENERATE_HIT_MAP
-  std::ofstream hout("pt_eta_average_hits_3million.hst");
-  invPtEtaAverageHits.serialize(hout);
+  std::ofstream hout("pt_eta_average_hits_3million.hst", ios::out | ios::binary);
+  invPtEtaAverageHits.serializeBinary(hout);
   hout.close();
 #else
-  std::ifstream hin("pt_eta_average_hits_3million.hst", ios::in);
-  Histo<2, double> invPtEtaAverageHits(hin); 
+  std::ifstream hin("pt_eta_average_hits_3million.hst", ios::in | ios::binary);
+  if (!hin) throw std::runtime_error("Cannot open pt_eta_average_hits_3million.hst: build with GENERATE_HIT_MAP to make it");
+  HitMapType invPtEtaAverageHits(hin); // older maps were written as text
   hin.close();
 #endif
 
@@ -296,7 +327,12 @@ void HoughTrack::processTree(std::string filename, long int startev, long int ho
 int main(int argc, char* argv[]) {
 
   HoughTrack ht;
-  ht.processTree(argv[1], str2any<long int>(argv[2]), str2any<long int>(argv[3]));
+  try {
+    ht.processTree(argv[1], str2any<long int>(argv[2]), str2any<long int>(argv[3]));
+  } catch (std::exception& e) { // e.g. a hit map which is missing or cannot be read
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
   
   return 0;
 }
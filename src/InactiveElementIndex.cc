@@ -0,0 +1,80 @@
+/**
+ * @file InactiveElementIndex.cc
+ * @brief This is the implementation of the eta lookup index over a collection of inactive elements
+ */
+
+#include <cmath>
+#include <algorithm>
+#include <InactiveElementIndex.h>
+
+namespace insur {
+  /**
+   * Build the index from the given collection: filter by side and category, cache the eta range and
+   * the material lengths of each element and distribute the elements into eta slices.
+   * @param elements The collection of inactive elements to be indexed; it must outlive the index
+   * @param cat The category of inactive elements to be kept; none if all of them should be
+   */
+  InactiveElementIndex::InactiveElementIndex(std::vector<InactiveElement>& elements, MaterialProperties::Category cat) :
+    cat_(cat), etaLow_(0), sliceWidth_(1) {
+    entries_.reserve(elements.size());
+    for (InactiveElement& element : elements) {
+      // rays are in z+ only, so only volumes in z+ need to be considered
+      if ((element.getZOffset() + element.getZLength()) <= 0) continue;
+      if ((cat != MaterialProperties::no_cat) && (cat != element.getCategory())) continue;
+      std::pair<double, double> etaMinMax = element.getEtaMinMax();
+      if (!(etaMinMax.first < etaMinMax.second)) continue; // empty eta range: can never be hit
+      Entry entry;
+      entry.element = &element;
+      entry.etaMin = etaMinMax.first;
+      entry.etaMax = etaMinMax.second;
+      entry.radiationLength = element.getRadiationLength();
+      entry.interactionLength = element.getInteractionLength();
+      entries_.push_back(entry);
+    }
+    if (entries_.empty()) return;
+
+    double etaHigh = entries_.front().etaMax;
+    etaLow_ = entries_.front().etaMin;
+    for (const Entry& entry : entries_) {
+      etaLow_ = std::min(etaLow_, entry.etaMin);
+      etaHigh = std::max(etaHigh, entry.etaMax);
+    }
+    // One slice per element on average keeps the candidate lists short without wasting memory
+    int nSlices = std::max(1, int(entries_.size()));
+    sliceWidth_ = (etaHigh - etaLow_) / nSlices;
+    if (!(sliceWidth_ > 0)) sliceWidth_ = 1;
+    slices_.resize(nSlices);
+    for (Entry& entry : entries_) {
+      entry.firstSlice = std::max(0, int(floor((entry.etaMin - etaLow_) / sliceWidth_)));
+      entry.lastSlice = std::min(nSlices - 1, int(floor((entry.etaMax - etaLow_) / sliceWidth_)));
+      if (entry.lastSlice - entry.firstSlice < MaxListedSlices) {
+        for (int i = entry.firstSlice; i <= entry.lastSlice; ++i) slices_[i].push_back(&entry);
+      } else {
+        wideEntries_.push_back(&entry);
+      }
+    }
+  }
+
+  /**
+   * Get the elements which may be crossed by a straight track from the origin with the given eta.
+   * The returned list is a superset of the crossed elements: <i>Entry::crossedBy()</i> gives the exact answer.
+   * @param eta The pseudorapidity of the track
+   * @param result The list of candidate entries, in the order of the original collection
+   */
+  void InactiveElementIndex::candidates(double eta, EntryList& result) const {
+    result.clear();
+    if (slices_.empty()) return;
+    double position = (eta - etaLow_) / sliceWidth_;
+    if (!(position >= 0) || position >= slices_.size()) return;
+    int slice = int(position);
+    // both lists are in the order of entries_, which is the one of the collection: merge them
+    const EntryList& listed = slices_[slice];
+    EntryList::const_iterator it = listed.begin();
+    for (const Entry* wide : wideEntries_) {
+      if (wide->firstSlice > slice || wide->lastSlice < slice) continue;
+      for (; it != listed.end() && *it < wide; ++it) result.push_back(*it);
+      result.push_back(wide);
+    }
+    result.insert(result.end(), it, listed.end());
+  }
+}
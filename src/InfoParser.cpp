@@ -0,0 +1,238 @@
+#include "InfoParser.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using boost::property_tree::ptree;
+using boost::property_tree::info_parser::info_parser_error;
+
+namespace {
+
+  // Same as the isspace() of the "C" locale, nothing outside ASCII being a space
+  inline bool isSpace(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+  /**
+   * Parses one file (or buffer) of the info format into a ptree, with the
+   * states of boost's read_info_internal(). Every line is a [text, end)
+   * range of the buffer, where end is the newline or the first null
+   * character, as the line would be seen through getline() and c_str().
+   */
+  class InfoReader {
+    const char* text_;
+    const char* end_;
+
+    void skipWhitespace() { while (text_ != end_ && isSpace(*text_)) ++text_; }
+    bool atEnd() const { return text_ == end_; }
+
+    // Copies [b, e) into result, replacing the escape sequences
+    static void expandEscapes(const char* b, const char* e, std::string& result) {
+      const char* backslash = static_cast<const char*>(memchr(b, '\\', e - b));
+      if (!backslash) {
+        result.assign(b, e);
+        return;
+      }
+      result.assign(b, backslash);
+      for (b = backslash; b != e; ++b) {
+        if (*b != '\\') {
+          result += *b;
+          continue;
+        }
+        if (++b == e) throw info_parser_error("character expected after backslash", "", 0);
+        switch (*b) {
+        case '0': result += '\0'; break;
+        case 'a': result += '\a'; break;
+        case 'b': result += '\b'; break;
+        case 'f': result += '\f'; break;
+        case 'n': result += '\n'; break;
+        case 'r': result += '\r'; break;
+        case 't': result += '\t'; break;
+        case 'v': result += '\v'; break;
+        case '"': result += '"'; break;
+        case '\'': result += '\''; break;
+        case '\\': result += '\\'; break;
+        default: throw info_parser_error("unknown escape sequence", "", 0);
+        }
+      }
+    }
+
+    void readWord(std::string& word) {
+      skipWhitespace();
+      const char* start = text_;
+      while (text_ != end_ && !isSpace(*text_) && *text_ != ';') ++text_;
+      expandEscapes(start, text_, word);
+    }
+
+    // Reads a quoted string. needMoreLines is set if it ends with a \ continuation, which is an error if it is null
+    void readString(std::string& result, bool* needMoreLines) {
+      skipWhitespace();
+      if (atEnd() || *text_ != '"') throw info_parser_error("expected \"", "", 0);
+      const char* start = ++text_;
+      bool escaped = false;
+      while (text_ != end_ && (escaped || *text_ != '"')) {
+        escaped = !escaped && *text_ == '\\';
+        ++text_;
+      }
+      if (atEnd()) throw info_parser_error("unexpected end of line", "", 0);
+      expandEscapes(start, text_++, result);
+      skipWhitespace();
+      if (!atEnd() && *text_ == '\\') {
+        if (!needMoreLines) throw info_parser_error("unexpected \\", "", 0);
+        ++text_;
+        skipWhitespace();
+        if (!atEnd() && *text_ != ';') throw info_parser_error("expected end of line after \\", "", 0);
+        *needMoreLines = true;
+      } else if (needMoreLines) {
+        *needMoreLines = false;
+      }
+    }
+
+    void readKey(std::string& key) {
+      skipWhitespace();
+      if (!atEnd() && *text_ == '"') readString(key, nullptr);
+      else readWord(key);
+    }
+
+    void readData(std::string& data, bool* needMoreLines) {
+      skipWhitespace();
+      if (!atEnd() && *text_ == '"') {
+        readString(data, needMoreLines);
+      } else {
+        *needMoreLines = false;
+        readWord(data);
+      }
+    }
+
+    void parseLines(const char* begin, const char* end, ptree& pt, const std::string& fileName, int includeDepth, unsigned long& lineNumber);
+
+  public:
+    void parse(const char* begin, const char* end, ptree& pt, const std::string& fileName, int includeDepth);
+  };
+
+  void InfoReader::parse(const char* begin, const char* end, ptree& pt, const std::string& fileName, int includeDepth) {
+    unsigned long lineNumber = 0;
+    try {
+      parseLines(begin, end, pt, fileName, includeDepth, lineNumber);
+    } catch (info_parser_error& e) {
+      // Errors of this file get its name and the current line, those of the included files are kept as they are
+      if (e.line() == 0) throw info_parser_error(e.message(), fileName, lineNumber);
+      throw;
+    }
+  }
+
+  void InfoReader::parseLines(const char* begin, const char* end, ptree& pt, const std::string& fileName, int includeDepth, unsigned long& lineNumber) {
+    enum { Key, Data, DataContinuation } state = Key;
+    ptree* last = nullptr;
+    std::vector<ptree*> stack(1, &pt);
+    std::string token;
+
+    // Like getline(), a buffer ending with a newline is followed by one last empty line
+    for (const char* line = begin; ; ) {
+      ++lineNumber;
+      const char* newline = static_cast<const char*>(memchr(line, '\n', end - line));
+      const char* lineEnd = newline ? newline : end;
+      const char* nul = static_cast<const char*>(memchr(line, '\0', lineEnd - line));
+      text_ = line;
+      end_ = nul ? nul : lineEnd;
+
+      skipWhitespace();
+      if (!atEnd() && *text_ == '#') {
+        ++text_;
+        readWord(token);
+        if (token != "include") throw info_parser_error("unknown directive", fileName, lineNumber);
+        if (includeDepth > 100) throw info_parser_error("include depth too large, probably recursive include", fileName, lineNumber);
+        readString(token, nullptr);
+        const char* directiveEnd = end_;
+        const char* directiveText = text_;
+        std::ifstream includeStream(token.c_str());
+        if (!includeStream.good()) throw info_parser_error("cannot open include file " + token, fileName, lineNumber);
+        std::string content((std::istreambuf_iterator<char>(includeStream)), std::istreambuf_iterator<char>());
+        InfoReader().parse(content.data(), content.data() + content.size(), *stack.back(), token, includeDepth + 1);
+        text_ = directiveText;
+        end_ = directiveEnd;
+        skipWhitespace();
+        if (!atEnd()) throw info_parser_error("expected end of line", fileName, lineNumber);
+      } else {
+        while (true) {
+          skipWhitespace();
+          if (atEnd() || *text_ == ';') { // end of line or comment
+            if (state == Data) state = Key; // the key had no data
+            break;
+          }
+          switch (state) {
+          case Key:
+            if (*text_ == '{') {
+              if (!last) throw info_parser_error("unexpected {", "", 0);
+              stack.push_back(last);
+              last = nullptr;
+              ++text_;
+            } else if (*text_ == '}') {
+              if (stack.size() <= 1) throw info_parser_error("unmatched }", "", 0);
+              stack.pop_back();
+              last = nullptr;
+              ++text_;
+            } else {
+              readKey(token);
+              last = &stack.back()->push_back(std::make_pair(token, ptree()))->second;
+              state = Data;
+            }
+            break;
+          case Data:
+            if (*text_ == '{') {
+              stack.push_back(last);
+              last = nullptr;
+              ++text_;
+              state = Key;
+            } else if (*text_ == '}') {
+              if (stack.size() <= 1) throw info_parser_error("unmatched }", "", 0);
+              stack.pop_back();
+              last = nullptr;
+              ++text_;
+              state = Key;
+            } else {
+              bool needMoreLines;
+              readData(last->data(), &needMoreLines);
+              state = needMoreLines ? DataContinuation : Key;
+            }
+            break;
+          case DataContinuation:
+            if (*text_ != '"') throw info_parser_error("expected \" after \\ in previous line", "", 0);
+            bool needMoreLines;
+            readString(token, &needMoreLines);
+            last->data() += token;
+            state = needMoreLines ? DataContinuation : Key;
+            break;
+          }
+        }
+      }
+
+      if (!newline) break;
+      line = newline + 1;
+    }
+
+    if (stack.size() != 1) throw info_parser_error("unmatched {", "", 0);
+  }
+
+}
+
+/**
+ * The tree is replaced only if the whole buffer could be read, as with read_info()
+ * @throw info_parser_error on a syntax error or an include file that cannot be opened
+ */
+void readInfo(const char* begin, const char* end, ptree& pt, const std::string& fileName) {
+  ptree local;
+  InfoReader().parse(begin, end, local, fileName, 0);
+  pt.swap(local);
+}
+
+void readInfo(const std::string& content, ptree& pt, const std::string& fileName) {
+  readInfo(content.data(), content.data() + content.size(), pt, fileName);
+}
+
+void readInfoFile(const std::string& fileName, ptree& pt) {
+  std::ifstream in(fileName.c_str());
+  if (!in) throw info_parser_error("cannot open file for reading", fileName, 0);
+  std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  readInfo(content, pt, fileName);
+}
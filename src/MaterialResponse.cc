@@ -0,0 +1,268 @@
+/**
+ * @file MaterialResponse.cc
+ * @brief This is the implementation of the tabulated material response of a tracker versus eta
+ */
+
+#include <cmath>
+#include <algorithm>
+#include <Math/Vector3D.h>
+#include <MaterialResponse.h>
+
+namespace insur {
+  /**
+   * Order two crossings by their distance from the origin.
+   */
+  static bool closerCrossing(const MaterialResponse::Crossing& a, const MaterialResponse::Crossing& b) {
+    return a.distance < b.distance;
+  }
+
+  MaterialResponse::MaterialResponse() : mb_(NULL), pm_(NULL), phi_(0), etaMax_(0), etaStep_(1) {}
+
+  MaterialResponse::~MaterialResponse() {
+    clearInactive();
+  }
+
+  void MaterialResponse::clearInactive() {
+    for (auto& index : indexes_) delete index.first;
+    indexes_.clear();
+  }
+
+  /**
+   * Build the table for the given material budgets. Any previous content is discarded.
+   * @param mb A reference to the material budget of the tracker
+   * @param pm A pointer to the material budget of the pixel detector; may be <i>NULL</i>
+   * @param etaMax The upper end of the eta grid, which starts at 0
+   * @param etaBins The number of grid points, spaced as in the eta scans of the <i>Analyzer</i>
+   * @param phi The reference phi used to cast rays onto the modules, and the only phi the table answers for
+   */
+  void MaterialResponse::build(MaterialBudget& mb, MaterialBudget* pm, double etaMax, int etaBins, double phi) {
+    clearInactive();
+    addInactive(mb, pm);
+    mb_ = &mb;
+    pm_ = pm;
+    phi_ = phi;
+    tabulate(etaMax, etaBins);
+  }
+
+  /**
+   * Add a collection of inactive elements to the ones tabulated by the next <i>buildInactive()</i>.
+   * @param elements The inactive elements; only those in z+ and of the given category are kept
+   * @param isPixel True if the elements belong to the pixel detector
+   * @param cat The category of the elements to be kept; all of them for <i>no_cat</i>
+   * @return The number of the collection, for <i>crossedEntries()</i>
+   */
+  int MaterialResponse::addInactive(std::vector<InactiveElement>& elements, bool isPixel, MaterialProperties::Category cat) {
+    indexes_.push_back(std::make_pair(new InactiveElementIndex(elements, cat), isPixel));
+    return indexes_.size() - 1;
+  }
+
+  /**
+   * Add the services and supports of the given material budgets, as seen by the hit finders.
+   */
+  void MaterialResponse::addInactive(MaterialBudget& mb, MaterialBudget* pm) {
+    addInactive(mb.getInactiveSurfaces().getBarrelServices(), false);
+    addInactive(mb.getInactiveSurfaces().getEndcapServices(), false);
+    addInactive(mb.getInactiveSurfaces().getSupports(), false);
+    if (pm) {
+      addInactive(pm->getInactiveSurfaces().getBarrelServices(), true);
+      addInactive(pm->getInactiveSurfaces().getEndcapServices(), true);
+      addInactive(pm->getInactiveSurfaces().getSupports(), true);
+    }
+  }
+
+  /**
+   * Build the table of the inactive elements added so far, without modules: it answers for any phi.
+   * Any previous content of the table is discarded, the collections of inactive elements are kept.
+   * @param etaMax The upper end of the eta grid, which starts at 0
+   * @param etaBins The number of grid points, spaced as in the eta scans of the <i>Analyzer</i>
+   */
+  void MaterialResponse::buildInactive(double etaMax, int etaBins) {
+    mb_ = NULL;
+    pm_ = NULL;
+    phi_ = 0;
+    tabulate(etaMax, etaBins);
+  }
+
+  void MaterialResponse::tabulate(double etaMax, int etaBins) {
+    etaMax_ = etaMax;
+    etaStep_ = (etaBins > 1) ? etaMax / (double)(etaBins - 1) : etaMax;
+    if (!(etaStep_ > 0)) etaStep_ = 1;
+
+    table_.assign(std::max(etaBins, 1), Crossings());
+    crossed_.assign(table_.size(), std::vector<InactiveElementIndex::EntryList>(indexes_.size()));
+    totals_.assign(table_.size(), Material());
+    for (unsigned int i = 0; i < table_.size(); ++i) {
+      cast(binEta(i), table_[i], &crossed_[i]);
+      for (const Crossing& crossing : table_[i]) totals_[i] += crossing.material;
+    }
+  }
+
+  /**
+   * Find the grid point closest to the given eta. Tracks go to z+ only, so the sign of eta is ignored.
+   * @return The index of the nearest grid point, or -1 if the table is empty
+   */
+  int MaterialResponse::findEtaBin(double eta) const {
+    if (table_.empty()) return -1;
+    int bin = int(floor(fabs(eta) / etaStep_ + 0.5));
+    return std::min(bin, int(table_.size()) - 1);
+  }
+
+  /**
+   * Exact ray casting for a straight track from the origin at the given eta and the reference phi.
+   * This is what the table is built from; it is exposed to validate the lookups.
+   * @param eta The pseudorapidity of the track
+   * @param crossings The list to be filled with the crossings, ordered by distance from the origin
+   */
+  void MaterialResponse::castRay(double eta, Crossings& crossings) const {
+    cast(eta, crossings, NULL);
+  }
+
+  void MaterialResponse::cast(double eta, Crossings& crossings, std::vector<InactiveElementIndex::EntryList>* crossed) const {
+    crossings.clear();
+    double theta = 2 * atan(exp(-fabs(eta)));
+    if (mb_) {
+      castModules(mb_->getBarrelModuleCaps(), theta, false, crossings);
+      castModules(mb_->getEndcapModuleCaps(), theta, false, crossings);
+    }
+    if (pm_) {
+      castModules(pm_->getBarrelModuleCaps(), theta, true, crossings);
+      castModules(pm_->getEndcapModuleCaps(), theta, true, crossings);
+    }
+    for (unsigned int i = 0; i < indexes_.size(); ++i) {
+      castInactive(*indexes_[i].first, fabs(eta), theta, indexes_[i].second, crossings, crossed ? &(*crossed)[i] : NULL);
+    }
+    std::stable_sort(crossings.begin(), crossings.end(), closerCrossing);
+  }
+
+  void MaterialResponse::castModules(std::vector<std::vector<ModuleCap> >& caps, double theta, bool isPixel, Crossings& crossings) const {
+    XYZVector origin, direction;
+    ROOT::Math::Polar3DVector dir;
+    dir.SetCoordinates(1, theta, phi_);
+    direction = dir;
+    for (std::vector<ModuleCap>& layer : caps) {
+      for (ModuleCap& cap : layer) {
+        Module& m = cap.getModule();
+        // rays are in z+ only, so consider only modules that lie on that side
+        if (m.maxZ() <= 0) continue;
+        auto h = m.checkTrackHits(origin, direction);
+        if (h.second == HitType::NONE) continue;
+        Crossing crossing;
+        crossing.moduleCap = &cap;
+        crossing.element = NULL;
+        crossing.hitType = h.second;
+        crossing.distance = h.first.R();
+        crossing.r = crossing.distance * sin(theta);
+        crossing.z = crossing.distance * cos(theta);
+        crossing.isPixel = isPixel;
+        // same tilt-aware scaling as in the material budget scan
+        double scale = (m.subdet() == BARREL) ? sin(theta + m.tiltAngle()) : cos(theta + m.tiltAngle() - M_PI/2);
+        crossing.material.radiation = cap.getRadiationLength() / scale;
+        crossing.material.interaction = cap.getInteractionLength() / scale;
+        crossings.push_back(crossing);
+      }
+    }
+  }
+
+  void MaterialResponse::castInactive(const InactiveElementIndex& index, double eta, double theta, bool isPixel, Crossings& crossings,
+                                      InactiveElementIndex::EntryList* crossed) const {
+    InactiveElementIndex::EntryList candidates;
+    index.candidates(eta, candidates);
+    for (const InactiveElementIndex::Entry* entry : candidates) {
+      if (!entry->crossedBy(eta)) continue;
+      if (crossed) crossed->push_back(entry);
+      InactiveElement* element = entry->element;
+      Crossing crossing;
+      crossing.moduleCap = NULL;
+      crossing.element = element;
+      crossing.hitType = HitType::NONE;
+      crossing.isPixel = isPixel;
+      // In case we are crossing the material with a very shallow angle
+      // we have to take into account its finite size, as in the hit finder
+      // (the same expressions as the hit finder, so that the results are identical on the grid points)
+      double thickness, normalScale, sNormal, sAlternate;
+      if (element->isVertical()) {
+        crossing.z = element->getZOffset() + element->getZLength() / 2.0;
+        crossing.r = crossing.z * tan(theta);
+        thickness = element->getZLength();
+        normalScale = cos(theta);
+        sAlternate = element->getRWidth() / sin(theta);
+      } else {
+        crossing.r = element->getInnerRadius() + element->getRWidth() / 2.0;
+        crossing.z = crossing.r / tan(theta);
+        thickness = element->getRWidth();
+        normalScale = sin(theta);
+        sAlternate = element->getZLength() / cos(theta);
+      }
+      sNormal = thickness / normalScale;
+      if (sNormal > sAlternate) {
+        crossing.material.radiation = entry->radiationLength / thickness * sAlternate;
+        crossing.material.interaction = entry->interactionLength / thickness * sAlternate;
+      } else {
+        crossing.material.radiation = entry->radiationLength / normalScale;
+        crossing.material.interaction = entry->interactionLength / normalScale;
+      }
+      crossing.distance = (theta == 0) ? crossing.r : (crossing.r / sin(theta));
+      crossings.push_back(crossing);
+    }
+  }
+
+  /**
+   * Nearest-bin lookup of the crossings for the given eta.
+   */
+  const MaterialResponse::Crossings& MaterialResponse::crossings(double eta) const {
+    int bin = findEtaBin(eta);
+    return (bin < 0) ? noCrossings_ : table_[bin];
+  }
+
+  /**
+   * Nearest-bin lookup of the inactive elements of one collection crossed at the given eta.
+   * @param collection The number given by <i>addInactive()</i>
+   * @return The crossed entries, in the order of the collection
+   */
+  const InactiveElementIndex::EntryList& MaterialResponse::crossedEntries(double eta, int collection) const {
+    int bin = findEtaBin(eta);
+    if (bin < 0 || collection < 0 || collection >= int(crossed_[bin].size())) return noEntries_;
+    return crossed_[bin][collection];
+  }
+
+  /**
+   * Total crossed material for the given eta, linearly interpolated between the neighbouring grid points.
+   */
+  Material MaterialResponse::material(double eta) const {
+    Material result;
+    if (totals_.empty()) return result;
+    double position = fabs(eta) / etaStep_;
+    int bin = int(floor(position));
+    if (bin >= int(totals_.size()) - 1) return totals_.back();
+    double fraction = position - bin;
+    result.radiation = totals_[bin].radiation * (1 - fraction) + totals_[bin + 1].radiation * fraction;
+    result.interaction = totals_[bin].interaction * (1 - fraction) + totals_[bin + 1].interaction * fraction;
+    return result;
+  }
+
+  /**
+   * Add to the track one hit per crossing of the nearest grid point, like the <i>Analyzer</i> hit finders do.
+   * @param eta The pseudorapidity of the track
+   * @param t A reference to the track object; its theta and phi should already be set
+   * @return The total crossed material
+   */
+  Material MaterialResponse::fillTrack(double eta, Track& t) const {
+    Material res;
+    for (const Crossing& crossing : crossings(eta)) {
+      Hit* hit;
+      if (crossing.moduleCap) {
+        hit = new Hit(crossing.distance, &(crossing.moduleCap->getModule()), crossing.hitType);
+      } else {
+        hit = new Hit(crossing.distance);
+        if (crossing.element->isVertical()) hit->setOrientation(Hit::Vertical);
+        else hit->setOrientation(Hit::Horizontal);
+        hit->setObjectKind(Hit::Inactive);
+      }
+      hit->setCorrectedMaterial(crossing.material);
+      hit->setPixel(crossing.isPixel);
+      t.addHit(hit);
+      res += crossing.material;
+    }
+    return res;
+  }
+}
@@ -0,0 +1,165 @@
+#include <MemoryMonitor.h>
+#include <messageLogger.h>
+#include <global_constants.h>
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+using insur::csv_separator;
+
+const size_t MemoryMonitor::MaxStages;
+const size_t MemoryMonitor::NotRecorded;
+std::atomic<long> MemoryMonitor::objects_[MemoryMonitor::NumFamilies];
+std::atomic<long> MemoryMonitor::bytes_[MemoryMonitor::NumFamilies];
+std::atomic<long> MemoryMonitor::peakBytes_[MemoryMonitor::NumFamilies];
+
+// Returns the instance, created on first use (thread-safe, as any function-local static)
+MemoryMonitor* MemoryMonitor::instance() {
+  static MemoryMonitor myInstance;
+  return &myInstance;
+}
+
+// Discards all the recorded stages, as if the instance had been just created
+void MemoryMonitor::destroy() {
+  MemoryMonitor* monitor = instance();
+  monitor->stages_.clear();
+  monitor->openStages_.clear();
+  monitor->droppedStages_ = 0;
+}
+
+bool MemoryMonitor::countersEnabled() {
+#ifdef MEMORY_COUNTERS
+  return true;
+#else
+  return false;
+#endif
+}
+
+const char* MemoryMonitor::familyName(Family family) {
+  static const char* names[NumFamilies] = { "Modules", "Hits", "Material elements", "Materialway sections" };
+  return (family >= 0 && family < NumFamilies) ? names[family] : "Unknown";
+}
+
+// Samples the resident set size from /proc and the heap in use from the allocator
+MemoryMonitor::Usage MemoryMonitor::currentUsage() {
+  Usage usage;
+  usage.rss = usage.peakRss = usage.heapInUse = -1;
+  FILE* status = fopen("/proc/self/status", "r");
+  if (status) {
+    char line[256];
+    long kiloBytes;
+    while (fgets(line, sizeof(line), status)) {
+      if (sscanf(line, "VmRSS: %ld kB", &kiloBytes) == 1) usage.rss = kiloBytes * 1024;
+      else if (sscanf(line, "VmHWM: %ld kB", &kiloBytes) == 1) usage.peakRss = kiloBytes * 1024;
+    }
+    fclose(status);
+  }
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+  struct mallinfo2 info = mallinfo2();
+  usage.heapInUse = long(info.uordblks + info.hblkhd);
+#elif defined(__GLIBC__)
+  struct mallinfo info = mallinfo();
+  usage.heapInUse = long((unsigned int)info.uordblks) + long((unsigned int)info.hblkhd);
+#endif
+  return usage;
+}
+
+// Resets the peak resident set size of the process to the current one (Linux 4.0 or later)
+bool MemoryMonitor::resetPeak() {
+  FILE* clearRefs = fopen("/proc/self/clear_refs", "w");
+  if (!clearRefs) return false;
+  bool success = (fputs("5", clearRefs) >= 0);
+  if (fclose(clearRefs) != 0) success = false;
+  return success;
+}
+
+MemoryMonitor::FamilyUsage MemoryMonitor::familyUsage(Family family) {
+  FamilyUsage usage;
+  usage.objects = objects_[family].load(std::memory_order_relaxed);
+  usage.bytes = bytes_[family].load(std::memory_order_relaxed);
+  usage.peakBytes = peakBytes_[family].load(std::memory_order_relaxed);
+  return usage;
+}
+
+void MemoryMonitor::countAllocation(Family family, size_t size) {
+  objects_[family].fetch_add(1, std::memory_order_relaxed);
+  long bytes = bytes_[family].fetch_add(size, std::memory_order_relaxed) + size;
+  long peak = peakBytes_[family].load(std::memory_order_relaxed);
+  while (bytes > peak && !peakBytes_[family].compare_exchange_weak(peak, bytes, std::memory_order_relaxed));
+}
+
+void MemoryMonitor::countDeallocation(Family family, size_t size) {
+  objects_[family].fetch_sub(1, std::memory_order_relaxed);
+  bytes_[family].fetch_sub(size, std::memory_order_relaxed);
+}
+
+// Steps are recorded in the order they start, so that nested steps follow their parent
+void MemoryMonitor::beginStage(const std::string& name) {
+  if (stages_.size() >= MaxStages) {
+    if (!droppedStages_) logWARNING("More than " + std::to_string(MaxStages) + " memory accounting stages: the following ones are not recorded");
+    droppedStages_++;
+    openStages_.push_back(NotRecorded);
+    return;
+  }
+  Stage stage;
+  stage.name = name;
+  stage.depth = openStages_.size() + 1;
+  stage.completed = false;
+  if (stage.depth == 1) resetPeak();
+  stage.before = currentUsage();
+  stage.after = stage.before;
+  memset(stage.families, 0, sizeof(stage.families));
+  openStages_.push_back(stages_.size());
+  stages_.push_back(stage);
+}
+
+void MemoryMonitor::endStage() {
+  if (openStages_.empty()) {
+    logERROR("A memory accounting stage was closed, not corresponding to any opened one");
+    return;
+  }
+  size_t index = openStages_.back();
+  openStages_.pop_back();
+  if (index == NotRecorded) return;
+  Stage& stage = stages_[index];
+  stage.after = currentUsage();
+  for (int family = 0; family < NumFamilies; ++family) stage.families[family] = familyUsage(Family(family));
+  stage.completed = true;
+}
+
+/**
+ * Writes the completed stages as comma-separated values, one line per stage,
+ * with a header line naming the columns; sizes are in bytes
+ */
+void MemoryMonitor::writeTable(std::ostream& out) const {
+  out << "stage" << csv_separator << "depth"
+      << csv_separator << "rss_before" << csv_separator << "rss_after"
+      << csv_separator << "peak_rss" << csv_separator << "heap_before" << csv_separator << "heap_after";
+  if (countersEnabled()) {
+    for (int family = 0; family < NumFamilies; ++family) {
+      std::string name = familyName(Family(family));
+      for (char& c : name) c = (c == ' ') ? '_' : tolower(c);
+      out << csv_separator << name << "_objects" << csv_separator << name << "_bytes" << csv_separator << name << "_peak_bytes";
+    }
+  }
+  out << std::endl;
+  for (const Stage& stage : stages_) {
+    if (!stage.completed) continue;
+    std::string name = stage.name;
+    for (char& c : name) if (c == ',' || c == '"') c = ' ';
+    out << name << csv_separator << stage.depth
+        << csv_separator << stage.before.rss << csv_separator << stage.after.rss
+        << csv_separator << stage.after.peakRss << csv_separator << stage.before.heapInUse << csv_separator << stage.after.heapInUse;
+    if (countersEnabled()) {
+      for (int family = 0; family < NumFamilies; ++family) {
+        out << csv_separator << stage.families[family].objects << csv_separator << stage.families[family].bytes
+            << csv_separator << stage.families[family].peakBytes;
+      }
+    }
+    out << std::endl;
+  }
+}
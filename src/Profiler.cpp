@@ -0,0 +1,233 @@
+#include <Profiler.h>
+#include <messageLogger.h>
+
+#include <algorithm>
+#include <ctime>
+#include <cstdio>
+#include <set>
+
+// Global static pointer used to ensure a single instance of the class
+std::atomic<Profiler*> Profiler::myInstance_(NULL);
+// Identifies the instance the per-thread data was registered with
+std::atomic<unsigned int> Profiler::generation_(0);
+
+namespace {
+  std::mutex instanceMutex;
+
+  // Escapes a string to be used inside a JSON string literal
+  std::string jsonEscape(const std::string& text) {
+    std::string result;
+    result.reserve(text.size());
+    for (char c : text) {
+      switch (c) {
+      case '"': result += "\\\""; break;
+      case '\\': result += "\\\\"; break;
+      case '\n': result += "\\n"; break;
+      case '\t': result += "\\t"; break;
+      default:
+        if ((unsigned char)c < 0x20) {
+          char code[8];
+          snprintf(code, sizeof(code), "\\u%04x", c);
+          result += code;
+        } else result += c;
+      }
+    }
+    return result;
+  }
+}
+
+// Returns the instance (if already present) or creates one if needed
+Profiler* Profiler::instance() {
+  Profiler* result = myInstance_.load();
+  if (!result) {
+    std::lock_guard<std::mutex> lock(instanceMutex);
+    result = myInstance_.load();
+    if (!result) myInstance_.store(result = new Profiler);
+  }
+  return result;
+}
+
+// Destroys the current instance: no zone should be open in any thread
+void Profiler::destroy() {
+  std::lock_guard<std::mutex> lock(instanceMutex);
+  delete myInstance_.exchange(NULL);
+}
+
+Profiler::Profiler() : myGeneration_(++generation_), origin_(std::chrono::steady_clock::now()), maxEvents_(1000000) {}
+
+Profiler::Nanoseconds Profiler::wallClock() const {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin_).count();
+}
+
+Profiler::Nanoseconds Profiler::cpuClock() {
+  timespec now;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) return 0;
+  return Nanoseconds(now.tv_sec) * 1000000000LL + now.tv_nsec;
+}
+
+// Returns the data of the calling thread, registering the thread on its first call
+Profiler::ThreadData& Profiler::threadData() {
+  static thread_local ThreadData* cached = NULL;
+  static thread_local unsigned int cachedGeneration = 0;
+  if (cachedGeneration != myGeneration_) {
+    std::lock_guard<std::mutex> lock(registryMutex_);
+    threads_.emplace_back(new ThreadData);
+    cached = threads_.back().get();
+    cached->id = threads_.size();
+    cached->droppedEvents = 0;
+    Node root;
+    root.parent = -1;
+    root.depth = 0;
+    root.calls = 0;
+    root.wallTime = root.cpuTime = root.childWallTime = 0;
+    cached->nodes.push_back(root);
+    cachedGeneration = myGeneration_;
+  }
+  return *cached;
+}
+
+void Profiler::beginZone(const std::string& name, const std::string& args) {
+  ThreadData& data = threadData();
+  std::lock_guard<std::mutex> lock(data.mutex);
+  int parent = data.stack.empty() ? 0 : data.stack.back().node;
+  std::map<std::string, int>::iterator found = data.nodes[parent].children.find(name);
+  int node;
+  if (found != data.nodes[parent].children.end()) node = found->second;
+  else {
+    node = data.nodes.size();
+    Node newNode;
+    newNode.name = name;
+    newNode.parent = parent;
+    newNode.depth = data.nodes[parent].depth + 1;
+    newNode.calls = 0;
+    newNode.wallTime = newNode.cpuTime = newNode.childWallTime = 0;
+    data.nodes[parent].children[name] = node;
+    data.nodes.push_back(newNode);
+  }
+  OpenZone zone;
+  zone.node = node;
+  zone.args = args;
+  zone.cpuStart = cpuClock();
+  zone.wallStart = wallClock();
+  data.stack.push_back(zone);
+}
+
+Profiler::Sample Profiler::endZone() {
+  Nanoseconds wallStop = wallClock();
+  Nanoseconds cpuStop = cpuClock();
+  Sample result = { 0, 0 };
+  ThreadData& data = threadData();
+  std::lock_guard<std::mutex> lock(data.mutex);
+  if (data.stack.empty()) {
+    logERROR("A profiler zone stop was requested, not corresponding to any zone start");
+    return result;
+  }
+  OpenZone& zone = data.stack.back();
+  Nanoseconds wallTime = wallStop - zone.wallStart;
+  Nanoseconds cpuTime = cpuStop - zone.cpuStart;
+  Node& node = data.nodes[zone.node];
+  node.calls++;
+  node.wallTime += wallTime;
+  node.cpuTime += cpuTime;
+  data.nodes[node.parent].childWallTime += wallTime;
+  if (data.events.size() < maxEvents_) {
+    Event event;
+    event.node = zone.node;
+    event.start = zone.wallStart;
+    event.duration = wallTime;
+    event.args.swap(zone.args);
+    data.events.push_back(event);
+  } else data.droppedEvents++;
+  data.stack.pop_back();
+  result.wallTime = wallTime * 1e-9;
+  result.cpuTime = cpuTime * 1e-9;
+  return result;
+}
+
+// Returns the number of zones currently open in the calling thread
+unsigned int Profiler::openZones() {
+  ThreadData& data = threadData();
+  std::lock_guard<std::mutex> lock(data.mutex);
+  return data.stack.size();
+}
+
+/**
+ * Merges the statistics of all the threads by zone path. The zones
+ * are listed depth-first, in the order they were first entered by the
+ * first thread running them. Zones still open are not included.
+ */
+std::vector<Profiler::ZoneSummary> Profiler::summary() const {
+  std::vector<ZoneSummary> result;
+  std::map<std::string, size_t> byPath;
+  std::vector<std::set<unsigned int> > threadsByZone;
+  std::lock_guard<std::mutex> registryLock(registryMutex_);
+  for (const std::unique_ptr<ThreadData>& data : threads_) {
+    std::lock_guard<std::mutex> lock(data->mutex);
+    std::vector<std::pair<int, std::string> > pending(1, std::make_pair(0, std::string())); // node, path of the parent
+    while (!pending.empty()) {
+      int index = pending.back().first;
+      const Node& node = data->nodes[index];
+      std::string path = pending.back().second.empty() ? node.name : pending.back().second + "/" + node.name;
+      pending.pop_back();
+      // children are visited in order of creation, which is the order they were first entered
+      std::vector<int> children;
+      for (const auto& child : node.children) children.push_back(child.second);
+      std::sort(children.begin(), children.end(), std::greater<int>());
+      for (int child : children) pending.push_back(std::make_pair(child, path));
+      if (node.calls == 0) continue; // the root, or a zone which is still open
+
+      std::map<std::string, size_t>::iterator found = byPath.find(path);
+      if (found == byPath.end()) {
+        ZoneSummary zone;
+        zone.path = path;
+        zone.name = node.name;
+        zone.depth = node.depth;
+        zone.calls = 0;
+        zone.wallTime = zone.cpuTime = zone.selfWallTime = 0;
+        zone.threads = 0;
+        found = byPath.insert(std::make_pair(path, result.size())).first;
+        result.push_back(zone);
+        threadsByZone.push_back(std::set<unsigned int>());
+      }
+      ZoneSummary& zone = result[found->second];
+      zone.calls += node.calls;
+      zone.wallTime += node.wallTime * 1e-9;
+      zone.cpuTime += node.cpuTime * 1e-9;
+      zone.selfWallTime += (node.wallTime - node.childWallTime) * 1e-9;
+      threadsByZone[found->second].insert(data->id);
+      zone.threads = threadsByZone[found->second].size();
+    }
+  }
+  return result;
+}
+
+/**
+ * Writes the completed zone occurrences in the Chrome trace-event format,
+ * one complete ("X") event per occurrence, with times in microseconds
+ * from the creation of the profiler.
+ */
+void Profiler::writeChromeTrace(std::ostream& out) const {
+  std::lock_guard<std::mutex> registryLock(registryMutex_);
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  char times[64];
+  for (const std::unique_ptr<ThreadData>& data : threads_) {
+    std::lock_guard<std::mutex> lock(data->mutex);
+    out << (first ? "\n" : ",\n");
+    first = false;
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << data->id
+        << ",\"args\":{\"name\":\"" << (data->id == 1 ? "main" : "worker " + std::to_string(data->id - 1)) << "\"}}";
+    for (const Event& event : data->events) {
+      snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f", event.start * 1e-3, event.duration * 1e-3);
+      out << ",\n{\"name\":\"" << jsonEscape(data->nodes[event.node].name) << "\",\"cat\":\"tklayout\",\"ph\":\"X\","
+          << times << ",\"pid\":1,\"tid\":" << data->id;
+      if (!event.args.empty()) out << ",\"args\":{\"detail\":\"" << jsonEscape(event.args) << "\"}";
+      out << "}";
+    }
+    if (data->droppedEvents) {
+      logWARNING("The profiler trace of thread " + std::to_string(data->id) + " is missing "
+                 + std::to_string(data->droppedEvents) + " zone occurrences over the maximum of " + std::to_string(maxEvents_));
+    }
+  }
+  out << "\n]}\n";
+}
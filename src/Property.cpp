@@ -5,6 +5,7 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <unordered_map>
 
 #include "global_funcs.h"
 #include "Property.h"
@@ -14,5 +15,95 @@
 std::function<int()> noDefault() { return [](){ throw std::logic_error("Tried to get value from an unset property"); return 0; }; }
 std::function<bool()> cacheIf(const bool& flag) { return [&flag]() { return flag; }; }
 
-std::set<string> PropertyObject::globalMatchedProperties_;
-std::set<string> PropertyObject::globalUnmatchedProperties_;
+namespace {
+  // All the compiled schemas, by class
+  std::map<std::type_index, vector<std::unique_ptr<PropertySchema> > >& schemaRegistry() {
+    static std::map<std::type_index, vector<std::unique_ptr<PropertySchema> > > registry;
+    return registry;
+  }
+
+  // Ids of the tree keys found unmatched by some object
+  std::unordered_map<string, int>& unmatchedNameIds() {
+    static std::unordered_map<string, int> ids;
+    return ids;
+  }
+  vector<string>& unmatchedNames() {
+    static vector<string> names;
+    return names;
+  }
+}
+
+PropertySchema::PropertySchema(const std::type_info& type, const PropertyMap& parsedChecked, const PropertyMap& parsed, const PropertyMap& checked) :
+    type_(type), seed_(0), used_(false) {
+  const PropertyMap* maps[] = { &parsedChecked, &parsed, &checked };
+  for (int k = 0; k < 3; k++) {
+    sizes_[k] = maps[k]->size();
+    for (auto& propElem : *maps[k]) names_.push_back(propElem.first);
+  }
+
+  // Looks for a seed with no collisions, in a table at least twice as large as the number of names
+  size_t numBuckets = 8;
+  while (numBuckets < 2*names_.size()) numBuckets *= 2;
+  for (bool collision = true; collision; ) {
+    for (int tries = 0; tries < 256 && collision; tries++) {
+      seed_++;
+      buckets_.assign(numBuckets, -1);
+      collision = false;
+      for (int i = 0; i < int(names_.size()) && !collision; i++) {
+        int& bucket = buckets_[hash(names_[i], seed_) & (numBuckets - 1)];
+        if (bucket < 0) bucket = i;
+        else collision = names_[bucket] != names_[i]; // a name registered twice keeps its first slot
+      }
+    }
+    numBuckets *= 2;
+  }
+}
+
+bool PropertySchema::registers(const PropertyMap& parsedChecked, const PropertyMap& parsed, const PropertyMap& checked) const {
+  if (sizes_[ParsedAndChecked] != parsedChecked.size() || sizes_[ParsedOnly] != parsed.size() || sizes_[CheckedOnly] != checked.size()) return false;
+  auto name = names_.begin();
+  for (const PropertyMap* map : { &parsedChecked, &parsed, &checked }) {
+    for (auto& propElem : *map) {
+      if (propElem.first != *name++) return false;
+    }
+  }
+  return true;
+}
+
+const PropertySchema& PropertySchema::get(const std::type_info& type, const PropertyMap& parsedChecked, const PropertyMap& parsed, const PropertyMap& checked) {
+  auto& classSchemas = schemaRegistry()[std::type_index(type)];
+  for (auto& schema : classSchemas) {
+    if (schema->registers(parsedChecked, parsed, checked)) return *schema;
+  }
+  classSchemas.emplace_back(new PropertySchema(type, parsedChecked, parsed, checked));
+  return *classSchemas.back();
+}
+
+void PropertySchema::recordUnmatched(const string& name) const {
+  auto id = unmatchedNameIds().insert(std::make_pair(name, int(unmatchedNames().size())));
+  if (id.second) unmatchedNames().push_back(name);
+  if (int(unmatched_.size()) <= id.first->second) unmatched_.resize(unmatchedNames().size());
+  unmatched_[id.first->second] = true;
+}
+
+/**
+ * Lists the tree keys left unmatched by some object, which are not the name
+ * of a property of any class that stored a tree
+ */
+std::set<string> PropertySchema::reportUnmatched() {
+  vector<bool> unmatched(unmatchedNames().size());
+  std::set<string> matched;
+  for (auto& classSchemas : schemaRegistry()) {
+    for (auto& schema : classSchemas.second) {
+      for (size_t i = 0; i < schema->unmatched_.size(); i++) {
+        if (schema->unmatched_[i]) unmatched[i] = true;
+      }
+      if (schema->used_) matched.insert(schema->names_.begin(), schema->names_.end());
+    }
+  }
+  std::set<string> report;
+  for (size_t i = 0; i < unmatched.size(); i++) {
+    if (unmatched[i] && !matched.count(unmatchedNames()[i])) report.insert(unmatchedNames()[i]);
+  }
+  return report;
+}
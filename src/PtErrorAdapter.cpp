@@ -1,8 +1,5 @@
 #include "PtErrorAdapter.h"
 
-const double PtErrorAdapter::minimumPt = 0.3;
-const double PtErrorAdapter::maximumPt = 30;
-
 const double PtErrorAdapter::ptMinFit = 0.22;
 const double PtErrorAdapter::ptMaxFit = 10.;
 // log(pt/z) distribution parameters for 12000 events at 14 TeV
@@ -143,45 +140,7 @@ double PtErrorAdapter::pToStrips(double p) const {
 } 
 
 double PtErrorAdapter::find_probability(double target, double ptCut) {
-
-  double lowerPt = minimumPt;
-  double higherPt = maximumPt;
-
-  double lowerProbability =  mod_.geometricEfficiency() * myPtError.probabilityInside(1/ptCut, 1/lowerPt, myPtError.computeError(lowerPt)/lowerPt);
-  double higerProbability =  mod_.geometricEfficiency() * myPtError.probabilityInside(1/ptCut, 1/higherPt, myPtError.computeError(higherPt)/higherPt);
-
-  double testPt;
-  double testProbability;
-
-  //std::cerr << "LO: prob("<<lowerPt<<") = " << lowerProbability << std::endl;
-  //std::cerr << "HI: prob("<<higherPt<<") = " << higerProbability << std::endl;
-
-  if ((target<lowerProbability)||(target>higerProbability)) return -1; // probability not reachable within desired pt range
-
-  for (int i=0; i<100; ++i) {
-    //std::cerr << std::endl;
-    //std::cerr << std::endl;
-    //std::cerr << std::endl;
-    //std::cerr << "****** STEP # " << i << "*********" << std::endl;
-    testPt = sqrt(lowerPt*higherPt);
-    testProbability = mod_.geometricEfficiency() * myPtError.probabilityInside(1/ptCut, 1/testPt, myPtError.computeError(testPt)/testPt);
-    //std::cerr << "Geometric efficiency is " << geometricEfficiency() << std::endl;
-    //std::cerr << "LO: prob("<<lowerPt<<") = " << lowerProbability << std::endl;
-    //std::cerr << "HI: prob("<<higherPt<<") = " << higerProbability << std::endl;
-    //std::cerr << "XX: prob("<<testPt<<") = " << testProbability << std::endl;
-
-    if (testProbability>target) {
-      higherPt = testPt;
-      // higerProbability = testProbability; // debug
-    } else {
-      lowerPt = testPt;
-      // lowerProbability = testProbability; // debug
-    }
-
-    if (fabs(testProbability-target)<1E-5) return (testPt);
-  }
-
-  return -1; // could not converge
+  return myPtError.findProbability(target, ptCut, mod_.geometricEfficiency());
 }
 
 double PtErrorAdapter::getPtCut() const {
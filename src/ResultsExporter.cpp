@@ -0,0 +1,227 @@
+#include "ResultsExporter.h"
+
+#include <cmath>
+#include <cstring>
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include "Tracker.h"
+#include "SimParms.h"
+#include "DetectorModule.h"
+#include "ModuleCap.h"
+#include "PtErrorAdapter.h"
+#include "Visitor.h"
+#include "global_constants.h"
+#include "hit.hh"
+#include "messageLogger.h"
+
+namespace {
+  // Copies a string into a fixed-size text column, truncating it if needed
+  template<size_t N> void setText(Char_t (&column)[N], const std::string& text) {
+    strncpy(column, text.c_str(), N - 1);
+    column[N - 1] = '\0';
+  }
+}
+
+ResultsExporter::ResultsExporter() : file_(nullptr), modules_(nullptr), materialTracks_(nullptr), resolutionTracks_(nullptr) {}
+
+ResultsExporter::~ResultsExporter() {
+  close();
+}
+
+/**
+ * Creates the output file (overwriting it) and its empty trees
+ * @return false if the file could not be created
+ */
+bool ResultsExporter::open(const std::string& fileName) {
+  close();
+  // The trees belong to the file: the current ROOT directory is put back so
+  // that the histograms made elsewhere do not end up in it
+  TDirectory* currentDirectory = gDirectory;
+  file_ = TFile::Open(fileName.c_str(), "RECREATE");
+  if (!file_ || file_->IsZombie()) {
+    logERROR("Could not create the results file " + fileName);
+    delete file_;
+    file_ = nullptr;
+    if (currentDirectory) currentDirectory->cd();
+    return false;
+  }
+  createTrees();
+  if (currentDirectory) currentDirectory->cd();
+  return true;
+}
+
+void ResultsExporter::createTrees() {
+  modules_ = new TTree("modules", "One row per module");
+  modules_->SetDirectory(file_);
+  modules_->Branch("detector", module_.detector, "detector/C");
+  modules_->Branch("section", module_.section, "section/C");
+  modules_->Branch("layer", &module_.layer, "layer/I");
+  modules_->Branch("ring", &module_.ring, "ring/I");
+  modules_->Branch("phiIndex", &module_.phiIndex, "phiIndex/I");
+  modules_->Branch("side", &module_.side, "side/I");
+  modules_->Branch("r", &module_.r, "r/D");
+  modules_->Branch("z", &module_.z, "z/D");
+  modules_->Branch("phi", &module_.phi, "phi/D");
+  modules_->Branch("type", module_.type, "type/C");
+  modules_->Branch("irradiationPower", &module_.irradiationPower, "irradiationPower/D");
+  modules_->Branch("hitChannels", &module_.hitChannels, "hitChannels/D");
+  modules_->Branch("trueStubs", &module_.trueStubs, "trueStubs/D");
+  modules_->Branch("fakeStubs", &module_.fakeStubs, "fakeStubs/D");
+  modules_->Branch("bandwidth", &module_.bandwidth, "bandwidth/D");
+  modules_->Branch("sparsifiedBandwidth", &module_.sparsifiedBandwidth, "sparsifiedBandwidth/D");
+  modules_->Branch("radiationLength", &module_.radiationLength, "radiationLength/D");
+  modules_->Branch("interactionLength", &module_.interactionLength, "interactionLength/D");
+
+  materialTracks_ = new TTree("materialTracks", "One row per track of the material budget scan");
+  materialTracks_->SetDirectory(file_);
+  materialTracks_->Branch("detector", materialTrack_.detector, "detector/C");
+  materialTracks_->Branch("eta", &materialTrack_.eta, "eta/D");
+  materialTracks_->Branch("phi", &materialTrack_.phi, "phi/D");
+  materialTracks_->Branch("radiationLength", &materialTrack_.radiationLength, "radiationLength/D");
+  materialTracks_->Branch("interactionLength", &materialTrack_.interactionLength, "interactionLength/D");
+
+  resolutionTracks_ = new TTree("resolutionTracks", "One row per track and momentum of the resolution scan");
+  resolutionTracks_->SetDirectory(file_);
+  resolutionTracks_->Branch("detector", resolutionTrack_.detector, "detector/C");
+  resolutionTracks_->Branch("tag", resolutionTrack_.tag, "tag/C");
+  resolutionTracks_->Branch("constantP", &resolutionTrack_.constantP, "constantP/O");
+  resolutionTracks_->Branch("ideal", &resolutionTrack_.ideal, "ideal/O");
+  resolutionTracks_->Branch("pt", &resolutionTrack_.pt, "pt/D");
+  resolutionTracks_->Branch("p", &resolutionTrack_.p, "p/D");
+  resolutionTracks_->Branch("eta", &resolutionTrack_.eta, "eta/D");
+  resolutionTracks_->Branch("phi", &resolutionTrack_.phi, "phi/D");
+  resolutionTracks_->Branch("deltaPtOverPt", &resolutionTrack_.deltaPtOverPt, "deltaPtOverPt/D");
+  resolutionTracks_->Branch("deltaPOverP", &resolutionTrack_.deltaPOverP, "deltaPOverP/D");
+  resolutionTracks_->Branch("deltaD0", &resolutionTrack_.deltaD0, "deltaD0/D");
+  resolutionTracks_->Branch("deltaZ0", &resolutionTrack_.deltaZ0, "deltaZ0/D");
+  resolutionTracks_->Branch("deltaPhi", &resolutionTrack_.deltaPhi, "deltaPhi/D");
+  resolutionTracks_->Branch("deltaCtgTheta", &resolutionTrack_.deltaCtgTheta, "deltaCtgTheta/D");
+  resolutionTracks_->Branch("radiationLength", &resolutionTrack_.radiationLength, "radiationLength/D");
+  resolutionTracks_->Branch("interactionLength", &resolutionTrack_.interactionLength, "interactionLength/D");
+  resolutionTracks_->Branch("activeHits", &resolutionTrack_.activeHits, "activeHits/I");
+}
+
+/**
+ * Fills one row per module of the tracker. The irradiated power and the
+ * material are the ones of the last power and material analyses, if any.
+ * @param detector the name of the tracker in the rows ("outer", "pixel")
+ */
+void ResultsExporter::fillModules(Tracker& tracker, const SimParms& simParms, const std::string& detector) {
+  if (!modules_) return;
+
+  class ModuleRowVisitor : public GeometryVisitor {
+    ModuleRow& row_;
+    TTree& tree_;
+    double nMB_, interestingPt_;
+  public:
+    ModuleRowVisitor(ModuleRow& row, TTree& tree, const SimParms& simParms) :
+        row_(row), tree_(tree), nMB_(simParms.numMinBiasEvents()), interestingPt_(simParms.triggerPtCut()) {}
+
+    void visit(DetectorModule& m) {
+      UniRef ref = m.uniRef();
+      setText(row_.section, ref.cnt);
+      row_.layer = ref.layer;
+      row_.ring = ref.ring;
+      row_.phiIndex = ref.phi;
+      row_.side = ref.side;
+      row_.r = m.center().Rho();
+      row_.z = m.center().Z();
+      row_.phi = m.center().Phi();
+      setText(row_.type, m.moduleType());
+      row_.irradiationPower = m.irradiationPower();
+
+      // Same rates and bandwidths as the trigger frequency and bandwidth analyses
+      row_.hitChannels = row_.bandwidth = row_.sparsifiedBandwidth = 0;
+      bool strips = m.sensors().back().type() == SensorType::Strip;
+      for (const auto& s : m.sensors()) {
+        double hitChannels = m.hitOccupancyPerEvent() * nMB_ * s.numChannels();
+        row_.hitChannels += hitChannels;
+        if (strips) {
+          int nChips = s.totalROCs();
+          row_.bandwidth += (16*nChips + s.numChannels())*100E3;
+          row_.sparsifiedBandwidth += ((m.numSparsifiedHeaderBits()*nChips)+(hitChannels*m.numSparsifiedPayloadBits()))*100E3;
+        }
+      }
+      row_.trueStubs = row_.fakeStubs = 0;
+      if (m.dsDistance() != 0.0) {
+        PtErrorAdapter pterr(m);
+        row_.trueStubs = pterr.getTriggerFrequencyTruePerEventAbove(interestingPt_)*nMB_;
+        row_.fakeStubs = pterr.getTriggerFrequencyTruePerEventBelow(interestingPt_)*nMB_ + pterr.getTriggerFrequencyFakePerEvent()*pow(nMB_, 2);
+      }
+
+      ModuleCap* cap = m.getModuleCap();
+      row_.radiationLength = cap ? cap->getRadiationLength() : -1;
+      row_.interactionLength = cap ? cap->getInteractionLength() : -1;
+
+      tree_.Fill();
+    }
+  };
+
+  setText(module_.detector, detector);
+  ModuleRowVisitor v(module_, *modules_, simParms);
+  tracker.accept(v);
+}
+
+/**
+ * Fills the row of a track of the material budget scan, with the material
+ * of all the hits it has collected so far
+ */
+void ResultsExporter::fillMaterialTrack(Track& track, const std::string& detector) {
+  if (!materialTracks_) return;
+  setText(materialTrack_.detector, detector);
+  materialTrack_.eta = track.getEta();
+  materialTrack_.phi = track.getPhi();
+  RILength material = track.getCorrectedMaterial();
+  materialTrack_.radiationLength = material.radiation;
+  materialTrack_.interactionLength = material.interaction;
+  materialTracks_->Fill();
+}
+
+/**
+ * Fills the row of a track of the resolution scan, once its errors have been computed
+ * @param constantP true if the momentum, rather than the transverse momentum, is fixed across eta
+ * @param ideal true for the track without material
+ */
+void ResultsExporter::fillResolutionTrack(Track& track, const std::string& detector, const std::string& tag, bool constantP, bool ideal) {
+  if (!resolutionTracks_) return;
+  setText(resolutionTrack_.detector, detector);
+  setText(resolutionTrack_.tag, tag);
+  resolutionTrack_.constantP = constantP;
+  resolutionTrack_.ideal = ideal;
+  resolutionTrack_.pt = track.getTransverseMomentum();
+  resolutionTrack_.p = track.getTransverseMomentum() / sin(track.getTheta());
+  resolutionTrack_.eta = track.getEta();
+  resolutionTrack_.phi = track.getPhi();
+  double R = track.getTransverseMomentum() / insur::magnetic_field / 0.3 * 1E3; // radius in mm
+  resolutionTrack_.deltaPtOverPt = track.getDeltaRho() * R;
+  resolutionTrack_.deltaPOverP = track.getDeltaP();
+  resolutionTrack_.deltaD0 = track.getDeltaD();
+  resolutionTrack_.deltaZ0 = track.getDeltaZ0();
+  resolutionTrack_.deltaPhi = track.getDeltaPhi();
+  resolutionTrack_.deltaCtgTheta = track.getDeltaCtgTheta();
+  RILength material = track.getCorrectedMaterial();
+  resolutionTrack_.radiationLength = material.radiation;
+  resolutionTrack_.interactionLength = material.interaction;
+  resolutionTrack_.activeHits = track.nActiveHits(true);
+  resolutionTracks_->Fill();
+}
+
+/**
+ * Writes the remaining baskets and the tree headers, and closes the file
+ * @return false if nothing was open or the file could not be written
+ */
+bool ResultsExporter::close() {
+  if (!file_) return false;
+  TDirectory* currentDirectory = gDirectory == file_ ? nullptr : gDirectory;
+  file_->cd();
+  bool written = modules_->Write() > 0 && materialTracks_->Write() > 0 && resolutionTracks_->Write() > 0;
+  file_->Close(); // deletes the trees
+  delete file_;
+  file_ = nullptr;
+  modules_ = materialTracks_ = resolutionTracks_ = nullptr;
+  if (currentDirectory) currentDirectory->cd();
+  if (!written) logERROR("Could not write the results file");
+  return written;
+}
@@ -7,6 +7,9 @@
 #include "SvnRevision.h"
 #include "Squid.h"
 #include "StopWatch.h"
+#include "TrackShooter.h"
+#include "InfoParser.h"
+#include "AnalysisServer.h"
 
 namespace insur {
   // public
@@ -16,8 +19,8 @@ namespace insur {
   Squid::Squid() :
       mainConfiguration(mainConfigHandler::instance()),
       t2c(mainConfiguration),
-      weightDistributionTracker(0.1),
-      weightDistributionPixel(0.1) {
+      weightDistributionTracker(10.), // mm, the scale of the service routing
+      weightDistributionPixel(10.) {
     tr = NULL;
     is = NULL;
     mb = NULL;
@@ -76,10 +79,11 @@ namespace insur {
     mainConfig.standardInclude=false;
     mainConfig.webOutput = webOutput;
     mainConfiguration.preprocessConfiguration(mainConfig);
-    t2c.addConfigFile(tk2CMSSW::ConfigFile{getGeometryFile(), ss.str()});
+    std::string config = ss.str();
+    t2c.addConfigFile(tk2CMSSW::ConfigFile{getGeometryFile(), config});
     using namespace boost::property_tree;
     ptree pt;
-    info_parser::read_info(ss, pt);
+    readInfo(config, pt);
 
     /*
     class CoordExportVisitor : public ConstGeometryVisitor {
@@ -415,8 +419,14 @@ namespace insur {
     }
     string layoutDirectory;
     //styleDirectory=mainConfiguration.getStyleDirectory();
-    layoutDirectory=mainConfiguration.getLayoutDirectory();
-    layoutDirectory+="/"+trackerName;
+    // an absolute html directory is used as it is, outside of the layout directory, and is not the title
+    if (htmlDir_ != "" && htmlDir_[0] == '/') {
+      layoutDirectory = htmlDir_;
+      trackerName = tr ? baseName_ : default_trackername;
+    } else {
+      layoutDirectory=mainConfiguration.getLayoutDirectory();
+      layoutDirectory+="/"+trackerName;
+    }
     if (layoutDirectory!="") site.setTargetDirectory(layoutDirectory);
     else return false;
     site.setTitle(trackerName);
@@ -428,9 +438,18 @@ namespace insur {
     site.addAuthor("Stefano Mersi");
     site.addAuthor("Gabrielle Hugo");
     site.setRevision(SvnRevision::revisionNumber);
+    sitePrepared = true;
     return true;
   }
 
+  /**
+   * Renders the report pages made so far: their plots are written to the
+   * website directory and freed now, instead of all together in makeSite()
+   */
+  void Squid::renderPages() {
+    if (prepareWebsite()) site.renderPages();
+  }
+
 
   /**
    * Actually creates the website where it was supposed to be
@@ -544,6 +563,7 @@ namespace insur {
       startTaskClock("Creating geometry report");
       v.geometrySummary(a, *tr, *simParms_, is, site, debugResolution);
       if (px) v.geometrySummary(pixelAnalyzer, *px, *simParms_, pi, site, debugResolution, "pixel");
+      renderPages();
       stopTaskClock();
       return true;
     } else {
@@ -560,6 +580,7 @@ namespace insur {
       stopTaskClock();
       startTaskClock("Creating bandwidth and rates report");
       v.bandwidthSummary(a, *tr, *simParms_, site);
+      renderPages();
       stopTaskClock();
       return true;
     } else {
@@ -573,6 +594,7 @@ namespace insur {
       startTaskClock("Computing multiple trigger tower connections");
       a.computeTriggerProcessorsBandwidth(*tr);
       v.triggerProcessorsSummary(a, *tr, site);
+      renderPages();
       stopTaskClock();
       return true;
     } else {
@@ -589,6 +611,7 @@ namespace insur {
       stopTaskClock();
       startTaskClock("Creating power report");
       v.irradiatedPowerSummary(a, *tr, site);
+      renderPages();
       stopTaskClock();
       return true;
     } else {
@@ -608,6 +631,7 @@ namespace insur {
       if (pm) v.histogramSummary(pixelAnalyzer, *pm, debugServices, site, "pixel");
       v.weigthSummart(a, weightDistributionTracker, site, "outer");
       if (pm) v.weigthSummart(pixelAnalyzer, weightDistributionPixel, site, "pixel");
+      renderPages();
       stopTaskClock();
       return true;
     }
@@ -631,6 +655,7 @@ namespace insur {
       v.taggedErrorSummary(a, site);
       v.taggedErrorSummary(pixelAnalyzer, site);
 #endif
+      renderPages();
       stopTaskClock();
       return true;
     }
@@ -648,6 +673,7 @@ namespace insur {
   bool Squid::reportTriggerPerformanceSite(bool extended) {
     startTaskClock("Creating trigger summary report");
     if (v.triggerSummary(a, *tr, site, extended)) {
+      renderPages();
       stopTaskClock();
       return true;
     } else {
@@ -657,8 +683,10 @@ namespace insur {
   }
 
   bool Squid::reportNeighbourGraphSite() {
-    if (v.neighbourGraphSummary(*is, site)) return true;
-    else {
+    if (v.neighbourGraphSummary(*is, site)) {
+      renderPages();
+      return true;
+    } else {
       logERROR(err_no_inacsurf);
       return false;
     }
@@ -672,6 +700,7 @@ namespace insur {
       startTaskClock("Saving additional information");
       v.additionalInfoSite(getSettingsFile(),
                            a, pixelAnalyzer, *tr, *simParms_, site);
+      renderPages();
       stopTaskClock();
       return true;
     }
@@ -692,6 +721,66 @@ namespace insur {
     htmlDir_ = htmlDir;
   }
 
+  /**
+   * Creates the file of the columnar results: from now on, the tracks of
+   * the material and resolution analyses are written to it as they are made
+   * @param fileName the name of the ROOT file to be (re)created
+   * @return True if the file could be created, false otherwise
+   */
+  bool Squid::openResultsFile(std::string fileName) {
+    if (!resultsExporter_.open(fileName)) return false;
+    a.setResultsExporter(&resultsExporter_, "outer");
+    pixelAnalyzer.setResultsExporter(&resultsExporter_, "pixel");
+    return true;
+  }
+
+  /**
+   * Adds the module rows to the file of the columnar results, with the
+   * outcome of the analyses run so far, and closes it
+   * @return True if there were no errors during processing, false otherwise
+   */
+  bool Squid::exportResults() {
+    if (!resultsExporter_.isOpen()) {
+      logERROR("The results file was not opened");
+      return false;
+    }
+    if (!tr) {
+      logERROR(err_no_tracker);
+      return false;
+    }
+    startTaskClock("Exporting the results");
+    resultsExporter_.fillModules(*tr, *simParms_, "outer");
+    if (px) resultsExporter_.fillModules(*px, *simParms_, "pixel");
+    a.setResultsExporter(nullptr, "");
+    pixelAnalyzer.setResultsExporter(nullptr, "");
+    bool result = resultsExporter_.close();
+    stopTaskClock();
+    return result;
+  }
+
+
+  /**
+   * Keeps the tracker and its material budget in memory and answers the
+   * queries of the AnalysisServer protocol on a UNIX socket, until a client
+   * asks for a shutdown. The material budget must have been created.
+   * @param socketPath the file name of the socket
+   * @return True if the server could run, false otherwise
+   */
+  bool Squid::serve(std::string socketPath) {
+    if (!tr) {
+      logERROR(err_no_tracker);
+      return false;
+    }
+    if (!mb) {
+      logERROR(err_no_matbudget);
+      return false;
+    }
+    startTaskClock("Computing dissipated power");
+    a.computeIrradiatedPowerConsumption(*tr);
+    stopTaskClock();
+    AnalysisServer server(*tr, *simParms_, a, *mb, pm);
+    return server.run(socketPath);
+  }
 
   std::string Squid::getGeometryFile() { 
     if (myGeometryFile_ == "") {
@@ -707,23 +796,38 @@ namespace insur {
     return mySettingsFile_;
   }
 
-  void Squid::simulateTracks(const po::variables_map& varmap, int seed) { // CUIDADO not ported to coderev -- yet?
+  /**
+   * Simulates events of tracks through the modules of the outer tracker and
+   * writes their hits to a ROOT file, on as many threads as requested
+   * @param varmap the track simulation options
+   * @return True if there were no errors during processing, false otherwise
+   */
+  bool Squid::simulateTracks(const po::variables_map& varmap, int seed) {
+    if (!tr) {
+      logERROR(err_no_tracker);
+      return false;
+    }
     startTaskClock("Shooting particles");
-/*    TrackShooter ts;
-    //std::ofstream ofs((outputfile + "." + any2str(getpid())).c_str());
-    //ofs.rdbuf()->pubsetbuf(&(std::vector<char>(32768)[0]), 32768);
-    //std::nounitbuf(ofs);
-    ts.setOutput(std::cout);
-    ts.setTrackerBoundaries(tr->getMaxR(), tr->getMaxBarrelZ(-1), tr->getMaxBarrelZ(+1));
-    for (std::vector<Layer*>::const_iterator lit = tr->getLayers().begin(); lit != tr->getLayers().end(); ++lit) {
-      ModuleVector* mods = (*lit)->getModuleVector();
-      for (ModuleVector::const_iterator mit = mods->begin(); mit != mods->end(); ++mit) {
-        ts.addModule(*mit);
-      }
+    TrackShooter ts;
+    double barrelMinZ = 0, barrelMaxZ = 0;
+    for (const auto& b : tr->barrels()) {
+      barrelMinZ = MIN(barrelMinZ, b.minZ());
+      barrelMaxZ = MAX(barrelMaxZ, b.maxZ());
     }
+    ts.setTrackerBoundaries(tr->maxR(), barrelMinZ, barrelMaxZ);
+
+    class ModuleCollector : public GeometryVisitor {
+      TrackShooter& ts_;
+    public:
+      ModuleCollector(TrackShooter& ts) : ts_(ts) {}
+      void visit(DetectorModule& m) { ts_.addModule(&m); }
+    };
+    ModuleCollector collector(ts);
+    tr->accept(collector);
 
-    ts.shootTracks(varmap, seed);*/
+    bool result = ts.shootTracks(varmap, seed);
     stopTaskClock();
+    return result;
   }
 
   void Squid::setCommandLine(int argc, char* argv[]) {
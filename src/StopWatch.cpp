@@ -25,6 +25,7 @@ void StopWatch::setVerbosity(unsigned int newVerbosity, bool newPerformance) {
 
 /* Object constructor */
 StopWatch::StopWatch() {
+  openCounters_ = 0;
   lastVerbosity_ = 0;
   verbosity_ = 1000;
   reportTime_ = true;
@@ -36,27 +37,30 @@ StopWatch::~StopWatch() {
 } 
 
 void StopWatch::startCounter(std::string message) {
-  startTimes_.push_back(clock());
-  if (startTimes_.size()<=verbosity_) {
+  Profiler::instance()->beginZone(message);
+  MemoryMonitor::instance()->beginStage(message);
+  openCounters_++;
+  if (openCounters_<=verbosity_) {
     std::cout << std::endl;
-    for (unsigned int i=1; i<startTimes_.size(); ++i) std::cout << "  ";
+    for (unsigned int i=1; i<openCounters_; ++i) std::cout << "  ";
     std::cout << message << " ... " << std::flush;
   }
 }
 
+// Returns the wall-clock time in s since the matching start
 double StopWatch::stopCounter() {
   double timeSeconds;
-  if (startTimes_.size()) {
-    clock_t stopTime = clock();
-    clock_t startTime = startTimes_.back();
-    startTimes_.pop_back();
-    timeSeconds = diffClock(stopTime, startTime);
-    if (startTimes_.size()<verbosity_) {
-      if (startTimes_.size()<lastVerbosity_) std::cout << std::endl;
+  if (openCounters_) {
+    Profiler::Sample elapsed = Profiler::instance()->endZone();
+    MemoryMonitor::instance()->endStage();
+    openCounters_--;
+    timeSeconds = elapsed.wallTime;
+    if (openCounters_<verbosity_) {
+      if (openCounters_<lastVerbosity_) std::cout << std::endl;
       std::cout << "done" ;
-      if (reportTime_) std::cout << " [in " << timeSeconds << " s]";
+      if (reportTime_) std::cout << " [in " << elapsed.wallTime << " s, CPU " << elapsed.cpuTime << " s]";
       std::cout << std::flush;
-      lastVerbosity_=startTimes_.size();
+      lastVerbosity_=openCounters_;
     }
   } else {
     timeSeconds = 0;
@@ -66,15 +70,7 @@ double StopWatch::stopCounter() {
 }
 
 void StopWatch::addInfo(std::string message) {
-  if (startTimes_.size()<=verbosity_) {
+  if (openCounters_<=verbosity_) {
     std::cout << message << " " << std::flush;
   }
 }
-
-/* Returns the difference between start and stop time in s */
-double StopWatch::diffClock(const clock_t& stopTime, const clock_t& startTime) {
-  double diffticks=stopTime-startTime;
-  double diffs=(diffticks)/CLOCKS_PER_SEC;
-  return diffs;
-}
-
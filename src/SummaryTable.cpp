@@ -1,26 +1,67 @@
 #include "SummaryTable.h"
 
-template<> void SummaryTable::setCell<std::string>(const int row, const int column, const std::string& content) {
-  if (column > 0 && !hasCell(0, column)) summaryTable[std::make_pair(0, column)] = any2str(column + columnOffset_);
-  if (row > 0 && !hasCell(row, 0)) summaryTable[std::make_pair(row, 0)] = any2str(row + rowOffset_);
-  summaryTable[std::make_pair(row, column)]=content;
+#include <cstdio>
+
+// Same text as any2str() with the given precision, without going through a stream
+std::string SummaryTable::Cell::format(int precision) const {
+  char buffer[64];
+  switch (type_) {
+  case Integer:
+    snprintf(buffer, sizeof(buffer), "%lld", integer_);
+    return buffer;
+  case Real:
+    if (precision > -1) {
+      int length = snprintf(buffer, sizeof(buffer), "%.*f", precision, real_);
+      if (length >= int(sizeof(buffer))) return any2str(real_, precision);
+    } else {
+      snprintf(buffer, sizeof(buffer), "%g", real_);
+    }
+    return buffer;
+  case Text:
+    return text_;
+  default:
+    return std::string();
+  }
+}
+
+SummaryTable::Cell& SummaryTable::cell(int row, int column) {
+  if (row >= int(cells_.size())) cells_.resize(row + 1);
+  std::vector<Cell>& cellRow = cells_[row];
+  if (column >= int(cellRow.size())) cellRow.resize(column + 1);
+  return cellRow[column];
+}
+
+void SummaryTable::putCell(const int row, const int column, const Cell& content) {
+  if (column > 0 && !hasCell(0, column)) cell(0, column).set(column + columnOffset_);
+  if (row > 0 && !hasCell(row, 0)) cell(row, 0).set(row + rowOffset_);
+  cell(row, column) = content;
   numRows_ = row+1 > numRows_ ? row+1 : numRows_;
   numColumns_ = column+1 > numColumns_ ? column+1 : numColumns_;
 }
 
-template<> void SummaryTable::setSummaryCell<std::string>(std::string label, const std::string& content) {
+void SummaryTable::putSummaryCell(const std::string& label, const Cell& content) {
   if (!hasSummaryCell()) {
     if (numRows_ > 2 && numColumns_ > 2) {
-      summaryLabelPosition_ = std::make_pair(numRows_, 0); 
+      summaryLabelPosition_ = std::make_pair(numRows_, 0);
       summaryCellPosition_ = std::make_pair(numRows_++, numColumns_++);
     } else if (numRows_ >= 2 && numColumns_ == 2) {
-      summaryLabelPosition_ = std::make_pair(numRows_, 0); 
+      summaryLabelPosition_ = std::make_pair(numRows_, 0);
       summaryCellPosition_ = std::make_pair(numRows_++, 1);
     } else if (numRows_ == 2 && numColumns_ > 2) {
-      summaryLabelPosition_ = std::make_pair(0, numColumns_); 
+      summaryLabelPosition_ = std::make_pair(0, numColumns_);
       summaryCellPosition_ = std::make_pair(1, numColumns_++);
     }
   }
-  summaryTable[summaryLabelPosition_] = label;
-  summaryTable[summaryCellPosition_] = content;
+  cell(summaryLabelPosition_.first, summaryLabelPosition_.second).set(label);
+  cell(summaryCellPosition_.first, summaryCellPosition_.second) = content;
+}
+
+std::map<std::pair<int, int>, std::string> SummaryTable::getContent() const {
+  std::map<std::pair<int, int>, std::string> content;
+  for (int row = 0; row < int(cells_.size()); ++row) {
+    for (int column = 0; column < int(cells_[row].size()); ++column) {
+      if (!cells_[row][column].empty()) content.insert(content.end(), std::make_pair(std::make_pair(row, column), cells_[row][column].format(precision_)));
+    }
+  }
+  return content;
 }
@@ -1,12 +1,18 @@
 #include <TrackShooter.h>
 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
-std::set<int> getModuleOctants(const Module* mod) {
+#include <messageLogger.h>
+
+
+std::set<int> getModuleOctants(const DetectorModule* mod) {
   std::set<int> octants;
-  octants.insert(getPointOctant(mod->getCorner(0).X(), mod->getCorner(0).Y(), mod->getCorner(0).Z())); 
-  octants.insert(getPointOctant(mod->getCorner(1).X(), mod->getCorner(1).Y(), mod->getCorner(1).Z())); 
-  octants.insert(getPointOctant(mod->getCorner(2).X(), mod->getCorner(2).Y(), mod->getCorner(2).Z())); 
-  octants.insert(getPointOctant(mod->getCorner(3).X(), mod->getCorner(3).Y(), mod->getCorner(3).Z())); 
+  for (int i = 0; i < 4; i++) {
+    const XYZVector& corner = mod->basePoly().getVertex(i);
+    octants.insert(getPointOctant(corner.X(), corner.Y(), corner.Z()));
+  }
   return octants;
 }
 
@@ -129,21 +135,25 @@ void TrackShooter::setTrackerBoundaries(double trackerMaxRho, double barrelMinZ,
   barrelMaxZ_ = barrelMaxZ;
 }  
 
-void TrackShooter::addModule(Module* module) { // also locks modules geometry so that only cached values for geometry properties are returned from now on
+void TrackShooter::addModule(DetectorModule* module) {
   BarrelModule* bmod; EndcapModule* emod;
-  module->lockGeometry();
   allMods_.push_back(module);
+
+  // The worker threads only read the modules: the properties the hits need are computed once here,
+  // so that no lazily computed value is first set by concurrent threads
+  PtErrorAdapter(*module).getTriggerProbability(HIGH_PT_THRESHOLD);
+  module->posRef();
   
   const std::set<int>& octants = getModuleOctants(module);
 
   if ((bmod=dynamic_cast<BarrelModule*>(module))) {
-    BarrelOctants& barrelOctants = barrelModsByRadius_[module->getMeanPoint().Rho()-module->getStereoDistance()/2]; // the radius is the radius of the center point of the lower module
+    BarrelOctants& barrelOctants = barrelModsByRadius_[module->center().Rho()]; // the collisions are searched on the mid-plane of the module
     barrelOctants.resize(8); // prepare the octants vector. it's going to be called for each module, but after the first time the call will do nothing
     for (std::set<int>::const_iterator oit = octants.begin(); oit != octants.end(); ++oit) {
       barrelOctants[*oit].push_back(bmod);
     }
   } else if ((emod=dynamic_cast<EndcapModule*>(module))) { 
-    EndcapOctants& endcapOctants = endcapModsByZ_[module->getMeanPoint().Z()-(module->getZSide()*module->getStereoDistance()/2)]; // getZSide() changes the sign of the addition because if mod is in Z+ then the first sensor to be hit is the one at lower Z, viceversa for Z-
+    EndcapOctants& endcapOctants = endcapModsByZ_[module->center().Z()];
     endcapOctants.resize(8);
     for (std::set<int>::const_iterator oit = octants.begin(); oit != octants.end(); ++oit) {
       endcapOctants[*oit].push_back(emod);
@@ -153,12 +163,12 @@ void TrackShooter::addModule(Module* module) { // also locks modules geometry so
 }
 
 XYVector TrackShooter::convertToLocalCoords(const XYZVector& globalHit, const BarrelModule* mod) const {
-  XYZVector locv = RotationZ(-mod->getMeanPoint().Phi())*(globalHit - mod->getMeanPoint()); // we translate the hit back to the origin, we rotate it like the module at phi=0 was hit (which now looks like a vertical segment in the XY plane), then we drop the irrelevant coordinate (X)
+  XYZVector locv = RotationZ(-mod->center().Phi())*(globalHit - mod->center()); // we translate the hit back to the origin, we rotate it like the module at phi=0 was hit (which now looks like a vertical segment in the XY plane), then we drop the irrelevant coordinate (X)
   return XYVector(locv.Y(), locv.Z());
 }
 
 XYVector TrackShooter::convertToLocalCoords(const XYZVector& globalHit, const EndcapModule* mod) const {
-  XYZVector locv = RotationZ(-mod->getMeanPoint().Phi())*(globalHit - mod->getMeanPoint()); // we translate the hit back to the origin, we rotate it like the module at phi=0 was hit (which now looks like a polygon in the XY plane with the local axes XY reverse-matched with the global YX), then we drop the irrelevant coordinate (Z)
+  XYZVector locv = RotationZ(-mod->center().Phi())*(globalHit - mod->center()); // we translate the hit back to the origin, we rotate it like the module at phi=0 was hit (which now looks like a polygon in the XY plane with the local axes XY reverse-matched with the global YX), then we drop the irrelevant coordinate (Z)
   return XYVector(locv.Y(), locv.X());
 }
 
@@ -192,7 +202,7 @@ int detectCollisionSlanted(XYVector& helixAxis, double R, double z0, double thet
 }
 */
 
-int TrackShooter::detectCollisionEndcap(const Helix& helix, const Polygon3d<4>& poly, std::vector<XYZVector>& collisions) {
+int TrackShooter::detectCollisionEndcap(const Helix& helix, const Polygon3d<4>& poly, std::vector<XYZVector>& collisions) const {
   // get z from module
   // put z in the helix equations, solve for t and obtain x and y
   // check whether x and y are inside the polygon of the module (only 1 collision is possible)
@@ -219,7 +229,7 @@ int TrackShooter::detectCollisionEndcap(const Helix& helix, const Polygon3d<4>&
   }
 }
 
-int TrackShooter::detectCollisionBarrel(const Helix& helix, const Polygon3d<4>& poly, std::vector<XYZVector>& collisions) {
+int TrackShooter::detectCollisionBarrel(const Helix& helix, const Polygon3d<4>& poly, std::vector<XYZVector>& collisions) const {
   // this method solves the equations of the intersection between a circle (particle track in the XY plane) and a line segment (module in XY)
   // both equation are expressed in their parametric forms, to aid in boundary checking.
   // In case of the mocule the parameter u must be between 0 and 1 for the hit to be inside the module
@@ -325,16 +335,14 @@ int TrackShooter::detectCollisionBarrel(const Helix& helix, const Polygon3d<4>&
 
 
 
-//#define FAKE_HITS
-
-void TrackShooter::shootTracks(long int numEvents, long int numTracksEv, int seed) {
+bool TrackShooter::shootTracks(long int numEvents, long int numTracksEv, int seed) {
 
   numEvents_ = numEvents;
   numTracksEv_ = numTracksEv;
 
-  die_.SetSeed(seed);
+  seed_ = seed;
 
-  shootTracks();
+  return shootTracks();
 }
 
 
@@ -344,43 +352,39 @@ void TrackShooter::setDefaultParameters() {
   numTracksEv_ = 1; 
   eventOffset_ = 0;
 
-  eta_ = std::auto_ptr<Value<double> >(new UniformValue<double>(die_, -2, 2));
-  phi0_ = std::auto_ptr<Value<double> >(new UniformValue<double>(die_, M_PI, -M_PI));
-  pt_ = std::auto_ptr<Value<double> >(new UniformValue<double>(die_, 2, 50));
-  z0_ = std::auto_ptr<Value<double> >(new UniformValue<double>(die_, 0.01, 0.5));
-  charge_ = std::auto_ptr<Value<int> >(new BinaryValue<int>(die_, -1, 1));
+  eta_.reset(new UniformValue<double>(-2, 2));
+  phi0_.reset(new UniformValue<double>(M_PI, -M_PI));
+  pt_.reset(new UniformValue<double>(2, 50));
+  z0_.reset(new UniformValue<double>(0.01, 0.5));
+  charge_.reset(new BinaryValue<int>(-1, 1));
 
   instanceId_ = any2str(getpid()) + "_" + any2str(time(NULL)); 
   tracksDir_ = ".";
 
   useInvPt_ = false;
+  seed_ = 0;
+  numThreads_ = std::max(1u, std::thread::hardware_concurrency());
 }
 
 
-void TrackShooter::shootTracks(const po::variables_map& varmap, int seed) {
-
-//  std::string line;
+bool TrackShooter::shootTracks(const po::variables_map& varmap, int seed) {
 
-//  while (line = std::getline(cfg, line, ";")) {
-//    if (line.find("//") != string::npos) line.erase(line.find("//")); // remove comments
-//    line = trim(line);
-//    if (line.empty()) continue;
-//    std::vector<string> tokens = split(line, "=,");
   for (po::variables_map::const_iterator it = varmap.begin(); it != varmap.end(); ++it) {
     std::string key(it->first);
-    if (key == "eta") eta_ = valueFromString<double>(die_, it->second.as<std::string>());
-    else if (key == "phi0") phi0_ = valueFromString<double>(die_, it->second.as<std::string>());
-    else if (key == "z0") z0_ = valueFromString<double>(die_, it->second.as<std::string>());
+    if (key == "eta") eta_ = valueFromString<double>(it->second.as<std::string>());
+    else if (key == "phi0") phi0_ = valueFromString<double>(it->second.as<std::string>());
+    else if (key == "z0") z0_ = valueFromString<double>(it->second.as<std::string>());
     else if (key == "pt") {
       useInvPt_ = false; // only either pt or invPt can be specified
-      pt_ = valueFromString<double>(die_, it->second.as<std::string>());
+      pt_ = valueFromString<double>(it->second.as<std::string>());
     } else if (key == "invPt") {
       useInvPt_ = true;
-      invPt_ =  valueFromString<double>(die_, it->second.as<std::string>());
-    } else if (key == "charge") charge_ = valueFromString<int>(die_, it->second.as<std::string>());
+      invPt_ =  valueFromString<double>(it->second.as<std::string>());
+    } else if (key == "charge") charge_ = valueFromString<int>(it->second.as<std::string>());
     else if (key == "num-events") numEvents_ = str2any<long int>(it->second.as<std::string>()); 
     else if (key == "num-tracks-ev") numTracksEv_ = str2any<long int>(it->second.as<std::string>());
     else if (key == "event-offset") eventOffset_ = str2any<long int>(it->second.as<std::string>());
+    else if (key == "tracksim-threads") numThreads_ = std::max(1, str2any<int>(it->second.as<std::string>()));
     else if (key == "instance-id") {
       static const std::string pidtag = "%PID%";
       static const std::string timetag = "%TIME%";
@@ -392,9 +396,9 @@ void TrackShooter::shootTracks(const po::variables_map& varmap, int seed) {
   
   }
 
-  die_.SetSeed(seed);
+  seed_ = seed;
 
-  shootTracks();
+  return shootTracks();
 }
 
 
@@ -411,7 +415,8 @@ void TrackShooter::printParameters() {
   std::cout << "charge = " << charge_->toString() << std::endl;
   std::cout << "instance-id = " << instanceId_ << std::endl;
   std::cout << "tracks-dir = " << tracksDir_ << std::endl;
-  std::cout << "rand-seed = " << die_.GetSeed() << std::endl;
+  std::cout << "tracksim-threads = " << numThreads_ << std::endl;
+  std::cout << "rand-seed = " << seed_ << std::endl;
 }
 
 
@@ -422,30 +427,135 @@ void TrackShooter::exportGeometryData() {
   TTree* tree = new TTree("geomdata", "Geometry data");
   tree->Branch("mdata", &mdata, "x/D:y:z:rho:phi:widthlo:widthhi:height:stereo:pitchlo:pitchhi:striplen:yres:inefftype/B:refcnt:refz:refrho:refphi:type"); 
 
-  for (std::vector<Module*>::const_iterator it = allMods_.begin(); it != allMods_.end(); ++it) {
-    Module* mod = (*it);
-    PosRef posref = mod->getPositionalReference();
-    XYZVector center = mod->getMeanPoint();
+  for (std::vector<DetectorModule*>::const_iterator it = allMods_.begin(); it != allMods_.end(); ++it) {
+    DetectorModule* mod = (*it);
+    PosRef posref = mod->posRef();
+    XYZVector center = mod->center();
     mdata = (ModuleData){ center.X(), center.Y(), center.Z(),
                           center.Rho(), center.Phi(),
-                          mod->getWidthLo(), mod->getWidthHi(), mod->getHeight(),
-                          mod->getStereoDistance(),
-                          mod->getLowPitch(), mod->getHighPitch(),
-                          mod->getStripLength(), 
-                          mod->getResolutionYTrigger(),
-                          mod->getModuleType()->getInefficiencyType(),
-                          posref.cnt, posref.z, posref.rho, posref.phi,
-                          mod->getSubdetectorType() };
+                          mod->minWidth(), mod->maxWidth(), mod->length(),
+                          mod->dsDistance(),
+                          mod->innerSensor().pitch(), mod->outerSensor().pitch(),
+                          mod->stripLength(), 
+                          mod->resolutionLocalY(center.Theta()),
+                          0, // the inefficiency type is no longer modelled
+                          char(posref.cnt), char(posref.z), char(posref.rho), char(posref.phi),
+                          char(mod->subdet()) };
 
     tree->Fill();
   }
 }
 
-void TrackShooter::shootTracks() {
 
-  Tracks tracks("tracks");
-  Hits hits("hits");
-//  Hits plhits("plhits");
+void TrackShooter::addHit(const XYZVector& hit, const XYVector& local, const DetectorModule* mod, double pt, Hits& hits) const {
+  PtErrorAdapter modPtError(*mod); // one per hit: the adapter keeps a state while computing
+  float pterr = modPtError.computeError(fabs(pt));
+  float hitprob = modPtError.getTriggerProbability(fabs(pt));
+  float deltaStrips = modPtError.pToStrips(fabs(pt));
+  PosRef posref = mod->posRef();
+  hits.push_back(hit.X(), hit.Y(), hit.Z(), local.X(), local.Y(), pterr, hitprob, deltaStrips, posref.cnt, posref.z, posref.rho, posref.phi);
+}
+
+
+// Adds the hits of one track, barrel first, then endcaps unless the track has escaped from the barrel volume
+void TrackShooter::shootTrack(const Helix& helix, std::vector<XYZVector>& collisions, Hits& hits) const {
+  double pt = helix.pt;
+  double eta = helix.eta;
+  double phi0 = helix.phi0;
+  double z0 = helix.z0;
+  int dir = helix.dir;
+  double theta = helix.theta;
+  double R = helix.R; 
+  double B = tan(theta)/R;
+
+  collisions.clear();
+
+  for (BarrelRadii::const_iterator rit = barrelModsByRadius_.begin(); rit != barrelModsByRadius_.end(); ++rit) {
+    double r = rit->first;
+    if (r >= 2*R) continue;
+    double z = 1/B*acos(1-r*r/(2*R*R)) + z0;
+    double x = R*sin(B*(z-z0));
+    double y = dir*R*(1-cos(B*(z-z0)));
+    double xrot = x*cos(phi0) - y*sin(phi0);
+    double yrot = x*sin(phi0) + y*cos(phi0);
+
+    const BarrelOctants& octants = rit->second;
+    const BarrelModules& bmods = octants[getPointOctant(xrot, yrot, z)]; // jump to the octant of the point (CUIDADO octant is determined used non-planar mods)
+
+    for (BarrelModules::const_iterator mit = bmods.begin(); mit != bmods.end(); ++mit) {
+      const BarrelModule* mod = (*mit);
+      if (detectCollisionBarrel(helix, mod->basePoly(), collisions)) { // planar collisions 
+        addHit(collisions[0], convertToLocalCoords(collisions[0], mod), mod, pt, hits);
+        collisions.clear();
+        if (fabs(pt) >= HIGH_PT_THRESHOLD) break; // high pT particles never curve back inside the detector so after a layer/disk has been hit it makes no sense to look for more hits in modules in the same layer/disk
+      }
+    }
+  }
+
+  if (2*R > trackerMaxRho_) { // track will at some point escape the tracker
+    double z = 1/B*acos(1-(trackerMaxRho_*trackerMaxRho_)/(2*R*R)) + z0;
+    if (barrelMinZ_ <= z && z <= barrelMaxZ_) return; // particle has escaped the detector from the barrel volume, we don't want the endcaps to see escaped particles curving back into the tracker
+  }
+
+  for (EndcapZs::const_iterator zit = endcapModsByZ_.begin(); zit != endcapModsByZ_.end(); ++zit) {
+    double z = zit->first;
+    if (signum(eta)*signum(z) <= 0) continue; // we need to skip the negative tracker section if the particle is headed towards positive Z's and viceversa, as the trajectory is an infinite sinusoid
+    double x = R*sin(B*(z-z0));
+    double y = dir*R*(1-cos(B*(z-z0)));
+    double xrot = x*cos(phi0) - y*sin(phi0);
+    double yrot = x*sin(phi0) + y*cos(phi0);
+
+    const EndcapOctants& octants = zit->second;
+    const EndcapModules& emods = octants[getPointOctant(xrot, yrot, z)];
+
+    for (EndcapModules::const_iterator mit = emods.begin(); mit != emods.end(); ++mit) {
+      const EndcapModule* mod = (*mit);
+      if (detectCollisionEndcap(helix, mod->basePoly(), collisions)) {
+        addHit(collisions[0], convertToLocalCoords(collisions[0], mod), mod, pt, hits);
+        collisions.clear();
+        if (fabs(pt) >= HIGH_PT_THRESHOLD) break; // high pT particles never curve back inside the detector so after a layer/disk has been hit it makes no sense to look for more hits in modules in the same layer/disk
+      }
+    }
+  }
+}
+
+
+// Simulates the events [firstEvent, lastEvent) into the block, drawing the tracks from die
+void TrackShooter::shootEvents(long int firstEvent, long int lastEvent, TRandom& die, std::vector<XYZVector>& collisions, EventBlock& block) const {
+  block.tracks.clear();
+  block.hits.clear();
+  block.firstHits.clear();
+  for (long int i = firstEvent; i < lastEvent; i++) {
+    for (long int j = 0; j < numTracksEv_; j++) {
+      double eta = eta_->get(die);
+      double phi0 = phi0_->get(die);
+      double z0 = z0_->get(die);
+      double pt = charge_->get(die) * (!useInvPt_ ? pt_->get(die) : 1./invPt_->get(die));
+
+      Helix helix(pt, eta, phi0, z0, 0.); // CUIDADO: d0 not supported yet
+
+      int firstHit = block.hits.size();
+      shootTrack(helix, collisions, block.hits);
+      block.firstHits.push_back(firstHit);
+      block.tracks.push_back(i, j, eta, phi0, z0, pt, block.hits.size() - firstHit);
+    }
+  }
+}
+
+
+// The seed of a block only depends on the seed of the simulation and on the block number (splitmix64 finalizer)
+UInt_t TrackShooter::blockSeed(UInt_t baseSeed, long int block) const {
+  uint64_t x = (uint64_t(baseSeed) << 32) + block;
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  x = x ^ (x >> 31);
+  UInt_t seed = UInt_t(x ^ (x >> 32));
+  return seed ? seed : 1; // 0 would ask ROOT for a random seed
+}
+
+
+bool TrackShooter::shootTracks() {
 
   printParameters();
 
@@ -453,8 +563,9 @@ void TrackShooter::shootTracks() {
 
   TFile* outfile = new TFile(outfileName.c_str(), "recreate");
   if (outfile->IsZombie()) {
-    std::cerr << "Failed opening file \"" << outfileName << "\" for writing. Simulation aborted." << std::endl;
-    return;
+    logERROR("Failed opening file \"" + outfileName + "\" for writing. Simulation aborted.");
+    delete outfile;
+    return false;
   }
 
   exportGeometryData();
@@ -463,212 +574,82 @@ void TrackShooter::shootTracks() {
 
   gROOT->ProcessLine("#include <vector>");
 
+  Tracks tracks("tracks");
+  Hits hits("hits");
   tracks.setupBranches(*tree);
   hits.setupBranches(*tree);
-  //plhits.setupBranches(*tree);
-
-  // build ordered maps
-  for (long int i=eventOffset_, totTracks = eventOffset_*numTracksEv_; i<numEvents_+eventOffset_; i++) {
-    // new event
-    //
-    for (long int j=0; j<numTracksEv_; j++, totTracks++) {
-      double eta = eta_->get();
-      double phi0 = phi0_->get();
-      double z0 = z0_->get();
-      double pt = charge_->get() * (!useInvPt_ ? pt_->get() : 1./invPt_->get());
-
-#ifdef FAKE_HITS
-      if ((totTracks % 500) == 0) cout << "Track " << totTracks << " of " << (numEvents_+eventOffset_)*numTracksEv_ << std::endl;
-#else
-      if ((totTracks % 5000) == 0) cout << "Track " << totTracks << " of " << (numEvents_+eventOffset_)*numTracksEv_ << std::endl;
-#endif
-/*      
-      // or pick from file
-      //
-      //
-      ParticleGenerator::Particle particle = partGen.getParticle();
-      
-      double pt = particle.pt;
-      double eta = particle.eta;
-      double phi0 = particle.phi;
-      double z0 = particle.z0;
-  */    
-
-      Helix helix(pt, eta, phi0, z0, 0.); // CUIDADO: d0 not supported yet
-      int dir = helix.dir;
-      double theta = helix.theta;
-      double R = helix.R; 
-      double B = tan(theta)/R;
-
-      std::vector<XYZVector> collisions;
-      collisions.clear();
-
-      for (BarrelRadii::const_iterator rit = barrelModsByRadius_.begin(); rit != barrelModsByRadius_.end(); ++rit) {
-        double r = rit->first;
-        if (r >= 2*R) continue;
-        double z = 1/B*acos(1-r*r/(2*R*R)) + z0;
-        double x = R*sin(B*(z-z0));
-        double y = dir*R*(1-cos(B*(z-z0)));
-        double xrot = x*cos(phi0) - y*sin(phi0);
-        double yrot = x*sin(phi0) + y*cos(phi0);
-       // double phirot = atan2(y,x) + phi0;
-       // if (phirot > M_PI) phirot -= 2*M_PI;
-
-        const BarrelOctants& octants = rit->second;
-        const BarrelModules& bmods = octants[getPointOctant(xrot, yrot, z)]; // jump to the octant of the point (CUIDADO octant is determined used non-planar mods)
-
-        for (BarrelModules::const_iterator mit = bmods.begin(); mit != bmods.end(); ++mit) {
-          BarrelModule* mod = (*mit);
-
-          const Polygon3d<4>& poly = mod->getFacePolygon(0);
-          double xpl;
-          double ypl;
-          double zpl;
-          //bool planarcoll = false;
-          if (detectCollisionBarrel(helix, poly, collisions)) { // planar collisions 
-            xpl = collisions[0].X();
-            ypl = collisions[0].Y();
-            zpl = collisions[0].Z(); 
-            ptError* modPtError = mod->getPtError();
-            float pterr = modPtError->computeError(pt);
-            float hitprob = mod->getTriggerProbability(pt);
-            float deltaStrips = modPtError->pToStrips(pt);
-            XYVector locv = convertToLocalCoords(collisions[0], mod); 
-            PosRef posref = mod->getPositionalReference();
-            hits.push_back(xpl, ypl, zpl, locv.X(), locv.Y(), pterr, hitprob, deltaStrips, posref.cnt, posref.z, posref.rho, posref.phi/*, -1., -1., eta*/);
-            collisions.clear();
-            //planarcoll = true;
-            //numpl++;
-            //xpl = locv.X();
-            //ypl = locv.Y();
-            if (fabs(pt) >= HIGH_PT_THRESHOLD) break; // high pT particles never curve back inside the detector so after a layer/disk has been hit it makes no sense to look for more hits in modules in the same layer/disk
-          }
-/*
-          double minPhi = mod->getMinPhi();
-          double maxPhi = mod->getMaxPhi();
-          if (mod->getMinZ() <= z && z <= mod->getMaxZ() &&
-              minPhi <= phirot && phirot <= maxPhi) {
-            ptError* modPtError = mod->getPtError();
-            float pterr = modPtError->computeError(pt);
-            float hitprob = mod->getTriggerProbability(pt);
-            float deltaStrips = modPtError->pToStrips(pt);
-            mod->setProperty("tracksimHits", mod->getProperty("tracksimHits")+1);
-            XYVector locv = convertToLocalCoords(XYZVector(xrot, yrot, z), mod); 
-            PosRef posref = mod->getPositionalReference();
-           // double dist = planarcoll ? sqrt((xrot - xpl)*(xrot - xpl) + (yrot - ypl)*(yrot - ypl) + (z - zpl)*(z - zpl)) : -1.;
-            double distx = planarcoll ? fabs(locv.X() - xpl) : -1.;
-            double disty = planarcoll ? fabs(locv.Y() - ypl) : -1.;
-            hits.push_back(xrot, yrot, z, locv.X(), locv.Y(), pterr, hitprob, deltaStrips, posref.cnt, posref.z, posref.rho, posref.phi, distx, disty, eta);
-
-            numcyl++;
-            //if (fabs(pt) >= HIGH_PT_THRESHOLD) break; // high pT particles never curve back inside the detector so after a layer/disk has been hit it makes no sense to look for more hits in modules in the same layer/disk
-            // CUIDADO this optimization has been disabled for debug
-          }
-*/
-        }
-      }
 
-      if (2*R > trackerMaxRho_) { // track will at some point escape the tracker
-        double z = 1/B*acos(1-(trackerMaxRho_*trackerMaxRho_)/(2*R*R)) + z0;
-        if (barrelMinZ_ <= z && z <= barrelMaxZ_) { // check whether the track will escape from the barrel volume
-          tracks.push_back(i, j, eta, phi0, z0, pt, hits.size());
-          tree->Fill();
-          hits.clear();
-          tracks.clear();
-          continue; // particle has escaped the detector from the barrel volume, we don't want the endcaps to see escaped particles curving back into the tracker, so we skip on
-        }
+  UInt_t baseSeed = seed_;
+  if (!baseSeed) baseSeed = TRandom3(0).GetSeed(); // a random seed was asked for: it is drawn once for all the blocks
+
+  long int eventsPerBlock = std::max(1L, TRACKS_PER_BLOCK/std::max(1L, numTracksEv_));
+  long int numBlocks = (numEvents_ + eventsPerBlock - 1)/eventsPerBlock;
+  int numWorkers = std::max(1L, std::min(long(numThreads_), numBlocks));
+  long int window = long(numWorkers)*BLOCKS_PER_THREAD;
+
+  // The blocks are taken in order by the workers, and put in the slot of their number modulo the window.
+  // A worker waits for its slot to be written before filling it, so that at most window blocks are kept in memory
+  std::vector<EventBlock> slots(window);
+  std::mutex mutex;
+  std::condition_variable blockReady, slotWritten;
+  long int nextBlock = 0, blocksWritten = 0;
+
+  auto worker = [&]() {
+    TRandom3 die;
+    std::vector<XYZVector> collisions;
+    while (true) {
+      long int b;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (nextBlock == numBlocks) return;
+        b = nextBlock++;
+        slotWritten.wait(lock, [&]() { return b < blocksWritten + window; });
       }
-
-      for (EndcapZs::const_iterator zit = endcapModsByZ_.begin(); zit != endcapModsByZ_.end(); ++zit) {
-        double z = zit->first;
-        if (signum(eta)*signum(z) <= 0) continue; // we need to skip the negative tracker section if the particle is headed towards positive Z's and viceversa, as the trajectory is an infinite sinusoid
-        double x = R*sin(B*(z-z0));
-        double y = dir*R*(1-cos(B*(z-z0)));
-        double xrot = x*cos(phi0) - y*sin(phi0);
-        double yrot = x*sin(phi0) + y*cos(phi0);
-
-        const EndcapOctants& octants = zit->second;
-        const EndcapModules& emods = octants[getPointOctant(xrot, yrot, z)];
-
-
-        for (EndcapModules::const_iterator mit = emods.begin(); mit != emods.end(); ++mit) {
-          EndcapModule* mod = (*mit);
-
-          const Polygon3d<4>& poly = mod->getFacePolygon(0);
-         // poly << (mod->getCorner(0) - XYZVector(0, 0, mod->getZSide()*mod->getStereoDistance()/2))
-         //   << (mod->getCorner(1) - XYZVector(0, 0, mod->getZSide()*mod->getStereoDistance()/2))
-         //   << (mod->getCorner(2) - XYZVector(0, 0, mod->getZSide()*mod->getStereoDistance()/2))
-         //   << (mod->getCorner(3) - XYZVector(0, 0, mod->getZSide()*mod->getStereoDistance()/2)); 
-
-          if (detectCollisionEndcap(helix, poly, collisions)) {
-            ptError* modPtError = mod->getPtError();
-            float pterr = modPtError->computeError(pt);
-            float hitprob = mod->getTriggerProbability(pt);
-            float deltaStrips = modPtError->pToStrips(pt);
-            PosRef posref = mod->getPositionalReference();
-            double xpl = collisions[0].X();
-            double ypl = collisions[0].Y();
-            double zpl = collisions[0].Z();
-            XYVector locv = convertToLocalCoords(collisions[0], mod);
-            hits.push_back(xpl, ypl, zpl, locv.X(), locv.Y(), pterr, hitprob, deltaStrips, posref.cnt, posref.z, posref.rho, posref.phi);
-            collisions.clear();
-            if (fabs(pt) >= HIGH_PT_THRESHOLD) break; // high pT particles never curve back inside the detector so after a layer/disk has been hit it makes no sense to look for more hits in modules in the same layer/disk
-          }
-/*
-          XYZVector hitv(xrot, yrot, z);
-          // check if hit lies in module
-
-          if (poly.isPointInside(hitv)) {
-            // module was hit
-            ptError* modPtError = mod->getPtError();
-            float pterr = modPtError->computeError(pt);
-            float hitprob = mod->getTriggerProbability(pt);
-            float deltaStrips = modPtError->pToStrips(pt);
-            mod->setProperty("tracksimHits", mod->getProperty("tracksimHits")+1);
-            PosRef posref = mod->getPositionalReference();
-            XYVector locv = convertToLocalCoords(XYZVector(xrot, yrot, z), mod);
-
-            hits.push_back(xrot, yrot, z, locv.X(), locv.Y(), pterr, hitprob, deltaStrips, posref.cnt, posref.z, posref.rho, posref.phi, -1., -1.);
-
-            //if (fabs(pt) >= HIGH_PT_THRESHOLD) break; // high pT particles never curve back inside the detector so after a layer/disk has been hit it makes no sense to look for more hits in modules in the same layer/disk
-          }      
-*/
-        }
-
+      EventBlock& block = slots[b % window];
+      long int firstEvent = eventOffset_ + b*eventsPerBlock;
+      die.SetSeed(blockSeed(baseSeed, b));
+      shootEvents(firstEvent, std::min(firstEvent + eventsPerBlock, eventOffset_ + numEvents_), die, collisions, block);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        block.ready = true;
       }
-      tracks.push_back(i, j, eta, phi0, z0, pt, hits.size());
-
+      blockReady.notify_one();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (int i = 0; i < numWorkers; i++) workers.push_back(std::thread(worker));
+
+  // The calling thread is the only one touching the tree
+  long int totTracks = eventOffset_*numTracksEv_;
+  for (long int b = 0; b < numBlocks; b++) {
+    EventBlock& block = slots[b % window];
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      blockReady.wait(lock, [&]() { return block.ready; });
+    }
+    for (int t = 0; t < int(block.firstHits.size()); t++, totTracks++) {
+      if ((totTracks % 5000) == 0) std::cout << "Track " << totTracks << " of " << (numEvents_+eventOffset_)*numTracksEv_ << std::endl;
+      int firstHit = block.firstHits[t];
+      int lastHit = t + 1 < int(block.firstHits.size()) ? block.firstHits[t + 1] : block.hits.size();
+      tracks.assign(block.tracks, t);
+      hits.assign(block.hits, firstHit, lastHit - firstHit);
       tree->Fill();
-
-      hits.clear();
-      tracks.clear();
-    }     
-#ifdef FAKE_HITS
-    // NOW BROKEN! ENABLING THEM IS USELESS!!
-    for (std::vector<Module*>::iterator mit = allMods_.begin(); mit != allMods_.end(); ++mit) {
-      Module* mod = (*mit);
-      // loop over all the modules again
-      // fake hits
-      Polygon3d<4> poly;
-      poly << mod->getCorner(0)-mod->getMeanPoint() << mod->getCorner(1)-mod->getMeanPoint() << mod->getCorner(2)-mod->getMeanPoint() << mod->getCorner(3)-mod->getMeanPoint();
-
-      int numFake = die.Poisson(mod->getTriggerFrequencyFakePerEvent());
-      for (int k = 0; k < numFake; k++) {
-        XYZVector fakehit = poly.generateRandomPoint(&die);
-        float deltaStrips = 1 + die.Integer(mod->getTriggerWindow()/2);
-        float fakept = mod->getPtError()->stripsToP(deltaStrips);
-        float pterr = mod->getPtError()->computeError(fakept);
-        PosRef posref = mod->getPositionalReference();
-      }
     }
-#endif
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      block.ready = false;
+      blocksWritten++;
+    }
+    slotWritten.notify_all();
   }
 
+  for (auto& w : workers) w.join();
+
   outfile->Write();
   outfile->Close();
   delete outfile;
 
   std::cout << "Output written to file " << outfileName << std::endl;
+  return true;
 }
-
-
@@ -4641,13 +4641,20 @@ namespace insur {
 
 
   // public
-  // creates a page with all the logs taken from the messagelogger objects
+  // adds the log page to the site: it is only filled when the site is written,
+  // so that it also gets the messages logged while the other pages are rendered
   // @param site a reference to the site we want to work onto
-  // @param loggerVector a vector of references to some messageLogger objects
+  void Vizard::makeLogPage(RootWSite& site) {
+    RootWPage& myPage = site.addPage("Log page");
+    myPage.setBuilder([this](RootWPage& page) { makeLogPage(page); });
+  }
+
+  // public
+  // fills a page with all the logs taken from the messagelogger objects
+  // @param myPage a reference to the page to be filled
   // @return true if any log was written
-  bool Vizard::makeLogPage(RootWSite& site) {
+  bool Vizard::makeLogPage(RootWPage& myPage) {
     bool anythingFound=false;
-    RootWPage& myPage = site.addPage("Log page");
     if (!MessageLogger::hasEmptyLog(MessageLogger::ERROR))
       myPage.setAlert(1);
     else if (!MessageLogger::hasEmptyLog(MessageLogger::WARNING))
@@ -4662,9 +4669,111 @@ namespace insur {
         //MessageLogger::getLatestLog(iLevel);
       }
     }
+    if (makeProfileSummary(myPage)) anythingFound=true;
+    if (makeMemorySummary(myPage)) anythingFound=true;
     return anythingFound;
   }
 
+  /**
+   * Adds to the page the memory in use at the boundaries of the steps completed so far,
+   * with the object family counts if they were compiled in, and the same data as a csv file
+   * @param myPage the page to add the memory content to
+   * @return true if any step was completed
+   */
+  bool Vizard::makeMemorySummary(RootWPage& myPage) {
+    const std::vector<MemoryMonitor::Stage>& stages = MemoryMonitor::instance()->stages();
+    bool counters = MemoryMonitor::countersEnabled();
+    const double MB = 1024. * 1024.;
+    RootWContent* myContent = NULL;
+    RootWTable* myTable = NULL;
+    int iRow = 0;
+    for (const MemoryMonitor::Stage& stage : stages) {
+      if (!stage.completed) continue;
+      if (!myContent) {
+        myContent = &myPage.addContent("Memory", false);
+        myTable = new RootWTable();
+        myTable->setContent(0, 0, "Stage");
+        myTable->setContent(0, 1, "RSS after [MB]");
+        myTable->setContent(0, 2, "RSS change [MB]");
+        myTable->setContent(0, 3, "Peak RSS [MB]");
+        myTable->setContent(0, 4, "Heap after [MB]");
+        myTable->setContent(0, 5, "Heap change [MB]");
+        if (counters) {
+          for (int family = 0; family < MemoryMonitor::NumFamilies; ++family)
+            myTable->setContent(0, 6+family, std::string(MemoryMonitor::familyName(MemoryMonitor::Family(family))) + " [MB]");
+        }
+      }
+      ++iRow;
+      std::string indent;
+      for (unsigned int level = 1; level < stage.depth; ++level) indent += "&nbsp;&nbsp;&nbsp;&nbsp;";
+      myTable->setContent(iRow, 0, indent + stage.name);
+      // -1 marks a reading not available on this platform: it is shown as such, and never subtracted
+      auto setMB = [&](int column, long bytes) {
+        if (bytes < 0) myTable->setContent(iRow, column, "n/a");
+        else myTable->setContent(iRow, column, bytes / MB, 1);
+      };
+      auto setChangeMB = [&](int column, long before, long after) {
+        if (before < 0 || after < 0) myTable->setContent(iRow, column, "n/a");
+        else myTable->setContent(iRow, column, (after - before) / MB, 1);
+      };
+      setMB(1, stage.after.rss);
+      setChangeMB(2, stage.before.rss, stage.after.rss);
+      setMB(3, stage.after.peakRss);
+      setMB(4, stage.after.heapInUse);
+      setChangeMB(5, stage.before.heapInUse, stage.after.heapInUse);
+      if (counters) {
+        for (int family = 0; family < MemoryMonitor::NumFamilies; ++family)
+          myTable->setContent(iRow, 6+family, stage.families[family].bytes / MB, 1);
+      }
+    }
+    if (!myContent) return false;
+    myContent->addItem(myTable);
+
+    std::ostringstream table;
+    MemoryMonitor::instance()->writeTable(table);
+    RootWTextFile* myTextFile = new RootWTextFile("memory.csv", "Memory in use at the end of each stage (bytes)");
+    myTextFile->addText(table.str());
+    myContent->addItem(myTextFile);
+    return true;
+  }
+
+  /**
+   * Adds to the page the time spent in the profiled zones completed so far,
+   * together with the Chrome trace of the zones
+   * @param myPage the page to add the profiling content to
+   * @return true if any zone was completed
+   */
+  bool Vizard::makeProfileSummary(RootWPage& myPage) {
+    std::vector<Profiler::ZoneSummary> zones = Profiler::instance()->summary();
+    if (zones.empty()) return false;
+    RootWContent& myContent = myPage.addContent("Profile", false);
+    RootWTable* myTable = new RootWTable();
+    myTable->setContent(0, 0, "Zone");
+    myTable->setContent(0, 1, "Calls");
+    myTable->setContent(0, 2, "Wall time [s]");
+    myTable->setContent(0, 3, "CPU time [s]");
+    myTable->setContent(0, 4, "Self wall time [s]");
+    myTable->setContent(0, 5, "Threads");
+    for (unsigned int i = 0; i < zones.size(); ++i) {
+      std::string indent;
+      for (unsigned int level = 1; level < zones[i].depth; ++level) indent += "&nbsp;&nbsp;&nbsp;&nbsp;";
+      myTable->setContent(i+1, 0, indent + zones[i].name);
+      myTable->setContent(i+1, 1, int(zones[i].calls));
+      myTable->setContent(i+1, 2, zones[i].wallTime, 3);
+      myTable->setContent(i+1, 3, zones[i].cpuTime, 3);
+      myTable->setContent(i+1, 4, zones[i].selfWallTime, 3);
+      myTable->setContent(i+1, 5, int(zones[i].threads));
+    }
+    myContent.addItem(myTable);
+
+    std::ostringstream trace;
+    Profiler::instance()->writeChromeTrace(trace);
+    RootWTextFile* myTextFile = new RootWTextFile("profile.json", "Chrome trace of the profiled zones (load in chrome://tracing)");
+    myTextFile->addText(trace.str());
+    myContent.addItem(myTextFile);
+    return true;
+  }
+
 
 
   // private
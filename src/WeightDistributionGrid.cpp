@@ -1,6 +1,8 @@
 #include "WeightDistributionGrid.h"
 #include "MaterialObject.h"
+#include "messageLogger.h"
 #include <algorithm>
+#include <cmath>
 
 namespace material {
 
@@ -8,35 +10,91 @@ namespace material {
     binDimension_(binDimension) {}
 
   void WeightDistributionGrid::addTotalGrams(double minZ, double minR, double maxZ, double maxR, double length, double surface, const MaterialObject& materialObject) {
-    int binIndexZStart = floor(minZ / binDimension_);
-    int binIndexZ = binIndexZStart;
-    int binIndexR = floor(minR / binDimension_);
-    double binMinZ, binMinR, binMaxZ, binMaxR, zMul, rMul;
+    addGrams(minZ, minR, maxZ, maxR, materialObject.totalGrams(length, surface));
+  }
+
+  WeightDistributionGrid::Tile& WeightDistributionGrid::tile(int tileZ, int tileR) {
+    Tile& t = tiles_[TileIndex(tileZ, tileR)];
+    if (t.empty()) t.assign(TileSize * TileSize, 0.);
+    return t;
+  }
 
-    do {
-      binMinR = floor(binIndexR * binDimension_);
-      binMaxR = binMinR + binDimension_;
+  /**
+   * Spreads the given grams uniformly over the (z, r) rectangle, each bin
+   * getting the fraction of the rectangle area it overlaps. The z overlaps are
+   * computed once per fill, then every r row is a plain scaled add over the
+   * contiguous rows of the tiles it crosses.
+   */
+  void WeightDistributionGrid::addGrams(double minZ, double minR, double maxZ, double maxR, double grams) {
+    double area = (maxZ - minZ) * (maxR - minR);
+    if (area <= 0.) return;
 
-      do {
-        binMinZ = floor(binIndexZ * binDimension_);
-        binMaxZ = binMinZ + binDimension_;
+    int firstZ = int(floor(minZ / binDimension_));
+    int lastZ = int(ceil(maxZ / binDimension_));
+    int firstR = int(floor(minR / binDimension_));
+    int lastR = int(ceil(maxR / binDimension_));
 
-        zMul = std::max(binMinZ, minZ) - std::min(binMaxZ, maxZ);
-        rMul = std::max(binMinR, minR) - std::min(binMaxR, maxR);
+    int columns = lastZ - firstZ;
+    zFractions_.resize(columns);
+    for (int i = 0; i < columns; ++i) {
+      double binMinZ = (firstZ + i) * binDimension_;
+      zFractions_[i] = std::max(0., std::min(binMinZ + binDimension_, maxZ) - std::max(binMinZ, minZ));
+    }
 
-        operator[](std::make_pair(binIndexZ, binIndexR)) += 
-          (materialObject.totalGrams(length, surface) * zMul * rMul) / ((maxZ - minZ) * (maxR - minR));
+    double gramsPerArea = grams / area;
+    const double* zFractions = zFractions_.data();
+    for (int binIndexR = firstR; binIndexR < lastR; ++binIndexR) {
+      double binMinR = binIndexR * binDimension_;
+      double rowFactor = gramsPerArea * std::max(0., std::min(binMinR + binDimension_, maxR) - std::max(binMinR, minR));
+      int tileR = tileOf(binIndexR);
+      int rowOffset = (binIndexR - tileR * TileSize) * TileSize;
+      for (int binIndexZ = firstZ; binIndexZ < lastZ; ) {
+        int tileZ = tileOf(binIndexZ);
+        int tileEnd = std::min(lastZ, (tileZ + 1) * TileSize);
+        double* row = tile(tileZ, tileR).data() + rowOffset;
+        for (; binIndexZ < tileEnd; ++binIndexZ) row[binIndexZ - tileZ * TileSize] += rowFactor * zFractions[binIndexZ - firstZ];
+      }
+    }
+  }
+
+  /**
+   * Adds the content of another grid with the same binning (e.g. a per-thread
+   * partial grid) to this one.
+   */
+  void WeightDistributionGrid::merge(const WeightDistributionGrid& other) {
+    if (other.tiles_.empty()) return;
+    if (other.binDimension_ != binDimension_) {
+      logERROR("Cannot merge weight distribution grids with different binning.");
+      return;
+    }
+    for (const auto& otherTile : other.tiles_) {
+      Tile& mine = tile(otherTile.first.first, otherTile.first.second);
+      const double* src = otherTile.second.data();
+      double* dst = mine.data();
+      for (int i = 0; i < TileSize * TileSize; ++i) dst[i] += src[i];
+    }
+  }
 
-        binIndexZ ++;
-      } while (binMaxZ < maxZ);
-      
-      binIndexR ++;
-      binIndexZ = binIndexZStart;
-    } while (binMinR < maxR);
+  void WeightDistributionGrid::reset() {
+    tiles_.clear();
   }
 
   double WeightDistributionGrid::binDimension() const {
     return binDimension_;
   }
-}
 
+  double WeightDistributionGrid::grams(int binIndexZ, int binIndexR) const {
+    int tileZ = tileOf(binIndexZ), tileR = tileOf(binIndexR);
+    auto found = tiles_.find(TileIndex(tileZ, tileR));
+    if (found == tiles_.end()) return 0.;
+    return found->second[(binIndexR - tileR * TileSize) * TileSize + binIndexZ - tileZ * TileSize];
+  }
+
+  double WeightDistributionGrid::totalGrams() const {
+    double total = 0.;
+    for (const auto& t : tiles_) {
+      for (double g : t.second) total += g;
+    }
+    return total;
+  }
+}
@@ -0,0 +1,196 @@
+/**
+ * @file XMLStream.cc
+ * @brief This is the implementation of the buffered output stream and the preloaded skeleton files used to write CMSSW XML
+ */
+
+#include <XMLStream.h>
+#include <tk2CMSSW_strings.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace insur {
+    XMLStream::XMLStream(std::ostream& out) : out_(out), buffer_(bufferSize), used_(0) {}
+
+    XMLStream::~XMLStream() { flush(); }
+
+    /**
+     * Hand the buffered text over to the underlying stream.
+     */
+    void XMLStream::flush() {
+        if (used_ > 0) out_.write(&buffer_[0], used_);
+        used_ = 0;
+    }
+
+    /**
+     * Append a block of text to the buffer, flushing it as needed. Blocks larger than the buffer go straight to the underlying stream.
+     */
+    void XMLStream::write(const char* data, size_t size) {
+        if (used_ + size > buffer_.size()) {
+            flush();
+            if (size > buffer_.size()) {
+                out_.write(data, size);
+                return;
+            }
+        }
+        memcpy(&buffer_[used_], data, size);
+        used_ += size;
+    }
+
+    XMLStream& XMLStream::operator<<(const char* s) {
+        write(s, strlen(s));
+        return *this;
+    }
+
+    XMLStream& XMLStream::writeUnsigned(unsigned long long i, bool negative) {
+        char digits[24];
+        char* p = digits + sizeof(digits);
+        do {
+            *--p = '0' + (i % 10);
+            i /= 10;
+        } while (i > 0);
+        if (negative) *--p = '-';
+        write(p, digits + sizeof(digits) - p);
+        return *this;
+    }
+
+    XMLStream& XMLStream::operator<<(double d) {
+        char result[32];
+        write(result, formatDouble(d, result));
+        return *this;
+    }
+
+    /**
+     * Format a number like a default-formatted <i>std::ostream</i> does, i.e. like <i>printf()</i> with <i>%g</i>.
+     * Values between 1e-4 and 1e6, which is where all the lengths and angles of the geometry are, are rounded to six
+     * significant digits directly; the rare values which are too close to a rounding tie to be sure of the result, and
+     * those outside of that range, are left to <i>snprintf()</i>.
+     * @param d The value to be formatted
+     * @param result A buffer for the formatted value; it must hold at least 32 characters
+     * @return The number of characters written, not counting the terminating null character
+     */
+    size_t XMLStream::formatDouble(double d, char* result) {
+        static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+        static const double inversePowers[] = { 1e0, 1e-1, 1e-2, 1e-3, 1e-4 };
+        double a = fabs(d);
+        if (a >= 1e-4 && a < 1e6) {
+            // decimal exponent of the value: the thresholds are exact or slightly above the powers of ten they stand for
+            int exponent;
+            if (a >= 1) for (exponent = 0; a >= powers[exponent + 1]; exponent++);
+            else for (exponent = -1; a < inversePowers[-exponent]; exponent--);
+            int decimals = 5 - exponent;
+            double scaled = a * powers[decimals];
+            double integral = floor(scaled);
+            double fraction = scaled - integral;
+            long digits = long(integral) + (fraction > 0.5 ? 1 : 0);
+            if (fabs(fraction - 0.5) > 1e-6 && digits < 1000000) {
+                char text[6];
+                for (int i = 5; i >= 0; i--, digits /= 10) text[i] = '0' + (digits % 10);
+                char* p = result;
+                if (d < 0) *p++ = '-';
+                if (exponent >= 0) {
+                    memcpy(p, text, exponent + 1);
+                    p += exponent + 1;
+                } else {
+                    *p++ = '0';
+                }
+                // fractional part, without trailing zeros
+                int last = 5;
+                while (last > exponent && text[last] == '0') last--;
+                if (last > exponent) {
+                    *p++ = '.';
+                    for (int i = exponent; i < -1; i++) *p++ = '0';
+                    for (int i = std::max(exponent + 1, 0); i <= last; i++) *p++ = text[i];
+                }
+                *p = 0;
+                return p - result;
+            }
+        }
+        int length = snprintf(result, 32, "%g", d);
+        return (length > 0) ? std::min(length, 31) : 0;
+    }
+
+    /**
+     * Load a skeleton file and locate the lines with the XML preamble and with the insertion markers.
+     * @param filename The name of the skeleton file
+     * @return True if the file could be read, false otherwise
+     */
+    bool XMLTemplate::load(const std::string& filename) {
+        text_.clear();
+        preambleLines_.clear();
+        insertionLines_.clear();
+        std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+        if (in.fail()) return false;
+        text_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        if (in.bad()) {
+            text_.clear();
+            return false;
+        }
+        if (!text_.empty() && text_[text_.size() - 1] != '\n') text_ += '\n';
+
+        findLines(xml_preamble_concise, preambleLines_);
+        findLines(xml_insert_marker, insertionLines_);
+        return true;
+    }
+
+    /**
+     * Collect the lines containing the given marker text, recording the position of its first occurrence in each of them.
+     */
+    void XMLTemplate::findLines(const std::string& marker, std::vector<Line>& lines) const {
+        size_t found = text_.find(marker);
+        while (found != std::string::npos) {
+            Line line;
+            line.marker = found;
+            line.begin = (found == 0) ? 0 : text_.rfind('\n', found - 1) + 1;
+            line.end = text_.find('\n', found) + 1;
+            lines.push_back(line);
+            found = text_.find(marker, line.end);
+        }
+    }
+
+    /**
+     * Copy the skeleton, line by line, up to the next line with the given marker.
+     * @param from The offset to start from; lines before it are skipped
+     * @param marker The kind of marker to look for
+     * @param out The output stream
+     * @param markerLine If given, it is set to the text of the line with the marker, without the newline, or cleared if there is none
+     * @return The offset of the line after the one with the marker, or <i>npos</i> if no marker was found and the whole rest was copied
+     */
+    size_t XMLTemplate::copyUntil(size_t from, Marker marker, XMLStream& out, std::string* markerLine) const {
+        if (markerLine) markerLine->clear();
+        if (from >= text_.size()) return npos;
+        const std::vector<Line>& lines = (marker == preamble) ? preambleLines_ : insertionLines_;
+        std::vector<Line>::const_iterator it = lines.begin();
+        while (it != lines.end() && it->begin < from) it++;
+        if (it == lines.end()) {
+            out.write(text_.data() + from, text_.size() - from);
+            return npos;
+        }
+        out.write(text_.data() + from, it->begin - from);
+        if (markerLine) markerLine->assign(text_, it->begin, it->end - it->begin - 1);
+        return it->end;
+    }
+
+    /**
+     * Copy the rest of the skeleton starting at the given offset; nothing is copied for <i>npos</i>.
+     */
+    void XMLTemplate::copyRest(size_t from, XMLStream& out) const {
+        if (from < text_.size()) out.write(text_.data() + from, text_.size() - from);
+    }
+
+    /**
+     * Copy the whole skeleton, replacing the first insertion marker of each line with the given text.
+     */
+    void XMLTemplate::copyReplacingMarkers(const std::string& replacement, XMLStream& out) const {
+        size_t from = 0;
+        for (std::vector<Line>::const_iterator it = insertionLines_.begin(); it != insertionLines_.end(); it++) {
+            out.write(text_.data() + from, it->marker - from);
+            out << replacement;
+            from = it->marker + xml_insert_marker.size();
+        }
+        copyRest(from, out);
+    }
+}
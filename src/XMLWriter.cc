@@ -14,16 +14,14 @@ namespace insur {
      * It identifies, by name tag, the vector of <i>(r, z)</i>-points that describe the volume addition to the pixel barrel.
      * It then writes those new coordinates into the skeleton file at the appropriate position.
      * @param s The vector containing the list of individual shapes that make up the tracker
-     * @param in A reference to a file stream that is bound to the skeleton file
-     * @param out A reference to a file stream that is bound to the output file
+     * @param in A reference to the preloaded skeleton file
+     * @param out A reference to the buffered stream bound to the output file
      */
-    void XMLWriter::pixbar(std::vector<ShapeInfo>& s, std::ifstream& in, std::ofstream& out) {
+    void XMLWriter::pixbar(std::vector<ShapeInfo>& s, const XMLTemplate& in, XMLStream& out) {
         unsigned int pos = 0;
-        std::string line;
-        while (std::getline(in, line) && (line.find(xml_preamble_concise) == std::string::npos)) out << line << std::endl; // scan for preamble
-        out << line << std::endl << getSimpleHeader(); // output the preamble followed by the header
-        while (std::getline(in, line) && (line.find(xml_insert_marker) == std::string::npos)) out << line << std::endl;
-        if (in.eof()) return; // No mid point marker, no party
+        size_t next = copyPreamble(in, out); // output the preamble followed by the header
+        next = in.copyUntil(next, XMLTemplate::insertion, out);
+        if (next == XMLTemplate::npos) return; // No mid point marker, no party
         if (s.size() > 0) {
             while ((pos < s.size()) && (s.at(pos).name_tag.find(xml_tob) == std::string::npos)) pos++;
             if ((pos < s.size()) && (s.at(pos).rzup.size() > 0)) {
@@ -41,7 +39,7 @@ namespace insur {
                 out << xml_zv3 << xml_general_endline;
             }
         }
-        while (std::getline(in, line)) out << line << std::endl;
+        in.copyRest(next, out);
     }
     
     /**
@@ -51,16 +49,14 @@ namespace insur {
      * above the pixel detector has no endcaps, the skeleton file remains unchanged but is nevertheless copied to a new
      * output file (minus the comment that serves as a position marker in the skeleton file).
      * @param s The vector containing the list of individual shapes that make up the tracker
-     * @param in A reference to a file stream that is bound to the skeleton file
-     * @param out A reference to a file stream that is bound to the output file
+     * @param in A reference to the preloaded skeleton file
+     * @param out A reference to the buffered stream bound to the output file
      */
-    void XMLWriter::pixfwd(std::vector<ShapeInfo>& s, std::ifstream& in, std::ofstream& out) {
+    void XMLWriter::pixfwd(std::vector<ShapeInfo>& s, const XMLTemplate& in, XMLStream& out) {
         unsigned pos = 0;
-        std::string line;
-        while (std::getline(in, line) && (line.find(xml_preamble_concise) == std::string::npos)) out << line << std::endl; // scan for preamble
-        out << line << std::endl << getSimpleHeader(); // output the preamble followed by the header
-        while (std::getline(in, line) && (line.find(xml_insert_marker) == std::string::npos)) out << line << std::endl;
-        if (in.eof()) return; // No mid point marker, no party
+        size_t next = copyPreamble(in, out); // output the preamble followed by the header
+        next = in.copyUntil(next, XMLTemplate::insertion, out);
+        if (next == XMLTemplate::npos) return; // No mid point marker, no party
         if (s.size() > 0) {
             while ((pos < s.size()) && (s.at(pos).name_tag.find(xml_tid) == std::string::npos)) pos++;
             if ((pos < s.size()) && (s.at(pos).rzup.size() > 0) && (s.at(pos).rzdown.size() > 0)) {
@@ -78,7 +74,7 @@ namespace insur {
                 out << s.at(pos).rzdown.at(0).second << xml_rzpoint_close;
             }
         }
-        while (std::getline(in, line)) out << line << std::endl;
+        in.copyRest(next, out);
     }
     
     /**
@@ -91,9 +87,9 @@ namespace insur {
      * makes sure they are called in the right order and at the right time. Additionally, it writes the opening and closing
      * tags of the file itself.
      * @param d A reference to a struct containing a number of vectors for the previously extracted tracker information
-     * @param out A reference to a file stream that is bound to the output file
+     * @param out A reference to the buffered stream bound to the output file
      */
-    void XMLWriter::tracker(CMSSWBundle& d, std::ofstream& out, std::istream& trackerVolumeTemplate, bool wt) {
+    void XMLWriter::tracker(CMSSWBundle& d, XMLStream& out, const XMLTemplate& trackerVolumeTemplate, bool wt) {
         std::vector<Element>& e = d.elements;
         std::vector<Composite>& c = d.composites;
         std::vector<LogicalInfo>& l = d.logic;
@@ -102,27 +98,25 @@ namespace insur {
         std::vector<PosInfo>& p = d.positions;
         std::vector<AlgoInfo>& a = d.algos;
         std::map<std::string,Rotation>& r = d.rots;
-        std::ostringstream buffer;
-        buffer << xml_preamble;
-        buffer << getExtendedHeader();
+        out << xml_preamble;
+        out << getExtendedHeader();
         if (wt) {
-            buffer << xml_new_const_section;
-            materialSection(xml_newtrackerfile, e, c, buffer);
-            rotationSection(r, xml_newtrackerfile, buffer);
-            logicalPartSection(l, xml_newtrackerfile, buffer, true);
-            solidSection(s, so, xml_newtrackerfile, buffer, trackerVolumeTemplate, true, true);
-            posPartSection(p, a, xml_newtrackerfile, buffer);
+            out << xml_new_const_section;
+            materialSection(xml_newtrackerfile, e, c, out);
+            rotationSection(r, xml_newtrackerfile, out);
+            logicalPartSection(l, xml_newtrackerfile, out, true);
+            solidSection(s, so, xml_newtrackerfile, out, trackerVolumeTemplate, true, true);
+            posPartSection(p, a, xml_newtrackerfile, out);
         }
         else {
-            buffer << xml_const_section;
-            materialSection(xml_trackerfile, e, c, buffer);
-            rotationSection(r, xml_trackerfile, buffer);
-            logicalPartSection(l, xml_trackerfile, buffer);
-            solidSection(s, so, xml_trackerfile, buffer, trackerVolumeTemplate, true);
-            posPartSection(p, a, xml_trackerfile, buffer);
+            out << xml_const_section;
+            materialSection(xml_trackerfile, e, c, out);
+            rotationSection(r, xml_trackerfile, out);
+            logicalPartSection(l, xml_trackerfile, out);
+            solidSection(s, so, xml_trackerfile, out, trackerVolumeTemplate, true);
+            posPartSection(p, a, xml_trackerfile, out);
         }
-        buffer << xml_defclose;
-        out << buffer.str();
+        out << xml_defclose;
     }
     
     /**
@@ -134,20 +128,20 @@ namespace insur {
      * listed in blocks that specify 128 channels per row and one channel per colums for a ROC. Last, a <i>SpecPar</i>
      * block is added for each multiple of those channels (row and column) that occur on the modules.
      * @t A reference to the collection of tracker topology information
-     * @in A reference to a file stream that is bound to the input file
-     * @out A reference to a file stream that is bound to the output file
+     * @in A reference to the preloaded skeleton file
+     * @out A reference to the buffered stream bound to the output file
      */
-    void XMLWriter::topology(std::vector<SpecParInfo>& t, std::ifstream& in, std::ofstream& out) {
+    void XMLWriter::topology(std::vector<SpecParInfo>& t, const XMLTemplate& in, XMLStream& out) {
         std::ostringstream strm;
-        std::string line;
         unsigned int i;
         int pos;
 	//int lindex, rindex, mindex;
-        while (std::getline(in, line) && (line.find(xml_preamble_concise) == std::string::npos)) out << line << std::endl; // scan for preamble
-        out << line << std::endl << getSimpleHeader(); // output the preamble followed by the header
+        size_t next = copyPreamble(in, out); // output the preamble followed by the header
 
         // Find the break
-        while (std::getline(in, line) && (line.find(xml_insert_marker) == std::string::npos)) out << line << std::endl;
+        next = in.copyUntil(next, XMLTemplate::insertion, out);
+
+        SpecParIndex specIndex(t);
 
         // Add Phase2OTBarrel
         out << xml_spec_par_open << xml_2OTbar << "SubDet" << xml_par_tail << xml_general_inter;
@@ -157,7 +151,7 @@ namespace insur {
 
         // Add Layers
         out << xml_spec_par_open << "OuterTracker" << xml_subdet_layer << xml_par_tail << xml_general_inter;
-        pos = findEntry(t, xml_subdet_layer + xml_par_tail);
+        pos = specIndex.find(xml_subdet_layer + xml_par_tail);
         if (pos != -1) {
             for (i = 0; i < t.at(pos).partselectors.size(); i++) {
                 out << xml_spec_par_selector << t.at(pos).partselectors.at(i) << xml_general_endline;
@@ -169,7 +163,7 @@ namespace insur {
 
         // Add Rods (straight or tilted)
         out << xml_spec_par_open << "OuterTracker" << xml_subdet_straight_or_tilted_rod << xml_par_tail << xml_general_inter;
-        pos = findEntry(t, xml_subdet_straight_or_tilted_rod + xml_par_tail);
+        pos = specIndex.find(xml_subdet_straight_or_tilted_rod + xml_par_tail);
         if (pos != -1) {
             for (i = 0; i < t.at(pos).partselectors.size(); i++) {
                 out << xml_spec_par_selector << t.at(pos).partselectors.at(i) << xml_general_endline;
@@ -180,7 +174,7 @@ namespace insur {
 
 	// Add BarrelStack
 	out << xml_spec_par_open << "OuterTracker" << xml_subdet_barrel_stack << xml_par_tail << xml_general_inter;
-	pos = findEntry(t, xml_subdet_barrel_stack + xml_par_tail);
+	pos = specIndex.find(xml_subdet_barrel_stack + xml_par_tail);
         if (pos != -1) {
 	  for (i = 0; i < t.at(pos).partselectors.size(); i++) {
 	    out << xml_spec_par_selector << t.at(pos).partselectors.at(i) << xml_general_endline;
@@ -198,7 +192,7 @@ namespace insur {
 
         // Add Disks
         out << xml_spec_par_open << "OuterTracker" << xml_subdet_wheel << xml_par_tail << xml_general_inter;
-        pos = findEntry(t, xml_subdet_wheel + xml_par_tail);
+        pos = specIndex.find(xml_subdet_wheel + xml_par_tail);
         if (pos != -1) {
             for (i = 0; i < t.at(pos).partselectors.size(); i++) {
                 out << xml_spec_par_selector << t.at(pos).partselectors.at(i) << xml_general_endline;
@@ -209,7 +203,7 @@ namespace insur {
 
         // Add Rings
         out << xml_spec_par_open << "OuterTracker" << xml_subdet_ring << xml_par_tail << xml_general_inter;
-        pos = findEntry(t, xml_subdet_ring + xml_par_tail);
+        pos = specIndex.find(xml_subdet_ring + xml_par_tail);
         if (pos != -1) {
             for (i = 0; i < t.at(pos).partselectors.size(); i++) {
                 out << xml_spec_par_selector << t.at(pos).partselectors.at(i) << xml_general_endline;
@@ -220,7 +214,7 @@ namespace insur {
 
 	// Add EndcapStack
 	out << xml_spec_par_open << "OuterTracker" << xml_subdet_endcap_stack << xml_par_tail << xml_general_inter;
-	pos = findEntry(t, xml_subdet_endcap_stack + xml_par_tail);
+	pos = specIndex.find(xml_subdet_endcap_stack + xml_par_tail);
         if (pos != -1) {
 	  for (i = 0; i < t.at(pos).partselectors.size(); i++) {
 	    out << xml_spec_par_selector << t.at(pos).partselectors.at(i) << xml_general_endline;
@@ -231,7 +225,7 @@ namespace insur {
 
 	// Add LowerDetectors
 	out << xml_spec_par_open << "OuterTracker" << xml_subdet_lower_detectors << xml_par_tail << xml_general_inter;
-	pos = findEntry(t, xml_subdet_tobdet + xml_par_tail);
+	pos = specIndex.find(xml_subdet_tobdet + xml_par_tail);
         if (pos != -1) {
 	  for (i = 0; i < t.at(pos).partselectors.size(); i++) {
 	    if (t.at(pos).partselectors.at(i).find(xml_base_lower) != std::string::npos) {
@@ -239,7 +233,7 @@ namespace insur {
 	    }
 	  }
         }
-        pos = findEntry(t, xml_subdet_tiddet + xml_par_tail);
+        pos = specIndex.find(xml_subdet_tiddet + xml_par_tail);
         if (pos != -1) {
 	  for (i = 0; i < t.at(pos).partselectors.size(); i++) {
 	    if (t.at(pos).partselectors.at(i).find(xml_base_lower) != std::string::npos) {
@@ -252,7 +246,7 @@ namespace insur {
 
 	// Add UpperDetectors
 	out << xml_spec_par_open << "OuterTracker" << xml_subdet_upper_detectors << xml_par_tail << xml_general_inter;
-	pos = findEntry(t, xml_subdet_tobdet + xml_par_tail);
+	pos = specIndex.find(xml_subdet_tobdet + xml_par_tail);
         if (pos != -1) {
 	  for (i = 0; i < t.at(pos).partselectors.size(); i++) {
 	    if (t.at(pos).partselectors.at(i).find(xml_base_upper) != std::string::npos) {
@@ -260,7 +254,7 @@ namespace insur {
 	    }
 	  }
         }
-        pos = findEntry(t, xml_subdet_tiddet + xml_par_tail);
+        pos = specIndex.find(xml_subdet_tiddet + xml_par_tail);
         if (pos != -1) {
 	  for (i = 0; i < t.at(pos).partselectors.size(); i++) {
 	    if (t.at(pos).partselectors.at(i).find(xml_base_upper) != std::string::npos) {
@@ -273,21 +267,21 @@ namespace insur {
 		
 		//Write specPar blocks for ROC parameters 
 		//TOB
-		pos = findEntry(t, xml_subdet_tobdet + xml_par_tail);
+		pos = specIndex.find(xml_subdet_tobdet + xml_par_tail);
 		if (pos != -1) {
 			  specParROC(t.at(pos).partselectors, t.at(pos).moduletypes, t.at(pos).parameter, out);
 		
 		}
 
 		//TID
-		pos = findEntry(t, xml_subdet_tiddet + xml_par_tail);
+		pos = specIndex.find(xml_subdet_tiddet + xml_par_tail);
 		if (pos != -1) {
 			  specParROC(t.at(pos).partselectors, t.at(pos).moduletypes, t.at(pos).parameter, out);
 		
 		}
 
         //copy rest of skeleton file unchanged
-        while (std::getline(in, line)) out << line << std::endl;
+        in.copyRest(next, out);
 
     }
     
@@ -295,16 +289,14 @@ namespace insur {
      * This function modifies the skeleton file <i>trackerProdCuts.xml</i> and writes the result to a new file
      * of the same name. Effectively, it simply adds to a long list of entries for active surfaces.
      * @param t A reference to the collection of tracker topology information
-     * @param in A reference to a file stream that is bound to the input file
-     * @param out A reference to a file stream that is bound to the output file
+     * @param in A reference to the preloaded skeleton file
+     * @param out A reference to the buffered stream bound to the output file
      */
-    void XMLWriter::prodcuts(std::vector<SpecParInfo>& t, std::ifstream& in, std::ofstream& out) {
+    void XMLWriter::prodcuts(std::vector<SpecParInfo>& t, const XMLTemplate& in, XMLStream& out) {
         unsigned int pos = 0;
-        std::string line;
-        while (std::getline(in, line) && (line.find(xml_preamble_concise) == std::string::npos)) out << line << std::endl; // scan for preamble
-        out << line << std::endl << getSimpleHeader(); // output the preamble followed by the header
+        size_t next = copyPreamble(in, out); // output the preamble followed by the header
         // head of file
-        while (std::getline(in, line) && (line.find(xml_insert_marker) == std::string::npos)) out << line << std::endl;
+        next = in.copyUntil(next, XMLTemplate::insertion, out);
         // TOB
         while ((pos < t.size()) && (t.at(pos).name.find(xml_subdet_tobdet) == std::string::npos)) pos++;
         if (pos < t.size()) {
@@ -321,7 +313,7 @@ namespace insur {
             }
         }
         // tail of file
-        while (std::getline(in, line)) out << line << std::endl;
+        in.copyRest(next, out);
     }
     
     /**
@@ -329,17 +321,15 @@ namespace insur {
      * same name. Effectively, it simply adds to two long lists of entries for active surfaces, one for those in the
      * barrel and one for those in endcap if there is one.
      * @param t A reference to the collection of tracker topology information
-     * @param in A reference to a file stream that is bound to the input file
-     * @param out A reference to a file stream that is bound to the output file
+     * @param in A reference to the preloaded skeleton file
+     * @param out A reference to the buffered stream bound to the output file
      */
-    void XMLWriter::trackersens(std::vector<SpecParInfo>& t, std::ifstream& in, std::ofstream& out) {
+    void XMLWriter::trackersens(std::vector<SpecParInfo>& t, const XMLTemplate& in, XMLStream& out) {
         unsigned int pos = 0;
-        std::string line;
-        while (std::getline(in, line) && (line.find(xml_preamble_concise) == std::string::npos)) out << line << std::endl; // scan for preamble
-        out << line << std::endl << getSimpleHeader(); // output the preamble followed by the header
+        size_t next = copyPreamble(in, out); // output the preamble followed by the header
         // TOB
         while ((pos < t.size()) && (t.at(pos).name.find(xml_subdet_tobdet) == std::string::npos)) pos++;
-        while (std::getline(in, line) && (line.find(xml_insert_marker) == std::string::npos)) out << line << std::endl;
+        next = in.copyUntil(next, XMLTemplate::insertion, out);
         if (pos < t.size()) {
             for (unsigned int i = 0; i < t.at(pos).partselectors.size(); i++) {
                 out << xml_spec_par_selector << t.at(pos).partselectors.at(i) << xml_general_endline;
@@ -348,14 +338,14 @@ namespace insur {
         pos = 0;
         // TID
         while ((pos < t.size()) && (t.at(pos).name.find(xml_subdet_tiddet) == std::string::npos)) pos++;
-        while (std::getline(in, line) && (line.find(xml_insert_marker) == std::string::npos)) out << line << std::endl;
+        next = in.copyUntil(next, XMLTemplate::insertion, out);
         if (pos < t.size()) {
             for (unsigned int i = 0; i < t.at(pos).partselectors.size(); i++) {
                 out << xml_spec_par_selector << t.at(pos).partselectors.at(i) << xml_general_endline;
             }
         }
         // tail of file
-        while (std::getline(in, line)) out << line << std::endl;
+        in.copyRest(next, out);
     }
     
     /**
@@ -365,24 +355,23 @@ namespace insur {
      * path strings from the available topology information is delegated to a private function. Once that returns, formatting
      * and output to file are taken care of in here.
      * @param t A reference to the collection of tracker topology information
-     * @param in A reference to a file stream that is bound to the input file
-     * @param out A reference to a file stream that is bound to the output file
+     * @param in A reference to the preloaded skeleton file
+     * @param out A reference to the buffered stream bound to the output file
      */
     void XMLWriter::recomaterial(std::vector<SpecParInfo>& t,
-            std::vector<RILengthInfo>& ri, std::ifstream& in, std::ofstream& out, bool wt) {
+            std::vector<RILengthInfo>& ri, const XMLTemplate& in, XMLStream& out, bool wt) {
         std::vector<PathInfo> b;
         b = buildPaths(t, b, wt);
         if (!b.empty()) {
-            std::string line;
-            while (std::getline(in, line) && (line.find(xml_preamble_concise) == std::string::npos)) out << line << std::endl; // scan for preamble
-            out << line << std::endl << getSimpleHeader(); // output the preamble followed by the header
-            while (std::getline(in, line) && (line.find(xml_insert_marker) == std::string::npos)) out << line << std::endl;
+            size_t next = copyPreamble(in, out); // output the preamble followed by the header
+            next = in.copyUntil(next, XMLTemplate::insertion, out);
+            // first RILengthInfo entry for each (barrel, layer) pair
+            std::map<std::pair<bool, int>, unsigned int> riIndex;
+            for (unsigned int i = 0; i < ri.size(); i++) riIndex.insert(std::make_pair(std::make_pair(ri.at(i).barrel, ri.at(i).index), i));
             std::vector<PathInfo>::iterator iter, guard = b.end();
             for (iter = b.begin(); iter != guard; iter++) {
-                unsigned int id;
-                for (id = 0; id < ri.size(); id++) {
-                    if ((ri.at(id).index == iter->layer) && (ri.at(id).barrel == iter->barrel)) break;
-                }
+                std::map<std::pair<bool, int>, unsigned int>::const_iterator riFound = riIndex.find(std::make_pair(iter->barrel, iter->layer));
+                unsigned int id = (riFound != riIndex.end()) ? riFound->second : ri.size();
 
                 if ((!iter->block_name.empty()) && (!iter->paths.empty())) {
                     std::vector<std::string>::iterator iiter, iguard = iter->paths.end();
@@ -400,10 +389,10 @@ namespace insur {
                         std::cerr << " in XMLWriter::recomaterial(). Using default dummy values." << std::endl;
                         out << xml_recomat_parameters;
                     }
-                    out << xml_spec_par_close << std::endl;
+                    out << xml_spec_par_close << '\n';
                 }
             }
-            while (std::getline(in, line)) out << line << std::endl;
+            in.copyRest(next, out);
         }
     }
     
@@ -412,13 +401,13 @@ namespace insur {
      * This function writes the opening and closing tags for a material section in a CMSSW XML file. It also loops through
      * the list of elementary materials and that of the composites to generate one entry each for the material section. Actual
      * XML formatting of those list elements is left to two other functions, though. All generated output is sent to an
-     * <i>ostringstream</i> that serves as a buffer for the output file contents.
+     * <i>XMLStream</i> that serves as a buffer for the output file contents.
      * @param name The label of the material section, typically the name of the output file
      * @param e A reference to the vector containing a series of elementary material definitions
      * @param c A reference to the vector containing a series of composite material definitions
      * @param stream A reference to the output buffer
      */
-    void XMLWriter::materialSection(std::string name , std::vector<Element>& e, std::vector<Composite>& c, std::ostringstream& stream) {
+    void XMLWriter::materialSection(std::string name , std::vector<Element>& e, std::vector<Composite>& c, XMLStream& stream) {
         stream << xml_material_section_open << name << xml_general_inter;
         for (unsigned int i = 0; i < e.size(); i++) elementaryMaterial(e.at(i).tag, e.at(i).density, e.at(i).atomic_number, e.at(i).atomic_weight, stream);
         for (unsigned int i = 0; i < c.size(); i++) compositeMaterial(c.at(i).name, c.at(i).density, c.at(i).method, c.at(i).elements, stream);
@@ -428,12 +417,12 @@ namespace insur {
     /**
      * This function writes the opening and closing tags for a rotation section in a CMSSW XML file, if such a block is
      * necessary. It also loops through the list of rotations, but leaves XML formatting of the individual entries to another
-     * function. All generated output is sent to an <i>ostringstream</i> that serves as a buffer for the output file contents.
+     * function. All generated output is sent to an <i>XMLStream</i> that serves as a buffer for the output file contents.
      * @param r A reference to the vector containing a series of rotation definitions
      * @param label The label of the rotation section, typically the name of the output file
      * @param stream A reference to the output buffer
      */
-  void XMLWriter::rotationSection(std::map<std::string,Rotation>& r, std::string label, std::ostringstream& stream) {
+  void XMLWriter::rotationSection(std::map<std::string,Rotation>& r, std::string label, XMLStream& stream) {
         if (!r.empty()) {
             stream << xml_rotation_section_open << label << xml_general_inter;
             for (auto const &it : r)
@@ -446,12 +435,12 @@ namespace insur {
      * This function writes the opening and closing tags for the logical part section in a CMSSW XML file that describes
      * a volume hierachy. It writes an entry for the root volume <i>Tracker</i> before looping through the list of logical
      * volumes within it. XML formatting of the those entries is left to another function, though. All generated output is sent
-     * to an <i>ostringstream</i> that serves as a buffer for the output file contents.
+     * to an <i>XMLStream</i> that serves as a buffer for the output file contents.
      * @param l A reference to the vector containing a series of logical volume definitions
      * @param label The label of the logical part section, typically the name of the output file
      * @param stream A reference to the output buffer
      */
-    void XMLWriter::logicalPartSection(std::vector<LogicalInfo>& l, std::string label, std::ostringstream& stream, bool wt) {
+    void XMLWriter::logicalPartSection(std::vector<LogicalInfo>& l, std::string label, XMLStream& stream, bool wt) {
         std::vector<LogicalInfo>::const_iterator iter, guard = l.end();
         stream << xml_logical_part_section_open << label << xml_general_inter;
         if (!wt) logicalPart(xml_tracker, xml_fileident + ":" + xml_tracker, xml_material_air, stream);
@@ -460,28 +449,21 @@ namespace insur {
     }
 
 
-    void XMLWriter::trackerLogicalVolume(std::ostringstream& stream, std::istream& instream) {
-      std::string line;
-      while (getline(instream, line)) {
-        size_t pos = line.find(xml_insert_marker);
-        if (pos != std::string::npos) {
-          line.replace(pos, xml_insert_marker.size(), xml_tracker);
-        }
-        stream << line << std::endl;
-      }
+    void XMLWriter::trackerLogicalVolume(XMLStream& stream, const XMLTemplate& instream) {
+      instream.copyReplacingMarkers(xml_tracker, stream);
     }
     
     /**
      * This function writes the opening and closing tags for the solid section in a CMSSW XML file. It writes an entry for the
      * root volume <i>Tracker</i> before looping through the list of physical shapes within it. XML formatting of all entries
-     * is left to another function, though. All generated output is sent to an <i>ostringstream</i> that serves as a buffer for
+     * is left to another function, though. All generated output is sent to an <i>XMLStream</i> that serves as a buffer for
      * the output file contents.
      * @param s A reference to the vector containing a series of physical volume definitions
      * @param so A reference to the vector containing a series of operations on physical volumes
      * @param label The label of the solid section, typically the name of the output file
      * @param stream A reference to the output buffer
      */
-    void XMLWriter::solidSection(std::vector<ShapeInfo>& s, std::vector<ShapeOperationInfo>& so, std::string label, std::ostringstream& stream, std::istream& trackerVolumeTemplate, bool notobtid, bool wt) {
+    void XMLWriter::solidSection(std::vector<ShapeInfo>& s, std::vector<ShapeOperationInfo>& so, std::string label, XMLStream& stream, const XMLTemplate& trackerVolumeTemplate, bool notobtid, bool wt) {
         stream << xml_solid_section_open << label << xml_general_inter;
         if (!wt) {
           //tubs(xml_tracker, pixel_radius, outer_radius, max_length, stream); // CUIDADO old tracker volume, now parsed from a file
@@ -523,14 +505,14 @@ namespace insur {
     /**
      * This function writes the opening and closing tags for the positioning section in a CMSSW XML file. It loops first through the
      * collection of explicit volume placements and then through those of the required placement algorithms, while leaving XML
-     * formatting of the individual entries to two other functions. All generated output is sent to an <i>ostringstream</i> that serves
+     * formatting of the individual entries to two other functions. All generated output is sent to an <i>XMLStream</i> that serves
      * as a buffer for the output file contents.
      * @param p A reference to the vector containing a series of placement definitions
      * @param a A reference to the vector containing a series of algorithm names and parameters
      * @param label The label of the position section, typically the name of the output file
      * @param stream A reference to the output buffer
      */
-    void XMLWriter::posPartSection(std::vector<PosInfo>& p, std::vector<AlgoInfo>& a, std::string label, std::ostringstream& stream) {
+    void XMLWriter::posPartSection(std::vector<PosInfo>& p, std::vector<AlgoInfo>& a, std::string label, XMLStream& stream) {
         std::vector<PosInfo>::iterator piter, pguard = p.end();
         std::vector<AlgoInfo>::iterator aiter, aguard = a.end();
         stream << xml_pos_part_section_open << label << xml_general_inter;
@@ -542,12 +524,12 @@ namespace insur {
     /**
      * This function writes the opening and closing tags for a section specifying additional parameters for various detector parts in a
      * CMSSW XML file. It also loops through the collection of parameter information but leaves formatting of the individual entries
-     * to another function. All generated output is sent to an <i>ostringstream</i> that serves as a buffer for the output file contents.
+     * to another function. All generated output is sent to an <i>XMLStream</i> that serves as a buffer for the output file contents.
      * @param t A reference to the collection of tracker topology information
      * @param label The label of the <i>SpecPar</i> section, typically the name of the output file
      * @param stream A reference to the output buffer
      */
-    void XMLWriter::specParSection(std::vector<SpecParInfo>& t, std::string label, std::ostringstream& stream) {
+    void XMLWriter::specParSection(std::vector<SpecParInfo>& t, std::string label, XMLStream& stream) {
         std::vector<SpecParInfo>::iterator titer, tguard = t.end();
         stream << xml_spec_par_section_open << label << xml_general_inter;
         for (titer = t.begin(); titer != tguard; titer++) specPar(titer->name, titer->parameter, titer->partselectors, stream);
@@ -562,7 +544,7 @@ namespace insur {
      * @param params A pre-formatted list of arguments for the algorithm
      * @param stream A reference to the output buffer
      */
-    void XMLWriter::algorithm(std::string name, std::string parent, std::vector<std::string>& params, std::ostringstream& stream) {
+    void XMLWriter::algorithm(std::string name, std::string parent, std::vector<std::string>& params, XMLStream& stream) {
         stream << xml_algorithm_open << name << xml_algorithm_parent << parent << xml_general_endline;
         for (unsigned int i = 0; i < params.size(); i++) stream << params.at(i);
         stream << xml_algorithm_close;
@@ -577,7 +559,7 @@ namespace insur {
      * @param a_weight The atomic weight of the element, in g/mole
      * @param stream A reference to the output buffer
      */
-    void XMLWriter::elementaryMaterial(std::string tag, double density, int a_number, double a_weight, std::ostringstream& stream) {
+    void XMLWriter::elementaryMaterial(std::string tag, double density, int a_number, double a_weight, XMLStream& stream) {
         stream << xml_elementary_material_open << tag << xml_elementary_material_first_inter << tag;
         stream << xml_elementary_material_second_inter << a_number << xml_elementary_material_third_inter;
         stream << a_weight << xml_elementary_material_fourth_inter << density;
@@ -594,7 +576,7 @@ namespace insur {
      * @param stream A reference to the output buffer
      */
     void XMLWriter::compositeMaterial(std::string name,
-            double density, CompType method, std::vector<std::pair<std::string, double> >& es, std::ostringstream& stream) {
+            double density, CompType method, std::vector<std::pair<std::string, double> >& es, XMLStream& stream) {
         stream << xml_composite_material_open << name << xml_composite_material_first_inter;
         stream << density << xml_composite_material_second_inter ;
         switch (method) {
@@ -623,7 +605,7 @@ namespace insur {
      * @param material The name of the material that this volume is made of
      * @param stream A reference to the output buffer
      */
-    void XMLWriter::logicalPart(std::string name, std::string solid, std::string material, std::ostringstream& stream) {
+    void XMLWriter::logicalPart(std::string name, std::string solid, std::string material, XMLStream& stream) {
         stream << xml_logical_part_open << name << xml_logical_part_first_inter << solid;
         stream << xml_logical_part_second_inter << material << xml_logical_part_close;
     }
@@ -637,7 +619,7 @@ namespace insur {
      * @param dz Half the volume length along z
      * @param stream A reference to the output buffer
      */
-    void XMLWriter::box(std::string name, double dx, double dy, double dz, std::ostringstream& stream) {
+    void XMLWriter::box(std::string name, double dx, double dy, double dz, XMLStream& stream) {
         stream << xml_box_open << name << xml_box_first_inter << dx << xml_box_second_inter << dy;
         stream << xml_box_third_inter << dz << xml_box_close;
     }
@@ -652,7 +634,7 @@ namespace insur {
      * @param dz Half the volume length along z
      * @param stream A reference to the output buffer
      */
-    void XMLWriter::trapezoid(std::string name, double dx, double dxx, double dy, double dyy, double dz, std::ostringstream& stream) {
+    void XMLWriter::trapezoid(std::string name, double dx, double dxx, double dy, double dyy, double dz, XMLStream& stream) {
         stream << xml_trapezoid_open << name << xml_trapezoid_first_inter << dx;
         stream << xml_trapezoid_second_inter << dxx << xml_trapezoid_third_inter << dy;
         stream << xml_trapezoid_fourth_inter << dyy << xml_trapezoid_fifth_inter << dz;
@@ -671,7 +653,7 @@ namespace insur {
      * @param dz Half the length of the tube
      * @param stream A reference to the output buffer
      */
-    void XMLWriter::tubs(std::string name, double rmin, double rmax, double dz, std::ostringstream& stream) {
+    void XMLWriter::tubs(std::string name, double rmin, double rmax, double dz, XMLStream& stream) {
         stream << xml_tubs_open << name << xml_tubs_first_inter << rmin << xml_tubs_second_inter << rmax;
         stream << xml_tubs_third_inter << dz << xml_tubs_close;
     }
@@ -687,7 +669,7 @@ namespace insur {
      * @param dz Half the length of the cone
      * @param stream A reference to the output buffer
      */
-    void XMLWriter::cone(std::string name, double rmin1, double rmax1, double rmin2, double rmax2, double dz, std::ostringstream& stream) {
+    void XMLWriter::cone(std::string name, double rmin1, double rmax1, double rmin2, double rmax2, double dz, XMLStream& stream) {
         stream << xml_cone_open << name << xml_cone_first_inter << rmax1 << xml_cone_second_inter << rmax2;
         stream << xml_cone_third_inter << rmin1 << xml_cone_fourth_inter << rmin2;
         stream << xml_cone_fifth_inter << dz << xml_cone_close;
@@ -706,7 +688,7 @@ namespace insur {
      * @param stream A reference to the output buffer
      */
     void XMLWriter::polycone(std::string name, std::vector<std::pair<double, double> >& rzu,
-            std::vector<std::pair<double, double> >& rzd, std::ostringstream& stream) {
+            std::vector<std::pair<double, double> >& rzd, XMLStream& stream) {
         stream << xml_polycone_open << name << xml_polycone_inter;
         for (unsigned int i = 0; i < rzu.size(); i++) {
             stream << xml_rzpoint_open << rzu.at(i).first << xml_rzpoint_inter << rzu.at(i).second << xml_rzpoint_close;
@@ -725,7 +707,7 @@ namespace insur {
      * @param rSolid2 The name of a second volume the operation is made on
      * @param stream A reference to the output buffer
      */
-    void XMLWriter::shapesUnion(std::string name, std::string rSolid1, std::string rSolid2, std::ostringstream& stream) {
+    void XMLWriter::shapesUnion(std::string name, std::string rSolid1, std::string rSolid2, XMLStream& stream) {
       stream << xml_union_open << name << xml_union_inter;
       stream << xml_rsolid_open << rSolid1 << xml_rsolid_close;
       stream << xml_rsolid_open << rSolid2 << xml_rsolid_close;
@@ -740,7 +722,7 @@ namespace insur {
      * @param rSolid2 The name of a second volume the operation is made on
      * @param stream A reference to the output buffer
      */
-    void XMLWriter::shapesIntersection(std::string name, std::string rSolid1, std::string rSolid2, std::ostringstream& stream) {
+    void XMLWriter::shapesIntersection(std::string name, std::string rSolid1, std::string rSolid2, XMLStream& stream) {
       stream << xml_intersection_open << name << xml_intersection_inter;
       stream << xml_rsolid_open << rSolid1 << xml_rsolid_close;
       stream << xml_rsolid_open << rSolid2 << xml_rsolid_close;
@@ -758,7 +740,7 @@ namespace insur {
      * @param copy The number of the child volume copy allowing different copies of the same child to be identified; <i>starts at 1</i>
      * @param stream A reference to the output buffer
      */
-    void XMLWriter::posPart(std::string parent, std::string child, std::string rotref, Translation& trans, int copy, std::ostringstream& stream) {
+    void XMLWriter::posPart(std::string parent, std::string child, std::string rotref, Translation& trans, int copy, XMLStream& stream) {
         stream << xml_pos_part_open << copy << xml_pos_part_first_inter << parent;
         stream << xml_pos_part_second_inter << child << xml_general_endline;
         if (!rotref.empty()) stream << xml_pos_part_third_inter << rotref << xml_general_endline;
@@ -778,7 +760,7 @@ namespace insur {
      * @param stream A reference to the output buffer
      */
     void XMLWriter::rotation(std::string name, double thetax, double phix,
-            double thetay, double phiy, double thetaz, double phiz, std::ostringstream& stream) {
+            double thetay, double phiy, double thetaz, double phiz, XMLStream& stream) {
         stream << xml_rotation_open << name << xml_rotation_first_inter << thetax << xml_rotation_second_inter << phix;
         stream << xml_rotation_third_inter << thetay << xml_rotation_fourth_inter << phiy << xml_rotation_fifth_inter;
         stream << thetaz << xml_rotation_sixth_inter << phiz << xml_rotation_close;
@@ -792,7 +774,7 @@ namespace insur {
      * @param z The displacement along the z axis
      * @param stream A reference to the output buffer
      */
-    void XMLWriter::translation(double x, double y, double z, std::ostringstream& stream) {
+    void XMLWriter::translation(double x, double y, double z, XMLStream& stream) {
         stream << xml_translation_open << x << xml_translation_first_inter << y << xml_translation_second_inter << z;
         stream << xml_translation_close;
     }
@@ -805,7 +787,7 @@ namespace insur {
      * @param partsel A list of logical volume names that the additional parameter applies to
      * @param stream A reference to the output buffer
      */
-    void XMLWriter::specPar1(std::string name, std::pair<std::string, std::string> param, std::vector<std::string>& partsel, std::ostringstream& stream) {
+    void XMLWriter::specPar1(std::string name, std::pair<std::string, std::string> param, std::vector<std::string>& partsel, XMLStream& stream) {
         stream << xml_spec_par_open << name << xml_general_inter;
 //std::cerr<<" >       "<<xml_spec_par_open << name << xml_general_inter<<std::endl;
         for (unsigned i = 0; i < partsel.size(); i++) {
@@ -822,7 +804,7 @@ namespace insur {
 
 
 
-    void XMLWriter::specPar(std::string name, std::pair<std::string, std::string> param, std::vector<std::string>& partsel, std::ostringstream& stream) {
+    void XMLWriter::specPar(std::string name, std::pair<std::string, std::string> param, std::vector<std::string>& partsel, XMLStream& stream) {
         stream << xml_spec_par_open << name << xml_general_inter;
         for (unsigned i = 0; i < partsel.size(); i++) {
             stream << xml_spec_par_selector << partsel.at(i) << xml_general_endline;
@@ -840,7 +822,7 @@ namespace insur {
      * @param stream A reference to the output buffer
      */
 
-	void XMLWriter::specParROC(std::vector<std::string>& partsel, std::vector<ModuleROCInfo>& minfo, std::pair<std::string, std::string> param, std::ofstream& stream) {
+	void XMLWriter::specParROC(std::vector<std::string>& partsel, std::vector<ModuleROCInfo>& minfo, std::pair<std::string, std::string> param, XMLStream& stream) {
 		for (unsigned i = 0; i < partsel.size(); i++) {
 			stream <<xml_spec_par_open << partsel.at(i)<<xml_par_tail<<xml_general_inter;
 			stream << xml_spec_par_selector <<partsel.at(i) << xml_general_endline;
@@ -861,6 +843,20 @@ namespace insur {
 
     
     //private
+    /**
+     * This function copies a skeleton file to the output up to and including the line with the XML preamble, followed by the
+     * generation header.
+     * @param in A reference to the skeleton file
+     * @param out A reference to the output stream
+     * @return The position in the skeleton file right after the preamble
+     */
+    size_t XMLWriter::copyPreamble(const XMLTemplate& in, XMLStream& out) const {
+        std::string line;
+        size_t next = in.copyUntil(0, XMLTemplate::preamble, out, &line);
+        out << line << '\n' << getSimpleHeader();
+        return next;
+    }
+
     /**
      * This function builds the topological path for every active surface from a collection of <i>SpecParInfo</i> instances.
      * @param specs The collection of topology information bundles
@@ -869,18 +865,36 @@ namespace insur {
      */
 
   std::vector<PathInfo>& XMLWriter::buildPaths(std::vector<SpecParInfo>& specs, std::vector<PathInfo>& blocks, bool wt) {
-    std::vector<PathInfo>::iterator existing;
+    int existing;
     std::string prefix, postfix, spname;
     std::vector<std::string> paths, tpaths;
     int lindex, dindex, rindex, mindex, layer = 0;
     int windex = 0;
     std::vector<PathInfo> tblocks;
     blocks.clear();
+    SpecParIndex specIndex(specs);
+    PathIndex blockIndex, tblockIndex;
     //TOB
-    lindex = findEntry(specs, xml_subdet_layer + xml_par_tail);
-    rindex = findEntry(specs, xml_subdet_straight_or_tilted_rod + xml_par_tail);
-    mindex = findEntry(specs, xml_subdet_tobdet + xml_par_tail);
+    lindex = specIndex.find(xml_subdet_layer + xml_par_tail);
+    rindex = specIndex.find(xml_subdet_straight_or_tilted_rod + xml_par_tail);
+    mindex = specIndex.find(xml_subdet_tobdet + xml_par_tail);
     if ((lindex >= 0) && (rindex >= 0) && (mindex >= 0)) {
+      // Modules belonging to each layer, in their original order: the module loop below only needs
+      // to visit those instead of all the modules of the tracker for every rod
+      std::unordered_map<std::string, std::vector<unsigned int> > layerModules;
+      for (unsigned int i = 0; i < specs.at(lindex).partselectors.size(); i++) {
+	std::string lnumber = specs.at(lindex).partselectors.at(i).substr(xml_layer.size());
+	if (layerModules.count(lnumber)) continue;
+	std::vector<unsigned int>& candidates = layerModules[lnumber];
+	for (unsigned int k = 0; k < specs.at(mindex).partselectors.size(); k++) {
+	  std::string& refstring = specs.at(mindex).partselectors.at(k);
+	  if (refstring.find(xml_barrel_module) == std::string::npos) continue;
+	  std::string mnumber = refstring.substr(xml_barrel_module.size());
+	  mnumber = mnumber.substr(0, findNumericPrefixSize(mnumber));
+	  if (refstring.find(xml_barrel_module + mnumber + xml_layer + lnumber) != std::string::npos) candidates.push_back(k);
+	}
+      }
+
       // layer loop
       for (unsigned int i = 0; i < specs.at(lindex).partselectors.size(); i++) {
 	std::string& lcurrent = specs.at(lindex).partselectors.at(i);
@@ -932,8 +946,9 @@ namespace insur {
 	    prefix = prefix + rcurrent;
 
 	    // module loop
-	    for (unsigned int k = 0; k < specs.at(mindex).partselectors.size(); k++) {
-	      std::string& refstring = specs.at(mindex).partselectors.at(k);
+	    const std::vector<unsigned int>& candidates = layerModules[lnumber];
+	    for (unsigned int c = 0; c < candidates.size(); c++) {
+	      std::string& refstring = specs.at(mindex).partselectors.at(candidates.at(c));
 	      std::string mnumber;
 
 	      if (refstring.find(xml_barrel_module) != std::string::npos) {
@@ -965,8 +980,8 @@ namespace insur {
 		}
 	      }
 	    }
-	    existing = findEntry(spname, blocks);
-	    if (existing != blocks.end()) existing->paths.insert(existing->paths.end(), paths.begin(), paths.end());
+	    existing = blockIndex.find(spname);
+	    if (existing >= 0) blocks.at(existing).paths.insert(blocks.at(existing).paths.end(), paths.begin(), paths.end());
 	    else {
 	      PathInfo pi;
 	      pi.block_name = spname;
@@ -974,6 +989,7 @@ namespace insur {
 	      pi.barrel = true;
 	      pi.paths = paths;
 	      blocks.push_back(pi);
+	      blockIndex.update(blocks);
 	    }
 	    paths.clear();
 	  }
@@ -982,10 +998,22 @@ namespace insur {
     }
     else { std::cerr << xml_subdet_layer << " or " << xml_subdet_straight_or_tilted_rod << " or " << xml_subdet_tobdet << " could not be found while building paths for trackerRecoMaterial.xml." << std::endl; }
     //TID
-    dindex = findEntry(specs, xml_subdet_wheel + xml_par_tail);
-    rindex = findEntry(specs, xml_subdet_ring + xml_par_tail);
-    windex = findEntry(specs, xml_subdet_tiddet + xml_par_tail);
+    dindex = specIndex.find(xml_subdet_wheel + xml_par_tail);
+    rindex = specIndex.find(xml_subdet_ring + xml_par_tail);
+    windex = specIndex.find(xml_subdet_tiddet + xml_par_tail);
     if ((dindex >= 0) && (rindex >= 0) && (windex >= 0)) {
+      // Modules whose name refers to each disc number, in their original order: a module can only match
+      // the postfix of one of the rings of a disc if it contains the name of the disc
+      std::unordered_map<std::string, std::vector<unsigned int> > discModules;
+      for (unsigned int i = 0; i < specs.at(dindex).partselectors.size(); i++) {
+	std::string dnumber = specs.at(dindex).partselectors.at(i).substr(xml_disc.size());
+	if (discModules.count(dnumber)) continue;
+	std::vector<unsigned int>& candidates = discModules[dnumber];
+	for (unsigned int k = 0; k < specs.at(windex).partselectors.size(); k++) {
+	  if (specs.at(windex).partselectors.at(k).find(xml_disc + dnumber) != std::string::npos) candidates.push_back(k);
+	}
+      }
+
       // disc loop
       for (unsigned int i = 0; i < specs.at(dindex).partselectors.size(); i++) {
 	std::string& dcurrent = specs.at(dindex).partselectors.at(i);
@@ -1021,8 +1049,9 @@ namespace insur {
 	    postfix = xml_endcap_module + rnumber + xml_disc + dnumber;
 
 	    // module loop
-	    for (unsigned int k=0; k<specs.at(windex).partselectors.size(); k++ ) {
-	      std::string refstring = specs.at(windex).partselectors.at(k);
+	    const std::vector<unsigned int>& candidates = discModules[dnumber];
+	    for (unsigned int c = 0; c < candidates.size(); c++) {
+	      std::string refstring = specs.at(windex).partselectors.at(candidates.at(c));
                         
 	      if (refstring.find(postfix) != std::string::npos) {
 
@@ -1051,16 +1080,16 @@ namespace insur {
 	  }
 	}
 	if (plus) {
-	  existing = findEntry(spname, blocks);
+	  existing = blockIndex.find(spname);
 	}
 	else {
-	  existing = findEntry(spname, tblocks);
+	  existing = tblockIndex.find(spname);
 	}
-	if (plus && (existing != blocks.end())) {
-	  existing->paths.insert(existing->paths.end(), paths.begin(), paths.end());
+	if (plus && (existing >= 0)) {
+	  blocks.at(existing).paths.insert(blocks.at(existing).paths.end(), paths.begin(), paths.end());
 	}
-	else if (!plus && (existing != tblocks.end())) {
-	  existing->paths.insert(existing->paths.end(), tpaths.begin(), tpaths.end());
+	else if (!plus && (existing >= 0)) {
+	  tblocks.at(existing).paths.insert(tblocks.at(existing).paths.end(), tpaths.begin(), tpaths.end());
 	}
 	else {
 	  PathInfo pi;
@@ -1070,10 +1099,12 @@ namespace insur {
 	  if (plus) {
 	    pi.paths = paths;
 	    blocks.push_back(pi);
+	    blockIndex.update(blocks);
 	  }
 	  else {
 	    pi.paths = tpaths;
 	    tblocks.push_back(pi);
+	    tblockIndex.update(tblocks);
 	  }
 	}
 	paths.clear();
@@ -1091,10 +1122,7 @@ namespace insur {
      * @return True if the provided topology representation has blocks indicating endcaps, false otherwise
      */
     bool XMLWriter::endcapsInTopology(std::vector<SpecParInfo>& specs) {
-        for (unsigned int i = 0; i < specs.size(); i++) {
-            if (specs.at(i).name.compare(xml_subdet_tiddet + xml_par_tail) == 0) return true;
-        }
-        return false;
+        return SpecParIndex(specs).find(xml_subdet_tiddet + xml_par_tail) >= 0;
     }
     
     /**
@@ -1119,36 +1147,5 @@ namespace insur {
         }
         return 0;
     }
-    
-    /**
-     * This is a custom function to find an entry in a collection of <i>SpecParInfo</i> structs
-     * @param specs The collection of available <i>SpecParInfo</i> instances
-     * @param name The requested block name
-     * @return The index of the matching entry in the collection; -1 if no such entry exists
-     */
-    int XMLWriter::findEntry(std::vector<SpecParInfo>& specs, std::string name) {
-        int index = 0;
-        while (index < (int)(specs.size())) {
-            if (specs.at(index).name.compare(name) == 0) return index;
-            index++;
-        }
-        return -1;
-    }
-    
-    /**
-     * This is a custom function to find the name of a <i>SpecPar</i> block in a nested string representation of a series of such blocks.
-     * @param name The name of the requested <i>SpecPar</i> block
-     * @param data The collection of available blocks
-     * @return An iterator pointing to the matching entry, or to <i>data.end()</i> if no such entry exists
-     */
-    std::vector<PathInfo>::iterator XMLWriter::findEntry(std::string name, std::vector<PathInfo>& data) {
-        std::vector<PathInfo>::iterator result = data.begin();
-        std::vector<PathInfo>::iterator guard = data.end();
-        while (result != guard) {
-            if ((result->block_name).compare(name) == 0) return result;
-            result++;
-        }
-        return result;
-    }
 
 }
@@ -1,23 +1,27 @@
 #include <TFile.h>
 #include <TCanvas.h>
-#include <string>
 #include <TList.h>
 #include <TKey.h>
 #include <TObject.h>
 #include <TProfile.h>
 #include <TAxis.h>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <iterator>
 #include <map>
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <thread>
 #include <time.h>
 #include <iomanip>
+#include <unistd.h>
+#include <sys/wait.h>
 #include <boost/program_options.hpp>
 
-std::ostream* osp = &std::cout;
-
 #define VNAME(x) #x
 #ifdef DEBUG
 #define VDUMP(x) std::cerr << #x << " = " << x << std::endl
@@ -25,44 +29,45 @@ std::ostream* osp = &std::cout;
 #define VDUMP(x)
 #endif
 
-void printEtaRange(double lowEta, double highEta) {
-  (*osp) << Form("   (abs(eta) >= %.04f && abs(eta) < %.04f) * ",
-                    lowEta, highEta);
+void printEtaRange(std::ostream& os, double lowEta, double highEta) {
+  os << Form("   (abs(eta) >= %.04f && abs(eta) < %.04f) * ",
+             lowEta, highEta);
 }
 
-void printPtRange(double lowPt, double highPt) {
+void printPtRange(std::ostream& os, double lowPt, double highPt) {
   if (highPt>lowPt) {
-    (*osp) << Form("(pt >= %.04f && pt < %.04f) * ",
-                   lowPt, highPt);
+    os << Form("(pt >= %.04f && pt < %.04f) * ",
+               lowPt, highPt);
   } else {
-    (*osp) << Form("(pt >= %.04f) * ",
-                   lowPt);
+    os << Form("(pt >= %.04f) * ",
+               lowPt);
   }
 }
 
-void printNewLine(bool last) {
-  if (!last) (*osp) << " + \\" << std::endl;
-  else (*osp) << std::endl << "}" << std::endl;;
+void printNewLine(std::ostream& os, bool last) {
+  if (!last) os << " + \\" << std::endl;
+  else os << std::endl << "}" << std::endl;;
 }
 
-void printResolutionScale(double resolution1,
+void printResolutionScale(std::ostream& os,
+                          double resolution1,
                           double pt1,
                           double resolution2,
                           double pt2) {
   if (pt1==pt2) {
-    (*osp) << Form("(%.8f)", resolution1);
+    os << Form("(%.8f)", resolution1);
   } else { 
     // Linear scaling!
-    (*osp) << Form("(%f + "                 // resolution1
-                   "(pt-%f)"                // pt1
-                   "* %f)",                 // (res2-res1) / (pt2-pt1)
-                   resolution1, pt1,
-                   (resolution2-resolution1)/(pt2-pt1) );
+    os << Form("(%f + "                 // resolution1
+               "(pt-%f)"                // pt1
+               "* %f)",                 // (res2-res1) / (pt2-pt1)
+               resolution1, pt1,
+               (resolution2-resolution1)/(pt2-pt1) );
   }
 }
 
-void printResolutionStandardWorsen(double myResolution, double myPt) {
-  (*osp) << Form("(%f*pt/%f)", myResolution, myPt);
+void printResolutionStandardWorsen(std::ostream& os, double myResolution, double myPt) {
+  os << Form("(%f*pt/%f)", myResolution, myPt);
 }
 
 // Get current date/time, format is YYYY-MM-DD.HH:mm:ss
@@ -78,73 +83,205 @@ const std::string currentDateTime() {
     return buf;
 }
 
+
+// The resolutions of one layout, by pT and by (rebinned) eta slice
+struct ResolutionTable {
+  std::vector<double> etaEdges;                    // newBins+1 edges
+  std::map<double, std::vector<double> > byMomentum; // pT [GeV] -> resolution per eta slice (fraction)
+};
+
+// Reads the pT profiles of a tkLayout output file, rebinning each of them to
+// the eta slicing and keeping its bin contents as soon as it is found: the
+// primitives of the canvas are walked once, and no profile is looked up again
+bool readResolutions(const std::string& rootFileName, double etaSlice, ResolutionTable& table) {
+  TFile inputFile(rootFileName.c_str(), "READ");
+  if (inputFile.IsZombie()) {
+    std::cerr << "File '" << rootFileName << "' does not exist" << std::endl;
+    return false;
+  }
+
+  // Read pt profiles > browse;
+  TKey* key = (TKey*)inputFile.GetListOfKeys()->At(0);
+  TObject* myObject = key ? key->ReadObj() : nullptr;
+  if (myObject && std::string(myObject->ClassName())=="TCanvas") {
+
+    TCanvas* aCanvas = (TCanvas*) myObject;
+    TIter next(aCanvas->GetListOfPrimitives());
+    int rebinScale = 0;
+    while (TObject* aPrimitive = next()) {
+
+      // TProfile
+      if (std::string(aPrimitive->ClassName())!="TProfile") continue;
+      TProfile* myProfile = (TProfile*)aPrimitive;
+      double aMomentum;
+      if (sscanf(myProfile->GetName(), "pt_vs_eta%lftracker_profile", &aMomentum)!=1 &&
+          sscanf(myProfile->GetName(), "Total_pt_vs_eta%lftracker_profile", &aMomentum)!=1) continue;
+
+      // First profile -> get eta, rescale bins, ...
+      if (!rebinScale) {
+        VDUMP(myProfile->GetXaxis()->GetXmax());
+        VDUMP(myProfile->GetXaxis()->GetXmin());
+        double originalEtaStep = myProfile->GetXaxis()->GetBinWidth(1);
+        VDUMP(originalEtaStep);
+        rebinScale = std::max(1, int(etaSlice / originalEtaStep));
+        VDUMP(rebinScale);
+      }
+      TProfile* rebinned = (TProfile*) myProfile->Rebin(rebinScale, "delphize_rebinned");
+      int newBins = rebinned->GetXaxis()->GetNbins();
+      if (table.etaEdges.empty()) {
+        VDUMP(newBins);
+        for (int iBin=1; iBin<=newBins; ++iBin) table.etaEdges.push_back(rebinned->GetXaxis()->GetBinLowEdge(iBin));
+        table.etaEdges.push_back(rebinned->GetXaxis()->GetBinUpEdge(newBins));
+      }
+      if (newBins+1 == int(table.etaEdges.size())) {
+        std::vector<double>& resolutions = table.byMomentum[aMomentum];
+        resolutions.resize(newBins);
+        for (int iBin=1; iBin<=newBins; ++iBin) resolutions[iBin-1] = rebinned->GetBinContent(iBin)/100.;
+      } else {
+        std::cerr << "Warning: profile " << myProfile->GetName() << " in '" << rootFileName << "' has a different eta binning, skipped" << std::endl;
+      }
+      delete rebinned;
+    }
+  }
+  delete myObject;
+  inputFile.Close();
+
+  // Check that non-zero profile map
+  if (table.byMomentum.empty()) {
+    std::cerr << "Error: the collection of profiles in '" << rootFileName << "' is empty" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// OK, for each eta slice (rebinned bins) we will compute
+// an interpolation formula. Keep your finger crossed...
+void printResolutionFormula(std::ostream& os, const ResolutionTable& table, const std::string& layoutName, const std::string& author) {
+  os << "#" << std::endl;
+  os << "# Automatically generated tracker resolution formula for layout: " << layoutName << std::endl;
+  os << "#" << std::endl;
+  os << "#  By " << author << " on: " << currentDateTime() << std::endl;
+  os << "#" << std::endl;
+  os << "set ResolutionFormula { ";
+
+  // Looping on eta range first:
+  int newBins = table.etaEdges.size() - 1;
+  for (int iBin=0; iBin<newBins; ++iBin) {
+
+    // Get eta
+    double lowEta  = table.etaEdges[iBin];
+    double highEta = table.etaEdges[iBin+1];
+
+    // Loop over pT
+    for (auto it = table.byMomentum.begin(); it!=table.byMomentum.end(); ++it) {
+
+      auto nextItem = std::next(it);
+
+      double myPt         = it->first;
+      double myResolution = it->second[iBin];
+      printEtaRange(os, lowEta, highEta);
+      if (it==table.byMomentum.begin()) {
+        // From here down the resolution will be always the same
+        printPtRange(os, 0, myPt);
+        printResolutionScale(os, myResolution, myPt, myResolution, myPt);
+        printNewLine(os, false);
+        printEtaRange(os, lowEta, highEta);
+      }
+      if (nextItem==table.byMomentum.end()) {
+        // From here up the resolution will just scale with pT
+        printPtRange(os, myPt, -1);
+        printResolutionStandardWorsen(os, myResolution, myPt);
+        printNewLine(os, iBin==newBins-1); // true if it is the last
+      }
+      else {
+        double nextPt         = nextItem->first;
+        double nextResolution = nextItem->second[iBin];
+        printPtRange(os, myPt, nextPt);
+        printResolutionScale(os, myResolution, myPt, nextResolution, nextPt);
+        printNewLine(os, false);
+      }
+    }
+  }
+}
+
+// Converts one tkLayout output file into the Delphes card <layoutName>_Delphes.conf.
+// The card is composed in memory and written in one go, so that a failed
+// conversion does not leave a truncated card behind.
+bool delphize(const std::string& rootFileName, const std::string& layoutName, const std::string& author, double etaSlice) {
+  ResolutionTable table;
+  if (!readResolutions(rootFileName, etaSlice, table)) return false;
+
+  std::ostringstream card;
+  printResolutionFormula(card, table, layoutName, author);
+
+  // Delphes output file
+  std::string delphesName = layoutName+"_Delphes.conf";
+  std::ofstream outFile(delphesName);
+  if (!outFile.is_open() || !(outFile << card.str())) {
+    std::cerr << "ERROR: could not write " << delphesName << std::endl;
+    return false;
+  }
+
+  std::ostringstream momenta;
+  for (const auto& it : table.byMomentum) momenta << " " << it.first;
+  std::cout << layoutName << ": using momenta [GeV]:" << momenta.str() << " -> " << delphesName << std::endl;
+  return true;
+}
+
+// Default layout name: the input file name without its directory and extension
+std::string layoutNameFromFile(const std::string& rootFileName) {
+  std::string name = rootFileName.substr(rootFileName.find_last_of('/')+1);
+  return name.substr(0, name.find_last_of('.'));
+}
+
 int main(int argc, char* argv[]) {
 
   //
   // Define variables
   std::string usage("Usage: ");
   usage += argv[0];
-  usage += " [options]";
+  usage += " [options] [input files]";
 
-  std::string rootFileName;
-  std::string layoutName;
-  TFile* inputFile       = nullptr;
-  std::ofstream* outFile = nullptr;
+  std::vector<std::string> rootFileNames;
+  std::vector<std::string> layoutNames;
 
   double      etaSlice = 0.0;
   std::string author   = "";
+  int         nJobs    = 0;
 
   //
   // Program options
   boost::program_options::options_description help("Program options");
   help.add_options()
     ("help,h"        , "Display help")
-    ("input-file,i"  , boost::program_options::value<std::string>()                                        , "Specify name of input root file (from tkLayout), containing canvas with pT profiles")
-    ("layout-name,n" , boost::program_options::value<std::string>()                                        , "Specify given layout name")
+    ("input-file,i"  , boost::program_options::value<std::vector<std::string> >(&rootFileNames)             , "Specify name of input root file (from tkLayout), containing canvas with pT profiles (can be repeated, or given as positional arguments)")
+    ("layout-name,n" , boost::program_options::value<std::vector<std::string> >(&layoutNames)               , "Specify given layout name, one per input file (optional: default = input file name without extension)")
     ("author,a"      , boost::program_options::value<std::string>(&author)->default_value("Unknown author"), "Specify author of DELPHES file (optional: default = Unknown author)")
     ("eta-slicing,s" , boost::program_options::value<double>(&etaSlice)->default_value(0.2)                , "Specify eta slicing <0.0?; 1.0>, e.g. 0.1, 0.2, ... (optional: default = 0.2)")
+    ("jobs,j"        , boost::program_options::value<int>(&nJobs)->default_value(0)                         , "Specify the number of layouts converted in parallel, each in its own process (optional: default = 0 = number of cores)")
     ;
+  boost::program_options::positional_options_description positional;
+  positional.add("input-file", -1);
 
   // Read user input
   boost::program_options::variables_map varMap;
   try {
 
     // Parse user defined options
-    boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(help).run(), varMap);
+    boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(help).positional(positional).run(), varMap);
     boost::program_options::notify(varMap);
 
-    // Check
-    if      (etaSlice <= 0.0 || etaSlice > 1.0)                     throw boost::program_options::invalid_option_value("eta-slicing");
-    else if (!varMap.count("input-file")  && !varMap.count("help")) throw boost::program_options::error("Forgot to define input root file???");
-    else if (!varMap.count("layout-name") && !varMap.count("help")) throw boost::program_options::error("Forgot to define layout name???");
-    else {
-
-      // Write help
-      if (varMap.count("help")) {
-        std::cout << usage << std::endl << help << std::endl;
-        return -1;
-      }
-
-      // Check that the provided ROOT input file corresponds to an existing file.
-      rootFileName = varMap["input-file"].as<std::string>();
-      inputFile = new TFile(rootFileName.c_str(),"READ");
-      if (!inputFile) {
-        std::cerr << "File '" << rootFileName << "' does not exist" << std::endl;
-        return 0;
-      }
-
-      // Delphes output file
-      outFile = new std::ofstream();
-      layoutName = varMap["layout-name"].as<std::string>();
-      std::string delphesName  = layoutName+"_Delphes.conf";
-      outFile->open(delphesName);
-      if (outFile->is_open()) {
-        osp = outFile;
-      } else {
-        std::cerr << "ERROR: could not open " << outFile << " -> writing config to the screen" << std::endl;
-        return -1;
-      }
+    // Write help
+    if (varMap.count("help")) {
+      std::cout << usage << std::endl << help << std::endl;
+      return -1;
     }
+
+    // Check
+    if      (etaSlice <= 0.0 || etaSlice > 1.0) throw boost::program_options::invalid_option_value("eta-slicing");
+    else if (nJobs < 0)                         throw boost::program_options::invalid_option_value("jobs");
+    else if (rootFileNames.empty())             throw boost::program_options::error("Forgot to define input root file???");
+    else if (!layoutNames.empty() && layoutNames.size()!=rootFileNames.size()) throw boost::program_options::error("Give either no layout name or one per input file");
   }catch(boost::program_options::error& e) {
 
     // Display error type
@@ -153,131 +290,56 @@ int main(int argc, char* argv[]) {
     return -1;
   }
 
-  std::map<double, TProfile*> ptProfiles;
+  for (size_t i=layoutNames.size(); i<rootFileNames.size(); ++i) layoutNames.push_back(layoutNameFromFile(rootFileNames[i]));
 
-  // Read pt profiles > browse;
-  TKey* key = (TKey*)inputFile->GetListOfKeys()->At(0);
-  if (key) {
-
-    // Object
-    TObject* myObject = key->ReadObj();
-    if (myObject) {
-
-      // Canvas
-      std::string aClass=myObject->ClassName();
-      if (aClass=="TCanvas") {
-
-        TCanvas* aCanvas = (TCanvas*) myObject;
-        TList* aList=aCanvas->GetListOfPrimitives();
-        for (int i=0; i<aList->GetSize(); ++i) {
-
-          // TProfile
-          std::string aClassName = aList->At(i)->ClassName();
-          if (aClassName=="TProfile") {
-
-            TProfile* myProfile = (TProfile*)aList->At(i);
-            //std::cerr << "TProfile: " << myProfile->GetName() << std::endl;
-            double aMomentum;
-            if (sscanf(myProfile->GetName(), "pt_vs_eta%lftracker_profile", &aMomentum)==1) {
-              //std::cerr << "Momentum [GeV]: " << aMomentum << std::endl;
-              ptProfiles[aMomentum]=(TProfile*) myProfile->Clone();
-            }
-            else if (sscanf(myProfile->GetName(), "Total_pt_vs_eta%lftracker_profile", &aMomentum)==1) {
-              //std::cerr << "Momentum [GeV]: " << aMomentum << std::endl;
-              ptProfiles[aMomentum]=(TProfile*) myProfile->Clone();
-
-            }
-          }
-        }
-      }
+  // Each layout is written to <layout name>_Delphes.conf: two layouts with the same name would overwrite each other's file
+  std::map<std::string, std::string> fileOfLayout;
+  for (size_t i=0; i<rootFileNames.size(); ++i) {
+    auto inserted = fileOfLayout.insert(std::make_pair(layoutNames[i], rootFileNames[i]));
+    if (!inserted.second) {
+      std::cerr << "\nERROR: " << inserted.first->second << " and " << rootFileNames[i] << " have the same layout name " << layoutNames[i]
+                << ", both would be written to " << layoutNames[i] << "_Delphes.conf: give distinct names with --layout-name" << std::endl << std::endl;
+      return -1;
     }
   }
-  //inputFile->Close();
 
-  // Check that non-zero profile map
-  auto itPtProfiles = ptProfiles.begin();
-  
-  if (itPtProfiles==ptProfiles.end()) {
-    std::cerr << "Error: the collection of profiles is empty" << std::endl;
-    return false;
-  }
-  
-  // First profile -> get eta, rescale bins, ...
-  TProfile* exampleProfile = itPtProfiles->second;
-
-  double maxEta = exampleProfile->GetXaxis()->GetXmax();
-  VDUMP(maxEta);
-  double minEta = exampleProfile->GetXaxis()->GetXmin();
-  VDUMP(minEta);
-  double originalEtaStep = exampleProfile->GetXaxis()->GetBinWidth(1);
-  VDUMP(originalEtaStep);
-  int rebinScale = etaSlice / originalEtaStep;
-  VDUMP(rebinScale);
-  for (auto it = ptProfiles.begin(); it!=ptProfiles.end(); ++it) it->second->Rebin(rebinScale);
-  int newBins = exampleProfile->GetXaxis()->GetNbins();
-  VDUMP(newBins);
-
-  // OK, for each eta slice (rebinned bins) we will compute
-  // an interpolation formula. Keep your finger crossed...
-  
-  // Looping on eta range first:
-  double lowEta, highEta;
-  double myResolution, nextResolution;
-  double myPt, nextPt;
-  (*osp) << "#" << std::endl;
-  (*osp) << "# Automatically generated tracker resolution formula for layout: " << layoutName << std::endl;
-  (*osp) << "#" << std::endl;
-  (*osp) << "#  By " << author << " on: " << currentDateTime() << std::endl;
-  (*osp) << "#" << std::endl;
-  (*osp) << "set ResolutionFormula { ";
-
-  for (int iBin=1; iBin<=newBins; ++iBin) {
-
-    // Get eta
-    lowEta  = exampleProfile->GetXaxis()->GetBinLowEdge(iBin);
-    highEta = exampleProfile->GetXaxis()->GetBinUpEdge(iBin);
-
-    // Loop over pT
-    for (auto it = ptProfiles.begin(); it!=ptProfiles.end(); ++it) {
-
-      auto nextItem = (++it)--;
-
-      double aMomentum = it->first;
-      if (iBin==1) std::cout << "Using momentum [GeV]: " << std::setw(6) << aMomentum << std::endl;
-
-      TProfile* myProfile = it->second;
-      myPt         = it->first;
-      myResolution = myProfile->GetBinContent(iBin)/100.;
-      printEtaRange(lowEta, highEta);
-      if (it==ptProfiles.begin()) {
-        // From here down the resolution will be always the same
-        printPtRange(0, myPt);
-        printResolutionScale(myResolution, myPt, myResolution, myPt);
-        printNewLine(false);
-        printEtaRange(lowEta, highEta);
-      }
-      if (nextItem==ptProfiles.end()) {
-        // From here up the resolution will just scale with pT
-        printPtRange(myPt, -1);
-        printResolutionStandardWorsen(myResolution, myPt);
-        printNewLine(iBin==newBins); // true if it is the last
-      }
-      else {
-        TProfile* nextProfile = nextItem->second;
-        nextPt = nextItem->first;
-        nextResolution = nextProfile->GetBinContent(iBin)/100.;
-        printPtRange(myPt, nextPt);
-        printResolutionScale(myResolution, myPt, nextResolution, nextPt);
-        printNewLine(false);
-      }
+  // A single layout is converted right here
+  if (rootFileNames.size()==1) return delphize(rootFileNames[0], layoutNames[0], author, etaSlice) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+  // Several layouts are converted by worker processes rather than threads, as
+  // ROOT objects are not thread safe: each worker opens its own file and owns
+  // all the ROOT objects it creates
+  if (!nJobs) nJobs = std::max(1u, std::thread::hardware_concurrency());
+  std::cout.flush();
+  std::cerr.flush();
+  std::map<pid_t, std::string> running;
+  int failures = 0;
+  auto waitForOne = [&]() {
+    int status;
+    pid_t pid = wait(&status);
+    if (pid < 0) return;
+    if (!WIFEXITED(status) || WEXITSTATUS(status)!=EXIT_SUCCESS) {
+      std::cerr << "ERROR: the conversion of layout " << running[pid] << " failed" << std::endl;
+      ++failures;
+    }
+    running.erase(pid);
+  };
+  for (size_t i=0; i<rootFileNames.size(); ++i) {
+    while (int(running.size()) >= nJobs) waitForOne();
+    pid_t pid = fork();
+    if (pid == 0) {
+      bool done = delphize(rootFileNames[i], layoutNames[i], author, etaSlice);
+      std::cout.flush();
+      std::cerr.flush();
+      _exit(done ? EXIT_SUCCESS : EXIT_FAILURE);
+    } else if (pid < 0) {
+      std::cerr << "ERROR: could not start the conversion of layout " << layoutNames[i] << std::endl;
+      ++failures;
+    } else {
+      running[pid] = layoutNames[i];
     }
   }
+  while (!running.empty()) waitForOne();
 
-  // Close file
-  inputFile->Close();
-  delete inputFile;
-  outFile->close();
-  delete outFile;
-
-  return true;
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -1,5 +1,12 @@
 #include <global_funcs.h>
 
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <locale>
+
 template<typename T> const std::vector<std::string> EnumTraits<T>::data = {};
 
 template<> std::string StringConverter<_NOT_STRING_ENUM>::str2any<std::string>(const std::string& from) { return from; };
@@ -11,6 +18,159 @@ template<> bool StringConverter<_NOT_STRING_ENUM>::str2any<bool>(const std::stri
 }
 
 
+// Stream-free conversions of the arithmetic types. They give the same
+// results as the stream versions in the classic locale: same characters
+// taken from the input, 0 when nothing can be read, the closest limit on
+// overflow, and the same printf formats for the output. With any other
+// locale the streams are used.
+namespace {
+  bool classicLocale() {
+    const char* point = localeconv()->decimal_point;
+    return point[0] == '.' && point[1] == '\0' && std::locale() == std::locale::classic();
+  }
+
+  template<typename T> T streamStr2any(const std::string& from) {
+    std::stringstream ssfrom(from);
+    T to;
+    ssfrom >> to;
+    return to;
+  }
+
+  template<typename T> std::string streamAny2str(const T& from, int precision) {
+    std::stringstream to("");
+    if (precision > -1) {
+      to.precision(precision);
+      to.setf(std::ios::fixed, std::ios::floatfield);
+    }
+    to << from;
+    return to.str();
+  }
+
+  bool isStreamSpace(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+  template<typename T> T parseInteger(const std::string& from) {
+    const char* c = from.c_str();
+    while (isStreamSpace(*c)) ++c;
+    bool negative = *c == '-';
+    if (*c == '-' || *c == '+') ++c;
+    if (*c < '0' || *c > '9') return T(0);
+    typedef unsigned long long Magnitude;
+    const bool negativeLimit = std::numeric_limits<T>::is_signed && negative;
+    const Magnitude limit = negativeLimit ? Magnitude(-(std::numeric_limits<T>::min() + 1)) + 1 : Magnitude(std::numeric_limits<T>::max());
+    Magnitude magnitude = 0;
+    bool overflow = false;
+    for (; *c >= '0' && *c <= '9'; ++c) {
+      unsigned digit = *c - '0';
+      if (magnitude > (limit - digit)/10) overflow = true;
+      else magnitude = magnitude*10 + digit;
+    }
+    if (overflow) return negativeLimit ? std::numeric_limits<T>::min() : std::numeric_limits<T>::max();
+    return negative ? T(-magnitude) : T(magnitude); // unsigned types wrap around, as with strtoul
+  }
+
+  // Number of characters a stream takes for a floating point number: a sign,
+  // digits with at most one decimal point, and an exponent after some digit
+  size_t floatLength(const char* c) {
+    const char* begin = c;
+    if (*c == '+' || *c == '-') ++c;
+    bool mantissa = false, point = false;
+    for (;; ++c) {
+      if (*c >= '0' && *c <= '9') mantissa = true;
+      else if (*c == '.' && !point) point = true;
+      else break;
+    }
+    if ((*c == 'e' || *c == 'E') && mantissa) {
+      ++c;
+      if (*c == '+' || *c == '-') ++c;
+      while (*c >= '0' && *c <= '9') ++c;
+    }
+    return c - begin;
+  }
+
+  template<typename T> T parseFloat(const std::string& from, T (*convert)(const char*, char**)) {
+    if (!classicLocale()) return streamStr2any<T>(from);
+    const char* c = from.c_str();
+    while (isStreamSpace(*c)) ++c;
+    size_t length = floatLength(c);
+    if (!length) return T(0);
+    // The conversion must take exactly the characters the stream would have taken
+    char buffer[64];
+    std::string longText;
+    const char* text = c;
+    if (c[length] != '\0') {
+      if (length < sizeof(buffer)) {
+        memcpy(buffer, c, length);
+        buffer[length] = '\0';
+        text = buffer;
+      } else {
+        longText.assign(c, length);
+        text = longText.c_str();
+      }
+    }
+    char* end;
+    T value = convert(text, &end);
+    if (end != text + length) return T(0);
+    if (value == std::numeric_limits<T>::infinity()) return std::numeric_limits<T>::max();
+    if (value == -std::numeric_limits<T>::infinity()) return -std::numeric_limits<T>::max();
+    return value;
+  }
+
+  float toFloat(const char* text, char** end) { return strtof(text, end); }
+  double toDouble(const char* text, char** end) { return strtod(text, end); }
+  long double toLongDouble(const char* text, char** end) { return strtold(text, end); }
+
+  template<typename T> std::string formatInteger(T from) {
+    typedef typename std::make_unsigned<T>::type Magnitude;
+    bool negative = std::numeric_limits<T>::is_signed && from < T(0);
+    Magnitude magnitude = negative ? Magnitude(0) - Magnitude(from) : Magnitude(from);
+    char buffer[24];
+    char* end = buffer + sizeof(buffer);
+    char* c = end;
+    do {
+      *--c = '0' + magnitude % 10;
+      magnitude /= 10;
+    } while (magnitude);
+    if (negative) *--c = '-';
+    return std::string(c, end);
+  }
+
+  // %g with 6 digits by default, as the streams, and %f with the given precision
+  template<typename T> std::string formatFloat(T from, int precision, bool longDouble) {
+    if (!classicLocale()) return streamAny2str(from, precision);
+    const char* format = precision > -1 ? (longDouble ? "%.*Lf" : "%.*f") : (longDouble ? "%.*Lg" : "%.*g");
+    if (precision < 0) precision = 6;
+    char buffer[64];
+    int length = longDouble ? snprintf(buffer, sizeof(buffer), format, precision, (long double)from) : snprintf(buffer, sizeof(buffer), format, precision, (double)from);
+    if (length < int(sizeof(buffer))) return std::string(buffer, length);
+    std::string text(length + 1, '\0');
+    if (longDouble) snprintf(&text[0], text.size(), format, precision, (long double)from);
+    else snprintf(&text[0], text.size(), format, precision, (double)from);
+    text.resize(length);
+    return text;
+  }
+}
+
+#define define_integer_conversions(T) \
+  template<> T StringConverter<_NOT_STRING_ENUM>::str2any<T>(const std::string& from) { return parseInteger<T>(from); } \
+  template<> std::string StringConverter<_NOT_STRING_ENUM>::any2str<T>(const T& from, int) { return formatInteger(from); }
+
+#define define_float_conversions(T, convert) \
+  template<> T StringConverter<_NOT_STRING_ENUM>::str2any<T>(const std::string& from) { return parseFloat<T>(from, convert); } \
+  template<> std::string StringConverter<_NOT_STRING_ENUM>::any2str<T>(const T& from, int precision) { return formatFloat(from, precision, std::is_same<T, long double>::value); }
+
+define_integer_conversions(short)
+define_integer_conversions(unsigned short)
+define_integer_conversions(int)
+define_integer_conversions(unsigned int)
+define_integer_conversions(long)
+define_integer_conversions(unsigned long)
+define_integer_conversions(long long)
+define_integer_conversions(unsigned long long)
+define_float_conversions(float, toFloat)
+define_float_conversions(double, toDouble)
+define_float_conversions(long double, toLongDouble)
+
+
 std::vector<std::string> split(const std::string& str, const std::string& seps, bool keepEmpty) {
   std::vector<std::string> tokens;
   std::string token;
@@ -15,6 +15,7 @@
 #include <boost/filesystem/operations.hpp>
 
 #include <sys/types.h>
+#include <sys/stat.h>
 
 #include <mainConfigHandler.h>
 
@@ -431,11 +432,58 @@ string ConfigInputOutput::getIncludedFile(string fileName) {
   }
 }
 
+namespace {
+
+  // Appends text to content, with every line prefixed by indent
+  void appendIndented(string& content, const string& text, const string& indent) {
+    if (indent.empty()) {
+      content += text;
+      return;
+    }
+    for (size_t begin = 0, end; begin < text.size(); begin = end + 1) {
+      end = text.find('\n', begin);
+      if (end == string::npos) end = text.size();
+      content += indent;
+      content.append(text, begin, end - begin);
+      content += '\n';
+    }
+  }
+}
+
+mainConfigHandler::FileStamp mainConfigHandler::fileStamp(const string& fileName) {
+  FileStamp stamp;
+  struct stat status;
+  if (stat(fileName.c_str(), &status) != 0) return stamp;
+  stamp.seconds = status.st_mtime;
+#if defined(__APPLE__)
+  stamp.nanoseconds = status.st_mtimespec.tv_nsec;
+#else
+  stamp.nanoseconds = status.st_mtim.tv_nsec;
+#endif
+  stamp.size = status.st_size;
+  return stamp;
+}
+
+/**
+ * Expands the @include and @include-std directives of a configuration file.
+ * Every included file is expanded once and kept, with all its own includes,
+ * in a cache checked against the modification times and sizes of the files: the
+ * following includes of the same file, from this layout or from the next
+ * ones, reuse the expanded content. The result is written with a single
+ * write to the output stream.
+ * @return the names of this file and of all the files it includes
+ */
 std::set<string> mainConfigHandler::preprocessConfiguration(ConfigInputOutput cfgInOut) {
+  PreprocessedFile result;
+  expandConfiguration(cfgInOut, result);
+  cfgInOut.os.write(result.content.data(), result.content.size());
+  return result.includeSet;
+}
+
+bool mainConfigHandler::expandConfiguration(ConfigInputOutput& cfgInOut, PreprocessedFile& result) {
   using namespace std;
 
   istream& is = cfgInOut.is;
-  ostream& os = cfgInOut.os;
   const string& absoluteFileName = cfgInOut.absoluteFileName;
   const string& relativeFileName = cfgInOut.relativeFileName;
   bool& standardInclude = cfgInOut.standardInclude;
@@ -458,12 +506,14 @@ std::set<string> mainConfigHandler::preprocessConfiguration(ConfigInputOutput cf
   // Avoid double-counting: files included from this one should be
   // counted only once
   clearGraphLinks(thisFileId);
-  std::string full_path = boost::filesystem::system_complete(absoluteFileName).string();
 
   string line;
   int numLine = 1;
-  std::set<string> includeSet;
-  includeSet.insert(absoluteFileName);
+  result.includeSet.insert(absoluteFileName);
+  result.fileStamps.push_back(make_pair(absoluteFileName, fileStamp(absoluteFileName)));
+  result.node.absoluteFileName = absoluteFileName;
+  result.node.relativeFileName = relativeFileName;
+  result.node.standardInclude = standardInclude;
 
   while(getline(is, line).good()) {
     if (line.find("//") != string::npos) line = line.erase(line.find("//"));
@@ -499,36 +549,88 @@ std::set<string> mainConfigHandler::preprocessConfiguration(ConfigInputOutput cf
 	fullIncludedFileName = getStandardIncludeDirectory()+ "/" + nextIncludeFileName;
       } else {
 	fullIncludedFileName = cfgInOut.getIncludedFile(nextIncludeFileName);
+	result.usesIncludePath = true;
       }
       includedFileId = getFileId(fullIncludedFileName);
-      
-      ifstream ifs(fullIncludedFileName);
-
-      if (ifs) {
-        stringstream ss;
-	ConfigInputOutput nextIncludeInputOutput(ifs, ss);
-	nextIncludeInputOutput.includePathList=cfgInOut.includePathList;
-	nextIncludeInputOutput.standardInclude=(includeStdOld || includeStdNew);
-	nextIncludeInputOutput.absoluteFileName=fullIncludedFileName;
-	nextIncludeInputOutput.relativeFileName=nextIncludeFileName;
-	nextIncludeInputOutput.webOutput=cfgInOut.webOutput;
-        auto&& moreIncludes = preprocessConfiguration(nextIncludeInputOutput);
 
+      const PreprocessedFile* included = expandInclude(cfgInOut, fullIncludedFileName, nextIncludeFileName, includeStdOld || includeStdNew);
+      if (included) {
 	// Graph node links
 	addGraphLink(thisFileId, includedFileId);
-        includeSet.insert(moreIncludes.begin(), moreIncludes.end());
-        string indent = line.substr(0, line.find_first_not_of(" \t"));
-
-        while (getline(ss, line).good()) {
-          os << indent << line << endl;   
-        }
+        result.includeSet.insert(included->includeSet.begin(), included->includeSet.end());
+        result.fileStamps.insert(result.fileStamps.end(), included->fileStamps.begin(), included->fileStamps.end());
+        result.node.children.push_back(included->node);
+        result.node.children.back().relativeFileName = nextIncludeFileName;
+        result.usesIncludePath |= included->usesIncludePath;
+        result.complete &= included->complete;
+        appendIndented(result.content, included->content, line.substr(0, line.find_first_not_of(" \t")));
       } else {
         cerr << "ERROR: ignoring " << ( (includeStdOld||includeStdNew) ? "@include-std" : "@include" ) << " directive in " << absoluteFileName << ":" << numLine << " : could not open included file : " << nextIncludeFileName << endl;
+        result.complete = false;
       }
     } else {
-      os << line << endl;
+      result.content += line;
+      result.content += '\n';
     }
     numLine++;
   }
-  return includeSet;
+  return result.complete;
+}
+
+/**
+ * Gives the expansion of an included file, from the cache if none of the
+ * files it is made of changed since it was expanded
+ * @return nullptr if the file could not be opened
+ */
+const mainConfigHandler::PreprocessedFile* mainConfigHandler::expandInclude(const ConfigInputOutput& parent, const string& fullIncludedFileName, const string& relativeFileName, bool standardInclude) {
+  boost::system::error_code error;
+  string canonicalName = boost::filesystem::canonical(fullIncludedFileName, error).string();
+  if (error) return nullptr;
+
+  // The expansion only depends on the include path list if some @include
+  // was looked up in it: otherwise it is kept under the path alone
+  string key = canonicalName + (standardInclude ? "\n@include-std\n" : "\n@include\n");
+  string contextKey = key;
+  for (const auto& aPath : parent.includePathList) contextKey += aPath + "\n";
+
+  for (const string* aKey : { &key, &contextKey }) {
+    auto cached = preprocessCache_.find(*aKey);
+    if (cached == preprocessCache_.end()) continue;
+    const PreprocessedFile& file = cached->second;
+    bool upToDate = file.complete && file.node.absoluteFileName == fullIncludedFileName;
+    for (auto it = file.fileStamps.begin(); upToDate && it != file.fileStamps.end(); ++it) upToDate = fileStamp(it->first) == it->second;
+    if (!upToDate) continue;
+    replayIncludeNode(file.node, relativeFileName, parent.webOutput);
+    return &file;
+  }
+
+  ifstream ifs(fullIncludedFileName);
+  if (!ifs) return nullptr;
+  ConfigInputOutput nextIncludeInputOutput(ifs, parent.os); // nothing is written to the stream: the expansion goes to the cache
+  nextIncludeInputOutput.includePathList=parent.includePathList;
+  nextIncludeInputOutput.standardInclude=standardInclude;
+  nextIncludeInputOutput.absoluteFileName=fullIncludedFileName;
+  nextIncludeInputOutput.relativeFileName=relativeFileName;
+  nextIncludeInputOutput.webOutput=parent.webOutput;
+  PreprocessedFile expanded;
+  expandConfiguration(nextIncludeInputOutput, expanded);
+
+  // No expansion is in use past this point, so the cache can be emptied when it grows too large
+  if (preprocessCache_.size() >= MaxPreprocessedFiles) preprocessCache_.clear();
+  PreprocessedFile& file = preprocessCache_[expanded.usesIncludePath ? contextKey : key];
+  file = std::move(expanded);
+  return &file;
+}
+
+// Adds to the graph the nodes and links that the expansion of a cached file would have added
+void mainConfigHandler::replayIncludeNode(const IncludeNode& node, const string& relativeFileName, bool webOutput) {
+  int nodeId = getFileId(node.absoluteFileName);
+  setNodeLocal(node.absoluteFileName, !node.standardInclude);
+  prepareNodeOutput(node.absoluteFileName, relativeFileName, webOutput);
+  clearGraphLinks(nodeId);
+  for (const auto& child : node.children) {
+    int childId = getFileId(child.absoluteFileName);
+    replayIncludeNode(child, child.relativeFileName, webOutput);
+    addGraphLink(nodeId, childId);
+  }
 }
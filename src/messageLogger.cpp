@@ -1,23 +1,28 @@
 #include <messageLogger.h>
+#include <algorithm>
+#include <cstdlib>
 
 //bool MessageLogger::wasModified[MessageLogger::NumberOfLevels];
-std::vector<LogMessage> MessageLogger::logMessageV;
+std::vector<LogMessage> MessageLogger::levelMessages_[MessageLogger::NumberOfLevels];
+std::unordered_multimap<uint64_t, string> MessageLogger::uniqueMessages_;
+std::mutex MessageLogger::mutex_;
+std::atomic<unsigned long> MessageLogger::nextSequence_(0);
+std::atomic<MessageLogger::PendingMessage*> MessageLogger::pendingMessages_(NULL);
 int MessageLogger::countInstances = 0;
 
 //  enum {UNKNOWN, ERROR, WARNING, INFO, DEBUG, NumberOfLevels};
 std::string MessageLogger::shortLevelCode[] = { "??", "EE", "WW", "II", "DD" };
 int MessageLogger::messageCounter[NumberOfLevels];
 
-// Global static pointer used to ensure a single instance of the class.
-MessageLogger* MessageLogger::myInstance_ = NULL;
+std::atomic<int> MessageLogger::screenLevel_(MessageLogger::ERROR);
 
-// Returns the instance (if already present) or creates one if needed
+// Returns the instance, created on first use from any thread; it is never destroyed, so it can log until the very end
 MessageLogger* MessageLogger::instance() {
-  return myInstance_ ? myInstance_ : (myInstance_ = new MessageLogger);
+  static MessageLogger* myInstance = new MessageLogger;
+  return myInstance;
 }
 
 MessageLogger::MessageLogger() {
-  screenLevel_ = ERROR;
   if (countInstances==0) {
     for (unsigned int i=0; i<NumberOfLevels; ++i)
       messageCounter[i]=0;
@@ -25,41 +30,115 @@ MessageLogger::MessageLogger() {
   ++countInstances;
 }
 
-bool MessageLogger::addMessage(string sourceFunction, string message, int level /*=UNKNOWN*/, bool unique /*=false*/ ) {
-  if(unique) {
-    if(uniqueMessages.count(message) == 0) {
-      uniqueMessages.insert(message);
-    } else {
-      return false;
+// Messages still queued at exit are stored and echoed as usual, and their queue entries freed
+void MessageLogger::collectPendingAtExit() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  collectPending();
+}
+
+// FNV-1a hash of the message text, to look up the unique messages
+uint64_t MessageLogger::messageHash(const string& message) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : message) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+bool MessageLogger::storeMessage(const string& sourceFunction, LogMessage& newMessage, bool unique) {
+  int level = newMessage.level;
+  if (unique) {
+    uint64_t hash = messageHash(newMessage.message);
+    auto known = uniqueMessages_.equal_range(hash);
+    for (auto it = known.first; it != known.second; ++it) {
+      if (it->second == newMessage.message) return false;
     }
+    uniqueMessages_.insert(std::make_pair(hash, newMessage.message));
   }
-    
-  if (level<=screenLevel_) {
+
+  if (level<=screenLevel_.load(std::memory_order_relaxed)) {
     std::cout << "(" + shortLevelCode[level]+ ") "
-	      << sourceFunction<<": " << message << std::endl;
+	      << sourceFunction<<": " << newMessage.message << std::endl;
   }
 
-  if (level==DEBUG) { // TODO: this could be more efficient
-     for (int i=sourceFunction.length(); i<20; ++i) message=" "+ message;
-     message = "[" + sourceFunction+"]: " + message;
+  if (level==DEBUG) {
+    std::string padding(sourceFunction.length() < 20 ? 20 - sourceFunction.length() : 0, ' ');
+    newMessage.message = "[" + sourceFunction + "]: " + padding + newMessage.message;
   }
 
   if ((level>=0)&&(level<NumberOfLevels)) {
-    LogMessage newMessage;
-    newMessage.level=level;
-    newMessage.message=message;
-    logMessageV.push_back(newMessage);
+    levelMessages_[level].push_back(std::move(newMessage));
     messageCounter[level]++;
     return true;
   } else return false;
 }
 
+bool MessageLogger::addMessage(string sourceFunction, string message, int level /*=UNKNOWN*/, bool unique /*=false*/ ) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  collectPending();
+  LogMessage newMessage;
+  newMessage.level = level;
+  newMessage.message = std::move(message);
+  newMessage.sequence = nextSequence_.fetch_add(1, std::memory_order_relaxed);
+  return storeMessage(sourceFunction, newMessage, unique);
+}
+
 bool MessageLogger::addMessage(string sourceFunction, ostringstream& message, int level /*=UNKNOWN*/, bool unique /*=false*/ ) {
   string newMessage = message.str();
   return addMessage(sourceFunction, newMessage, level, unique);
 }
 
+/**
+ * Adds a message from any thread. The message is only queued here: it is
+ * filtered, echoed and stored when the main thread next uses the logger.
+ * @return false if the level is invalid
+ */
+bool MessageLogger::enqueueMessage(const string& sourceFunction, const string& message, int level /*=UNKNOWN*/, bool unique /*=false*/ ) {
+  if ((level<0)||(level>=NumberOfLevels)) return false;
+  static bool flushedAtExit = (std::atexit(collectPendingAtExit) == 0);
+  (void)flushedAtExit;
+  PendingMessage* pending = new PendingMessage;
+  pending->sourceFunction = sourceFunction;
+  pending->logMessage.level = level;
+  pending->logMessage.message = message;
+  pending->logMessage.sequence = nextSequence_.fetch_add(1, std::memory_order_relaxed);
+  pending->unique = unique;
+  pending->next = pendingMessages_.load(std::memory_order_relaxed);
+  while (!pendingMessages_.compare_exchange_weak(pending->next, pending, std::memory_order_release, std::memory_order_relaxed));
+  return true;
+}
+
+// Moves the queued messages to the level buffers, in the order they were queued
+void MessageLogger::collectPending() {
+  if (!pendingMessages_.load(std::memory_order_relaxed)) return;
+  PendingMessage* pending = pendingMessages_.exchange(NULL, std::memory_order_acquire);
+  PendingMessage* ordered = NULL;
+  while (pending) {
+    PendingMessage* next = pending->next;
+    pending->next = ordered;
+    ordered = pending;
+    pending = next;
+  }
+  while (ordered) {
+    PendingMessage* next = ordered->next;
+    storeMessage(ordered->sourceFunction, ordered->logMessage, ordered->unique);
+    delete ordered;
+    ordered = next;
+  }
+}
+
+// Messages queued by other threads can arrive after later ones from the main thread
+void MessageLogger::sortLevel(int level) {
+  std::vector<LogMessage>& messages = levelMessages_[level];
+  auto earlier = [](const LogMessage& a, const LogMessage& b) { return a.sequence < b.sequence; };
+  if (!std::is_sorted(messages.begin(), messages.end(), earlier))
+    std::stable_sort(messages.begin(), messages.end(), earlier);
+}
+
 bool MessageLogger::hasEmptyLog(int level) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  collectPending();
   if ((level>=0)&&(level<NumberOfLevels)) {
     return (messageCounter[level]==0);
   }
@@ -67,34 +146,54 @@ bool MessageLogger::hasEmptyLog(int level) {
 }
 
 string MessageLogger::getLatestLog(int level) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  collectPending();
   string result="";
   if ((level>=0)&&(level<NumberOfLevels)) {
-    std::vector<LogMessage>::iterator itMessage;
-    //std::vector<LogMessage>::iterator nextMessage;
-    for (itMessage=logMessageV.begin();
-	 itMessage!=logMessageV.end(); ) {
-      if (itMessage->level==level) {
-        result += (*itMessage).message+"\n";
-	//nextMessage=itMessage+1;
-	messageCounter[itMessage->level]--;
-        logMessageV.erase(itMessage);
-	//itMessage=nextMessage;
-      } else {
-	++itMessage;
-      }
+    sortLevel(level);
+    std::vector<LogMessage>& messages = levelMessages_[level];
+    size_t length = 0;
+    for (const LogMessage& m : messages) length += m.message.size() + 1;
+    result.reserve(length);
+    for (const LogMessage& m : messages) {
+      result += m.message;
+      result += '\n';
     }
+    messages.clear();
+    messageCounter[level] = 0;
   }
   return result;
 }
 
+// Merges the levels in order of arrival
 string MessageLogger::getLatestLog() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  collectPending();
   string result="";
-  std::vector<LogMessage>::iterator itMessage=logMessageV.begin();
-  while (itMessage!=logMessageV.end()) {
-    result += "(" + shortLevelCode[itMessage->level]+ ") " + itMessage->message+"\n";
-    messageCounter[itMessage->level]--;
-    logMessageV.erase(itMessage);
-    itMessage=logMessageV.begin();
+  size_t position[NumberOfLevels];
+  size_t length = 0;
+  for (int level=0; level<NumberOfLevels; ++level) {
+    sortLevel(level);
+    position[level] = 0;
+    for (const LogMessage& m : levelMessages_[level]) length += m.message.size() + shortLevelCode[level].size() + 4;
+  }
+  result.reserve(length);
+  while (true) {
+    int next = -1;
+    for (int level=0; level<NumberOfLevels; ++level) {
+      if (position[level] < levelMessages_[level].size() &&
+          (next < 0 || levelMessages_[level][position[level]].sequence < levelMessages_[next][position[next]].sequence))
+        next = level;
+    }
+    if (next < 0) break;
+    const LogMessage& m = levelMessages_[next][position[next]++];
+    result += "(" + shortLevelCode[next] + ") ";
+    result += m.message;
+    result += '\n';
+  }
+  for (int level=0; level<NumberOfLevels; ++level) {
+    levelMessages_[level].clear();
+    messageCounter[level] = 0;
   }
   return result;
 }
@@ -10,12 +10,18 @@ using namespace std;
 double ptError::IP_length = 70;     // mm
 double ptError::B = insur::magnetic_field; // T
 
+// Range of pT where the trigger efficiency is looked for
+double ptError::minimumPt = 0.3;  // GeV/c
+double ptError::maximumPt = 30;   // GeV/c
+
 void ptError::defaultParameters() {
   Module_pitch = defaultModulePitch;
   Module_strip_l = defaultStripLength;
   Module_z = defaultModuleZ;
   Module_r = defaultModuleR;
   Module_d = defaultModuleD;
+  Module_ed = defaultModuleD;
+  Module_tilt = 0;
   Module_h = defaultModuleHeight;
   zCorrelation = defaultZCorrelation;
   moduleType = ModuleSubdetector::BARREL; // Barrel is the default moduleType 
@@ -137,6 +143,53 @@ double ptError::probabilityInside(double cut, double value, double value_err) {
   return probabilityInside_norm(mycut, myvalue);
 }
 
+double ptError::stripsToP(double strips) const {
+  double A = 0.3 * B * Module_r / 1000. / 2.; // GeV
+  double x = strips * Module_pitch;
+  return A * sqrt( pow(Module_ed/x,2) + 1 );
+}
+
+double ptError::pToStrips(double p) const {
+  double A = 0.3 * B * Module_r / 1000. / 2.; // GeV
+  double a = pow(p/A,2);
+  return Module_ed / sqrt(a-1) / Module_pitch;
+}
+
+double ptError::geometricEfficiency() const {
+  double theta = atan2(Module_r, Module_z);
+  double inefficiency = fabs(Module_d / (zCorrelation==SAMESEGMENT ? Module_strip_l : Module_h) / tan(theta+Module_tilt));
+  return 1-inefficiency;
+}
+
+// Probability for a track of transverse momentum p to pass the cut of the module
+double ptError::triggerProbability(double p, double ptCut, double geometricEfficiency) {
+  return geometricEfficiency * probabilityInside(1/ptCut, 1/p, computeError(p)/p);
+}
+
+/**
+ * Finds the pT at which the trigger probability reaches the target, by
+ * bisection of log(pT) between minimumPt and maximumPt: the probability
+ * only grows with pT, so each step halves the interval in log scale
+ * @return the pT, or -1 if the probability is not reached within the range,
+ * or not within 1E-5 before the interval collapses or after 100 steps
+ */
+double ptError::findProbability(double target, double ptCut, double geometricEfficiency) {
+  double lowerPt = minimumPt;
+  double higherPt = maximumPt;
+
+  if (target < triggerProbability(lowerPt, ptCut, geometricEfficiency) ||
+      target > triggerProbability(higherPt, ptCut, geometricEfficiency)) return -1; // probability not reachable within desired pt range
+
+  for (int i=0; i<100 && higherPt > lowerPt*(1+1E-9); ++i) {
+    double testPt = sqrt(lowerPt*higherPt);
+    double testProbability = triggerProbability(testPt, ptCut, geometricEfficiency);
+    if (fabs(testProbability-target)<1E-5) return testPt;
+    if (testProbability>target) higherPt = testPt;
+    else lowerPt = testPt;
+  }
+  return -1; // could not converge
+}
+
 /* */
 
 
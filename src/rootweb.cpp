@@ -456,7 +456,7 @@ RootWContent::~RootWContent() {
   while(!itemList_.empty()) {
     myItem = (*itemList_.begin());
     if (myItem!=NULL) {
-      //delete myItem;
+      delete myItem; // items are created for one content only
       myItem = NULL;
     }
     itemList_.erase(itemList_.begin());
@@ -658,6 +658,7 @@ RootWPage::RootWPage() {
   site_ = NULL;
   targetDirectory_ = "";
   alert_ = 0;
+  rendered_ = false;
 }
 
 RootWPage::RootWPage(string title) {
@@ -665,9 +666,11 @@ RootWPage::RootWPage(string title) {
   site_ = NULL;
   targetDirectory_ = "";
   alert_ = 0;
+  rendered_ = false;
 }
 
 RootWPage::~RootWPage() {
+  for (RootWContent* myContent : contentList_) delete myContent;
 }
 
 void RootWPage::setTargetDirectory(string newTargetDirectory) {
@@ -727,16 +730,10 @@ ostream& RootWPage::dump(ostream& output) {
   
   // Header standard part, with the menu list, etc...
   // up to opening the primaryContent div
+  // The contents are written first, as rendering can still set the alert shown in the menu
+  render();
   site_->dumpHeader(output, this);
-  
-  vector<RootWContent*>::iterator it;
-  RootWContent* myContent;
-  for (it = contentList_.begin(); it != contentList_.end(); ++it) {
-    myContent =(*it);
-    myContent->setTargetDirectory(targetDirectory_);
-    myContent->setPage(this);
-    myContent->dump(output);
-  }
+  output << body_;
   
   // Header standard part, with copyright, etc...
   // starting from closing the primaryContent div
@@ -752,6 +749,35 @@ ostream& RootWPage::dump(ostream& output) {
 }
 
 
+/**
+ * Builds the contents of the page, if a builder was given, and writes them
+ * out: the images and files are saved and the html is kept for dump(). The
+ * contents are then deleted, so that the plots of a page do not stay in
+ * memory while the next ones are made. Contents added afterwards are
+ * ignored.
+ */
+void RootWPage::render() {
+  if (rendered_) return;
+  if (builder_) {
+    builder_(*this);
+    builder_ = nullptr;
+  }
+  // Saving to the summary file changes the current ROOT directory: put it back, so that
+  // the histograms made after this page is rendered do not end up in the summary file
+  TDirectory* currentDirectory = gDirectory;
+  ostringstream body;
+  for (RootWContent* myContent : contentList_) {
+    myContent->setTargetDirectory(targetDirectory_);
+    myContent->setPage(this);
+    myContent->dump(body);
+    delete myContent;
+  }
+  contentList_.clear();
+  if (currentDirectory) currentDirectory->cd();
+  body_ = body.str();
+  rendered_ = true;
+}
+
 void RootWPage::setRelevance(int newRelevance) {
   relevance = newRelevance;
 }
@@ -784,6 +810,7 @@ RootWSite::RootWSite() {
   summaryFile_ = nullptr;
   createSummaryFile_ = true;
   summaryFileName_ = "summary.root";
+  targetPrepared_ = false;
 }
 
 RootWSite::RootWSite(string title) {
@@ -797,6 +824,7 @@ RootWSite::RootWSite(string title) {
   summaryFile_ = nullptr;
   createSummaryFile_ = true;
   summaryFileName_ = "summary.root";
+  targetPrepared_ = false;
 }
 
 RootWSite::RootWSite(string title, string comment) {
@@ -810,6 +838,7 @@ RootWSite::RootWSite(string title, string comment) {
   summaryFile_ = nullptr;
   createSummaryFile_ = true;
   summaryFileName_ = "summary.root";
+  targetPrepared_ = false;
 }
 
 RootWSite::~RootWSite() {
@@ -978,12 +1007,9 @@ ostream& RootWSite::dumpHeader(ostream& output, RootWPage* thisPage) {
   
 }
 
-bool RootWSite::makeSite(bool verbose) {
-  ofstream myPageFile;
-  RootWPage* myPage;
-  string myPageFileName;
-  //string targetStyleDirectory = targetDirectory_ + "/style";
-
+// Creates the target directory and the summary file, the first time it is called
+bool RootWSite::prepareTarget() {
+  if (targetPrepared_) return true;
 
   // Check if the directory already exists
   if (boost::filesystem::exists( targetDirectory_ )) {
@@ -1005,12 +1031,42 @@ bool RootWSite::makeSite(bool verbose) {
   //}
   //boost::filesystem::create_symlink(styleDirectory_, targetStyleDirectory);
   
-  vector<RootWPage*>::iterator it;
   if (createSummaryFile_) {
+    TDirectory* currentDirectory = gDirectory;
     summaryFile_ = new TFile(Form("%s/%s",
 				  targetDirectory_.c_str(),
 				  summaryFileName_.c_str()), "RECREATE");
+    if (currentDirectory) currentDirectory->cd();
   } else summaryFile_ = nullptr;
+  targetPrepared_ = true;
+  return true;
+}
+
+/**
+ * Renders the pages added since the last call, writing their images and
+ * files to the target directory and freeing their contents. The html
+ * pages themselves are only written by makeSite(), when the menu is complete.
+ * @return false if the target directory could not be created
+ */
+bool RootWSite::renderPages() {
+  if (!prepareTarget()) return false;
+  for (RootWPage* myPage : pageList_) {
+    if (myPage->isRendered()) continue;
+    myPage->setTargetDirectory(targetDirectory_);
+    myPage->render();
+  }
+  return true;
+}
+
+bool RootWSite::makeSite(bool verbose) {
+  ofstream myPageFile;
+  RootWPage* myPage;
+  string myPageFileName;
+  //string targetStyleDirectory = targetDirectory_ + "/style";
+
+  if (!renderPages()) return false;
+
+  vector<RootWPage*>::iterator it;
   for (it=pageList_.begin(); it!=pageList_.end(); it++) {
     myPage = (*it);
     if (verbose) std::cout << " " << myPage->getTitle() << std::flush;
@@ -1021,7 +1077,12 @@ bool RootWSite::makeSite(bool verbose) {
     myPageFile.close();
   }
   if (verbose) std::cout << " ";
-  if (summaryFile_) summaryFile_->Close();
+  if (summaryFile_) {
+    summaryFile_->Close();
+    delete summaryFile_;
+    summaryFile_ = nullptr;
+  }
+  targetPrepared_ = false;
 
   return true;
 }
@@ -39,101 +39,77 @@ namespace insur {
         wr.setExtendedHeader(extendedHeaderStream.str());
         wr.setSimpleHeader(simpleHeaderStream.str());
         
-        // translate collected information to XML and write to buffers
-        std::ifstream instream;
-        std::ofstream outstream;
+        // preload the skeleton files, so that nothing is touched on disk if one of them is missing
+        XMLTemplate pixbarTemplate, pixfwdTemplate, trackerVolumeTemplate, topologyTemplate, prodcutsTemplate, trackersensTemplate, recomatTemplate;
+        try {
+            if (!wt) {
+                if (!pixbarTemplate.load(xmlpath + "/" + xml_pixbarfile)) throw std::runtime_error("Error opening the pixbar skeleton file.");
+                if (!pixfwdTemplate.load(xmlpath + "/" + xml_pixfwdfile)) throw std::runtime_error("Error opening the pixfwd skeleton file.");
+            }
+            trackerVolumeTemplate.load(xmlpath + "/" + xml_trackervolumefile); // without it the tracker volume is simply left out
+            if (!topologyTemplate.load(xmlpath + "/" + (wt ? xml_newtopologyfile : xml_topologyfile))) throw std::runtime_error("Error opening the topology skeleton file.");
+            if (!prodcutsTemplate.load(xmlpath + "/" + xml_prodcutsfile)) throw std::runtime_error("Error opening the prodcuts skeleton file.");
+            if (!trackersensTemplate.load(xmlpath + "/" + xml_trackersensfile)) throw std::runtime_error("Error opening the trackersens skeleton file.");
+            if (!recomatTemplate.load(xmlpath + "/" + (wt ? xml_newrecomatfile : xml_recomatfile))) throw std::runtime_error("Error opening the recomaterial skeleton file.");
+        }
+        catch (std::runtime_error& e) {
+            std::cerr << "Error reading files: " << e.what() << std::endl;
+            std::cerr << "No files were changed." <<std::endl;
+            return;
+        }
+
+        // translate collected information to XML: the files are independent of each other and are written concurrently
         try {
             if (bfs::exists(outpath)) bfs::rename(outpath, tmppath);
             bfs::create_directory(outpath);
 
+            std::string trackerfile = wt ? xml_newtrackerfile : xml_trackerfile;
+            std::vector<std::future<void> > jobs; // after everything the jobs use: if anything goes wrong, it waits for them first
+            std::vector<std::string> written;
             if (!wt) {
-                instream.open((xmlpath + "/" + xml_pixbarfile).c_str());
-                outstream.open((outpath + xml_pixbarfile).c_str());
-                if (instream.fail() || outstream.fail()) throw std::runtime_error("Error opening one of the pixbar files.");
-                //writeSimpleHeader(outstream);
-                wr.pixbar(data.shapes, instream, outstream);
-                if (outstream.fail()) throw std::runtime_error("Error writing to pixbar file.");
-                instream.close();
-                instream.clear();
-                outstream.close();
-                outstream.clear();
-                std::cout << "CMSSW modified pixel barrel has been written to " << outpath << xml_pixbarfile << std::endl;
-
-                instream.open((xmlpath + "/" + xml_pixfwdfile).c_str());
-                outstream.open((outpath + xml_pixfwdfile).c_str());
-                if (instream.fail() || outstream.fail()) throw std::runtime_error("Error opening one of the pixfwdn files.");
-                //writeSimpleHeader(outstream);
-                wr.pixfwd(data.shapes, instream, outstream);
-                if (outstream.fail()) throw std::runtime_error("Error writing to pixfwd file.");
-                instream.close();
-                instream.clear();
-                outstream.close();
-                outstream.clear();
-                std::cout << "CMSSW modified pixel endcap has been written to " << outpath << xml_pixfwdfile << std::endl;
+                jobs.push_back(std::async(std::launch::async, [&]() {
+                    writeXmlFile(outpath + xml_pixbarfile, "pixbar", [&](XMLStream& out) { wr.pixbar(data.shapes, pixbarTemplate, out); });
+                }));
+                written.push_back("CMSSW modified pixel barrel has been written to " + outpath + xml_pixbarfile);
+                jobs.push_back(std::async(std::launch::async, [&]() {
+                    writeXmlFile(outpath + xml_pixfwdfile, "pixfwd", [&](XMLStream& out) { wr.pixfwd(data.shapes, pixfwdTemplate, out); });
+                }));
+                written.push_back("CMSSW modified pixel endcap has been written to " + outpath + xml_pixfwdfile);
             }
-            if (wt) outstream.open((outpath + xml_newtrackerfile).c_str());
-            else outstream.open((outpath + xml_trackerfile).c_str());
-            if (outstream.fail()) throw std::runtime_error("Error opening tracker file for writing.");
-            std::ifstream trackerVolumeTemplate((xmlpath + "/" + xml_trackervolumefile).c_str());
-            wr.tracker(data, outstream, trackerVolumeTemplate, wt);
-            if (outstream.fail()) throw std::runtime_error("Error writing to tracker file.");
-            outstream.close();
-            outstream.clear();
-            std::cout << "CMSSW tracker geometry output has been written to " << outpath << (wt ? xml_newtrackerfile : xml_trackerfile) << std::endl;
+            jobs.push_back(std::async(std::launch::async, [&]() {
+                writeXmlFile(outpath + trackerfile, "tracker", [&](XMLStream& out) { wr.tracker(data, out, trackerVolumeTemplate, wt); });
+            }));
+            written.push_back("CMSSW tracker geometry output has been written to " + outpath + trackerfile);
+            jobs.push_back(std::async(std::launch::async, [&]() {
+                writeXmlFile(outpath + xml_topologyfile, "topology", [&](XMLStream& out) { wr.topology(data.specs, topologyTemplate, out); });
+            }));
+            written.push_back("CMSSW topology output has been written to " + outpath + xml_topologyfile);
+            jobs.push_back(std::async(std::launch::async, [&]() {
+                writeXmlFile(outpath + xml_prodcutsfile, "prodcuts", [&](XMLStream& out) { wr.prodcuts(data.specs, prodcutsTemplate, out); });
+            }));
+            written.push_back("CMSSW prodcuts output has been written to " + outpath + xml_prodcutsfile);
+            jobs.push_back(std::async(std::launch::async, [&]() {
+                writeXmlFile(outpath + xml_trackersensfile, "trackersens", [&](XMLStream& out) { wr.trackersens(data.specs, trackersensTemplate, out); });
+            }));
+            written.push_back("CMSSW sensor surface output has been written to " + outpath + xml_trackersensfile);
+            jobs.push_back(std::async(std::launch::async, [&]() {
+                writeXmlFile(outpath + xml_recomatfile, "recomaterial", [&](XMLStream& out) { wr.recomaterial(data.specs, data.lrilength, recomatTemplate, out, wt); });
+            }));
+            written.push_back("CMSSW reco material output has been written to " + outpath + xml_recomatfile);
 
-            if (wt) instream.open((xmlpath + "/" + xml_newtopologyfile).c_str());
-            else instream.open((xmlpath + "/" + xml_topologyfile).c_str());
-            outstream.open((outpath + xml_topologyfile).c_str());
-            if (instream.fail() || outstream.fail()) throw std::runtime_error("Error opening one of the topology files.");
-            //writeSimpleHeader(outstream);
-            wr.topology(data.specs, instream, outstream);
-            if (outstream.fail()) throw std::runtime_error("Error writing to topology file.");
-            instream.close();
-            instream.clear();
-            outstream.close();
-            outstream.clear();
-            std::cout << "CMSSW topology output has been written to " << outpath << xml_topologyfile << std::endl;
-
-            instream.open((xmlpath + "/" + xml_prodcutsfile).c_str());
-            outstream.open((outpath + xml_prodcutsfile).c_str());
-            if (instream.fail() || outstream.fail()) throw std::runtime_error("Error opening one of the prodcuts files.");
-            //writeSimpleHeader(outstream);
-            wr.prodcuts(data.specs, instream, outstream);
-            if (outstream.fail()) throw std::runtime_error("Error writing to prodcuts file.");
-            instream.close();
-            instream.clear();
-            outstream.close();
-            outstream.clear();
-            std::cout << "CMSSW prodcuts output has been written to " << outpath << xml_prodcutsfile << std::endl;
-
-            instream.open((xmlpath + "/" + xml_trackersensfile).c_str());
-            outstream.open((outpath + xml_trackersensfile).c_str());
-            if (instream.fail() || outstream.fail()) throw std::runtime_error("Error opening one of the trackersens files.");
-            //writeSimpleHeader(outstream);
-            wr.trackersens(data.specs, instream, outstream);
-            if (outstream.fail()) throw std::runtime_error("Error writing trackersens to file.");
-            instream.close();
-            instream.clear();
-            outstream.close();
-            outstream.clear();
-            std::cout << "CMSSW sensor surface output has been written to " << outpath << xml_trackersensfile << std::endl;
-
-            if (wt) instream.open((xmlpath + "/" + xml_newrecomatfile).c_str());
-            else instream.open((xmlpath + "/" + xml_recomatfile).c_str());
-            outstream.open((outpath + xml_recomatfile).c_str());
-            if (instream.fail() || outstream.fail()) throw std::runtime_error("Error opening one of the recomaterial files.");
-            //writeSimpleHeader(outstream);
-            wr.recomaterial(data.specs, data.lrilength, instream, outstream, wt);
-            if (outstream.fail()) throw std::runtime_error("Error writing recomaterial to file.");
-            instream.close();
-            instream.clear();
-            outstream.close();
-            outstream.clear();
-            std::cout << "CMSSW reco material output has been written to " << outpath << xml_recomatfile << std::endl;
+            // wait for all the files before reporting the first error, if any, whatever the jobs threw
+            std::string error;
+            for (unsigned int i = 0; i < jobs.size(); i++) {
+                try { jobs.at(i).get(); }
+                catch (std::exception& e) { if (error.empty()) error = e.what(); }
+                catch (...) { if (error.empty()) error = "Unknown error while writing the files."; }
+            }
+            if (!error.empty()) throw std::runtime_error(error);
+            for (unsigned int i = 0; i < written.size(); i++) std::cout << written.at(i) << std::endl;
 
             bfs::remove_all(tmppath);
         }
-        catch (std::runtime_error& e) {
+        catch (std::exception& e) { // the jobs are destroyed, hence joined, before getting here
             std::cerr << "Error writing files: " << e.what() << std::endl;
             if (bfs::exists(outpath)) bfs::remove_all(outpath);
             if (bfs::exists(tmppath)) bfs::rename(tmppath, outpath);
@@ -142,6 +118,22 @@ namespace insur {
     }
     
     // private
+    /**
+     * Write one of the XML files through a buffered stream.
+     * @param filename The full name of the output file
+     * @param what A short description of the file for the error messages
+     * @param writer The function writing the file contents to the stream
+     */
+    void tk2CMSSW::writeXmlFile(const std::string& filename, const std::string& what, std::function<void(XMLStream&)> writer) {
+        std::ofstream outstream(filename.c_str());
+        if (outstream.fail()) throw std::runtime_error("Error opening " + what + " file for writing.");
+        XMLStream out(outstream);
+        writer(out);
+        out.flush();
+        outstream.close();
+        if (outstream.fail()) throw std::runtime_error("Error writing to " + what + " file.");
+    }
+
     /**
      * This prints the contents of the internal CMSSWBundle collection; used for debugging.
      */
@@ -16,7 +16,7 @@ int main(int argc, char* argv[]) {
   int verbosity;
   int randseed; 
 
-  std::string basename, optfile, xmldir, htmldir;
+  std::string basename, optfile, xmldir, htmldir, resultsfile, socketpath;
   
   po::options_description shown("Analysis options");
   shown.add_options()
@@ -36,10 +36,12 @@ int main(int argc, char* argv[]) {
     ("all,a", "Report all analyses, except extended\ntrigger and debug page. (implies all other relevant\nreport options)")
     ("graph,g", "Build and report neighbour graph.")
     ("xml", po::value<std::string>(&xmldir)->implicit_value(""), "Produce XML output files for materials.\nOptional arg specifies the subdirectory\nof the output directory (chosen via inst\nscript) where to create XML files.\nIf not supplied, the config file name (minus extension)\nwill be used as subdir.")
-    ("html-dir", po::value<std::string>(&htmldir), "Override the default html output dir\n(equal to the tracker name in the main\ncfg file) with the one specified.")
+    ("html-dir", po::value<std::string>(&htmldir), "Override the default html output dir\n(equal to the tracker name in the main\ncfg file) with the one specified, inside the\nlayout directory unless it is absolute.")
+    ("export", po::value<std::string>(&resultsfile), "Write the per-module and per-track results\nto the given ROOT file, as flat trees.")
+    ("serve", po::value<std::string>(&socketpath), "Build the tracker and its material once, then\nanswer material, resolution and module queries\non the given UNIX socket, one request per line\n(\"help\" lists them), until \"shutdown\".")
     ("verbosity", po::value<int>(&verbosity)->default_value(1), "Levels of details in the program's output (overridden by the option 'quiet').")
     ("quiet", "No output is produced, except the required messages (equivalent to verbosity 0, overrides the option 'verbosity')")
-    ("performance", "Outputs the CPU time needed for each computing step (overrides the option 'quiet').")
+    ("performance", "Outputs the wall-clock and CPU time needed for each computing step (overrides the option 'quiet'). The full profile is shown on the log page of the website.")
     ("randseed", po::value<int>(&randseed)->default_value(0xcafebabe), "Set the random seed\nIf explicitly set to 0, seed is random")
     ("pixelxml", "Produce XML output files for pixel.\nThe config file name (minus extension)\nwill be used as subdir.");
     
@@ -57,6 +59,7 @@ int main(int argc, char* argv[]) {
     ("charge", po::value<std::string>(), "Particle charge")
     ("instance-id", po::value<std::string>(), "Id of the program instance, to tag the output file with")
     ("tracks-dir", po::value<std::string>(), "Override the default tracksim output dir.\nIf not supplied, the files will be saved in\nthe working dir")
+    ("tracksim-threads", po::value<std::string>(), "N. of threads simulating the events.\nIf not supplied, one per processor core")
     ;
 
   po::options_description otheropt("Other options");
@@ -129,10 +132,15 @@ int main(int argc, char* argv[]) {
     // The tracker (and possibly pixel) must be build in any case
   if (!squid.buildTracker()) return EXIT_FAILURE;
 
-  if (!vm.count("tracksim")) {
+  if (vm.count("serve")) {
+    if (!squid.pureAnalyzeGeometry(geomtracks)) return EXIT_FAILURE;
+    if (!squid.buildMaterials(verboseMaterial) || !squid.createMaterialBudget(verboseMaterial)) return EXIT_FAILURE;
+    if (!squid.serve(socketpath)) return EXIT_FAILURE;
+  } else if (!vm.count("tracksim")) {
     // The tracker should pick the types here but in case it does not,
     // we can still write something
     if (!squid.pureAnalyzeGeometry(geomtracks)) return EXIT_FAILURE;
+    if (vm.count("export") && !squid.openResultsFile(resultsfile)) return EXIT_FAILURE;
 
 
     if ((vm.count("all") || vm.count("bandwidth") || vm.count("bandwidth-cpu")) && !squid.reportBandwidthSite()) return EXIT_FAILURE;
@@ -163,6 +171,7 @@ int main(int argc, char* argv[]) {
 
     if (!squid.reportGeometrySite(vm.count("debug-resolution"))) return EXIT_FAILURE;
     if (!squid.additionalInfoSite()) return EXIT_FAILURE;
+    if (vm.count("export") && !squid.exportResults()) return EXIT_FAILURE;
     if (!squid.makeSite()) return EXIT_FAILURE;
 
   } else {
@@ -178,7 +187,7 @@ int main(int argc, char* argv[]) {
 //      vmtracks.insert(std::make_pair("num-events", po::variable_value(boost::any(tracksim[0]), false)));
 //      vmtracks.insert(std::make_pair("num-tracks", po::variable_value(boost::any(tracksim[1]), false)));
 //    }
-    squid.simulateTracks(vm, randseed);
+    if (!squid.simulateTracks(vm, randseed)) return EXIT_FAILURE;
 
     //if (tracksim.size() == 2) { squid.simulateTracks(str2any<long int>(tracksim[0]), str2any<long int>(tracksim[1]), randseed, "", ""); }
     //else if (tracksim.size() == 1 && tracksim[0].at(0)=="\"") { squid.simulateTracks(0, 0, randseed, "", trim(tracksim[0], " \"")); }
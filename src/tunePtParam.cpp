@@ -1,25 +1,29 @@
 // Standard c++ libraries
 #include <cstdlib>
 #include <iostream>
+#include <fstream>
 #include <cstring>
+#include <cmath>
 #include <vector>
 #include <sstream>
 #include <string>
 #include <cstdio>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 // BOOST
 #include <boost/program_options.hpp>
 
 // Private libraries
 #include <ptError.h>
-#include <module.hh>
 
 using namespace std;
 namespace po = boost::program_options;
 
-void syntax(char* programName) {
-  //void syntax(char* po::options_description& visible, char* programName) {
-  std::cout << "Syntax: " << programName << endl
+void syntax(char* programName, const po::options_description& visible) {
+  std::cout << "Syntax: " << programName << " [options]" << endl
+            << "    or: " << programName << endl
             << " [Barrel|Endcap]" << std::endl
             << " mod_d_start mod_d_stop mod_d_step" << std::endl
             << " pitch strip_l mod_z mod_r window efficient_pt"<< std::endl;
@@ -27,188 +31,243 @@ void syntax(char* programName) {
   std::cout << "Pitch    : micrometers" << std::endl;
   std::cout << "mod_*    : millimeters" << std::endl;
   std::cout << "window   : number of strips" << std::endl;
-  //std::cout << "And then the show: " << visible << std::endl;
+  std::cout << "Each scanned parameter is either a value, a list of values (v1,v2,...)" << std::endl
+            << "or a range start:stop:step (stop excluded)" << std::endl;
+  std::cout << visible << std::endl;
 }
 
-enum { Momentum, Distance };
+// One module geometry and stacking to evaluate
+struct ScanPoint {
+  int moduleType;
+  double z, r;            // mm
+  double pitch;           // mm
+  double stripLength;     // mm
+  double distance;        // mm
+  double window;          // strips
+};
 
-int main(int argc, char*argv[]) {
-  cout << "# Tuning Thinkness" << endl;
-  if (argc!=11) {
-    syntax(argv[0]);
-    return -1;
-  }
+struct ScanResult {
+  double pCut;            // GeV/c
+  double efficiency1;     // % at 1 GeV/c
+  double inefficiency;    // % at the efficient pt
+  double pt1, pt90;       // GeV/c at 1% and 90% efficiency
+  double geometricInefficiency; // %
+};
 
-  int ModuleType;
-  if (strcmp(argv[1], "Barrel")==0) {
-    ModuleType = Module::Barrel;
-    std::cout << "# Module type = Barrel" << std::endl;
-  } else if (strcmp(argv[1], "Endcap")==0) {
-    ModuleType = Module::Endcap;
-    std::cout << "# Module type = Endcap" << std::endl;
-  } else {
-    syntax(argv[0]);
-    return 0;
+// Reads a value, a list v1,v2,... or a range start:stop:step into values, multiplied by scale
+bool parseValues(const std::string& text, double scale, std::vector<double>& values) {
+  values.clear();
+  double start, stop, step;
+  char tail;
+  if (sscanf(text.c_str(), "%lf:%lf:%lf%c", &start, &stop, &step, &tail) == 3) {
+    if (step <= 0) return false;
+    // Same stepping as the original mod_d loop, without accumulating the rounding
+    for (int i = 0; start + i*step < stop; ++i) values.push_back((start + i*step) * scale);
+    return !values.empty();
+  }
+  std::istringstream items(text);
+  std::string item;
+  while (std::getline(items, item, ',')) {
+    char* end;
+    double value = strtod(item.c_str(), &end);
+    if (end == item.c_str() || *end != '\0') return false;
+    values.push_back(value * scale);
   }
+  return !values.empty();
+}
 
-  double start = atof(argv[2]);
-  double stop = atof(argv[3]);
-  double step = atof(argv[4]);
-
-  double pitch = atof(argv[5])/1000.;
-  double strip_l = atof(argv[6]);
-  double mod_z = atof(argv[7]);
-  double mod_r = atof(argv[8]);
-  double window = atof(argv[9]);
-  double efficient_pt = atof(argv[10]);
-
-  ptError myError;
-  myError.setModuleType(ModuleType);
-  myError.setPitch(pitch);
-  myError.setStripLength(strip_l);
-  myError.setZ(mod_z);
-  myError.setR(mod_r);
-
-  double p;
-  double curvature, cur_error;
-  double p_cut; //, cur_cut;  
- 
-  double mod_d; 
-
-  double theta = atan(mod_r/mod_z);
-  cout << "# eta = " << -1 * log(tan(theta/2)) << endl;
-  cout << "mod_d p_cut eff_1 inef_"<< efficient_pt << " pt(1%) pt(90%) geom_ineff" << endl;
-  for (mod_d=start; mod_d<stop; mod_d+=step) {
-    myError.setDistance(mod_d);
-    
-    p_cut = myError.stripsToP(window/2.);
-    //cur_cut = 1/p_cut;
-
-    //cout << mod_d << " "
-    //     << p_cut << " ";
-    printf("%.2f %.2f ", mod_d, p_cut);
-
-    p = 1;
-    curvature = 1 / p;
-    cur_error = myError.computeError(p) * curvature;
-    //cout << 100 * myError.probabilityInside(cur_cut, curvature, cur_error) * myError.geometricEfficiency() << " ";
-    printf("%.2f ", 100 * myError.probabilityInside(1/p_cut, curvature, cur_error) * myError.geometricEfficiency());
-
-    p = efficient_pt;
-    curvature = 1 / p;
-    cur_error = myError.computeError(p) * curvature;
-    //cout << 100-100 * myError.probabilityInside(cur_cut, curvature, cur_error) * myError.geometricEfficiency() << " ";
-    printf("%.2f ",100-100 * myError.probabilityInside(1/p_cut, curvature, cur_error) * myError.geometricEfficiency());
-
-    double myValue;
-    myValue = myError.find_probability(0.01, p_cut);
-    //std::cout << 1/myValue << " ";
-    printf("%.2f ", myValue);
-    myValue = myError.find_probability(0.90, p_cut);
-    //std::cout << 1/myValue;
-    printf("%.2f ", myValue);
-
-
-    myValue = 100*(1-myError.geometricEfficiency());
-    printf("%.2f ", myValue);
-    std::cout << std::endl;
+bool parseModuleType(const std::string& text, int& moduleType) {
+  if (text=="Barrel") moduleType = BARREL;
+  else if (text=="Endcap") moduleType = ENDCAP;
+  else return false;
+  return true;
+}
+
+// Reads the module geometries, one per line: [Barrel|Endcap] mod_z mod_r pitch strip_l ('#' starts a comment)
+bool readModules(const std::string& fileName, std::vector<ScanPoint>& modules) {
+  std::ifstream in(fileName);
+  if (!in) {
+    std::cerr << "Could not open the module list " << fileName << std::endl;
+    return false;
   }
+  std::string line;
+  for (int lineNumber = 1; std::getline(in, line); ++lineNumber) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream fields(line);
+    std::string type;
+    ScanPoint module;
+    if (!(fields >> type)) continue;
+    if (!parseModuleType(type, module.moduleType) || !(fields >> module.z >> module.r >> module.pitch >> module.stripLength)) {
+      std::cerr << fileName << ":" << lineNumber << ": expected [Barrel|Endcap] mod_z mod_r pitch strip_l" << std::endl;
+      return false;
+    }
+    module.pitch /= 1000.;
+    modules.push_back(module);
+  }
+  return true;
+}
 
-  return(0);
+ScanResult evaluate(ptError& myError, const ScanPoint& point, double efficientPt) {
+  myError.setModuleType(point.moduleType);
+  myError.setPitch(point.pitch);
+  myError.setStripLength(point.stripLength);
+  myError.setZ(point.z);
+  myError.setR(point.r);
+  myError.setDistance(point.distance);
+  myError.setEffectiveDistance(point.distance);
+
+  ScanResult result;
+  double geometricEfficiency = myError.geometricEfficiency();
+  result.pCut = myError.stripsToP(point.window/2.);
+  result.efficiency1 = 100 * myError.triggerProbability(1, result.pCut, geometricEfficiency);
+  result.inefficiency = 100 - 100 * myError.triggerProbability(efficientPt, result.pCut, geometricEfficiency);
+  result.pt1 = myError.findProbability(0.01, result.pCut, geometricEfficiency);
+  result.pt90 = myError.findProbability(0.90, result.pCut, geometricEfficiency);
+  result.geometricInefficiency = 100*(1-geometricEfficiency);
+  return result;
+}
+
+// Evaluates all the points, each worker thread with its own ptError
+std::vector<ScanResult> evaluateAll(const std::vector<ScanPoint>& points, double efficientPt, int nThreads) {
+  std::vector<ScanResult> results(points.size());
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    ptError myError;
+    for (size_t i = next++; i < points.size(); i = next++) results[i] = evaluate(myError, points[i], efficientPt);
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < nThreads; ++i) threads.emplace_back(worker);
+  worker();
+  for (auto& t : threads) t.join();
+  return results;
+}
+
+void printTable(FILE* out, const std::vector<ScanPoint>& points, const std::vector<ScanResult>& results, double efficientPt) {
+  fprintf(out, "# type eta mod_z mod_r pitch strip_l mod_d window p_cut eff_1 inef_%g pt(1%%) pt(90%%) geom_ineff\n", efficientPt);
+  for (size_t i = 0; i < points.size(); ++i) {
+    const ScanPoint& p = points[i];
+    const ScanResult& r = results[i];
+    double theta = atan2(p.r, p.z);
+    fprintf(out, "%c %.3f %.1f %.1f %.1f %.2f %.2f %g %.2f %.2f %.2f %.2f %.2f %.2f\n",
+            p.moduleType == BARREL ? 'B' : 'E', -1 * log(tan(theta/2)), p.z, p.r, p.pitch*1000., p.stripLength,
+            p.distance, p.window, r.pCut, r.efficiency1, r.inefficiency, r.pt1, r.pt90, r.geometricInefficiency);
+  }
 }
 
-/*
-
-int main(int ac, char* av[]) {
-  try {
-    // Declare the variables later used in the parameter scan
-    std::cout << "Syntax: " << programName << endl
-	      << " [Barrel|Endcap]" << std::endl
-	      << " mod_d_start mod_d_stop mod_d_step" << std::endl
-	      << " pitch strip_l mod_z mod_r window"<< std::endl;
-    std::cout << "Pt units : GeV/c" << std::endl;
-    std::cout << "Pitch    : micrometers" << std::endl;
-    std::cout << "mod_*    : millimeters" << std::endl;
-    std::cout << "window   : number of strips" << std::endl;
-    std::cout << "And then the show: " << visible << std::endl;
-    
-    string ModuleType = "Barrel";
-    double pitch = 90;     // micrometers
-    double strip_l = 23.2; // mm
-    double mod_z = 954;    // mm
-    double mod_r = 348;    // mm
-    double mod_d = 1.3;    // mm
-    double window = 3;     // number of strips
-    double ptCut;
-
-    // Declare a group of options that will be
-    // allowed only on command line
-    po::options_description generic("Generic");
-    generic.add_options()
-      ("help", "produce help message")
-      ;
-
-    // Declare optional options
-    po::options_description optional("Material plot");
-    optional.add_options()
-      ("trackerOnly,t", "takes only into account the outer tracker")
-      ("maxRange,r", po::value<double>(&range), "sets the vertical range for the material plot")
-      ("output,o", po::value<string>(&outputName), "output file name (.png will be added)")
-      ;
-
-    // Create the command line option set
-    po::options_description cmdline_options;
-    cmdline_options.add(generic).add(optional);
-
-    // Create the list to be shown
-    po::options_description visible("Options");
-    visible.add(generic).add(optional);
-
-    // Actually read the options from command line
+int main(int argc, char*argv[]) {
+  std::string typeText, distanceText, pitchText, stripLengthText, zText, rText, windowText;
+  std::string modulesFile, outputFile;
+  double efficientPt;
+  int nThreads;
+
+  po::options_description visible("Options");
+  visible.add_options()
+    ("help,h", "Display help")
+    ("type,t", po::value<std::string>(&typeText)->default_value("Barrel"), "Module type: Barrel or Endcap")
+    ("distance,d", po::value<std::string>(&distanceText), "Distance between the sensors [mm]")
+    ("pitch,p", po::value<std::string>(&pitchText), "Strip pitch [um]")
+    ("strip-length,l", po::value<std::string>(&stripLengthText), "Strip length [mm]")
+    ("z,z", po::value<std::string>(&zText), "Module z [mm]")
+    ("r,r", po::value<std::string>(&rText), "Module r [mm]")
+    ("window,w", po::value<std::string>(&windowText), "Trigger window [strips]")
+    ("modules,m", po::value<std::string>(&modulesFile), "File with one module per line: [Barrel|Endcap] mod_z mod_r pitch strip_l, scanned instead of --type, --z, --r, --pitch and --strip-length")
+    ("efficient-pt,e", po::value<double>(&efficientPt)->default_value(2.), "pt at which the inefficiency is given [GeV/c]")
+    ("threads,j", po::value<int>(&nThreads)->default_value(0), "Number of threads (0 = number of cores)")
+    ("output,o", po::value<std::string>(&outputFile), "Output file (default: standard output)")
+    ;
+
+  // The original positional syntax scans mod_d for one module
+  if (argc==11 && argv[1][0]!='-') {
+    std::ostringstream range;
+    range << argv[2] << ":" << argv[3] << ":" << argv[4];
+    typeText = argv[1];
+    distanceText = range.str();
+    pitchText = argv[5];
+    stripLengthText = argv[6];
+    zText = argv[7];
+    rText = argv[8];
+    windowText = argv[9];
+    efficientPt = atof(argv[10]);
+    nThreads = 0;
+  } else {
     po::variables_map vm;
-    store(po::command_line_parser(ac, av).
-	  options(cmdline_options).run(), vm);
-    notify(vm);
-
-    // List the options
-    if (vm.count("help")) {
-      printUsage(visible, av[0]);
-      return 0;
+    try {
+      po::store(po::command_line_parser(argc, argv).options(visible).run(), vm);
+      po::notify(vm);
+    } catch (po::error& e) {
+      std::cerr << "Error: " << e.what() << std::endl;
+      syntax(argv[0], visible);
+      return -1;
+    }
+    bool geometryGiven = vm.count("modules") || (vm.count("pitch") && vm.count("strip-length") && vm.count("z") && vm.count("r"));
+    if (vm.count("help") || !vm.count("distance") || !vm.count("window") || !geometryGiven) {
+      syntax(argv[0], visible);
+      return -1;
+    }
+  }
+
+  // The module geometries
+  std::vector<ScanPoint> modules;
+  if (!modulesFile.empty()) {
+    if (!readModules(modulesFile, modules)) return -1;
+  } else {
+    std::vector<std::string> types;
+    std::istringstream typeItems(typeText);
+    std::string item;
+    while (std::getline(typeItems, item, ',')) types.push_back(item);
+    std::vector<double> pitches, stripLengths, zs, rs;
+    if (!parseValues(pitchText, 1/1000., pitches) || !parseValues(stripLengthText, 1, stripLengths) ||
+        !parseValues(zText, 1, zs) || !parseValues(rText, 1, rs)) {
+      std::cerr << "Error: could not read the module geometry" << std::endl;
+      syntax(argv[0], visible);
+      return -1;
     }
-    
-    bool usePixel = (vm.count("trackerOnly")==0);
-    int myColor;
-
-    // Look into the input-file list
-    if (vm.count("input-file")) {
-      string dirName;
-      prepareCanvas();
-      Palette::skipColors(100);
-      Palette::prepare(fileV.size(), 210, 0.6,.6);
-      for (unsigned int iMat=0 ; iMat<fileV.size(); ++iMat) {
-	dirName = (mainConfiguration.getLayoutDirectory()
-		   + "/" + fileV.at(iMat));
-	cerr << dirName << endl; // debug
-	myColor = Palette::color(iMat);
-	plotMaterial(dirName, myColor, usePixel, fileV.at(iMat));
+    for (const auto& type : types) {
+      ScanPoint module;
+      if (!parseModuleType(type, module.moduleType)) {
+        syntax(argv[0], visible);
+        return -1;
       }
-      if (lastPixel) {
-	myLegend->AddEntry(lastPixel, "pixel", "F");
+      for (double z : zs) for (double r : rs) for (double pitch : pitches) for (double stripLength : stripLengths) {
+        module.z = z;
+        module.r = r;
+        module.pitch = pitch;
+        module.stripLength = stripLength;
+        modules.push_back(module);
       }
-      //Palette::prepare(10, 210, 0.9, 0.4);
-      printCanvas(outputName);
-    } else {
-      cout << "Error: at least a layout name should be given" << endl << endl;
+    }
+  }
 
-      printUsage(visible, av[0]);
-      return -1;
+  // The stackings, for every module
+  std::vector<double> distances, windows;
+  if (!parseValues(distanceText, 1, distances) || !parseValues(windowText, 1, windows)) {
+    std::cerr << "Error: could not read the distances or the windows" << std::endl;
+    syntax(argv[0], visible);
+    return -1;
+  }
+  std::vector<ScanPoint> points;
+  points.reserve(modules.size()*distances.size()*windows.size());
+  for (const auto& module : modules) {
+    for (double window : windows) {
+      for (double distance : distances) {
+        ScanPoint point = module;
+        point.distance = distance;
+        point.window = window;
+        points.push_back(point);
+      }
     }
+  }
+
+  if (nThreads <= 0) nThreads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<ScanResult> results = evaluateAll(points, efficientPt, nThreads);
 
-  } catch(exception& e) {
-    cout << e.what() << endl;
-    return 1;
+  FILE* out = stdout;
+  if (!outputFile.empty() && !(out = fopen(outputFile.c_str(), "w"))) {
+    std::cerr << "Error: could not open " << outputFile << std::endl;
+    return -1;
   }
-  return 0;
+  printTable(out, points, results, efficientPt);
+  if (out != stdout) fclose(out);
+
+  return(0);
 }
-  
-*/
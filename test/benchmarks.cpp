@@ -0,0 +1,236 @@
+// Microbenchmarks of the hot kernels of tkLayout on a reference tracker
+// Usage: benchmarks [geometry file] [output json] [samples] [material budget tracks]
+//
+// Every benchmark is warmed up once, then calibrated so that one sample lasts
+// at least minSampleTime; the samples are repeated and summarized by their
+// minimum, median, mean and standard deviation, in nanoseconds per operation.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <TError.h>
+#include <TRandom3.h>
+
+#include <Squid.h>
+#include <Analyzer.h>
+#include <MaterialResponse.h>
+#include <PtErrorAdapter.h>
+#include <StopWatch.h>
+#include <mainConfigHandler.h>
+
+using namespace std;
+using insur::MaterialBudget;
+
+static const char* defaultGeometry = "geometries/CMS_Phase2/Baseline_tilted_200.cfg";
+static const double minSampleTime = 0.05; // s
+static volatile double sink; // keeps the compiler from discarding the results of the kernels
+
+struct Result {
+  string name;
+  long operationsPerCall;
+  long callsPerSample;
+  vector<double> samples; // ns per operation
+  double min, median, mean, stddev;
+};
+
+typedef chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start) {
+  return chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Times a kernel: batch(calls) runs the kernel the given number of times and returns the elapsed time in s
+static Result measure(const string& name, int samples, long operationsPerCall, function<double(long)> batch) {
+  Result result;
+  result.name = name;
+  result.operationsPerCall = max(operationsPerCall, 1L);
+  double warmup = batch(1);
+  result.callsPerSample = (warmup > 0 && warmup < minSampleTime) ? long(ceil(minSampleTime / warmup)) : 1;
+  for (int i = 0; i < samples; ++i) {
+    double elapsed = batch(result.callsPerSample);
+    result.samples.push_back(elapsed * 1e9 / double(result.callsPerSample * result.operationsPerCall));
+  }
+  vector<double> sorted = result.samples;
+  sort(sorted.begin(), sorted.end());
+  size_t n = sorted.size();
+  result.min = sorted.front();
+  result.median = (n % 2) ? sorted[n/2] : (sorted[n/2 - 1] + sorted[n/2]) / 2;
+  double sum = 0, sum2 = 0;
+  for (double x : sorted) { sum += x; sum2 += x * x; }
+  result.mean = sum / n;
+  result.stddev = (n > 1) ? sqrt(max(0., (sum2 - sum * sum / n) / (n - 1))) : 0;
+  cout << name << ": median " << result.median << " ns/op, min " << result.min
+       << " ns/op, stddev " << result.stddev << " ns/op (" << n << " samples of "
+       << result.callsPerSample << " x " << result.operationsPerCall << " operations)" << endl;
+  return result;
+}
+
+// Same as measure() for a kernel without any setup: every call of the kernel is timed
+static Result measureKernel(const string& name, int samples, long operationsPerCall, function<void()> kernel) {
+  return measure(name, samples, operationsPerCall, [&kernel](long calls) {
+    Clock::time_point start = Clock::now();
+    for (long i = 0; i < calls; ++i) kernel();
+    return secondsSince(start);
+  });
+}
+
+static string jsonEscape(const string& text) {
+  string result;
+  for (char c : text) {
+    if (c == '"' || c == '\\') result += '\\';
+    result += c;
+  }
+  return result;
+}
+
+static void writeJson(ostream& out, const string& geometry, const vector<Result>& results) {
+  out << "{\n  \"geometry\": \"" << jsonEscape(geometry) << "\",\n  \"unit\": \"ns/op\",\n  \"benchmarks\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& r = results[i];
+    out << (i ? ",\n" : "\n") << "    {\"name\": \"" << jsonEscape(r.name) << "\""
+        << ", \"operations_per_call\": " << r.operationsPerCall << ", \"calls_per_sample\": " << r.callsPerSample
+        << ", \"min\": " << r.min << ", \"median\": " << r.median << ", \"mean\": " << r.mean << ", \"stddev\": " << r.stddev
+        << ", \"samples\": [";
+    for (size_t j = 0; j < r.samples.size(); ++j) out << (j ? ", " : "") << r.samples[j];
+    out << "]}";
+  }
+  out << "\n  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+  string geometry = (argc > 1) ? argv[1] : defaultGeometry;
+  string outputFile = (argc > 2) ? argv[2] : "benchmarks.json";
+  int samples = (argc > 3) ? atoi(argv[3]) : 15;
+  int materialTracks = (argc > 4) ? atoi(argv[4]) : 1000;
+  if (samples < 1) samples = 1;
+
+  StopWatch::instance()->setVerbosity(0, false);
+  gErrorIgnoreLevel = kError; // the analyzers replace their histograms at every run
+  insur::Squid squid;
+  squid.setGeometryFile(geometry);
+  if (!squid.buildTracker() || !squid.buildInactiveSurfaces() || !squid.buildMaterials() || !squid.createMaterialBudget()) {
+    cerr << "Could not build the reference tracker from " << geometry << endl;
+    return EXIT_FAILURE;
+  }
+  MaterialBudget& mb = *squid.getMaterialBudget();
+  Tracker& tracker = mb.getTracker();
+  const SimParms& simParms = *squid.getSimParms();
+  vector<Module*> modules(tracker.modules().begin(), tracker.modules().end());
+
+  // Straight tracks from the origin covering the tracker acceptance
+  TRandom3 dice(0xcaffe);
+  const int nDirections = 64;
+  vector<XYZVector> directions;
+  for (int i = 0; i < nDirections; ++i) {
+    ROOT::Math::Polar3DVector dir;
+    dir.SetCoordinates(1, 2 * atan(exp(-dice.Uniform(-4, 4))), dice.Uniform(0, 2 * M_PI));
+    directions.push_back(XYZVector(dir));
+  }
+  XYZVector origin;
+  long nSensors = 0;
+  for (const Module* m : modules) nSensors += m->sensors().size();
+
+  vector<Result> results;
+
+  results.push_back(measureKernel("Sensor::checkHitSegment", samples, nSensors * nDirections, [&]() {
+    double hits = 0;
+    for (const XYZVector& direction : directions)
+      for (const Module* m : modules)
+        for (const Sensor& s : m->sensors()) hits += s.checkHitSegment(origin, direction).second;
+    sink = hits;
+  }));
+
+  results.push_back(measureKernel("Polygon3d::isLineIntersecting", samples, long(modules.size()) * nDirections, [&]() {
+    double hits = 0;
+    for (const XYZVector& direction : directions)
+      for (const Module* m : modules) hits += m->basePoly().isLineIntersecting(origin, direction);
+    sink = hits;
+  }));
+
+  // Tracks with the full material, as in the resolution estimate
+  insur::MaterialResponse response;
+  response.build(mb, squid.getPixelMaterialBudget(), 2.5, 250);
+  vector<Track> tracks;
+  for (int i = 0; i < response.etaBins(); ++i) {
+    double eta = response.binEta(i);
+    double theta = 2 * atan(exp(-eta));
+    double phi = dice.Uniform(0, 2 * M_PI);
+    Track track;
+    track.setTheta(theta);
+    track.setPhi(phi);
+    response.fillTrack(eta, track);
+    if (simParms.useIPConstraint()) track.addIPConstraint(simParms.rError(), simParms.zErrorCollider());
+    track.sort();
+    track.setTransverseMomentum(10);
+    if (track.nActiveHits(true) >= 3) tracks.push_back(track);
+  }
+  results.push_back(measureKernel("Track::computeErrors", samples, tracks.size(), [&]() {
+    for (Track& track : tracks) track.computeErrors();
+    sink = tracks.size();
+  }));
+
+  const IrradiationMapsManager& irradiation = simParms.irradiationMapsManager();
+  results.push_back(measureKernel("IrradiationMapsManager::calculateIrradiationPower", samples, modules.size(), [&]() {
+    double power = 0;
+    for (const Module* m : modules) power += irradiation.calculateIrradiationPower(make_pair(m->center().Z(), m->center().Rho()));
+    sink = power;
+  }));
+
+  vector<Module*> ptModules;
+  for (Module* m : modules) if (m->sensors().size() == 2) ptModules.push_back(m);
+  results.push_back(measureKernel("PtErrorAdapter::getTriggerFrequencyTruePerEventBetween", samples, ptModules.size(), [&]() {
+    double frequency = 0;
+    for (Module* m : ptModules) {
+      PtErrorAdapter pterr(*m);
+      frequency += pterr.getTriggerFrequencyTruePerEventBetween(2, 5);
+    }
+    sink = frequency;
+  }));
+
+  // The materialway modifies the tracker it is built on: every call builds a new tracker, untimed.
+  // Only the materialway of the outer tracker is timed, with the same binning as in the Squid
+  results.push_back(measure("Materialway::build", max(samples / 3, 3), 1, [&](long calls) {
+    double elapsed = 0;
+    for (long i = 0; i < calls; ++i) {
+      insur::Squid freshSquid;
+      StopWatch::instance()->setVerbosity(0, false); // the previous squid destroyed the stop watch
+      freshSquid.setGeometryFile(geometry);
+      freshSquid.buildTracker();
+      freshSquid.buildInactiveSurfaces();
+      material::Materialway materialway;
+      material::WeightDistributionGrid weightDistribution(10.);
+      Clock::time_point start = Clock::now();
+      materialway.build(*freshSquid.getTracker(), *freshSquid.getInactiveSurfaces(), weightDistribution);
+      elapsed += secondsSince(start);
+    }
+    return elapsed;
+  }));
+
+  results.push_back(measure("Analyzer::analyzeMaterialBudget", max(samples / 3, 3), materialTracks, [&](long calls) {
+    double elapsed = 0;
+    for (long i = 0; i < calls; ++i) {
+      insur::Analyzer analyzer;
+      analyzer.simParms(squid.getSimParms());
+      Clock::time_point start = Clock::now();
+      analyzer.analyzeMaterialBudget(mb, mainConfigHandler::instance().getMomenta(), materialTracks, squid.getPixelMaterialBudget());
+      elapsed += secondsSince(start);
+    }
+    return elapsed;
+  }));
+
+  ofstream out(outputFile.c_str());
+  writeJson(out, geometry, results);
+  if (out.fail()) {
+    cerr << "Could not write the results to " << outputFile << endl;
+    return EXIT_FAILURE;
+  }
+  cout << "Results written to " << outputFile << endl;
+  return EXIT_SUCCESS;
+}
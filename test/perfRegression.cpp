@@ -0,0 +1,254 @@
+// End-to-end performance regression check over a list of geometries
+// Usage: perfRegression [options] <geometry file> [<geometry file> ...]
+//   -l <file>       read the geometry files from a list, one per line ('#' starts a comment)
+//   -b <file>       compare with the given baseline, failing on regressions
+//   -w <file>       write the measurements as a new baseline
+//   -n <tracks>     number of tracks for the analyses (default 1000)
+//   -t <fraction>   tolerance on wall-clock and CPU time (default 0.25)
+//   -m <fraction>   tolerance on the peak memory (default 0.10)
+//   -T <seconds>    time differences below this are never regressions (default 0.5)
+//   -M <MB>         memory differences below this are never regressions (default 50)
+//
+// Every geometry goes through the full pipeline of "tklayout --all", in this
+// process, with the website written to a temporary directory, removed
+// afterwards. The wall-clock time and CPU time of the outermost steps are
+// taken from the Profiler. Their peak memory is the
+// peak resident memory reached during the step above the resident memory
+// at its start, from the MemoryMonitor. The baseline is a tab-separated
+// file with one line per geometry and step.
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <Squid.h>
+#include <StopWatch.h>
+#include <Profiler.h>
+#include <MemoryMonitor.h>
+
+using namespace std;
+
+struct Measurement {
+  double wallTime, cpuTime; // s
+  double peakMemory;        // MB above the memory at the start of the step
+};
+
+typedef map<pair<string, string>, Measurement> Measurements; // keyed by geometry and step
+
+struct Options {
+  string baselineFile, newBaselineFile;
+  int tracks = 1000;
+  double timeTolerance = 0.25, memoryTolerance = 0.10;
+  double minTime = 0.5, minMemory = 50;
+};
+
+// Same sequence of steps as "tklayout --all"
+static bool runPipeline(const string& geometry, const string& htmlDir, int tracks) {
+  insur::Squid squid;
+  StopWatch::instance()->setVerbosity(1, true);
+  squid.setGeometryFile(geometry);
+  squid.setHtmlDir(htmlDir);
+  return squid.buildTracker()
+    && squid.pureAnalyzeGeometry(tracks)
+    && squid.reportBandwidthSite()
+    && squid.reportTriggerProcessorsSite()
+    && squid.reportPowerSite()
+    && squid.buildMaterials()
+    && squid.createMaterialBudget()
+    && squid.pureAnalyzeMaterialBudget(tracks, true, false)
+    && squid.reportMaterialBudgetSite(false)
+    && squid.reportResolutionSite()
+    && squid.analyzeTriggerEfficiency(tracks, false)
+    && squid.reportTriggerPerformanceSite(false)
+    && squid.reportGeometrySite(false)
+    && squid.additionalInfoSite()
+    && squid.makeSite();
+}
+
+// Steps run more than once are summed for the time and take the largest peak for the memory
+static void collect(const string& geometry, Measurements& measurements) {
+  for (const Profiler::ZoneSummary& zone : Profiler::instance()->summary()) {
+    if (zone.depth != 1) continue;
+    Measurement& m = measurements[make_pair(geometry, zone.name)];
+    m.wallTime = zone.wallTime;
+    m.cpuTime = zone.cpuTime;
+    m.peakMemory = 0;
+  }
+  for (const MemoryMonitor::Stage& stage : MemoryMonitor::instance()->stages()) {
+    if (stage.depth != 1 || !stage.completed) continue;
+    Measurements::iterator it = measurements.find(make_pair(geometry, stage.name));
+    if (it == measurements.end()) continue;
+    if (stage.before.rss < 0 || stage.after.peakRss < 0) continue; // not available on this platform
+    it->second.peakMemory = max(it->second.peakMemory, (stage.after.peakRss - stage.before.rss) / (1024. * 1024.));
+  }
+}
+
+static bool readBaseline(const string& filename, Measurements& baseline) {
+  ifstream in(filename.c_str());
+  if (!in.good()) return false;
+  string line;
+  while (getline(in, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    vector<string> fields;
+    istringstream lineStream(line);
+    string field;
+    while (getline(lineStream, field, '\t')) fields.push_back(field);
+    if (fields.size() != 5) {
+      cerr << "Skipping malformed baseline line: " << line << endl;
+      continue;
+    }
+    Measurement& m = baseline[make_pair(fields[0], fields[1])];
+    m.wallTime = atof(fields[2].c_str());
+    m.cpuTime = atof(fields[3].c_str());
+    m.peakMemory = atof(fields[4].c_str());
+  }
+  return true;
+}
+
+static bool writeBaseline(const string& filename, const Measurements& measurements) {
+  ofstream out(filename.c_str());
+  out << "# geometry\tstep\twall time [s]\tCPU time [s]\tpeak memory above the start of the step [MB]" << endl;
+  for (const auto& entry : measurements) {
+    out << entry.first.first << '\t' << entry.first.second << '\t' << entry.second.wallTime << '\t'
+        << entry.second.cpuTime << '\t' << entry.second.peakMemory << endl;
+  }
+  return !out.fail();
+}
+
+static bool regressed(double current, double reference, double tolerance, double floor) {
+  return current > reference * (1 + tolerance) && current - reference > floor;
+}
+
+// Prints one line per step and returns the number of regressions
+static int compare(const Measurements& measurements, const Measurements& baseline, const Options& options) {
+  int regressions = 0;
+  for (const auto& entry : measurements) {
+    const string& geometry = entry.first.first;
+    const string& step = entry.first.second;
+    const Measurement& current = entry.second;
+    Measurements::const_iterator it = baseline.find(entry.first);
+    if (it == baseline.end()) {
+      cout << "NEW        " << geometry << " | " << step << endl;
+      continue;
+    }
+    const Measurement& reference = it->second;
+    vector<string> reasons;
+    if (regressed(current.wallTime, reference.wallTime, options.timeTolerance, options.minTime)) reasons.push_back("wall time");
+    if (regressed(current.cpuTime, reference.cpuTime, options.timeTolerance, options.minTime)) reasons.push_back("CPU time");
+    if (regressed(current.peakMemory, reference.peakMemory, options.memoryTolerance, options.minMemory)) reasons.push_back("peak memory");
+    cout << (reasons.empty() ? "OK         " : "REGRESSION ") << geometry << " | " << step
+         << ": wall " << current.wallTime << " s (baseline " << reference.wallTime << " s)"
+         << ", CPU " << current.cpuTime << " s (baseline " << reference.cpuTime << " s)"
+         << ", peak " << current.peakMemory << " MB (baseline " << reference.peakMemory << " MB)";
+    for (size_t i = 0; i < reasons.size(); ++i) cout << (i ? ", " : " <- ") << reasons[i];
+    cout << endl;
+    if (!reasons.empty()) regressions++;
+  }
+  for (const auto& entry : baseline) {
+    if (!measurements.count(entry.first)) cout << "MISSING    " << entry.first.first << " | " << entry.first.second << endl;
+  }
+  return regressions;
+}
+
+int main(int argc, char* argv[]) {
+  Options options;
+  vector<string> geometries;
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+    if (arg.size() == 2 && arg[0] == '-' && i + 1 < argc) {
+      string value = argv[++i];
+      switch (arg[1]) {
+      case 'l': {
+        ifstream list(value.c_str());
+        if (!list.good()) {
+          cerr << "Could not read the list of geometries " << value << endl;
+          return EXIT_FAILURE;
+        }
+        string line;
+        while (getline(list, line)) {
+          line = line.substr(0, line.find('#'));
+          istringstream lineStream(line);
+          string geometry;
+          if (lineStream >> geometry) geometries.push_back(geometry);
+        }
+        break;
+      }
+      case 'b': options.baselineFile = value; break;
+      case 'w': options.newBaselineFile = value; break;
+      case 'n': options.tracks = atoi(value.c_str()); break;
+      case 't': options.timeTolerance = atof(value.c_str()); break;
+      case 'm': options.memoryTolerance = atof(value.c_str()); break;
+      case 'T': options.minTime = atof(value.c_str()); break;
+      case 'M': options.minMemory = atof(value.c_str()); break;
+      default:
+        cerr << "Unknown option " << arg << endl;
+        return EXIT_FAILURE;
+      }
+    } else if (arg[0] == '-') {
+      cerr << "Unknown option or missing value: " << arg << endl;
+      return EXIT_FAILURE;
+    } else {
+      geometries.push_back(arg);
+    }
+  }
+  if (geometries.empty()) {
+    cerr << "Usage: " << argv[0] << " [-l list] [-b baseline] [-w new baseline] [-n tracks] [-t time tolerance] "
+         << "[-m memory tolerance] [-T min seconds] [-M min MB] <geometry file> ..." << endl;
+    return EXIT_FAILURE;
+  }
+
+
+  Measurements measurements;
+  int failures = 0;
+  for (size_t i = 0; i < geometries.size(); ++i) {
+    const string& geometry = geometries[i];
+    cout << "Running the full pipeline on " << geometry << endl;
+    Profiler::destroy();
+    MemoryMonitor::destroy();
+    // the website goes to a temporary directory of its own
+    string htmlDir = (boost::filesystem::temp_directory_path() / "perfRegression-XXXXXX").string();
+    vector<char> htmlDirTemplate(htmlDir.begin(), htmlDir.end());
+    htmlDirTemplate.push_back('\0');
+    if (!mkdtemp(htmlDirTemplate.data())) {
+      cerr << "Could not create a temporary directory " << htmlDir << ": " << strerror(errno) << endl;
+      return EXIT_FAILURE;
+    }
+    htmlDir = htmlDirTemplate.data();
+    if (!runPipeline(geometry, htmlDir, options.tracks)) {
+      cerr << "The pipeline failed on " << geometry << endl;
+      failures++;
+    }
+    collect(geometry, measurements);
+    boost::system::error_code error;
+    boost::filesystem::remove_all(htmlDir, error);
+  }
+
+  if (!options.newBaselineFile.empty()) {
+    if (writeBaseline(options.newBaselineFile, measurements)) cout << "Baseline written to " << options.newBaselineFile << endl;
+    else {
+      cerr << "Could not write the baseline " << options.newBaselineFile << endl;
+      failures++;
+    }
+  }
+  if (!options.baselineFile.empty()) {
+    Measurements baseline;
+    if (!readBaseline(options.baselineFile, baseline)) {
+      cerr << "Could not read the baseline " << options.baselineFile << endl;
+      return EXIT_FAILURE;
+    }
+    int regressions = compare(measurements, baseline, options);
+    cout << regressions << " step(s) regressed" << endl;
+    failures += regressions;
+  }
+
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
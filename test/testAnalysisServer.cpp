@@ -0,0 +1,286 @@
+// Checks the replies of the analysis server protocol, then the framing of
+// the request lines over its socket
+// Usage: testAnalysisServer <geometry file>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <Squid.h>
+#include <Analyzer.h>
+#include <AnalysisServer.h>
+#include <DetectorModule.h>
+#include <StopWatch.h>
+#include <Visitor.h>
+
+using namespace std;
+using insur::AnalysisServer;
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+  if (!condition) {
+    cerr << "Failed: " << what << endl;
+    failures++;
+  }
+}
+
+// The last line of a reply, which is its status
+string status(const string& reply) {
+  string last = reply.substr(0, reply.find_last_not_of('\n') + 1);
+  return last.erase(0, last.rfind('\n') + 1);
+}
+
+// Sends one request and compares the connection state and the last line of the reply
+string ask(AnalysisServer& server, const string& request, bool expectedMore, const string& expectedStatus) {
+  ostringstream reply;
+  bool more = server.answer(request, reply);
+  string text = reply.str();
+  if (more != expectedMore || status(text) != expectedStatus) {
+    cerr << "Request \"" << request << "\": got \"" << status(text) << "\"" << (more ? "" : " and a close")
+         << ", expected \"" << expectedStatus << "\"" << (expectedMore ? "" : " and a close") << endl;
+    failures++;
+  }
+  return text;
+}
+
+// The lines of a reply before its status, split in words
+vector<vector<string> > dataLines(const string& reply) {
+  vector<vector<string> > lines;
+  istringstream in(reply);
+  for (string line; getline(in, line); ) {
+    istringstream words(line);
+    vector<string> fields;
+    for (string word; words >> word; ) fields.push_back(word);
+    lines.push_back(fields);
+  }
+  if (!lines.empty()) lines.pop_back();
+  return lines;
+}
+
+bool isNumber(const string& word, double& value) {
+  istringstream in(word);
+  return (in >> value) && in.eof();
+}
+
+void checkResolution(AnalysisServer& server) {
+  string reply = ask(server, "resolution 0.5 10 0.1", true, "ok");
+  vector<vector<string> > lines = dataLines(reply);
+  check(!lines.empty(), "a valid resolution request gives at least one track");
+  for (const vector<string>& fields : lines) {
+    bool valid = fields.size() == 9 && (fields[1] == "real" || fields[1] == "ideal");
+    double value;
+    for (size_t i = 2; valid && i < fields.size(); i++) valid = isNumber(fields[i], value) && std::isfinite(value);
+    if (valid) valid = isNumber(fields[8], value) && value >= 3;
+    if (!valid) {
+      cerr << "Unexpected resolution reply: " << reply << endl;
+      failures++;
+      break;
+    }
+  }
+}
+
+void checkModule(AnalysisServer& server, Tracker& tracker) {
+  class FirstModule : public ConstGeometryVisitor {
+  public:
+    const DetectorModule* module = nullptr;
+    void visit(const DetectorModule& m) { if (!module) module = &m; }
+  };
+  FirstModule first;
+  tracker.accept(first);
+  if (!first.module) {
+    cerr << "The tracker has no module" << endl;
+    failures++;
+    return;
+  }
+  const DetectorModule& m = *first.module;
+  UniRef ref = m.uniRef();
+  ostringstream request;
+  request << "module " << ref.cnt << " " << ref.layer << " " << ref.ring << " " << ref.phi << " " << ref.side;
+  vector<vector<string> > lines = dataLines(ask(server, request.str(), true, "ok"));
+  double r = 0, z = 0, phi = 0;
+  bool valid = lines.size() == 1 && lines[0].size() == 7 &&
+               isNumber(lines[0][0], r) && isNumber(lines[0][1], z) && isNumber(lines[0][2], phi);
+  double value;
+  for (size_t i = 3; valid && i < 7; i++) valid = isNumber(lines[0][i], value) && value >= 0;
+  check(valid, "the module reply is a line of seven numbers");
+  check(valid && fabs(r - m.center().Rho()) < 1e-6 && fabs(z - m.center().Z()) < 1e-6 && fabs(phi - m.center().Phi()) < 1e-6,
+        "the module reply gives the position of the module");
+}
+
+// A client of the server socket, which gives up after a few seconds
+class Client {
+  int fd_;
+public:
+  Client(const string& socketPath) : fd_(-1) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    for (int attempt = 0; attempt < 1000 && fd_ < 0; attempt++) { // the server may not be listening yet
+      fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+      if (connect(fd_, (sockaddr*)&address, sizeof(address)) == 0) break;
+      close(fd_);
+      fd_ = -1;
+      usleep(10000);
+    }
+    if (fd_ < 0) return;
+    timeval timeout = { 10, 0 };
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  }
+  ~Client() { if (fd_ >= 0) close(fd_); }
+  bool connected() const { return fd_ >= 0; }
+  void send(const string& data) {
+    for (size_t written = 0; written < data.size(); ) {
+      ssize_t n = ::send(fd_, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+      if (n <= 0) return;
+      written += n;
+    }
+  }
+  // Reads the replies up to the given number of status lines, or up to the end of the connection
+  string receive(int replies) {
+    string received;
+    char buffer[4096];
+    while (replies > 0) {
+      ssize_t n = read(fd_, buffer, sizeof(buffer));
+      if (n <= 0) break;
+      for (ssize_t i = 0; i < n; i++) {
+        received += buffer[i];
+        if (buffer[i] != '\n') continue;
+        string line = status(received);
+        if (line == "ok" || line.compare(0, 6, "error ") == 0) replies--;
+      }
+    }
+    return received;
+  }
+  // A server closing with unread requests resets the connection instead of ending it
+  bool closedByServer() {
+    char c;
+    ssize_t n = read(fd_, &c, 1);
+    return n == 0 || (n < 0 && errno == ECONNRESET);
+  }
+};
+
+void checkFraming(const string& socketPath) {
+  {
+    Client client(socketPath);
+    if (!client.connected()) {
+      cerr << "Could not connect to " << socketPath << endl;
+      failures++;
+      return;
+    }
+    // A request may come in pieces, and several requests in one piece
+    client.send("hel");
+    usleep(50000);
+    client.send("p\nmaterial 0.5");
+    usleep(50000);
+    client.send(" 0.1\n\nmodule nowhere 1 1 1 1\n");
+    string replies = client.receive(4);
+    istringstream lines(replies);
+    vector<string> statuses;
+    for (string line; getline(lines, line); ) {
+      if (line == "ok" || line.compare(0, 6, "error ") == 0) statuses.push_back(line);
+    }
+    check(statuses == vector<string>({ "ok", "ok", "error empty request", "error no module nowhere 1 1 1 1" }),
+          "requests split and joined across reads are answered in order");
+    check(replies.find("material <eta> [<phi>]\n") != string::npos, "the help comes through the socket");
+
+    // A line of the largest length is still a request
+    client.send(string(4096, 'x') + "\n");
+    check(status(client.receive(1)) == "error unknown request " + string(4096, 'x'), "a line of 4096 characters is answered");
+    client.send("quit\n");
+    check(status(client.receive(1)) == "ok" && client.closedByServer(), "quit closes the connection");
+  }
+  {
+    Client client(socketPath);
+    client.send(string(4097, 'x') + "\nhelp\n");
+    check(status(client.receive(1)) == "error request too long" && client.closedByServer(), "a line of 4097 characters drops the client");
+  }
+  {
+    Client client(socketPath);
+    client.send(string(5000, 'x'));
+    check(status(client.receive(1)) == "error request too long" && client.closedByServer(), "a long line without its end drops the client");
+  }
+  {
+    Client client(socketPath);
+    client.send("shutdown\n");
+    check(status(client.receive(1)) == "ok", "shutdown is answered");
+  }
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    cerr << "Usage: " << argv[0] << " <geometry file>" << endl;
+    return EXIT_FAILURE;
+  }
+
+  StopWatch::instance()->setVerbosity(0, false);
+  insur::Squid squid;
+  squid.setGeometryFile(argv[1]);
+  if (!squid.buildTracker() || !squid.buildMaterials() || !squid.createMaterialBudget()) {
+    cerr << "Could not build the material model for " << argv[1] << endl;
+    return EXIT_FAILURE;
+  }
+  insur::Analyzer analyzer;
+  AnalysisServer server(*squid.getTracker(), *squid.getSimParms(), analyzer, *squid.getMaterialBudget(), squid.getPixelMaterialBudget());
+
+  string help = ask(server, "help", true, "ok");
+  for (const char* request : { "material <eta> [<phi>]", "resolution <eta> <pt> [<phi>]", "module <section> <layer> <ring> <phi> <side>", "quit", "shutdown" }) {
+    if (help.find(string(request) + "\n") == string::npos) {
+      cerr << "The help does not list " << request << endl;
+      failures++;
+    }
+  }
+
+  ask(server, "", true, "error empty request");
+  ask(server, "   ", true, "error empty request");
+  ask(server, "frobnicate 1 2", true, "error unknown request frobnicate");
+  ask(server, "material", true, "error expected material <eta> [<phi>]");
+  ask(server, "material north", true, "error expected material <eta> [<phi>]");
+  ask(server, "material -0.5", true, "error negative eta");
+  ask(server, "resolution 0.5", true, "error expected resolution <eta> <pt> [<phi>]");
+  ask(server, "resolution 0.5 -1", true, "error expected resolution <eta> <pt> [<phi>]");
+  ask(server, "resolution -0.5 10", true, "error negative eta");
+  ask(server, "module BRL 1", true, "error expected module <section> <layer> <ring> <phi> <side>");
+  ask(server, "module nowhere 1 1 1 1", true, "error no module nowhere 1 1 1 1");
+
+  // A valid request gives one line of two lengths before the status
+  istringstream material(ask(server, "material 0.5 0.1", true, "ok"));
+  double radiation = -1, interaction = -1;
+  if (!(material >> radiation >> interaction) || radiation <= 0 || interaction <= 0) {
+    cerr << "Unexpected material reply: " << material.str() << endl;
+    failures++;
+  }
+  checkResolution(server);
+  checkModule(server, *squid.getTracker());
+
+  ask(server, "quit", false, "ok");
+  ask(server, "shutdown", false, "ok");
+
+  char pattern[] = "/tmp/testAnalysisServer-XXXXXX";
+  if (!mkdtemp(pattern)) {
+    cerr << "Cannot create a temporary directory: " << strerror(errno) << endl;
+    return EXIT_FAILURE;
+  }
+  string socketPath = string(pattern) + "/server.sock";
+  bool served = false;
+  std::thread serverThread([&]() { served = server.run(socketPath); });
+  checkFraming(socketPath);
+  serverThread.join();
+  check(served, "the server stops cleanly after a shutdown");
+  rmdir(pattern);
+
+  if (failures == 0) cout << "All analysis server tests passed" << endl;
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+// Checks that the CMSSW XML export does not depend on the way the Extractor
+// runs: the files written with the layers and discs analysed concurrently
+// and with the composite cache must be the same, byte for byte, as those
+// analysed in sequence or without the cache. Only the generation date of
+// the headers may differ.
+// Usage: testCMSSWExport <geometry file>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+
+#include <Squid.h>
+#include <StopWatch.h>
+#include <mainConfigHandler.h>
+#include <tk2CMSSW.h>
+
+using namespace std;
+namespace bfs = boost::filesystem;
+
+int failures = 0;
+
+// A translator whose extractor can be set up by the test
+class Translator : public insur::tk2CMSSW {
+public:
+  Translator(bool concurrent, bool cached) : tk2CMSSW(mainConfigHandler::instance()) {
+    ex.setConcurrentAnalysis(concurrent);
+    ex.setCompositeCache(cached);
+  }
+};
+
+// Reads a whole file, without the lines that hold the generation date
+string readOutput(const bfs::path& file) {
+  ifstream in(file.string().c_str(), ios::binary);
+  string content, line;
+  while (getline(in, line)) {
+    if (line.find("generation date: ") != string::npos) continue;
+    content += line + "\n";
+  }
+  return content;
+}
+
+set<string> listFiles(const bfs::path& dir) {
+  set<string> names;
+  if (!bfs::is_directory(dir)) return names;
+  for (bfs::directory_iterator it(dir); it != bfs::directory_iterator(); ++it) {
+    if (bfs::is_regular_file(it->status())) names.insert(it->path().filename().string());
+  }
+  return names;
+}
+
+// Compares the files of two output directories, reporting the first differing line of each file
+void compareOutputs(const bfs::path& reference, const bfs::path& other, const string& what) {
+  set<string> names = listFiles(reference);
+  if (names.empty()) {
+    cerr << what << ": nothing was written to " << reference << endl;
+    failures++;
+    return;
+  }
+  if (names != listFiles(other)) {
+    cerr << what << ": the files in " << reference << " and " << other << " are not the same" << endl;
+    failures++;
+  }
+  for (const string& name : names) {
+    string expected = readOutput(reference / name), found = readOutput(other / name);
+    if (expected == found) continue;
+    size_t at = 0;
+    while (at < expected.size() && at < found.size() && expected[at] == found[at]) at++;
+    size_t line = 1;
+    for (size_t i = 0; i < at; i++) if (expected[i] == '\n') line++;
+    cerr << what << ": " << name << " differs from line " << line << endl;
+    failures++;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    cerr << "Usage: " << argv[0] << " <geometry file>" << endl;
+    return EXIT_FAILURE;
+  }
+
+  StopWatch::instance()->setVerbosity(0, false);
+  insur::Squid squid;
+  squid.setGeometryFile(argv[1]);
+  if (!squid.buildTracker() || !squid.buildMaterials() || !squid.createMaterialBudget()) {
+    cerr << "Could not build the material model for " << argv[1] << endl;
+    return EXIT_FAILURE;
+  }
+
+  // the outputs go next to the skeleton files, in directories of their own
+  bfs::path xmlDirectory = mainConfigHandler::instance().getXmlDirectory();
+  string prefix = "testCMSSWExport-" + to_string(getpid()) + "-";
+  string concurrentDir = prefix + "concurrent", sequentialDir = prefix + "sequential", uncachedDir = prefix + "uncached";
+
+  Translator concurrent(true, true);
+  concurrent.translate(squid.getMaterialTable(), *squid.getMaterialBudget(), concurrentDir);
+  Translator sequential(false, true);
+  sequential.translate(squid.getMaterialTable(), *squid.getMaterialBudget(), sequentialDir);
+  Translator uncached(true, false);
+  uncached.translate(squid.getMaterialTable(), *squid.getMaterialBudget(), uncachedDir);
+
+  compareOutputs(xmlDirectory / concurrentDir, xmlDirectory / sequentialDir, "sequential analysis");
+  compareOutputs(xmlDirectory / concurrentDir, xmlDirectory / uncachedDir, "no composite cache");
+
+  bfs::remove_all(xmlDirectory / concurrentDir);
+  bfs::remove_all(xmlDirectory / sequentialDir);
+  bfs::remove_all(xmlDirectory / uncachedDir);
+
+  if (failures == 0) cout << "All CMSSW export tests passed" << endl;
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,145 @@
+// Checks FlatHisto as the Hough transform uses it: the per-thread partial
+// histograms, merged in the order of the events, must hold the same SmartBin
+// values as one histogram filled in sequence, and the text they serialize
+// must be read back by Histo with the same bins
+// Usage: testFlatHisto
+
+#include <HoughTrack.h>
+
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+typedef FlatHisto<4, SmartBin, uint16_t> HoughHisto;
+
+int failures = 0;
+
+struct Fill {
+  double coords[4];
+  SmartBin bin;
+};
+
+// A few hits per event, in a coarse binning so that many events stack in the same bins,
+// with some of them in the underflow and overflow
+vector<vector<Fill> > makeEvents(int count) {
+  mt19937 generator(12345);
+  uniform_real_distribution<double> coord(-0.2, 1.2);
+  uniform_int_distribution<int> hits(1, 12), hitid(0, 15);
+  vector<vector<Fill> > events(count);
+  for (int evid = 0; evid < count; evid++) {
+    for (int h = hits(generator); h > 0; h--) {
+      Fill fill;
+      for (int i = 0; i < 4; i++) fill.coords[i] = coord(generator);
+      fill.bin = SmartBin(1, evid, 1 << hitid(generator));
+      events[evid].push_back(fill);
+    }
+  }
+  return events;
+}
+
+void fillEvents(HoughHisto& histo, const vector<vector<Fill> >& events, size_t first, size_t last) {
+  for (size_t e = first; e < last; e++) {
+    for (const Fill& fill : events[e]) histo.fill(fill.coords, fill.bin);
+  }
+}
+
+map<vector<double>, SmartBin> contents(const HoughHisto& histo) {
+  map<vector<double>, SmartBin> bins;
+  for (HoughHisto::const_iterator it = histo.begin(); it != histo.end(); ++it) {
+    vector<double> key;
+    for (int i = 0; i < 4; i++) key.push_back(it->first.at(i));
+    bins[key] = it->second;
+  }
+  return bins;
+}
+
+bool sameBin(const SmartBin& a, const SmartBin& b) {
+  return a.eventid == b.eventid && a.hitmask == b.hitmask && a.count == b.count && a.stacked == b.stacked;
+}
+
+void checkMerged(const HoughHisto& empty, const vector<vector<Fill> >& events, const map<vector<double>, SmartBin>& expected, int numThreads) {
+  size_t eventsPerThread = (events.size() + numThreads - 1)/numThreads;
+  vector<HoughHisto> partials(numThreads, empty);
+  vector<future<void> > jobs;
+  for (int t = 0; t < numThreads; t++) {
+    jobs.push_back(async(launch::async, [&, t]() {
+      size_t first = min(events.size(), t*eventsPerThread);
+      fillEvents(partials[t], events, first, min(events.size(), first + eventsPerThread));
+    }));
+  }
+  HoughHisto merged(empty);
+  for (int t = 0; t < numThreads; t++) {
+    jobs[t].get();
+    merged.merge(partials[t], [](SmartBin& bin, const SmartBin& later) { bin.merge(later); });
+  }
+
+  map<vector<double>, SmartBin> found = contents(merged);
+  if (found.size() != expected.size()) {
+    cerr << numThreads << " threads: " << found.size() << " bins, expected " << expected.size() << endl;
+    failures++;
+    return;
+  }
+  int wrong = 0;
+  for (map<vector<double>, SmartBin>::const_iterator it = expected.begin(); it != expected.end(); ++it) {
+    map<vector<double>, SmartBin>::const_iterator other = found.find(it->first);
+    if (other == found.end() || !sameBin(it->second, other->second)) wrong++;
+  }
+  if (wrong) {
+    cerr << numThreads << " threads: " << wrong << " bins differ from the sequential filling" << endl;
+    failures++;
+  }
+}
+
+void checkReadByHisto(HoughHisto& flat) {
+  stringstream text;
+  flat.serialize(text);
+  Histo<4, int, BinKey<4, uint16_t> > histo(text);
+
+  for (int i = 0; i < 4; i++) {
+    if (histo.getNbins(i) != flat.getNbins(i) || histo.getLo(i) != flat.getLo(i) || histo.getHi(i) != flat.getHi(i)) {
+      cerr << "Histo read another binning for dimension " << i << endl;
+      failures++;
+    }
+  }
+  if (histo.size() != flat.size()) {
+    cerr << "Histo read " << histo.size() << " bins, expected " << flat.size() << endl;
+    failures++;
+  }
+  map<vector<double>, SmartBin> expected = contents(flat);
+  int wrong = 0;
+  for (Histo<4, int, BinKey<4, uint16_t> >::const_iterator it = histo.begin(); it != histo.end(); ++it) {
+    vector<double> key;
+    for (int i = 0; i < 4; i++) key.push_back((*it).first.at(i));
+    map<vector<double>, SmartBin>::const_iterator bin = expected.find(key);
+    if (bin == expected.end() || int(bin->second) != (*it).second) wrong++;
+  }
+  if (wrong) {
+    cerr << "Histo read " << wrong << " bins with other keys or counts" << endl;
+    failures++;
+  }
+}
+
+int main() {
+  int nbins[4] = { 10, 8, 6, 10 };
+  double lo[4] = { 0., 0., 0., 0. };
+  double hi[4] = { 1., 1., 1., 1. };
+  HoughHisto empty(nbins, lo, hi);
+  vector<vector<Fill> > events = makeEvents(2000);
+
+  HoughHisto sequential(empty);
+  fillEvents(sequential, events, 0, events.size());
+  map<vector<double>, SmartBin> expected = contents(sequential);
+
+  for (int numThreads : { 1, 2, 3, 8 }) checkMerged(empty, events, expected, numThreads);
+  checkReadByHisto(sequential);
+
+  if (failures == 0) cout << "All FlatHisto tests passed" << endl;
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,135 @@
+// Checks the serializations of Histo: a histogram written as text or as
+// binary must be read back with the same binning, extremes and bins by every
+// bin storage (map, sorted vector and dense array), and a stream that does
+// not hold a valid histogram must be refused
+// Usage: testHisto
+
+#include <Histo.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+typedef Histo<2, double, BinKey<2, unsigned> > MapHisto;
+typedef Histo<2, double, SortedBinKey<2> > SortedHisto;
+typedef Histo<2, double, DenseBinKey<2> > DenseHisto;
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+  if (!condition) {
+    cerr << "Failed: " << what << endl;
+    failures++;
+  }
+}
+
+// The bins as exported keys and values, in the order of the keys
+template<class H> vector<pair<vector<double>, double> > contents(const H& histo) {
+  vector<pair<vector<double>, double> > bins;
+  for (typename H::const_iterator it = histo.begin(); it != histo.end(); ++it) {
+    bins.push_back(make_pair(vector<double>{ (*it).first.at(0), (*it).first.at(1) }, (*it).second));
+  }
+  return bins;
+}
+
+// Weights and coordinates which the text keeps exactly, with some fills in the underflow and overflow
+template<class H> H makeHisto() {
+  int nbins[2] = { 8, 5 };
+  double lo[2] = { -2., 0. };
+  double hi[2] = { 2., 10. };
+  H histo(nbins, lo, hi);
+  for (int i = 0; i < 40; i++) {
+    double coords[2] = { -2.25 + 0.125*i, 0.75*(i % 15) - 0.5 };
+    histo.fill(coords, 0.25*(i % 7) + 0.5);
+  }
+  return histo;
+}
+
+template<class H, class R> void checkSame(const H& written, const R& read, const string& what) {
+  for (int i = 0; i < 2; i++) {
+    check(read.getNbins(i) == written.getNbins(i) && read.getLo(i) == written.getLo(i) && read.getHi(i) == written.getHi(i), what + ": binning");
+  }
+  check(read.minimumValue() == written.minimumValue() && read.maximumValue() == written.maximumValue(), what + ": extremes");
+  check(read.size() == written.size() && contents(read) == contents(written), what + ": bins");
+}
+
+template<class H> string text(H& histo) {
+  ostringstream out;
+  histo.serialize(out);
+  return out.str();
+}
+
+template<class H> string binary(const H& histo) {
+  ostringstream out(ios::out | ios::binary);
+  histo.serializeBinary(out);
+  return out.str();
+}
+
+// Writes a histogram with one storage and reads it back with another
+template<class H, class R> void checkRoundTrips(const string& writer, const string& reader) {
+  H written = makeHisto<H>();
+  istringstream textIn(text(written));
+  R fromText(textIn);
+  checkSame(written, fromText, "text from " + writer + " to " + reader);
+  istringstream binaryIn(binary(written), ios::in | ios::binary);
+  R fromBinary(binaryIn);
+  checkSame(written, fromBinary, "binary from " + writer + " to " + reader);
+}
+
+template<class H> void checkRefused(const string& content, const string& what) {
+  istringstream in(content, ios::in | ios::binary);
+  bool thrown = false;
+  try {
+    H histo(in);
+  } catch (std::runtime_error&) {
+    thrown = true;
+  }
+  check(thrown, what + " refused");
+}
+
+// A failed read leaves the histogram as it was
+template<class H> void checkUnchanged(const string& content, bool binaryRead, const string& what) {
+  H histo = makeHisto<H>();
+  istringstream in(content, ios::in | ios::binary);
+  bool read = binaryRead ? histo.deserializeBinary(in) : histo.deserialize(in);
+  check(!read, what + " not read");
+  checkSame(makeHisto<H>(), histo, what + " leaves the histogram unchanged");
+}
+
+template<class H> void checkInvalid(const string& name) {
+  H histo = makeHisto<H>();
+  string good = text(histo);
+  string goodBinary = binary(histo);
+
+  checkRefused<H>("", name + ": empty stream");
+  checkRefused<H>(good.substr(0, good.size()/2), name + ": truncated text");
+  checkRefused<H>("0 5\r\n-2 0\r\n2 10\r\n0 0\n0\n", name + ": text without bins along a dimension");
+  checkRefused<H>("8 5\r\n2 0\r\n-2 10\r\n0 0\n0\n", name + ": text with an empty range");
+  checkRefused<H>("8 5\r\n-2 0\r\n2 10\r\n0 1\n1\n9 1 1\n", name + ": text with a key out of range");
+  checkRefused<H>("8 5\r\n-2 0\r\n2 10\r\n0 1\n2\n2 1 1\n1 1 1\n", name + ": text with unsorted keys");
+  checkRefused<H>(goodBinary.substr(0, goodBinary.size() - 1), name + ": truncated binary");
+
+  checkUnchanged<H>(good.substr(0, good.size()/2), false, name + ": truncated text");
+  checkUnchanged<H>(goodBinary.substr(0, goodBinary.size() - 1), true, name + ": truncated binary");
+}
+
+int main() {
+  checkRoundTrips<MapHisto, MapHisto>("map", "map");
+  checkRoundTrips<SortedHisto, SortedHisto>("sorted", "sorted");
+  checkRoundTrips<DenseHisto, DenseHisto>("dense", "dense");
+  checkRoundTrips<MapHisto, SortedHisto>("map", "sorted");
+  checkRoundTrips<MapHisto, DenseHisto>("map", "dense");
+  checkRoundTrips<DenseHisto, MapHisto>("dense", "map");
+
+  checkInvalid<MapHisto>("map");
+  checkInvalid<SortedHisto>("sorted");
+  checkInvalid<DenseHisto>("dense");
+
+  if (failures == 0) cout << "All Histo serialization tests passed" << endl;
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,176 @@
+// Checks readInfo against boost::property_tree::info_parser::read_info: on
+// every input both must give the same tree, or the same error with the same
+// file name and line number, leaving the tree they were given untouched
+// Usage: testInfoParser
+
+#include <InfoParser.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+using boost::property_tree::ptree;
+using boost::property_tree::info_parser::info_parser_error;
+
+int failures = 0;
+
+// The tree read, or the error met, by one of the parsers
+struct Outcome {
+  ptree tree;
+  bool failed = false;
+  string message, fileName;
+  unsigned long line = 0;
+};
+
+ptree untouched() {
+  ptree pt;
+  pt.put("untouched", "yes");
+  return pt;
+}
+
+Outcome withBoost(const string& content) {
+  Outcome outcome;
+  outcome.tree = untouched();
+  istringstream is(content);
+  try {
+    boost::property_tree::info_parser::read_info(is, outcome.tree);
+  } catch (info_parser_error& e) {
+    outcome.failed = true;
+    outcome.message = e.message();
+    outcome.fileName = e.filename();
+    outcome.line = e.line();
+  }
+  return outcome;
+}
+
+Outcome withReadInfo(const string& content) {
+  Outcome outcome;
+  outcome.tree = untouched();
+  try {
+    readInfo(content, outcome.tree);
+  } catch (info_parser_error& e) {
+    outcome.failed = true;
+    outcome.message = e.message();
+    outcome.fileName = e.filename();
+    outcome.line = e.line();
+  }
+  return outcome;
+}
+
+string describe(const Outcome& outcome) {
+  if (!outcome.failed) {
+    ostringstream os;
+    boost::property_tree::info_parser::write_info(os, outcome.tree);
+    return "tree\n" + os.str();
+  }
+  ostringstream os;
+  os << "error \"" << outcome.message << "\" in \"" << outcome.fileName << "\" at line " << outcome.line;
+  return os.str();
+}
+
+// Compares both parsers on one input; expectFailure tells whether boost is supposed to refuse it
+void compare(const string& what, const string& content, bool expectFailure) {
+  Outcome expected = withBoost(content);
+  Outcome found = withReadInfo(content);
+  if (expected.failed != expectFailure) {
+    cerr << what << ": boost gave an unexpected " << describe(expected) << endl;
+    failures++;
+  }
+  bool same = expected.failed == found.failed && expected.tree == found.tree;
+  if (expected.failed) same = same && expected.message == found.message && expected.fileName == found.fileName && expected.line == found.line;
+  if (!same) {
+    cerr << what << ": expected " << describe(expected) << endl << "got " << describe(found) << endl;
+    failures++;
+  }
+}
+
+void writeFile(const string& fileName, const string& content) {
+  ofstream out(fileName.c_str(), ios::binary);
+  out << content;
+}
+
+int main() {
+  // Trees
+  compare("empty buffer", "", false);
+  compare("keys and values", "a 1\nb two\nc\n", false);
+  compare("no newline at the end", "a 1\nb 2", false);
+  compare("windows line ends", "a 1\r\nb\r\n{\r\n  c 3\r\n}\r\n", false);
+  compare("nested blocks", "a\n{\n  b 1\n  c\n  {\n    d 2\n  }\n}\ne 3\n", false);
+  compare("blocks on one line", "a { b 1 c { d 2 } } e 3 f { }\n", false);
+  compare("block after data", "a 1 {\n b 2\n}\n", false);
+  compare("repeated keys", "a 1\na 2\na\n{\n a 3\n}\n", false);
+  compare("comments", "; a comment\na 1 ; another\nb ; no data\n  ;\n", false);
+  compare("semicolon ending a word", "a 1;comment\nb;c\n", false);
+  compare("spaces and tabs", " \t a \t 1 \t \n\t\tb\t\"x y\"\t\n", false);
+  compare("quoted keys and values", "\"a key\" \"a value\"\n\"\" \"\"\n\"k\"\n", false);
+
+  // Escapes
+  compare("escapes in quoted strings", "a \"\\a\\b\\f\\n\\r\\t\\v\\\"\\'\\\\\\0x\"\n", false);
+  compare("escapes in words", "a\\tb c\\\\d\n", false);
+  compare("escaped quote at the end of a string", "a \"x\\\\\" b\n", false);
+  compare("unknown escape in a string", "a 1\nb \"\\q\"\n", true);
+  compare("unknown escape in a word", "a 1\nb c\\q\n", true);
+  compare("backslash at the end of a word", "a 1\nb c\\\n", true);
+  compare("unterminated string", "a 1\nb \"open\n", true);
+
+  // Continuations
+  compare("continued value", "a \"one\" \\\n  \"two\" \\\n  \"three\"\nb 2\n", false);
+  compare("continued value with comments", "a \"one\" \\ ; more\n  \"two\" ; done\n", false);
+  compare("continuation without a string", "a \"one\" \\\n  two\n", true);
+  compare("text after a continuation", "a \"one\" \\ two\n\"three\"\n", true);
+  compare("continuation after a quoted key", "\"a\" \\\n", true);
+  compare("continuation after a word", "a one \\\n\"two\"\n", true);
+
+  // Embedded null characters: the rest of their line is ignored
+  compare("null in a value", string("a 1\0ignored\nb 2\n", 16), false);
+  compare("null at the start of a line", string("a 1\n\0b 2\nc 3\n", 13), false);
+  compare("null in an unterminated string", string("a \"x\0\"\nb 2\n", 11), true);
+  compare("null hiding a brace", string("a {\0}\n}\n", 8), false);
+
+  // Unmatched braces
+  compare("unmatched {", "a\n{\n  b 1\n", true);
+  compare("unmatched }", "a 1\n}\n", true);
+  compare("} after data", "a 1 }\n", true);
+  compare("{ without a key", "{\n a 1\n}\n", true);
+  compare("{ after a block", "a { b 1 } {\n}\n", true);
+
+  // Directives, with the include files in a directory of their own
+  char pattern[] = "/tmp/testInfoParser-XXXXXX";
+  if (!mkdtemp(pattern)) {
+    cerr << "Cannot create a temporary directory: " << strerror(errno) << endl;
+    return EXIT_FAILURE;
+  }
+  string directory = pattern;
+  string inner = directory + "/inner.info", outer = directory + "/outer.info", broken = directory + "/broken.info";
+  string outerBroken = directory + "/outerBroken.info";
+  writeFile(inner, "x 1\ny\n{\n  z \"2\"\n}\n");
+  writeFile(outer, "before 0\n#include \"" + inner + "\"\nafter 3\n");
+  writeFile(broken, "x 1\ny \"open\nz 2\n");
+  writeFile(outerBroken, "a\n{\n#include \"" + inner + "\"\n#include \"" + broken + "\"\n}\n");
+
+  compare("include", "a 1\n#include \"" + inner + "\"\nb 2\n", false);
+  compare("include in a block", "a\n{\n  #include \"" + inner + "\"\n}\n", false);
+  compare("comment after an include", "#include \"" + inner + "\" ; comment\n", true);
+  compare("nested include", "a\n{\n#include \"" + outer + "\"\n}\n", false);
+  compare("error in an include file", "a 1\n\n#include \"" + broken + "\"\n", true);
+  compare("error in a nested include file", "b 1\n#include \"" + outerBroken + "\"\n", true);
+  compare("missing include file", "a 1\n#include \"" + directory + "/missing.info\"\n", true);
+  compare("include without quotes", "a 1\n#include " + inner + "\n", true);
+  compare("text after an include", "#include \"" + inner + "\" b\n", true);
+  compare("unknown directive", "a 1\n#define b 2\n", true);
+
+  unlink(inner.c_str());
+  unlink(outer.c_str());
+  unlink(broken.c_str());
+  unlink(outerBroken.c_str());
+  rmdir(directory.c_str());
+
+  if (failures == 0) cout << "All info parser tests passed" << endl;
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
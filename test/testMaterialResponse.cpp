@@ -0,0 +1,142 @@
+// Checks the tabulated material response against the hit finders of the Analyzer
+// Usage: testMaterialResponse <geometry file> [eta bins] [eta max] [tolerance] [samples]
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <TRandom3.h>
+
+#include <Squid.h>
+#include <MaterialResponse.h>
+#include <StopWatch.h>
+
+using namespace std;
+using insur::MaterialResponse;
+using insur::MaterialBudget;
+
+// The material of one track as seen by the material budget scan: tilt-corrected
+// modules, and inactive elements with the shallow crossing correction
+class ReferenceAnalyzer : public insur::Analyzer {
+public:
+  Material material(MaterialBudget& mb, MaterialBudget* pm, double eta, double phi) {
+    double theta = 2 * atan(exp(-eta));
+    Track track;
+    std::map<std::string, Material> components;
+    Material total = analyzeModules(mb.getBarrelModuleCaps(), eta, theta, phi, track, components);
+    total += analyzeModules(mb.getEndcapModuleCaps(), eta, theta, phi, track, components);
+    if (pm) {
+      total += analyzeModules(pm->getBarrelModuleCaps(), eta, theta, phi, track, components, true);
+      total += analyzeModules(pm->getEndcapModuleCaps(), eta, theta, phi, track, components, true);
+    }
+    return total + inactiveMaterial(mb, pm, eta);
+  }
+  Material inactiveMaterial(MaterialBudget& mb, MaterialBudget* pm, double eta) {
+    double theta = 2 * atan(exp(-eta));
+    Track track;
+    Material total = findHitsInactiveSurfaces(mb.getInactiveSurfaces().getBarrelServices(), eta, theta, track);
+    total += findHitsInactiveSurfaces(mb.getInactiveSurfaces().getEndcapServices(), eta, theta, track);
+    total += findHitsInactiveSurfaces(mb.getInactiveSurfaces().getSupports(), eta, theta, track);
+    if (pm) {
+      total += findHitsInactiveSurfaces(pm->getInactiveSurfaces().getBarrelServices(), eta, theta, track, true);
+      total += findHitsInactiveSurfaces(pm->getInactiveSurfaces().getEndcapServices(), eta, theta, track, true);
+      total += findHitsInactiveSurfaces(pm->getInactiveSurfaces().getSupports(), eta, theta, track, true);
+    }
+    return total;
+  }
+};
+
+bool differ(double a, double b) { return fabs(a - b) > 1e-9 * max(fabs(a), fabs(b)); }
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    cerr << "Usage: " << argv[0] << " <geometry file> [eta bins] [eta max] [tolerance] [samples]" << endl;
+    return EXIT_FAILURE;
+  }
+  int etaBins = (argc > 2) ? atoi(argv[2]) : 2000;
+  double etaMax = (argc > 3) ? atof(argv[3]) : 4.0;
+  double tolerance = (argc > 4) ? atof(argv[4]) : 0.01;
+  int samples = (argc > 5) ? atoi(argv[5]) : 1000;
+
+  StopWatch::instance()->setVerbosity(0, false);
+  insur::Squid squid;
+  squid.setGeometryFile(argv[1]);
+  if (!squid.buildTracker() || !squid.buildMaterials() || !squid.createMaterialBudget()) {
+    cerr << "Could not build the material model for " << argv[1] << endl;
+    return EXIT_FAILURE;
+  }
+
+  MaterialBudget& mb = *squid.getMaterialBudget();
+  MaterialBudget* pm = squid.getPixelMaterialBudget();
+  ReferenceAnalyzer reference;
+  int failures = 0;
+
+  // The modules are only crossed at the reference phi of the table: check two of them
+  const double referencePhis[] = { 0., 1.3 };
+  for (double phi : referencePhis) {
+    MaterialResponse response;
+    response.build(mb, pm, etaMax, etaBins, phi);
+
+    // On the grid points the table must give the material of the scan
+    int mismatches = 0;
+    for (int i = 0; i < response.etaBins(); ++i) {
+      double eta = response.binEta(i);
+      Material expected = reference.material(mb, pm, eta, phi);
+      Material tabulated = response.material(eta);
+      if (differ(tabulated.radiation, expected.radiation) || differ(tabulated.interaction, expected.interaction)) {
+        cerr << "Mismatch on grid point eta = " << eta << ", phi = " << phi << ": radiation " << expected.radiation
+             << " (scan), " << tabulated.radiation << " (table), interaction " << expected.interaction
+             << " (scan), " << tabulated.interaction << " (table)" << endl;
+        mismatches++;
+      }
+    }
+
+    // Between grid points the interpolation must stay close to the scan on average:
+    // single tracks can cross module edges, so only the mean deviation is required to be small
+    TRandom3 dice(0xcaffe);
+    double sumDeviation = 0, sumExpected = 0, maxDeviation = 0;
+    for (int i = 0; i < samples; ++i) {
+      double eta = dice.Uniform(0, etaMax);
+      double expected = reference.material(mb, pm, eta, phi).radiation;
+      double deviation = fabs(response.material(eta).radiation - expected);
+      sumDeviation += deviation;
+      sumExpected += expected;
+      if (deviation > maxDeviation) maxDeviation = deviation;
+    }
+    double meanRelativeDeviation = (sumExpected > 0) ? sumDeviation / sumExpected : 0;
+    cout << "phi = " << phi << ": grid points: " << response.etaBins() << ", mismatches: " << mismatches << endl;
+    cout << "phi = " << phi << ": random samples: " << samples << ", mean relative deviation: " << meanRelativeDeviation
+         << ", max absolute deviation: " << maxDeviation << endl;
+    if (meanRelativeDeviation > tolerance) {
+      cerr << "Mean relative deviation above tolerance " << tolerance << endl;
+      failures++;
+    }
+    failures += mismatches;
+  }
+
+  // A table of the inactive surfaces only, as used by the Analyzer scans, gives the same hits on the grid points
+  MaterialResponse inactive;
+  inactive.addInactive(mb, pm);
+  inactive.buildInactive(etaMax, etaBins);
+  int inactiveMismatches = 0;
+  for (int i = 0; i < inactive.etaBins(); ++i) {
+    double eta = inactive.binEta(i);
+    Material expected = reference.inactiveMaterial(mb, pm, eta);
+    Track track;
+    Material filled = inactive.fillTrack(eta, track);
+    size_t crossedEntries = 0;
+    for (int collection = 0; collection < (pm ? 6 : 3); ++collection) crossedEntries += inactive.crossedEntries(eta, collection).size();
+    if (differ(filled.radiation, expected.radiation) || differ(filled.interaction, expected.interaction)
+        || crossedEntries != inactive.crossings(eta).size()) {
+      cerr << "Inactive mismatch on grid point eta = " << eta << ": radiation " << expected.radiation << " (scan), "
+           << filled.radiation << " (table), " << crossedEntries << " crossed entries for "
+           << inactive.crossings(eta).size() << " crossings" << endl;
+      inactiveMismatches++;
+    }
+  }
+  cout << "inactive surfaces: grid points: " << inactive.etaBins() << ", mismatches: " << inactiveMismatches << endl;
+  failures += inactiveMismatches;
+
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
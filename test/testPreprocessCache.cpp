@@ -0,0 +1,130 @@
+// Checks the cache of the included configuration files: every layout
+// expanded with the cache must give the same content and the same list of
+// files as when the cache is emptied first. The layouts share nested
+// @include and @includestd files; one of the standard ones includes a
+// file found through the include path of the layout, so that its expansion
+// differs from one layout to the other. Then some of the files are touched.
+// Usage: testPreprocessCache
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include <mainConfigHandler.h>
+
+using namespace std;
+namespace bfs = boost::filesystem;
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+  if (!condition) {
+    cerr << "Failed: " << what << endl;
+    failures++;
+  }
+}
+
+void writeFile(const bfs::path& file, const string& content) {
+  ofstream out(file.string().c_str());
+  out << content;
+}
+
+// Rewrites a file and moves its modification time forward, for the file systems with a coarse one
+void touchFile(const bfs::path& file, const string& content) {
+  std::time_t before = bfs::last_write_time(file);
+  writeFile(file, content);
+  bfs::last_write_time(file, before + 2);
+}
+
+struct Expansion {
+  string content;
+  set<string> files;
+  bool operator==(const Expansion& other) const { return content == other.content && files == other.files; }
+};
+
+Expansion expand(const bfs::path& layout, bool cached) {
+  mainConfigHandler& handler = mainConfigHandler::instance();
+  if (!cached) handler.clearPreprocessCache();
+  ifstream is(layout.string().c_str());
+  ostringstream os;
+  ConfigInputOutput cfgInOut(is, os);
+  cfgInOut.absoluteFileName = layout.string();
+  cfgInOut.relativeFileName = layout.filename().string();
+  Expansion expansion;
+  expansion.files = handler.preprocessConfiguration(cfgInOut);
+  expansion.content = os.str();
+  return expansion;
+}
+
+void checkExpansion(const Expansion& cached, const bfs::path& layout, const string& expectedLine, const string& what) {
+  check(cached == expand(layout, false), what + ": the cached expansion is the uncached one");
+  check(cached.content.find(expectedLine + "\n") != string::npos, what + ": the expansion holds \"" + expectedLine + "\"");
+}
+
+int main() {
+  char pattern[] = "/tmp/testPreprocessCache-XXXXXX";
+  if (!mkdtemp(pattern)) {
+    cerr << "Cannot create a temporary directory: " << strerror(errno) << endl;
+    return EXIT_FAILURE;
+  }
+  bfs::path root = bfs::canonical(pattern);
+
+  // A configuration of its own, whose standard directory holds the @includestd files
+  bfs::path standard = root / "standard", stdinclude = standard / "config" / "stdinclude";
+  bfs::create_directories(stdinclude);
+  bfs::create_directories(standard / "xml");
+  bfs::create_directories(root / "layouts" / "A");
+  bfs::create_directories(root / "layouts" / "B");
+  writeFile(root / "tkgeometryrc",
+            "TKG_BINDIRECTORY=\"" + root.string() + "\"\n"
+            "TKG_LAYOUTDIRECTORY=\"" + (root / "layouts").string() + "\"\n"
+            "TKG_STANDARDDIRECTORY=\"" + standard.string() + "\"\n"
+            "TKG_MOMENTA=\"1.00, 10.00\"\n"
+            "TKG_TRIGGERMOMENTA=\"1.00\"\n"
+            "TKG_THRESHOLD_PROB=\"0.50\"\n");
+  setenv(CONFIGURATIONFILENAMEDEFINITION, (root / "tkgeometryrc").string().c_str(), 1);
+
+  bfs::path layouts = root / "layouts";
+  writeFile(stdinclude / "common.cfg", "common {\n  @include \"part.cfg\"\n}\n");
+  writeFile(layouts / "A" / "part.cfg", "part A\n");
+  writeFile(layouts / "B" / "part.cfg", "part B, which is longer\n");
+  writeFile(stdinclude / "outer.cfg", "outer {\n  @include-std inner.cfg\n}\n");
+  writeFile(stdinclude / "inner.cfg", "inner 1\n");
+  writeFile(layouts / "A" / "local.cfg", "@includestd \"outer.cfg\"\n");
+  writeFile(layouts / "A" / "layout.cfg", "layout A\n@includestd \"common.cfg\"\n@include \"local.cfg\"\n");
+  writeFile(layouts / "B" / "layout.cfg", "layout B\n@include-std outer.cfg\n@include-std common.cfg\n");
+  bfs::path layoutA = layouts / "A" / "layout.cfg", layoutB = layouts / "B" / "layout.cfg";
+
+  // Everything is cached by the first expansions, before any uncached one
+  mainConfigHandler::instance().clearPreprocessCache();
+  Expansion firstA = expand(layoutA, true);
+  Expansion firstB = expand(layoutB, true);
+  Expansion secondA = expand(layoutA, true);
+  checkExpansion(firstA, layoutA, "  part A", "first expansion of A");
+  checkExpansion(firstB, layoutB, "  part B, which is longer", "expansion of B after A");
+  checkExpansion(secondA, layoutA, "  inner 1", "second expansion of A");
+  check(firstA.files.size() == 6 && firstB.files.size() == 5, "the layouts are made of six and five files");
+
+  // The touched files must be read again, in both the nested standard includes and the include path ones
+  expand(layoutA, true);
+  expand(layoutB, true);
+  touchFile(layouts / "A" / "part.cfg", "part C\n");
+  touchFile(stdinclude / "inner.cfg", "inner 2\n");
+  Expansion touchedA = expand(layoutA, true);
+  Expansion touchedB = expand(layoutB, true);
+  checkExpansion(touchedA, layoutA, "  part C", "expansion of A after a touch");
+  checkExpansion(touchedA, layoutA, "  inner 2", "nested standard include of A after a touch");
+  checkExpansion(touchedB, layoutB, "  inner 2", "expansion of B after a touch");
+
+  bfs::remove_all(root);
+
+  if (failures == 0) cout << "All preprocess cache tests passed" << endl;
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
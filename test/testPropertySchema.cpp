@@ -0,0 +1,76 @@
+#include <Property.h>
+
+#include <iostream>
+#include <set>
+#include <string>
+
+// Checks the compiled property schemas of PropertyObject::store(): the
+// matched keys are given to their property, the checked-only ones are left
+// in the tree, the unknown ones are reported, and an object registering
+// other names gets another schema even if the number of properties is the same
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+  if (!condition) {
+    std::cout << "Failed: " << what << std::endl;
+    failures++;
+  }
+}
+
+PropertyTree makeTree(const std::vector<std::pair<std::string, std::string> >& entries) {
+  PropertyTree pt;
+  for (auto& entry : entries) pt.add(entry.first, entry.second);
+  return pt;
+}
+
+class Matched : public PropertyObject {
+public:
+  Property<int, NoDefault> count;
+  Property<double, Default> width;
+  Property<int, NoDefault> required;
+  Matched() :
+      count("count", parsedAndChecked()),
+      width("width", parsedOnly(), 1.),
+      required("required", checkedOnly()) {}
+  bool inTree(const std::string& key) const { return propertyTree().count(key) > 0; }
+};
+
+// Registers either "before" or "after", so that the sizes of the maps stay the same
+class Switching : public PropertyObject {
+public:
+  Property<int, NoDefault> before;
+  Property<int, NoDefault> after;
+  Switching() : before("before", parsedOnly()), after("after") {}
+  void switchProperties() {
+    parsedOnly().erase("before");
+    parsedOnly()["after"] = &after;
+  }
+};
+
+int main() {
+  Matched matched;
+  matched.store(makeTree({ {"count", "3"}, {"width", "2.5"}, {"required", "7"}, {"unknown", "1"} }));
+  check(matched.count.state() && matched.count() == 3, "parsed and checked property read from the tree");
+  check(matched.width() == 2.5, "parsed property read from the tree");
+  check(!matched.required.state(), "checked-only property not parsed");
+  check(matched.inTree("required"), "checked-only entry left in the tree");
+  check(matched.inTree("unknown"), "unmatched entry left in the tree");
+  check(!matched.inTree("count") && !matched.inTree("width"), "parsed entries removed from the tree");
+
+  Switching switching;
+  switching.store(makeTree({ {"before", "1"} }));
+  check(switching.before.state() && switching.before() == 1, "property registered first read from the tree");
+  switching.switchProperties();
+  switching.store(makeTree({ {"after", "2"} }));
+  check(switching.after.state() && switching.after() == 2, "property registered after a store read from the tree");
+
+  std::set<std::string> unmatched = PropertySchema::reportUnmatched();
+  check(unmatched.count("unknown") == 1, "unknown key reported");
+  for (const char* name : { "count", "width", "required", "before", "after" }) {
+    check(unmatched.count(name) == 0, std::string("registered key ") + name + " not reported");
+  }
+
+  if (failures == 0) std::cout << "All property schema tests passed" << std::endl;
+  return failures == 0 ? 0 : 1;
+}
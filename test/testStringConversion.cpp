@@ -0,0 +1,125 @@
+#include <global_funcs.h>
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Checks that str2any and any2str give, for the arithmetic types, exactly
+// the results of the stream conversions they replace
+
+// A blank text leaves the value of the stream version uninitialized: 0 is expected instead
+template<typename T> T streamStr2any(const std::string& from) {
+  std::stringstream ssfrom(from);
+  T to = T();
+  ssfrom >> to;
+  return to;
+}
+
+template<typename T> std::string streamAny2str(const T& from, int precision = -1) {
+  std::stringstream to("");
+  if (precision > -1) {
+    to.precision(precision);
+    to.setf(std::ios::fixed, std::ios::floatfield);
+  }
+  to << from;
+  return to.str();
+}
+
+template<typename T> bool same(T a, T b) { return a == b || (std::isnan((long double)a) && std::isnan((long double)b)); }
+
+int failures = 0;
+
+template<typename T> void checkParse(const std::string& text, const char* typeName) {
+  T expected = streamStr2any<T>(text);
+  T actual = str2any<T>(text);
+  if (!same(expected, actual)) {
+    if (++failures <= 50) std::cout << "str2any<" << typeName << ">(\"" << text << "\") = " << actual << ", stream gives " << expected << std::endl;
+  }
+}
+
+template<typename T> void checkFormat(T value, int precision, const char* typeName) {
+  std::string expected = streamAny2str(value, precision);
+  std::string actual = any2str(value, precision);
+  if (expected != actual) {
+    if (++failures <= 50) std::cout << "any2str<" << typeName << ">(" << expected << ", " << precision << ") = " << actual << std::endl;
+  }
+}
+
+#define CHECK_PARSE_ALL(text) \
+  checkParse<short>(text, "short"); checkParse<unsigned short>(text, "unsigned short"); \
+  checkParse<int>(text, "int"); checkParse<unsigned int>(text, "unsigned int"); \
+  checkParse<long>(text, "long"); checkParse<unsigned long>(text, "unsigned long"); \
+  checkParse<long long>(text, "long long"); checkParse<unsigned long long>(text, "unsigned long long"); \
+  checkParse<float>(text, "float"); checkParse<double>(text, "double"); checkParse<long double>(text, "long double")
+
+int main(int argc, char* argv[]) {
+  std::vector<std::string> texts = {
+    "", " ", "0", "-0", "+0", "1", "-1", "+1", "  42", "\t\n 42", "42  ", "42abc", "abc", "+", "-", "+-1", "- 1",
+    "007", "0x1A", "1.5", "-1.5", ".5", "-.5", "5.", ".", "-.", "1e3", "1E3", "1e", "1e+", "1e-", "1e+3", "1.e3",
+    ".e3", "e3", "1e3.5", "1.2.3", "1,5", "inf", "-inf", "nan", "INF", "infinity", "1e400", "-1e400", "1e-400",
+    "1e39", "-1e39", "3.4028235e38", "1.17549435e-38", "0.1", "0.30000000000000004", "123456789012345678901234567890",
+    "32767", "32768", "-32768", "-32769", "65535", "65536", "2147483647", "2147483648", "-2147483648", "-2147483649",
+    "4294967295", "4294967296", "9223372036854775807", "9223372036854775808", "-9223372036854775808",
+    "-9223372036854775809", "18446744073709551615", "18446744073709551616", "-18446744073709551615",
+    "00000000000000000000000000001", "0.000000000000000000000000000000000000000000001", "1e0000000000000000000005",
+    "12 34", "2.54cm", "true", "1_000", "\v7", "\f7", "\r7"
+  };
+  for (const auto& text : texts) { CHECK_PARSE_ALL(text); }
+
+  // Random texts made of the characters a number can start with
+  std::mt19937_64 die(12345);
+  const char alphabet[] = " +-.eE0123456789x";
+  for (int i = 0; i < 50000; ++i) {
+    std::string text;
+    int length = die() % 12;
+    for (int j = 0; j < length; ++j) text += alphabet[die() % (sizeof(alphabet) - 1)];
+    CHECK_PARSE_ALL(text);
+  }
+
+  // Random numbers, written by the streams with various precisions
+  std::uniform_real_distribution<double> exponent(-320, 320);
+  for (int i = 0; i < 50000; ++i) {
+    double value = (die() % 2 ? 1 : -1) * pow(10, exponent(die)) * (die() % 1000) / 1000.;
+    int precision = int(die() % 22) - 1;
+    std::string text = streamAny2str(value, precision);
+    checkParse<float>(text, "float"); checkParse<double>(text, "double"); checkParse<long double>(text, "long double");
+    checkFormat(value, precision, "double");
+    checkFormat(float(value), precision, "float");
+    checkFormat((long double)value, precision, "long double");
+    long long integer = (long long)die() >> (die() % 64);
+    checkFormat(integer, precision, "long long");
+    checkFormat(int(integer), precision, "int");
+    checkFormat(short(integer), precision, "short");
+    checkFormat((unsigned long long)integer, precision, "unsigned long long");
+    checkFormat((unsigned)integer, precision, "unsigned int");
+    CHECK_PARSE_ALL(std::to_string(integer));
+    CHECK_PARSE_ALL(std::to_string(-integer));
+  }
+
+  // Limits and special values
+  const double specials[] = { 0., -0., 1., -1., 0.1, 1e300, 1e-300, 4.9e-324, std::numeric_limits<double>::max(),
+                              std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(),
+                              std::numeric_limits<double>::quiet_NaN(), 123456.5, 999999.5, 1234567. };
+  for (double value : specials) {
+    for (int precision = -1; precision < 400; ++precision) {
+      checkFormat(value, precision, "double");
+      checkFormat(float(value), precision, "float");
+    }
+  }
+  checkFormat(std::numeric_limits<long long>::min(), -1, "long long");
+  checkFormat(std::numeric_limits<long long>::max(), -1, "long long");
+  checkFormat(std::numeric_limits<unsigned long long>::max(), -1, "unsigned long long");
+  checkFormat(std::numeric_limits<short>::min(), -1, "short");
+
+  if (failures) {
+    std::cout << failures << " conversions differ from the stream ones" << std::endl;
+    return 1;
+  }
+  std::cout << "All conversions match the stream ones" << std::endl;
+  return 0;
+}
@@ -0,0 +1,95 @@
+#include <WeightDistributionGrid.h>
+
+#include <cmath>
+#include <iostream>
+#include <random>
+
+using material::WeightDistributionGrid;
+
+// Fills two grids with random rectangles, merges them and checks every bin
+// against a single grid filled with all the rectangles, and against the
+// analytic share of each rectangle
+
+struct Rectangle { double minZ, minR, maxZ, maxR, grams; };
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+  if (!condition) {
+    std::cout << "FAILED: " << what << std::endl;
+    failures++;
+  }
+}
+
+bool close(double a, double b) { return fabs(a - b) <= 1e-9 * std::max(1., fabs(a) + fabs(b)); }
+
+// Grams of the rectangle falling in the bin, from the overlap of the areas
+double expectedGrams(const Rectangle& r, double binDimension, int binIndexZ, int binIndexR) {
+  double overlapZ = std::max(0., std::min((binIndexZ + 1) * binDimension, r.maxZ) - std::max(binIndexZ * binDimension, r.minZ));
+  double overlapR = std::max(0., std::min((binIndexR + 1) * binDimension, r.maxR) - std::max(binIndexR * binDimension, r.minR));
+  return r.grams * overlapZ * overlapR / ((r.maxZ - r.minZ) * (r.maxR - r.minR));
+}
+
+int main() {
+  const double binDimension = 10.;
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<double> z(-1500., 1500.), r(0., 1200.), length(0.5, 900.), grams(1., 1000.);
+
+  std::vector<Rectangle> rectangles;
+  for (int i = 0; i < 200; ++i) {
+    Rectangle rect;
+    rect.minZ = z(rng);
+    rect.minR = r(rng);
+    rect.maxZ = rect.minZ + length(rng);
+    rect.maxR = rect.minR + length(rng) / 3;
+    rect.grams = grams(rng);
+    rectangles.push_back(rect);
+  }
+  // A rectangle within one bin, and one straddling z = 0 and several tiles
+  rectangles.push_back(Rectangle{ 1.5, 2.5, 3.5, 4.5, 10. });
+  rectangles.push_back(Rectangle{ -700., 100., 700., 130., 50. });
+
+  WeightDistributionGrid first(binDimension), second(binDimension), all(binDimension);
+  double total = 0;
+  for (size_t i = 0; i < rectangles.size(); ++i) {
+    const Rectangle& rect = rectangles[i];
+    (i % 2 ? second : first).addGrams(rect.minZ, rect.minR, rect.maxZ, rect.maxR, rect.grams);
+    all.addGrams(rect.minZ, rect.minR, rect.maxZ, rect.maxR, rect.grams);
+    total += rect.grams;
+  }
+  first.merge(second);
+
+  check(close(first.totalGrams(), total), "total grams of the merged grid");
+  check(close(all.totalGrams(), total), "total grams of the single grid");
+  check(first.numTiles() == all.numTiles(), "same tiles in the merged and single grids");
+
+  int minBinZ = int(floor(-1500. / binDimension)) - 1, maxBinZ = int(ceil(2400. / binDimension)) + 1;
+  int maxBinR = int(ceil(1500. / binDimension)) + 1;
+  for (int binIndexZ = minBinZ; binIndexZ <= maxBinZ; ++binIndexZ) {
+    for (int binIndexR = -1; binIndexR <= maxBinR; ++binIndexR) {
+      double expected = 0;
+      for (const Rectangle& rect : rectangles) expected += expectedGrams(rect, binDimension, binIndexZ, binIndexR);
+      double merged = first.grams(binIndexZ, binIndexR);
+      if (!close(merged, all.grams(binIndexZ, binIndexR)) || !close(merged, expected)) {
+        std::cout << "bin (" << binIndexZ << ", " << binIndexR << "): merged " << merged
+                  << ", single " << all.grams(binIndexZ, binIndexR) << ", expected " << expected << std::endl;
+        failures++;
+      }
+    }
+  }
+
+  // Only the tiles reached by the material are allocated
+  WeightDistributionGrid small(binDimension);
+  small.addGrams(1.5, 2.5, 3.5, 4.5, 10.);
+  check(small.numTiles() == 1, "a fill within one bin allocates one tile");
+  check(close(small.grams(0, 0), 10.), "a fill within one bin goes to that bin");
+  small.reset();
+  check(small.empty() && small.totalGrams() == 0, "reset empties the grid");
+
+  if (failures) {
+    std::cout << failures << " checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "All weight distribution grid checks passed" << std::endl;
+  return 0;
+}